@@ -41,11 +41,13 @@
 #include "core/heisenberg.hpp"
 #include "core/hubbard.hpp"
 #include "core/integral.hpp"
+#include "core/integral_binary.hpp"
 #include "core/integral_compressed.hpp"
 #include "core/integral_dyall.hpp"
 #include "core/integral_fink.hpp"
 #include "core/integral_general.hpp"
 #include "core/iterative_matrix_functions.hpp"
+#include "core/lz_codec.hpp"
 #include "core/matching.hpp"
 #include "core/matrix.hpp"
 #include "core/matrix_functions.hpp"
@@ -55,7 +57,9 @@
 #include "core/parallel_rule.hpp"
 #include "core/parallel_tensor_functions.hpp"
 #include "core/point_group.hpp"
+#include "core/profiler.hpp"
 #include "core/rule.hpp"
+#include "core/small_gemm.hpp"
 #include "core/sparse_matrix.hpp"
 #include "core/spin_permutation.hpp"
 #include "core/state_info.hpp"
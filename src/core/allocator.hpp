@@ -24,16 +24,25 @@
 #pragma once
 
 #include "fp_codec.hpp"
+#include "lz_codec.hpp"
+#include "profiler.hpp"
 #include "utils.hpp"
 #ifdef _HAS_TBB
 #include "tbb/scalable_allocator.h"
 #endif
 #include <algorithm>
+#include <array>
+#include <atomic>
 #ifndef __EMSCRIPTEN__
 #ifdef __unix__
 #include <execinfo.h>
 #endif
 #endif
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define _HAS_MMAP_SCRATCH
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 #include <cassert>
 #include <complex>
 #include <cstdint>
@@ -42,9 +51,12 @@
 #include <functional>
 #include <future>
 #include <iostream>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -288,6 +300,302 @@ template <typename T> struct VectorAllocator : Allocator<T> {
     }
 };
 
+/** Statistics of the arena allocator (in Bytes), shared by all
+ * ArenaAllocator instances of the same element type. */
+struct ArenaStats {
+    size_t used = 0;      //!< Size of blocks currently handed out.
+    size_t requested = 0; //!< Size requested by the currently live blocks.
+    size_t peak_used = 0; //!< High-water mark of used.
+    size_t cached = 0;    //!< Size of free blocks kept in thread caches.
+    size_t n_allocs = 0;  //!< Total number of allocations.
+    size_t n_reuses = 0;  //!< Number of allocations served from a cache.
+    /** Fraction of the used memory that is lost to size class rounding.
+     * @return The internal fragmentation ratio.
+     */
+    double fragmentation() const {
+        return used == 0 ? 0.0 : 1.0 - (double)requested / used;
+    }
+    friend ostream &operator<<(ostream &os, const ArenaStats &c) {
+        os << "ARENA USED=" << Parsing::to_size_string(c.used)
+           << " PEAK=" << Parsing::to_size_string(c.peak_used)
+           << " CACHED=" << Parsing::to_size_string(c.cached)
+           << " FRAG=" << fixed << setprecision(3) << c.fragmentation()
+           << " N-ALLOC=" << c.n_allocs << " N-REUSE=" << c.n_reuses;
+        return os;
+    }
+};
+
+/** Size-class pool allocator for temporary arrays.
+ * Blocks are rounded up to one of four size classes per power of two and
+ * freed blocks are kept in a per-thread cache, so that deallocation can
+ * happen in arbitrary order in O(1) time, and repeated allocations of
+ * similar sizes (e.g. in Davidson iterations and in different sweep
+ * iterations) do not go to the system allocator. Blocks still allocated
+ * when the allocator is destroyed are returned to the pool automatically.
+ * Allocated memory is zero-initialized, as for VectorAllocator.
+ * @tparam T The type of the element in the array.
+ */
+template <typename T> struct ArenaAllocator : Allocator<T> {
+    static const int n_classes = 256; //!< Number of size classes.
+    /** Per-thread cache of free blocks, indexed by size class. */
+    struct ThreadCache {
+        array<vector<T *>, n_classes> blocks; //!< Free blocks.
+        size_t cached = 0; //!< Number of elements in the free blocks.
+        size_t epoch = 0;  //!< Value of cache_epoch when last released.
+        bool valid = true; //!< Whether the cache is not yet destroyed.
+        ~ThreadCache() {
+            for (int c = 0; c < n_classes; c++)
+                for (T *p : blocks[c]) {
+                    stats_data().cached -= class_size(c) * sizeof(T);
+                    delete[] p;
+                }
+            valid = false;
+        }
+    };
+    /** Global statistics, updated atomically. */
+    struct AtomicStats {
+        atomic<size_t> used{0}, requested{0}, peak_used{0}, cached{0},
+            n_allocs{0}, n_reuses{0};
+    };
+    mutex mtx; //!< Mutex guarding the set of live blocks.
+    unordered_map<T *, pair<int, size_t>>
+        live; //!< Live blocks and their size class and requested size.
+    /** Default constructor. */
+    ArenaAllocator() {}
+    /** Destructor. Return all live blocks to the pool. */
+    ~ArenaAllocator() override {
+        for (auto &r : live)
+            release(r.first, r.second.first, r.second.second);
+    }
+    /** Maximal size of the free blocks kept in the cache of each thread (in
+     * Bytes). Free blocks exceeding this limit are returned to the system.
+     * @return Reference to the limit.
+     */
+    static atomic<size_t> &max_thread_cache() {
+        static atomic<size_t> x{(size_t)1 << 26};
+        return x;
+    }
+    /** Maximal total size of the free blocks kept in the caches of all
+     * threads (in Bytes). Free blocks exceeding this limit are returned to
+     * the system.
+     * @return Reference to the limit.
+     */
+    static atomic<size_t> &max_total_cache() {
+        static atomic<size_t> x{(size_t)1 << 28};
+        return x;
+    }
+    /** Get the size class for an array of n elements.
+     * Class c has size (4 + c % 4) * 2^(c / 4 + 2).
+     * @param n Number of elements in the array.
+     * @return The size class.
+     */
+    static int size_class(size_t n) {
+        int k = 2;
+        while (((size_t)8 << k) < n)
+            k++;
+        int j = (int)((n + ((size_t)1 << k) - 1) >> k) - 4;
+        if (j < 0)
+            j = 0;
+        else if (j == 4)
+            k++, j = 0;
+        return 4 * (k - 2) + j;
+    }
+    /** Get the number of elements in blocks of a size class.
+     * @param c The size class.
+     * @return Number of elements.
+     */
+    static size_t class_size(int c) {
+        return (size_t)(4 + c % 4) << (c / 4 + 2);
+    }
+    /** Get a snapshot of the global statistics.
+     * @return The statistics.
+     */
+    static ArenaStats stats() {
+        const AtomicStats &st = stats_data();
+        ArenaStats r;
+        r.used = st.used, r.requested = st.requested;
+        r.peak_used = st.peak_used, r.cached = st.cached;
+        r.n_allocs = st.n_allocs, r.n_reuses = st.n_reuses;
+        return r;
+    }
+    /** Reset the high-water mark and allocation counters. */
+    static void reset_stats() {
+        AtomicStats &st = stats_data();
+        st.peak_used = (size_t)st.used;
+        st.n_allocs = 0, st.n_reuses = 0;
+    }
+    /** Return all free blocks in the cache of the calling thread to the
+     * system. */
+    static void release_thread_cache() {
+        ThreadCache &tc = thread_cache();
+        if (!tc.valid)
+            return;
+        for (int c = 0; c < n_classes; c++) {
+            for (T *p : tc.blocks[c])
+                delete[] p;
+            stats_data().cached -= tc.blocks[c].size() * class_size(c) *
+                                   sizeof(T);
+            tc.blocks[c].clear();
+        }
+        tc.cached = 0;
+        tc.epoch = cache_epoch();
+    }
+    /** Return the free blocks in the caches of all threads to the system.
+     * Caches of the threads in an OpenMP team of n_threads threads are
+     * released immediately. Caches of other threads are released when these
+     * threads next use the allocator. Invoked after each solve (see
+     * EffectiveHamiltonian::deallocate), so that cached blocks are not
+     * kept between sites.
+     * @param n_threads Number of threads in the OpenMP team (if zero, the
+     *   default number of threads is used).
+     */
+    static void release_all_thread_caches(int n_threads = 0) {
+        cache_epoch()++;
+        release_thread_cache();
+        if (n_threads > 0) {
+#pragma omp parallel num_threads(n_threads)
+            release_thread_cache();
+        } else {
+#pragma omp parallel
+            release_thread_cache();
+        }
+    }
+    /** Allocate a length n array.
+     * @param n Number of elements in the array.
+     * @return The allocated pointer.
+     */
+    T *allocate(size_t n) override {
+        int c = size_class(n);
+        T *p = acquire(c, n);
+        lock_guard<mutex> lock(mtx);
+        live[p] = make_pair(c, n);
+        return p;
+    }
+    /** Deallocate a length n array. Can be invoked in arbitrary order.
+     * @param ptr The pointer to be deallocated.
+     * @param n Number of elements in the array.
+     */
+    void deallocate(void *ptr, size_t n) override {
+        pair<int, size_t> cn;
+        {
+            lock_guard<mutex> lock(mtx);
+            auto it = live.find((T *)ptr);
+            if (it == live.end()) {
+                cout << "deallocation of unallocated address" << endl;
+                abort();
+            }
+            cn = it->second;
+            live.erase(it);
+        }
+        release((T *)ptr, cn.first, cn.second);
+    }
+    /** Change the allocated size for one allocated block.
+     * The pointer is unchanged if the block is large enough.
+     * @param ptr The allocated pointer.
+     * @param n Number of elements in original allocation.
+     * @param new_n Number of elements in the new allocation.
+     * @return The new pointer.
+     */
+    T *reallocate(T *ptr, size_t n, size_t new_n) override {
+        pair<int, size_t> cn;
+        {
+            lock_guard<mutex> lock(mtx);
+            auto it = live.find(ptr);
+            if (it == live.end()) {
+                cout << "reallocation of unallocated address" << endl;
+                abort();
+            }
+            cn = it->second;
+            if (new_n <= class_size(cn.first)) {
+                if (new_n > cn.second)
+                    memset(ptr + cn.second, 0,
+                           sizeof(T) * (new_n - cn.second));
+                stats_data().requested += sizeof(T) * new_n;
+                stats_data().requested -= sizeof(T) * cn.second;
+                it->second.second = new_n;
+                return ptr;
+            }
+        }
+        T *new_ptr = allocate(new_n);
+        memcpy(new_ptr, ptr, sizeof(T) * min(cn.second, new_n));
+        deallocate(ptr, n);
+        return new_ptr;
+    }
+    /** Return a copy of the allocator. The copy shares the pool but has an
+     * independent set of live blocks.
+     * @return The copy of this allocator.
+     */
+    shared_ptr<Allocator<T>> copy() const override {
+        return make_shared<ArenaAllocator<T>>();
+    }
+    /** Print the status of the allocator.
+     * @param os The output stream.
+     * @param c The object to be printed.
+     * @return The output stream.
+     */
+    friend ostream &operator<<(ostream &os, const ArenaAllocator &c) {
+        os << "N-ALLOCATED=" << c.live.size() << " " << stats() << endl;
+        return os;
+    }
+
+  private:
+    static AtomicStats &stats_data() {
+        static AtomicStats st;
+        return st;
+    }
+    static atomic<size_t> &cache_epoch() {
+        static atomic<size_t> x{0};
+        return x;
+    }
+    static ThreadCache &thread_cache() {
+        static thread_local ThreadCache tc;
+        return tc;
+    }
+    // cache of the calling thread, released first if outdated
+    static ThreadCache &current_thread_cache() {
+        ThreadCache &tc = thread_cache();
+        if (tc.valid && tc.epoch != cache_epoch())
+            release_thread_cache();
+        return tc;
+    }
+    static T *acquire(int c, size_t n) {
+        AtomicStats &st = stats_data();
+        ThreadCache &tc = current_thread_cache();
+        const size_t sz = class_size(c);
+        T *p = nullptr;
+        if (tc.valid && tc.blocks[c].size() != 0) {
+            p = tc.blocks[c].back();
+            tc.blocks[c].pop_back();
+            tc.cached -= sz;
+            st.cached -= sz * sizeof(T);
+            st.n_reuses++;
+        } else
+            p = new T[sz];
+        memset(p, 0, sizeof(T) * n);
+        st.n_allocs++;
+        st.requested += n * sizeof(T);
+        size_t used = (st.used += sz * sizeof(T));
+        size_t peak = st.peak_used;
+        while (used > peak && !st.peak_used.compare_exchange_weak(peak, used))
+            ;
+        return p;
+    }
+    static void release(T *p, int c, size_t n) {
+        AtomicStats &st = stats_data();
+        ThreadCache &tc = current_thread_cache();
+        const size_t sz = class_size(c);
+        st.used -= sz * sizeof(T);
+        st.requested -= n * sizeof(T);
+        if (tc.valid && (tc.cached + sz) * sizeof(T) <= max_thread_cache() &&
+            st.cached + sz * sizeof(T) <= max_total_cache()) {
+            tc.blocks[c].push_back(p);
+            tc.cached += sz;
+            st.cached += sz * sizeof(T);
+        } else
+            delete[] p;
+    }
+};
+
 #ifdef _USE_GLOBAL_VARIABLE
 
 extern shared_ptr<StackAllocator<uint32_t>> _g_ialloc;
@@ -329,6 +637,14 @@ template <typename FL> inline shared_ptr<StackAllocator<FL>> &dalloc_() {
 /** Global variable for the integer stack memory allocator. */
 #define ialloc (ialloc_())
 
+/** Memory placement policy of data frame stacks on NUMA machines. */
+enum struct NUMATypes : uint8_t {
+    None = 0,       //!< Default (first-touch) placement.
+    Interleave = 1, //!< Pages of all stacks are interleaved over all sockets.
+    Frames = 2 //!< Stacks of frame ``i`` are preferably placed on socket ``i
+               //!< % n_sockets``.
+};
+
 /** DataFrame includes several (n_frames = 2) frames.
  * Each frame includes one integer stack memory and one double stack memory.
  * The two frames are used alternatively to avoid data copying. */
@@ -356,6 +672,29 @@ template <typename FL> struct DataFrame {
             //!< with sweep index as suffix.
     size_t save_dir_quota = 0; //!< Disk quota for save_dir (in bytes).
     string alt_save_dir = ""; //!< Alternative scartch folder.
+    bool tiered_scratch =
+        false; //!< If false, new renormalized operator files are written to
+               //!< alt_save_dir once save_dir_quota is exceeded. If true, new
+               //!< files are always written to save_dir and the files farthest
+               //!< from the sweep front are moved to alt_save_dir instead.
+    size_t scratch_cache_size =
+        0; //!< Byte budget of the in-memory LRU cache of scratch files. Saved
+           //!< data frames are kept in the cache (and also written to disk),
+           //!< so that loading them again does not need disk access. If zero,
+           //!< the cache is not used.
+    mutable size_t scratch_cache_used = 0; //!< Bytes used by the cache.
+    mutable size_t n_cache_hits = 0, //!< Number of loads served by the cache.
+        n_cache_misses = 0,          //!< Number of loads not in the cache.
+        n_cache_evictions = 0, //!< Number of files evicted from the cache.
+        n_spills = 0;          //!< Number of files moved to alt_save_dir.
+    mutable list<pair<string, pair<shared_ptr<stringstream>, size_t>>>
+        scratch_cache;
+    //!< In-memory LRU cache of scratch files (most recently used first).
+    //!< Each entry contains the filename, the file contents and its size.
+    mutable unordered_map<
+        string,
+        list<pair<string, pair<shared_ptr<stringstream>, size_t>>>::iterator>
+        scratch_cache_index; //!< Filename to cache entry map.
     string prefix = "F", //!< Filename prefix for common scratch files (such as
                          //!< MPS tensors).
         prefix_distri =
@@ -374,7 +713,7 @@ template <typename FL> struct DataFrame {
         i_frame;              //!< The index of Current activated data frame.
     mutable double tread = 0, //!< IO Time cost for reading scratch files.
         twrite = 0,           //!< IO Time cost for writing scratch files.
-        tasync = 0;           //!< IO Time cost for async writing scratch files.
+        tasync = 0; //!< IO Time cost for async reading/writing scratch files.
     mutable double fpread = 0, //!< IO Time cost for reading scratch files with
                                //!< floating-point decompression.
         fpwrite = 0;           //!< IO Time cost for writing scratch files with
@@ -399,13 +738,23 @@ template <typename FL> struct DataFrame {
     //!< the contents of the file with that filename is in the loading buffer.
     mutable vector<pair<string, shared_ptr<stringstream>>> save_buffers;
     //!< Buffers for async saving.
-    mutable vector<shared_future<void>> save_futures;
-    //!< Async saving files.
+    mutable vector<shared_future<double>> save_futures;
+    //!< Async saving files (the result is the time cost).
+    mutable vector<
+        pair<string, shared_future<pair<shared_ptr<stringstream>, double>>>>
+        prefetch_buffers;
+    //!< Buffers for async loading of files that will be loaded soon.
     bool load_buffering = false, //!< Whether load buffering should be used. If
                                  //!< true, memory usage will increase.
         save_buffering =
             false; //!< Whether async saving and saving buffering should be
                    //!< used. If true, memory usage will increase.
+    bool prefetch_buffering =
+        false; //!< Whether files hinted by prefetch_data should be read
+               //!< asynchronously into memory buffers (at most n_frames
+               //!< files), so that disk latency is hidden behind computation.
+               //!< If true, memory usage will increase. Not used when
+               //!< mmap_scratch is effective.
     bool use_main_stack =
         true; //!< Whether main stack should be used for storing blocked
               //!< operators in enlarged blocks. If false, these blocked
@@ -417,13 +766,30 @@ template <typename FL> struct DataFrame {
     bool minimal_memory_usage =
         false; //!< Whether MPO should be build in minimal memory mode by saving
                //!< intermediates to disk. In this mode, MPO should have
-               //!< different tags.
+               //!< different tags. For GeneralMPO this is a partial memory
+               //!< reduction: the terms of GeneralFCIDUMP stay in memory.
     bool compressed_sparse_tensor_storage =
         false; //!< Whether block-sparse tensor should be stored in compressed
                //!< form to save storage (mainly for MPS).
     shared_ptr<FPCodec<FL>> fp_codec =
         nullptr; //!< Floating-point compression codec. If nullptr,
                  //!< floating-point compression will not be used.
+    shared_ptr<LZCodec> lz_codec =
+        nullptr; //!< Lossless compression codec for scratch files and (when
+                 //!< fp_codec is nullptr) compressed block-sparse tensors. If
+                 //!< fp_codec is also set, fp_codec is used for the double
+                 //!< stacks and lz_codec is only used for the integer stacks.
+    bool mmap_scratch =
+        false; //!< Whether scratch files of data frames should be saved in a
+               //!< page-aligned layout and loaded by memory-mapping the file
+               //!< directly into the stack memory (copy-on-write), instead of
+               //!< reading through file streams. Ignored when fp_codec or
+               //!< lz_codec is used or when memory mapping is not supported.
+    static const size_t mmap_magic =
+        0x4d4d4150324b4c42ULL; //!< Header tag of page-aligned scratch files.
+    NUMATypes numa_type =
+        NUMATypes::None; //!< Memory placement policy of the stacks on NUMA
+                         //!< machines. Set it using set_numa_policy.
     /** Constructor.
      * @param isize Max size (in bytes) of all integer stacks.
      * @param dsize Max size (in bytes) of all double stacks.
@@ -450,7 +816,12 @@ template <typename FL> struct DataFrame {
         size_t dmain = (size_t)(dmain_ratio * this->dsize);
         size_t ir = (this->isize - imain) / (n_frames - 1);
         size_t dr = (this->dsize - dmain) / (n_frames - 1);
-        FL *dptr = new FL[this->dsize];
+        // make every double stack start at a page boundary
+        // so that scratch files can be mapped into the stack memory
+        const size_t pe = page_size() / sizeof(FL);
+        if (dmain >= pe && dr >= pe)
+            dmain = dmain / pe * pe, dr = dr / pe * pe;
+        FL *dptr = allocate_stack_memory(this->dsize);
         uint32_t *iptr = new uint32_t[this->isize];
         iallocs.push_back(make_shared<StackAllocator<uint32_t>>(iptr, imain));
         dallocs.push_back(make_shared<StackAllocator<FL>>(dptr, dmain));
@@ -495,42 +866,489 @@ template <typename FL> struct DataFrame {
      */
     void reset_buffer(int i) {
         load_buffers[i] = make_pair("", nullptr);
-        if (save_buffering && save_futures[i].valid())
-            save_futures[i].wait();
+        join_save(i);
         save_buffers[i] = make_pair("", nullptr);
+        for (size_t j = 0; j < prefetch_buffers.size(); j++)
+            join_prefetch(j, true);
+        prefetch_buffers.clear();
     }
-    /** Rename one scratch file.
+    /** Wait for the async saving in one data frame, if there is any.
+     * The time cost of the async task is only added to tasync here (in the
+     * calling thread), to avoid data race among async tasks.
+     * @param i The index of the data frame.
+     */
+    void join_save(int i) const {
+        if (save_futures[i].valid()) {
+            tasync += save_futures[i].get();
+            save_futures[i] = shared_future<double>();
+        }
+    }
+    /** Wait for one async prefetching task.
+     * @param j The index in prefetch_buffers.
+     * @param discard If true, the contents are not needed, and errors in
+     *   reading the file are ignored.
+     * @return The buffer stream with file contents.
+     */
+    shared_ptr<stringstream> join_prefetch(size_t j,
+                                           bool discard = false) const {
+        pair<shared_ptr<stringstream>, double> r(nullptr, 0.0);
+        if (!prefetch_buffers[j].second.valid())
+            return nullptr;
+        if (!discard)
+            r = prefetch_buffers[j].second.get();
+        else {
+            try {
+                r = prefetch_buffers[j].second.get();
+            } catch (...) {
+            }
+        }
+        tasync += r.second;
+        prefetch_buffers[j].second =
+            shared_future<pair<shared_ptr<stringstream>, double>>();
+        return r.first;
+    }
+    /** Discard the prefetched contents of one file, if there is any.
+     * @param filename The filename.
+     */
+    void discard_prefetch(const string &filename) const {
+        for (size_t j = 0; j < prefetch_buffers.size(); j++)
+            if (prefetch_buffers[j].first == filename) {
+                join_prefetch(j, true);
+                prefetch_buffers.erase(prefetch_buffers.begin() + j);
+                return;
+            }
+    }
+    /** Wait for the pending async saving of one file, if there is any.
+     * @param filename The filename.
+     */
+    void wait_save(const string &filename) const {
+        for (int i = 0; i < (int)save_buffers.size(); i++)
+            if (save_buffers[i].first == filename)
+                join_save(i);
+    }
+    /** Wait for the pending async saving of one file, if there is any, and
+     * remove it from the saving buffers, so that an older write cannot
+     * overwrite newer contents of the same file.
+     * @param filename The filename.
+     */
+    void discard_save(const string &filename) const {
+        for (int i = 0; i < (int)save_buffers.size(); i++)
+            if (save_buffers[i].first == filename) {
+                join_save(i);
+                save_buffers[i] = make_pair("", nullptr);
+            }
+    }
+    /** Size of a buffer stream.
+     * @param ss The buffer stream.
+     * @return The number of bytes in the stream.
+     */
+    static size_t buffer_size(const shared_ptr<stringstream> &ss) {
+        ss->seekp(0, ios::end);
+        return (size_t)ss->tellp();
+    }
+    /** Remove the cached contents of one file, if there is any.
+     * @param filename The filename.
+     */
+    void discard_cache(const string &filename) const {
+        auto it = scratch_cache_index.find(filename);
+        if (it == scratch_cache_index.end())
+            return;
+        scratch_cache_used -= it->second->second.second;
+        scratch_cache.erase(it->second);
+        scratch_cache_index.erase(it);
+    }
+    /** Put the contents of one file into the in-memory cache, evicting the
+     * least recently used files if the cache exceeds scratch_cache_size.
+     * Must not be called when the stream is being written by another thread.
+     * @param filename The filename.
+     * @param ss The buffer stream with file contents.
+     */
+    void insert_cache(const string &filename,
+                      const shared_ptr<stringstream> &ss) const {
+        discard_cache(filename);
+        const size_t sz = buffer_size(ss);
+        if (sz > scratch_cache_size)
+            return;
+        scratch_cache.push_front(make_pair(filename, make_pair(ss, sz)));
+        scratch_cache_index[filename] = scratch_cache.begin();
+        scratch_cache_used += sz;
+        while (scratch_cache_used > scratch_cache_size) {
+            scratch_cache_used -= scratch_cache.back().second.second;
+            scratch_cache_index.erase(scratch_cache.back().first);
+            scratch_cache.pop_back();
+            n_cache_evictions++;
+        }
+    }
+    /** Find the contents of one file in the in-memory cache and mark it as
+     * the most recently used one. Entries for files that no longer exist
+     * on disk are discarded.
+     * @param filename The filename.
+     * @return The buffer stream or nullptr if the file is not cached.
+     */
+    shared_ptr<stringstream> find_cache(const string &filename) const {
+        auto it = scratch_cache_index.find(filename);
+        if (it == scratch_cache_index.end())
+            return nullptr;
+        else if (!Parsing::file_exists(filename)) {
+            discard_cache(filename);
+            return nullptr;
+        }
+        scratch_cache.splice(scratch_cache.begin(), scratch_cache, it->second);
+        // the stream may still be used for async saving
+        wait_save(filename);
+        return it->second->second.first;
+    }
+    /** Remove all contents in the in-memory cache. */
+    void clear_cache() const {
+        scratch_cache.clear();
+        scratch_cache_index.clear();
+        scratch_cache_used = 0;
+    }
+    /** Rename one scratch file. If the two files are on different
+     * file systems, the file is copied and the original file is removed.
      * @param old_filename original filename.
      * @param new_filename new filename.
      */
     void rename_data(const string &old_filename,
                      const string &new_filename) const {
-        if (!Parsing::rename_file(old_filename, new_filename))
-            throw runtime_error("Renaming '" + old_filename + "' to '" +
-                                new_filename + "' failed.");
+        discard_prefetch(old_filename);
+        discard_prefetch(new_filename);
+        discard_cache(new_filename);
+        discard_save(old_filename);
+        discard_save(new_filename);
+        if (!Parsing::rename_file(old_filename, new_filename)) {
+            if (!Parsing::file_exists(old_filename))
+                throw runtime_error("Renaming '" + old_filename + "' to '" +
+                                    new_filename + "' failed.");
+            if (Parsing::link_exists(new_filename) ||
+                Parsing::file_exists(new_filename))
+                Parsing::remove_file(new_filename);
+            Parsing::copy_file(old_filename, new_filename);
+            Parsing::remove_file(old_filename);
+        }
+        auto it = scratch_cache_index.find(old_filename);
+        if (it != scratch_cache_index.end()) {
+            auto cit = it->second;
+            scratch_cache_index.erase(it);
+            cit->first = new_filename;
+            scratch_cache_index[new_filename] = cit;
+        }
         for (auto &fn : present_filenames)
             fn = "";
     }
+    /** Move one scratch file from save_dir to alt_save_dir.
+     * @param filename The filename in save_dir.
+     * @return The new filename in alt_save_dir.
+     */
+    string spill_data(const string &filename) const {
+        const string new_filename =
+            alt_save_dir + "/" + Parsing::get_filename(filename);
+        if (!Parsing::path_exists(alt_save_dir))
+            Parsing::mkdir(alt_save_dir);
+        rename_data(filename, new_filename);
+        n_spills++;
+        return new_filename;
+    }
+    /** Remove one scratch file, together with its pending async saving,
+     * prefetched and cached contents.
+     * @param filename The filename.
+     */
+    void remove_data(const string &filename) const {
+        discard_prefetch(filename);
+        discard_cache(filename);
+        discard_save(filename);
+        if (Parsing::link_exists(filename) || Parsing::file_exists(filename))
+            Parsing::remove_file(filename);
+        for (auto &fn : present_filenames)
+            if (fn == filename)
+                fn = "";
+    }
     /** Load one data frame from input stream.
      * @param i The index of the data frame.
      * @param ifs The input stream.
      */
     void load_data_from(int i, istream &ifs) const {
-        ifs.read((char *)&iallocs[i]->used, sizeof(iallocs[i]->used));
-        ifs.read((char *)&dallocs[i]->used, sizeof(dallocs[i]->used));
-        ifs.read((char *)iallocs[i]->data, sizeof(uint32_t) * iallocs[i]->used);
+        size_t hdr[4];
+        ifs.read((char *)&hdr[0], sizeof(size_t));
+        if (hdr[0] == mmap_magic) {
+            // page-aligned layout written by save_aligned_data_to
+            ifs.read((char *)&hdr[1], sizeof(size_t) * 3);
+            iallocs[i]->used = hdr[2], dallocs[i]->used = hdr[3];
+            ifs.read((char *)iallocs[i]->data,
+                     sizeof(uint32_t) * iallocs[i]->used);
+            size_t off = sizeof(hdr) + sizeof(uint32_t) * iallocs[i]->used;
+            ifs.ignore((hdr[1] - off % hdr[1]) % hdr[1]);
+        } else {
+            iallocs[i]->used = hdr[0];
+            ifs.read((char *)&dallocs[i]->used, sizeof(dallocs[i]->used));
+            if (lz_codec != nullptr)
+                lz_codec->read_array(ifs, iallocs[i]->data, iallocs[i]->used);
+            else
+                ifs.read((char *)iallocs[i]->data,
+                         sizeof(uint32_t) * iallocs[i]->used);
+        }
         _t2.get_time();
-        if (fp_codec != nullptr)
+        // page-aligned layout is never compressed
+        if (hdr[0] != mmap_magic && fp_codec != nullptr)
             fp_codec->read_array(ifs, dallocs[i]->data, dallocs[i]->used);
+        else if (hdr[0] != mmap_magic && lz_codec != nullptr)
+            lz_codec->read_array(ifs, dallocs[i]->data, dallocs[i]->used);
         else
             ifs.read((char *)dallocs[i]->data, sizeof(FL) * dallocs[i]->used);
         fpread += _t2.get_time();
     }
+    /** Get the size of the memory page used for memory-mapped files.
+     * @return The page size in bytes.
+     */
+    static size_t page_size() {
+#ifdef _HAS_MMAP_SCRATCH
+        return (size_t)sysconf(_SC_PAGESIZE);
+#else
+        return 4096;
+#endif
+    }
+    /** Allocate memory for double stacks. When memory mapping is supported,
+     * the memory is obtained from an anonymous mapping so that it starts at a
+     * page boundary.
+     * @param n Number of elements.
+     * @return The allocated pointer.
+     */
+    static FL *allocate_stack_memory(size_t n) {
+#ifdef _HAS_MMAP_SCRATCH
+        void *ptr = mmap(nullptr, sizeof(FL) * n, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw runtime_error("DataFrame::allocate_stack_memory failed.");
+        return (FL *)ptr;
+#else
+        return new FL[n];
+#endif
+    }
+    /** Deallocate memory for double stacks.
+     * @param ptr The pointer returned by allocate_stack_memory.
+     * @param n Number of elements.
+     */
+    static void deallocate_stack_memory(FL *ptr, size_t n) {
+#ifdef _HAS_MMAP_SCRATCH
+        munmap(ptr, sizeof(FL) * n);
+#else
+        delete[] ptr;
+#endif
+    }
+    /** Set the memory placement policy of stack memory on NUMA machines.
+     * Pages already touched are migrated if possible. Only effective on Linux.
+     * @param t The NUMA memory policy.
+     * @return false if the policy cannot be applied.
+     */
+    bool set_numa_policy(NUMATypes t) {
+        numa_type = t;
+        bool ok = true;
+        for (int i = 0; i < n_frames; i++) {
+            ok = bind_memory(dallocs[i]->data, sizeof(FL) * dallocs[i]->size,
+                             i) &&
+                 ok;
+            ok = bind_memory(iallocs[i]->data,
+                             sizeof(uint32_t) * iallocs[i]->size, i) &&
+                 ok;
+        }
+        return ok;
+    }
+    /** Apply the NUMA memory policy to a memory range of one data frame.
+     * Only whole pages inside the range are affected.
+     * @param ptr Start of the memory range.
+     * @param len Length of the memory range in bytes.
+     * @param i The index of the data frame.
+     * @return false if the policy cannot be applied.
+     */
+    bool bind_memory(void *ptr, size_t len, int i) const {
+#ifdef _HAS_NUMA_AFFINITY
+        const size_t pg = page_size();
+        size_t st = ((size_t)ptr + pg - 1) / pg * pg;
+        size_t ed = ((size_t)ptr + len) / pg * pg;
+        if (ed <= st)
+            return true;
+        const auto &topo = Threading::numa_topology();
+        // numa modes and flags from linux/mempolicy.h
+        const int mpol_default = 0, mpol_preferred = 1, mpol_interleave = 3;
+        const unsigned mpol_mf_move = 1U << 1;
+        const size_t nbits = sizeof(unsigned long) * 8, maxnode = 1024;
+        vector<unsigned long> mask(maxnode / nbits, 0);
+        int mode = mpol_default;
+        if (numa_type == NUMATypes::Interleave) {
+            mode = mpol_interleave;
+            for (const auto &node : topo)
+                mask[node.first / nbits] |= 1UL << (node.first % nbits);
+        } else if (numa_type == NUMATypes::Frames) {
+            mode = mpol_preferred;
+            const int node = topo[i % topo.size()].first;
+            mask[node / nbits] |= 1UL << (node % nbits);
+        }
+        return syscall(SYS_mbind, st, ed - st, mode,
+                       mode == mpol_default ? nullptr : mask.data(),
+                       mode == mpol_default ? 0 : maxnode + 1,
+                       mpol_mf_move) == 0;
+#else
+        return false;
+#endif
+    }
+    /** Save one data frame into output stream, using the page-aligned layout
+     * for memory-mapped loading. The layout is: a header of four size_t
+     * (magic tag, alignment, integer stack size, double stack size), the
+     * integer stack, zero padding, and the double stack starting at an offset
+     * that is a multiple of the alignment.
+     * @param i The index of the data frame.
+     * @param ofs The output stream.
+     */
+    void save_aligned_data_to(int i, ostream &ofs) const {
+        const size_t align = page_size();
+        size_t hdr[4] = {mmap_magic, align, iallocs[i]->used, dallocs[i]->used};
+        ofs.write((char *)hdr, sizeof(hdr));
+        ofs.write((char *)iallocs[i]->data,
+                  sizeof(uint32_t) * iallocs[i]->used);
+        size_t off = sizeof(hdr) + sizeof(uint32_t) * iallocs[i]->used;
+        vector<char> pad((align - off % align) % align, 0);
+        ofs.write(pad.data(), pad.size());
+        ofs.write((char *)dallocs[i]->data, sizeof(FL) * dallocs[i]->used);
+    }
+    /** Load one data frame from a file with the page-aligned layout. When the
+     * double stack of the data frame is page-aligned, the payload is mapped
+     * into the stack memory (private copy-on-write mapping), so that no data
+     * copying happens and pages are read on demand. Otherwise, the payload is
+     * read with positioned reads.
+     * @param i The index of the data frame.
+     * @param filename The filename for the data frame.
+     * @return false if the file does not have the page-aligned layout, in
+     * which case nothing is loaded.
+     */
+    bool load_mapped_data(int i, const string &filename) const {
+#ifdef _HAS_MMAP_SCRATCH
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw runtime_error("DataFrame::load_data on '" + filename +
+                                "' failed.");
+        size_t hdr[4];
+        if (pread(fd, hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+            hdr[0] != mmap_magic) {
+            close(fd);
+            return false;
+        }
+        const size_t align = hdr[1], ilen = sizeof(uint32_t) * hdr[2];
+        const size_t dlen = sizeof(FL) * hdr[3];
+        const size_t doff = (sizeof(hdr) + ilen + align - 1) / align * align;
+        const size_t mlen = (dlen + align - 1) / align * align;
+        bool ok = hdr[2] <= iallocs[i]->size && hdr[3] <= dallocs[i]->size &&
+                  pread(fd, iallocs[i]->data, ilen, sizeof(hdr)) ==
+                      (ssize_t)ilen;
+        if (ok && dlen != 0) {
+            _t2.get_time();
+            if (align == page_size() &&
+                (size_t)dallocs[i]->data % align == 0 &&
+                mlen <= sizeof(FL) * dallocs[i]->size) {
+                void *ptr = mmap(dallocs[i]->data, mlen, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_FIXED, fd, (off_t)doff);
+                ok = ptr == (void *)dallocs[i]->data;
+                // the new mapping does not inherit the memory policy
+                if (ok && numa_type != NUMATypes::None)
+                    bind_memory(ptr, mlen, i);
+                if (ok)
+                    madvise(ptr, mlen, MADV_WILLNEED);
+            } else
+                ok = pread(fd, dallocs[i]->data, dlen, (off_t)doff) ==
+                     (ssize_t)dlen;
+            fpread += _t2.get_time();
+        }
+        close(fd);
+        if (!ok)
+            throw runtime_error("DataFrame::load_data on '" + filename +
+                                "' failed.");
+        iallocs[i]->used = hdr[2];
+        dallocs[i]->used = hdr[3];
+        return true;
+#else
+        return false;
+#endif
+    }
+    /** Read the whole file into a buffer stream.
+     * @param filename The filename.
+     * @param tasync Pointer to the time recorder for async loading.
+     * @return The buffer stream.
+     */
+    static shared_ptr<stringstream> buffer_load_data(const string &filename,
+                                                     double *tasync) {
+        Timer tx;
+        tx.get_time();
+        shared_ptr<stringstream> ss = make_shared<stringstream>();
+        ifstream ifs(filename.c_str(), ios::binary);
+        if (!ifs.good())
+            throw runtime_error("DataFrame::buffer_load_data on '" +
+                                filename + "' failed.");
+        *ss << ifs.rdbuf();
+        if (ifs.fail() || ifs.bad())
+            throw runtime_error("DataFrame::buffer_load_data on '" +
+                                filename + "' failed.");
+        ifs.close();
+        *tasync += tx.get_time();
+        return ss;
+    }
+    /** Hint that one scratch file will be loaded soon. When mmap_scratch is
+     * true, the kernel is asked to start reading the file into page cache
+     * asynchronously. Otherwise, if prefetch_buffering is true, the file is
+     * read into a memory buffer in a background thread and load_data will
+     * take the contents from the buffer. Otherwise, nothing happens.
+     * @param filename The filename for the data frame.
+     */
+    void prefetch_data(const string &filename) const {
+        for (auto &fn : present_filenames)
+            if (fn == filename)
+                return;
+        if (scratch_cache_index.count(filename))
+            return;
+#ifdef _HAS_MMAP_SCRATCH
+        if (mmap_scratch && fp_codec == nullptr && lz_codec == nullptr) {
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd == -1)
+                return;
+#ifdef POSIX_FADV_WILLNEED
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+            close(fd);
+            return;
+        }
+#endif
+        if (!prefetch_buffering)
+            return;
+        for (int i = 0; i < n_frames; i++)
+            if (load_buffers[i].first == filename ||
+                save_buffers[i].first == filename)
+                return;
+        for (auto &pb : prefetch_buffers)
+            if (pb.first == filename)
+                return;
+        if (!Parsing::file_exists(filename))
+            return;
+        if ((int)prefetch_buffers.size() >= n_frames) {
+            join_prefetch(0, true);
+            prefetch_buffers.erase(prefetch_buffers.begin());
+        }
+        // each task records its own time cost, which is added to tasync
+        // when the task is joined
+        prefetch_buffers.push_back(make_pair(
+            filename, async(launch::async,
+                            [](const string &fn) {
+                                double tx = 0;
+                                shared_ptr<stringstream> ss =
+                                    buffer_load_data(fn, &tx);
+                                return make_pair(ss, tx);
+                            },
+                            filename)
+                          .share()));
+    }
     /** Load one data frame from disk.
      * @param i The index of the data frame.
      * @param filename The filename for the data frame.
      */
     void load_data(int i, const string &filename) const {
+        ProfileScope ps("DataFrame::load_data");
         _t.get_time();
         if (present_filenames[i] == filename) {
             return;
@@ -550,16 +1368,66 @@ template <typename FL> struct DataFrame {
             save_data_to(i, *ss);
             load_buffers[i] = make_pair(present_filenames[i], ss);
         }
+        // the file may be written asynchronously from any data frame
+        wait_save(filename);
         if (save_buffers[i].first == filename) {
-            if (save_futures[i].valid())
-                save_futures[i].wait();
-            save_buffers[i].second->clear();
-            save_buffers[i].second->seekg(0);
-            load_data_from(i, *save_buffers[i].second);
+            if (!(mmap_scratch && load_mapped_data(i, filename))) {
+                save_buffers[i].second->clear();
+                save_buffers[i].second->seekg(0);
+                load_data_from(i, *save_buffers[i].second);
+            }
             present_filenames[i] = filename;
             tread += _t.get_time();
             return;
         }
+        if (scratch_cache_size != 0) {
+            shared_ptr<stringstream> ss = find_cache(filename);
+            if (ss != nullptr) {
+                n_cache_hits++;
+                ss->clear();
+                ss->seekg(0);
+                load_data_from(i, *ss);
+                tread += _t.get_time();
+                update_peak_used_memory();
+                present_filenames[i] = filename;
+                return;
+            }
+            n_cache_misses++;
+        }
+        for (size_t j = 0; j < prefetch_buffers.size(); j++)
+            if (prefetch_buffers[j].first == filename) {
+                shared_ptr<stringstream> ss = join_prefetch(j);
+                prefetch_buffers.erase(prefetch_buffers.begin() + j);
+                load_data_from(i, *ss);
+                if (ss->fail() || ss->bad())
+                    throw runtime_error("DataFrame::load_data on '" +
+                                        filename + "' failed.");
+                if (scratch_cache_size != 0)
+                    insert_cache(filename, ss);
+                tread += _t.get_time();
+                update_peak_used_memory();
+                present_filenames[i] = filename;
+                return;
+            }
+        if (mmap_scratch && load_mapped_data(i, filename)) {
+            tread += _t.get_time();
+            update_peak_used_memory();
+            present_filenames[i] = filename;
+            return;
+        }
+        if (scratch_cache_size != 0) {
+            double tx = 0;
+            shared_ptr<stringstream> ss = buffer_load_data(filename, &tx);
+            load_data_from(i, *ss);
+            if (ss->fail() || ss->bad())
+                throw runtime_error("DataFrame::load_data on '" + filename +
+                                    "' failed.");
+            insert_cache(filename, ss);
+            tread += _t.get_time();
+            update_peak_used_memory();
+            present_filenames[i] = filename;
+            return;
+        }
         ifstream ifs(filename.c_str(), ios::binary);
         if (!ifs.good())
             throw runtime_error("DataFrame::load_data on '" + filename +
@@ -580,11 +1448,16 @@ template <typename FL> struct DataFrame {
     void save_data_to(int i, ostream &ofs) const {
         ofs.write((char *)&iallocs[i]->used, sizeof(iallocs[i]->used));
         ofs.write((char *)&dallocs[i]->used, sizeof(dallocs[i]->used));
-        ofs.write((char *)iallocs[i]->data,
-                  sizeof(uint32_t) * iallocs[i]->used);
+        if (lz_codec != nullptr)
+            lz_codec->write_array(ofs, iallocs[i]->data, iallocs[i]->used);
+        else
+            ofs.write((char *)iallocs[i]->data,
+                      sizeof(uint32_t) * iallocs[i]->used);
         _t2.get_time();
         if (fp_codec != nullptr)
             fp_codec->write_array(ofs, dallocs[i]->data, dallocs[i]->used);
+        else if (lz_codec != nullptr)
+            lz_codec->write_array(ofs, dallocs[i]->data, dallocs[i]->used);
         else
             ofs.write((char *)dallocs[i]->data, sizeof(FL) * dallocs[i]->used);
         fpwrite += _t2.get_time();
@@ -619,32 +1492,67 @@ template <typename FL> struct DataFrame {
      * @param filename The filename for the data frame.
      */
     void save_data(int i, const string &filename) const {
+        ProfileScope ps("DataFrame::save_data");
         if (!partition_can_write) {
             update_peak_used_memory();
             present_filenames[i] = filename;
             return;
         }
         _t.get_time();
+        discard_prefetch(filename);
+        discard_cache(filename);
+        discard_save(filename);
+        const bool aligned =
+            mmap_scratch && fp_codec == nullptr && lz_codec == nullptr;
+        // the file may be mapped in some data frames
+        // so it must be replaced rather than overwritten
+        if (Parsing::link_exists(filename) || Parsing::file_exists(filename))
+            Parsing::remove_file(filename);
         if (save_buffering) {
-            if (save_futures[i].valid())
-                save_futures[i].wait();
+            join_save(i);
             shared_ptr<stringstream> ss = make_shared<stringstream>();
-            save_data_to(i, *ss);
+            if (aligned)
+                save_aligned_data_to(i, *ss);
+            else
+                save_data_to(i, *ss);
+            if (scratch_cache_size != 0)
+                insert_cache(filename, ss);
             save_buffers[i] = make_pair(filename, ss);
-            save_futures[i] = async(launch::async, &DataFrame::buffer_save_data,
-                                    filename, ss, &tasync);
+            save_futures[i] = async(
+                launch::async,
+                [](const string &fn, const shared_ptr<stringstream> &xss) {
+                    double tx = 0;
+                    buffer_save_data(fn, xss, &tx);
+                    return tx;
+                },
+                filename, ss);
+            twrite += _t.get_time();
+            update_peak_used_memory();
+            present_filenames[i] = filename;
+            return;
+        } else if (scratch_cache_size != 0) {
+            // write-through: the same buffer is cached and saved
+            shared_ptr<stringstream> ss = make_shared<stringstream>();
+            if (aligned)
+                save_aligned_data_to(i, *ss);
+            else
+                save_data_to(i, *ss);
+            double tx = 0;
+            buffer_save_data(filename, ss, &tx);
+            insert_cache(filename, ss);
             twrite += _t.get_time();
             update_peak_used_memory();
             present_filenames[i] = filename;
             return;
         }
-        if (Parsing::link_exists(filename))
-            Parsing::remove_file(filename);
         ofstream ofs(filename.c_str(), ios::binary);
         if (!ofs.good())
             throw runtime_error("DataFrame::save_data on '" + filename +
                                 "' failed.");
-        save_data_to(i, ofs);
+        if (aligned)
+            save_aligned_data_to(i, ofs);
+        else
+            save_data_to(i, ofs);
         if (!ofs.good())
             throw runtime_error("DataFrame::save_data on '" + filename +
                                 "' failed.");
@@ -658,13 +1566,20 @@ template <typename FL> struct DataFrame {
      */
     void deallocate() {
         delete[] iallocs[0]->data;
-        delete[] dallocs[0]->data;
+        deallocate_stack_memory(dallocs[0]->data, dsize);
         iallocs.clear();
         dallocs.clear();
-        if (save_buffering)
-            for (const auto &ft : save_futures)
-                if (ft.valid())
-                    ft.wait();
+        // errors in async saving cannot be reported here
+        for (int i = 0; i < (int)save_futures.size(); i++) {
+            try {
+                join_save(i);
+            } catch (...) {
+            }
+        }
+        for (size_t j = 0; j < prefetch_buffers.size(); j++)
+            join_prefetch(j, true);
+        prefetch_buffers.clear();
+        clear_cache();
     }
     /** Return the current used memory in all stacks.
      * @return The current used memory in Bytes.
@@ -700,11 +1615,24 @@ template <typename FL> struct DataFrame {
            << " MinDiskUsage = " << df.minimal_disk_usage
            << " MinMemUsage = " << df.minimal_memory_usage
            << " IBuf = " << df.load_buffering << " OBuf = " << df.save_buffering
-           << endl;
+           << " MMap = " << df.mmap_scratch
+           << " PBuf = " << df.prefetch_buffering
+           << " NUMA = " << (int)df.numa_type << endl;
         if (df.fp_codec != nullptr)
             os << " FPCompression: prec = " << scientific << setprecision(2)
                << df.fp_codec->prec << " chunk = " << fixed
                << df.fp_codec->chunk_size << endl;
+        if (df.lz_codec != nullptr)
+            os << " LZCompression: chunk = " << df.lz_codec->chunk_size
+               << " shuffle = " << df.lz_codec->shuffle << endl;
+        if (df.scratch_cache_size != 0 || df.tiered_scratch)
+            os << " ScratchTiers: cache = "
+               << Parsing::to_size_string(df.scratch_cache_used) << " / "
+               << Parsing::to_size_string(df.scratch_cache_size)
+               << " hits = " << df.n_cache_hits
+               << " misses = " << df.n_cache_misses
+               << " evictions = " << df.n_cache_evictions
+               << " spills = " << df.n_spills << endl;
         os << " IMain = " << Parsing::to_size_string(df.iallocs[0]->used * 4)
            << " / " << Parsing::to_size_string(df.iallocs[0]->size * 4);
         os << " DMain = "
@@ -23,16 +23,20 @@
 #include "complex_matrix_functions.hpp"
 #include "matrix.hpp"
 #include "matrix_functions.hpp"
+#include "small_gemm.hpp"
 #include "threading.hpp"
 #ifdef _HAS_INTEL_MKL
 #include "mkl.h"
 #endif
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -161,6 +165,25 @@ inline void cblas_xgemm_batch<complex<float>>(
 
 #endif
 
+// Compute one row-major gemm using SmallGEMM microkernels if it is tiny
+// returns false if the gemm should be computed by BLAS
+template <typename FL>
+inline bool small_xgemm(const CBLAS_TRANSPOSE TransA,
+                        const CBLAS_TRANSPOSE TransB, MKL_INT m, MKL_INT n,
+                        MKL_INT k, FL alpha, const FL *A, MKL_INT lda,
+                        const FL *B, MKL_INT ldb, FL beta, FL *C, MKL_INT ldc) {
+    // conjugation is only a no-op for real numbers
+    const bool cpx = !is_floating_point<FL>::value;
+    if (!SmallGEMM<FL>::is_small(m, n, k, threading->small_gemm_size) ||
+        (cpx && (TransA > CblasTrans || TransB > CblasTrans)))
+        return false;
+    const bool ta = TransA == CblasTrans || TransA == CblasConjTrans;
+    const bool tb = TransB == CblasTrans || TransB == CblasConjTrans;
+    SmallGEMM<FL>::multiply(ta, tb, m, n, k, alpha, A, lda, B, ldb, beta, C,
+                            ldc);
+    return true;
+}
+
 template <typename FL>
 inline void threaded_xgemm_batch(
     const CBLAS_LAYOUT Layout, const CBLAS_TRANSPOSE *TransA_Array,
@@ -179,8 +202,7 @@ inline void threaded_xgemm_batch(
         i += gsize;
     }
     int ntq = threading->activate_quanta();
-#pragma omp parallel for schedule(dynamic) num_threads(ntq)
-    for (MKL_INT i = 0; i < (int)gidxs.size(); i++) {
+    auto f = [&](int tid, size_t i) {
         const MKL_INT ig = gidxs[i];
         const char *tra =
             TransA_Array[ig] == CblasNoTrans
@@ -199,8 +221,24 @@ inline void threaded_xgemm_batch(
         const MKL_INT lda = lda_Array[ig], ldb = ldb_Array[ig],
                       ldc = ldc_Array[ig];
         const MKL_INT gsize = group_size[ig];
-        xgemm<FL>(trb, tra, &n, &m, &k, &alpha, B_Array[i], &ldb, A_Array[i],
-                  &lda, &beta, C_Array[i], &ldc);
+        if (!small_xgemm<FL>(TransA_Array[ig], TransB_Array[ig], m, n, k,
+                             alpha, A_Array[i], lda, B_Array[i], ldb, beta,
+                             C_Array[i], ldc))
+            xgemm<FL>(trb, tra, &n, &m, &k, &alpha, B_Array[i], &ldb,
+                      A_Array[i], &lda, &beta, C_Array[i], &ldc);
+    };
+    if (threading->work_stealing) {
+        // cost hint of each gemm is m * n * k
+        vector<uint64_t> costs = threading->task_costs(
+            gidxs.size(), [&gidxs, M_Array, N_Array, K_Array](size_t i) {
+                const MKL_INT ig = gidxs[i];
+                return (uint64_t)M_Array[ig] * N_Array[ig] * K_Array[ig];
+            });
+        TaskScheduler::run(ntq, gidxs.size(), costs, f);
+    } else {
+#pragma omp parallel for schedule(dynamic) num_threads(ntq)
+        for (MKL_INT i = 0; i < (int)gidxs.size(); i++)
+            f(0, (size_t)i);
     }
 }
 
@@ -230,7 +268,10 @@ single_xgemm(const CBLAS_LAYOUT Layout, const CBLAS_TRANSPOSE *TransA_Array,
     const FL alpha = alpha_Array[ig] * scale, beta = beta_Array[ig];
     const MKL_INT lda = lda_Array[ig], ldb = ldb_Array[ig], ldc = ldc_Array[ig];
     const MKL_INT gsize = group_size[ig];
-    xgemm<FL>(trb, tra, &n, &m, &k, &alpha, B, &ldb, A, &lda, &beta, C, &ldc);
+    if (!small_xgemm<FL>(TransA_Array[ig], TransB_Array[ig], m, n, k, alpha, A,
+                         lda, B, ldb, beta, C, ldc))
+        xgemm<FL>(trb, tra, &n, &m, &k, &alpha, B, &ldb, A, &lda, &beta, C,
+                  &ldc);
 }
 
 // The parameters for a series of DGEMM operations
@@ -336,10 +377,13 @@ template <typename FL> struct BatchGEMM {
                     cfactor, c.data, c.n);
     }
     // Execute DGEMM operation groups from index ii to ii + nn
-    void perform(MKL_INT ii = 0, MKL_INT kk = 0, MKL_INT nn = 0) {
+    // impl: -1 = depending on threading type, 0 = grouped, 1 = threaded
+    void perform(MKL_INT ii = 0, MKL_INT kk = 0, MKL_INT nn = 0,
+                 int impl = -1) {
         if (nn != 0 || gp.size() != 0) {
 #ifndef _HAS_BLIS
-            if (threading->type & ThreadingTypes::Quanta)
+            if (impl == 1 ||
+                (impl == -1 && (threading->type & ThreadingTypes::Quanta)))
 #endif
                 threaded_xgemm_batch<FL>(
                     layout, &ta[ii], &tb[ii], &m[ii], &n[ii], &k[ii],
@@ -348,14 +392,38 @@ template <typename FL> struct BatchGEMM {
                     &gp[ii]);
 #ifndef _HAS_BLIS
             else
-                cblas_xgemm_batch<FL>(
-                    layout, &ta[ii], &tb[ii], &m[ii], &n[ii], &k[ii],
-                    &alpha[ii], &a[kk], &lda[ii], &b[kk], &ldb[ii], &beta[ii],
-                    &c[kk], &ldc[ii], nn == 0 ? (MKL_INT)gp.size() : nn,
-                    &gp[ii]);
+                perform_grouped(ii, kk, nn == 0 ? (MKL_INT)gp.size() : nn);
 #endif
         }
     }
+    // Execute DGEMM operation groups from index ii to ii + nn
+    // using grouped BLAS batch, where consecutive groups of tiny gemm
+    // are computed by SmallGEMM microkernels
+    void perform_grouped(MKL_INT ii, MKL_INT kk, MKL_INT nn) {
+        const int max_dim = threading->small_gemm_size;
+        for (MKL_INT ig = ii, ik = kk; ig < ii + nn;) {
+            MKL_INT jg = ig, jk = ik;
+            for (; jg < ii + nn && !is_small_group(jg, max_dim); jg++)
+                jk += gp[jg];
+            if (jg != ig)
+                cblas_xgemm_batch<FL>(layout, &ta[ig], &tb[ig], &m[ig], &n[ig],
+                                      &k[ig], &alpha[ig], &a[ik], &lda[ig],
+                                      &b[ik], &ldb[ig], &beta[ig], &c[ik],
+                                      &ldc[ig], jg - ig, &gp[ig]);
+            for (; jg < ii + nn && is_small_group(jg, max_dim); jg++)
+                for (MKL_INT j = 0; j < gp[jg]; j++, jk++)
+                    small_xgemm<FL>(ta[jg], tb[jg], m[jg], n[jg], k[jg],
+                                    alpha[jg], a[jk], lda[jg], b[jk], ldb[jg],
+                                    beta[jg], c[jk], ldc[jg]);
+            ig = jg, ik = jk;
+        }
+    }
+    // Whether gemm in group ig can be computed by SmallGEMM microkernels
+    bool is_small_group(MKL_INT ig, int max_dim) const {
+        return SmallGEMM<FL>::is_small(m[ig], n[ig], k[ig], max_dim) &&
+               (is_floating_point<FL>::value ||
+                (ta[ig] <= CblasTrans && tb[ig] <= CblasTrans));
+    }
     inline void perform_single(MKL_INT ii, const FL *a, const FL *b, FL *c,
                                FL scale = 1.0) {
         single_xgemm<FL>(layout, &ta[ii], &tb[ii], &m[ii], &n[ii], &k[ii],
@@ -408,9 +476,9 @@ template <typename FL> struct BatchGEMMRef {
     BatchGEMMRef(const shared_ptr<BatchGEMM<FL>> &batch, size_t nflop,
                  size_t work, MKL_INT i, MKL_INT k, MKL_INT n, MKL_INT nk)
         : batch(batch), nflop(nflop), work(work), i(i), k(k), n(n), nk(nk) {}
-    void perform() {
+    void perform(int impl = -1) {
         if (n != 0)
-            batch->perform(i, k, n);
+            batch->perform(i, k, n, impl);
     }
 };
 
@@ -843,6 +911,354 @@ struct AdvancedGEMM<FL, typename enable_if<is_complex<FL>::value>::type> {
     }
 };
 
+// Autotuner for the execution strategy of batched DGEMM
+// Measurements are grouped into buckets of problem sizes (powers of two)
+// and the best choice of each bucket is cached until clear is invoked
+struct BatchGEMMAutoTuner {
+    // candidate SeqTypes for multiplication in effective Hamiltonian
+    // (SeqTypes::Auto can be added, if it is supported by the tensor
+    // functions in use)
+    vector<SeqTypes> modes = {SeqTypes::None, SeqTypes::Simple,
+                              SeqTypes::Tasked};
+    // number of trial multiplications for each candidate SeqTypes
+    int n_trials = 2;
+    // expected number of multiplications per site
+    // (for amortizing the cost of precompute)
+    int n_expected = 16;
+    // whether grouped and threaded batched DGEMM should be compared
+    bool tune_batch = true;
+    // number of trials for each batched DGEMM implementation
+    int n_batch_trials = 3;
+    // bucket -> best SeqTypes
+    map<int, SeqTypes> mode_cache;
+    // bucket -> time per multiplication of each candidate SeqTypes
+    map<int, vector<double>> mode_times;
+    // bucket -> (time per flop, count) for grouped and threaded DGEMM
+    map<int, array<pair<double, int>, 2>> batch_times;
+    mutex mtx;
+    BatchGEMMAutoTuner() {}
+    // bucket index of a size, which is ceil(log2(size))
+    static int bucket(size_t size) {
+        int r = 0;
+        for (size_t x = 1; x < size; x <<= 1)
+            r++;
+        return r;
+    }
+    // bucket index of a batch of ngemm DGEMM with total flop count nflop
+    static int batch_bucket(size_t nflop, size_t ngemm) {
+        return bucket(nflop / max(ngemm, (size_t)1)) * 64 + bucket(ngemm);
+    }
+    bool has_mode(int key) {
+        lock_guard<mutex> lock(mtx);
+        return mode_cache.count(key);
+    }
+    SeqTypes get_mode(int key) {
+        lock_guard<mutex> lock(mtx);
+        return mode_cache.at(key);
+    }
+    // record time for each candidate SeqTypes and return the best one
+    SeqTypes set_mode_times(int key, const vector<double> &times) {
+        assert(times.size() == modes.size() && modes.size() != 0);
+        lock_guard<mutex> lock(mtx);
+        size_t ib = min_element(times.begin(), times.end()) - times.begin();
+        mode_times[key] = times;
+        return mode_cache[key] = modes[ib];
+    }
+    // select implementation for the next batched DGEMM in the bucket
+    int batch_impl(int key) {
+#ifdef _HAS_BLIS
+        return -1;
+#else
+        lock_guard<mutex> lock(mtx);
+        const array<pair<double, int>, 2> &tx = batch_times[key];
+        for (int impl = 0; impl < 2; impl++)
+            if (tx[impl].second < n_batch_trials)
+                return impl;
+        return tx[0].first / tx[0].second <= tx[1].first / tx[1].second ? 0
+                                                                          : 1;
+#endif
+    }
+    void record_batch(int key, int impl, double t, size_t nflop) {
+        if (impl == -1)
+            return;
+        lock_guard<mutex> lock(mtx);
+        pair<double, int> &tx = batch_times[key][impl];
+        if (tx.second < n_batch_trials)
+            tx.first += t / max(nflop, (size_t)1), tx.second++;
+    }
+    void clear() {
+        lock_guard<mutex> lock(mtx);
+        mode_cache.clear(), mode_times.clear(), batch_times.clear();
+    }
+    friend ostream &operator<<(ostream &os, BatchGEMMAutoTuner &c) {
+        lock_guard<mutex> lock(c.mtx);
+        const char *names[] = {"None", "Simple", "Auto", "", "Tasked",
+                               "SimpleTasked"};
+        for (auto &r : c.mode_cache) {
+            os << " SIZE <= 2^" << setw(2) << r.first
+               << " MODE = " << setw(12)
+               << ((uint8_t)r.second < 6 ? names[(uint8_t)r.second] : "???")
+               << " T/MULT =";
+            for (double t : c.mode_times.at(r.first))
+                os << " " << scientific << setprecision(3) << t;
+            os << endl;
+        }
+        for (auto &r : c.batch_times) {
+            os << " FLOP/GEMM <= 2^" << setw(2) << r.first / 64
+               << " NGEMM <= 2^" << setw(2) << r.first % 64 << " T/FLOP =";
+            for (auto &tx : r.second)
+                os << " " << scientific << setprecision(3)
+                   << (tx.second == 0 ? 0.0 : tx.first / tx.second);
+            os << endl;
+        }
+        os << fixed;
+        return os;
+    }
+};
+
+// Trace of batched DGEMM in one multiplication, for replaying
+// without physics objects (see gemm_replay.cpp)
+// Each stage is a batch of independent DGEMM and stages are executed in
+// order. Only shapes, strides, conj flags and scalars are stored
+struct BatchGEMMTrace {
+    struct Group {
+        // 0 = no trans, 1 = trans, 2 = conj, 3 = conj trans
+        uint8_t conja, conjb;
+        MKL_INT m, n, k, lda, ldb, ldc, gp;
+        complex<double> alpha, beta;
+    };
+    // size of float point type in bytes
+    int fl_size = 0;
+    bool is_cpx = false;
+    // SeqTypes used for capturing
+    SeqTypes mode = SeqTypes::None;
+    vector<vector<Group>> stages;
+    BatchGEMMTrace() {}
+    template <typename FL>
+    static typename enable_if<is_complex<FL>::value, FL>::type
+    to_fl(const complex<double> &x) {
+        return FL(x.real(), x.imag());
+    }
+    template <typename FL>
+    static typename enable_if<!is_complex<FL>::value, FL>::type
+    to_fl(const complex<double> &x) {
+        return (FL)x.real();
+    }
+    static uint8_t conj_code(CBLAS_TRANSPOSE t) {
+        return t == CblasNoTrans
+                   ? 0
+                   : (t == CblasTrans ? 1 : (t == CblasConjTrans ? 3 : 2));
+    }
+    // append DGEMM groups from index ii to ii + nn as one stage
+    template <typename FL>
+    void add_stage(const BatchGEMM<FL> &b, MKL_INT ii, MKL_INT nn) {
+        fl_size = (int)sizeof(FL), is_cpx = is_complex<FL>::value;
+        if (nn == 0)
+            return;
+        stages.push_back(vector<Group>());
+        stages.back().reserve(nn);
+        for (MKL_INT i = ii; i < ii + nn; i++)
+            stages.back().push_back(Group{
+                conj_code(b.ta[i]), conj_code(b.tb[i]), b.m[i], b.n[i],
+                b.k[i], b.lda[i], b.ldb[i], b.ldc[i], b.gp[i],
+                complex<double>(xreal<FL>(b.alpha[i]), ximag<FL>(b.alpha[i])),
+                complex<double>(xreal<FL>(b.beta[i]), ximag<FL>(b.beta[i]))});
+    }
+    template <typename FL> void add_stage(const BatchGEMM<FL> &b) {
+        add_stage(b, 0, (MKL_INT)b.gp.size());
+    }
+    size_t n_gemm() const {
+        size_t r = 0;
+        for (auto &st : stages)
+            for (auto &g : st)
+                r += g.gp;
+        return r;
+    }
+    // flop count, using the same convention as BatchGEMM::nflop
+    size_t n_flop() const {
+        size_t r = 0;
+        for (auto &st : stages)
+            for (auto &g : st)
+                r += (size_t)g.m * g.n * g.k * g.gp;
+        return r;
+    }
+    void clear() { stages.clear(); }
+    void save_data(ostream &ofs) const {
+        ofs << "BATCHGEMMTRACE 1" << endl;
+        ofs << fl_size << " " << (int)is_cpx << " " << (int)mode << " "
+            << stages.size() << endl;
+        ofs << setprecision(17);
+        for (auto &st : stages) {
+            ofs << st.size() << endl;
+            for (auto &g : st)
+                ofs << (int)g.conja << " " << (int)g.conjb << " " << g.m
+                    << " " << g.n << " " << g.k << " " << g.lda << " "
+                    << g.ldb << " " << g.ldc << " " << g.gp << " "
+                    << g.alpha.real() << " " << g.alpha.imag() << " "
+                    << g.beta.real() << " " << g.beta.imag() << endl;
+        }
+    }
+    void save_data(const string &filename) const {
+        ofstream ofs(filename.c_str(), ios::out);
+        if (!ofs.good())
+            throw runtime_error("BatchGEMMTrace:save_data on '" + filename +
+                                "' failed.");
+        save_data(ofs);
+        if (!ofs.good())
+            throw runtime_error("BatchGEMMTrace:save_data on '" + filename +
+                                "' failed.");
+        ofs.close();
+    }
+    void load_data(istream &ifs) {
+        string header;
+        int version = 0, cpx = 0, xmode = 0;
+        size_t nst = 0;
+        ifs >> header >> version;
+        if (header != "BATCHGEMMTRACE" || version != 1)
+            throw runtime_error("BatchGEMMTrace:load_data unknown format.");
+        ifs >> fl_size >> cpx >> xmode >> nst;
+        is_cpx = cpx, mode = (SeqTypes)xmode;
+        stages.resize(nst);
+        for (auto &st : stages) {
+            size_t ng = 0;
+            ifs >> ng;
+            st.resize(ng);
+            for (auto &g : st) {
+                int ca, cb;
+                double ar, ai, br, bi;
+                ifs >> ca >> cb >> g.m >> g.n >> g.k >> g.lda >> g.ldb >>
+                    g.ldc >> g.gp >> ar >> ai >> br >> bi;
+                g.conja = (uint8_t)ca, g.conjb = (uint8_t)cb;
+                g.alpha = complex<double>(ar, ai);
+                g.beta = complex<double>(br, bi);
+            }
+        }
+        if (ifs.fail())
+            throw runtime_error("BatchGEMMTrace:load_data failed.");
+    }
+    void load_data(const string &filename) {
+        ifstream ifs(filename.c_str(), ios::in);
+        if (!ifs.good())
+            throw runtime_error("BatchGEMMTrace:load_data on '" + filename +
+                                "' failed.");
+        load_data(ifs);
+        ifs.close();
+    }
+    // build one BatchGEMM for each stage, with input and output arrays
+    // taken round-robin from two arenas of at least max_mem elements each
+    // (so outputs of different DGEMM may alias for very large traces)
+    template <typename FL>
+    vector<shared_ptr<BatchGEMM<FL>>> build(vector<FL> &arena,
+                                            size_t max_mem) const {
+        typedef typename GMatrix<FL>::FP FP;
+        if (fl_size != (int)sizeof(FL) || is_cpx != is_complex<FL>::value)
+            throw runtime_error("BatchGEMMTrace:build float type mismatch.");
+        size_t max_sz = 0;
+        for (auto &st : stages)
+            for (auto &g : st) {
+                max_sz = max(max_sz, (size_t)(g.conja & 1 ? g.k : g.m) * g.lda);
+                max_sz = max(max_sz, (size_t)(g.conjb & 1 ? g.n : g.k) * g.ldb);
+                max_sz = max(max_sz, (size_t)g.m * g.ldc);
+            }
+        const size_t hsz = max(max_mem, max_sz * 2);
+        arena.resize(hsz * 2);
+        Random::fill<FP>((FP *)arena.data(),
+                         arena.size() * sizeof(FL) / sizeof(FP));
+        size_t pin = 0, pout = 0;
+        auto take = [hsz](size_t &p, size_t sz) {
+            if (p + sz > hsz)
+                p = 0;
+            return (p += sz) - sz;
+        };
+        vector<shared_ptr<BatchGEMM<FL>>> r;
+        r.reserve(stages.size());
+        for (auto &st : stages) {
+            r.push_back(make_shared<BatchGEMM<FL>>());
+            for (auto &g : st) {
+                r.back()->xgemm_group(g.conja, g.conjb, g.m, g.n, g.k,
+                                      to_fl<FL>(g.alpha), g.lda, g.ldb,
+                                      to_fl<FL>(g.beta), g.ldc, g.gp);
+                const size_t asz = (size_t)(g.conja & 1 ? g.k : g.m) * g.lda;
+                const size_t bsz = (size_t)(g.conjb & 1 ? g.n : g.k) * g.ldb;
+                const size_t csz = (size_t)g.m * g.ldc;
+                for (MKL_INT j = 0; j < g.gp; j++) {
+                    const FL *a = arena.data() + take(pin, asz);
+                    const FL *b = arena.data() + take(pin, bsz);
+                    r.back()->xgemm_array(a, b,
+                                          arena.data() + hsz + take(pout, csz));
+                }
+            }
+            r.back()->build_acc_gp();
+        }
+        return r;
+    }
+    // replay all stages n_repeat times with the given SeqTypes
+    // None: sequential DGEMM (parallelism only inside each DGEMM)
+    // Tasked: DGEMM in each stage parallelized over operator threads
+    // otherwise: batched DGEMM for each stage (BatchGEMM::perform)
+    // returns total time (in seconds), not including building arrays
+    template <typename FL>
+    double replay_typed(SeqTypes xmode, int n_repeat = 1,
+                        size_t max_mem = (size_t)1 << 24) const {
+        vector<FL> arena;
+        vector<shared_ptr<BatchGEMM<FL>>> bs = build<FL>(arena, max_mem);
+        Timer t;
+        t.get_time();
+        for (int ir = 0; ir < n_repeat; ir++)
+            for (auto &b : bs) {
+                if (xmode == SeqTypes::None) {
+                    for (MKL_INT ig = 0; ig < (MKL_INT)b->gp.size(); ig++)
+                        for (MKL_INT k = b->acc_gp[ig]; k < b->acc_gp[ig + 1];
+                             k++)
+                            b->perform_single(ig, b->a[k], b->b[k], b->c[k]);
+                } else if (xmode & SeqTypes::Tasked) {
+                    int ntop = threading->activate_operator();
+#pragma omp parallel for schedule(dynamic) num_threads(ntop)
+                    for (int ig = 0; ig < (int)b->gp.size(); ig++)
+                        for (MKL_INT k = b->acc_gp[ig]; k < b->acc_gp[ig + 1];
+                             k++)
+                            b->perform_single(ig, b->a[k], b->b[k], b->c[k]);
+                    threading->activate_normal();
+                } else
+                    b->perform();
+            }
+        return t.get_time();
+    }
+    // replay with the float point type used for capturing
+    double replay(SeqTypes xmode, int n_repeat = 1,
+                  size_t max_mem = (size_t)1 << 24) const {
+        if (!is_cpx && fl_size == (int)sizeof(double))
+            return replay_typed<double>(xmode, n_repeat, max_mem);
+        else if (is_cpx && fl_size == (int)sizeof(complex<double>))
+            return replay_typed<complex<double>>(xmode, n_repeat, max_mem);
+#ifdef _USE_SINGLE_PREC
+        else if (!is_cpx && fl_size == (int)sizeof(float))
+            return replay_typed<float>(xmode, n_repeat, max_mem);
+        else if (is_cpx && fl_size == (int)sizeof(complex<float>))
+            return replay_typed<complex<float>>(xmode, n_repeat, max_mem);
+#endif
+        throw runtime_error("BatchGEMMTrace:replay unsupported float type.");
+    }
+    friend ostream &operator<<(ostream &os, const BatchGEMMTrace &c) {
+        map<int, pair<size_t, size_t>> hist;
+        for (auto &st : c.stages)
+            for (auto &g : st) {
+                const int key =
+                    BatchGEMMAutoTuner::bucket((size_t)g.m * g.n * g.k);
+                hist[key].first += g.gp;
+                hist[key].second += (size_t)g.m * g.n * g.k * g.gp;
+            }
+        os << " STAGES = " << c.stages.size() << " NGEMM = " << c.n_gemm()
+           << " NFLOP = " << c.n_flop() << " FL SIZE = " << c.fl_size
+           << " COMPLEX = " << c.is_cpx << " MODE = " << (int)c.mode << endl;
+        for (auto &h : hist)
+            os << " FLOP/GEMM <= 2^" << setw(2) << h.first
+               << " NGEMM = " << setw(10) << h.second.first
+               << " NFLOP = " << setw(14) << h.second.second << endl;
+        return os;
+    }
+};
+
 // Batched DGEMM analyzer
 template <typename FL> struct BatchGEMMSeq {
     typedef typename GMatrix<FL>::FP FP;
@@ -856,6 +1272,11 @@ template <typename FL> struct BatchGEMMSeq {
     FL *work, *rwork;
     SeqTypes mode;
     bool no_check = true;
+    // if not nullptr, SeqTypes in effective Hamiltonian and implementation of
+    // batched DGEMM are selected by measurements
+    shared_ptr<BatchGEMMAutoTuner> tuner = nullptr;
+    // if not nullptr, all performed batched DGEMM are appended to the trace
+    shared_ptr<BatchGEMMTrace> trace = nullptr;
     BatchGEMMSeq(size_t max_batch_flops = 1LU << 30,
                  SeqTypes mode = SeqTypes::None)
         : max_batch_flops(max_batch_flops), mode(mode), vdata(nullptr) {
@@ -1394,6 +1815,8 @@ template <typename FL> struct BatchGEMMSeq {
     void deallocate() { vdata = nullptr; }
     // Perform non-conflicting batched DGEMM
     void simple_perform() {
+        ProfileScope ps("BatchGEMMSeq::simple_perform");
+        const size_t nflop = cumulative_nflop;
         divide_batch();
         if (!no_check)
             assert(check());
@@ -1401,6 +1824,7 @@ template <typename FL> struct BatchGEMMSeq {
         perform();
         deallocate();
         clear();
+        ps.nflop = cumulative_nflop - nflop;
     }
     // SeqTypes::Auto:
     //   Perform possibly conflicting batched DGEMM
@@ -1408,6 +1832,8 @@ template <typename FL> struct BatchGEMMSeq {
     // SeqTypes::Tasked:
     //   Each thread write to thread-copied outputs
     void auto_perform(const GMatrix<FL> &v = GMatrix<FL>(nullptr, 0, 0)) {
+        ProfileScope ps("BatchGEMMSeq::auto_perform");
+        const size_t nflop = cumulative_nflop;
         if (mode == SeqTypes::Auto) {
             prepare();
             allocate();
@@ -1418,6 +1844,8 @@ template <typename FL> struct BatchGEMMSeq {
             int ntop = threading->activate_operator();
             vector<GMatrix<FL>> vts(ntop, v);
             assert(batch[0]->c.size() == 0);
+            if (trace != nullptr)
+                trace->add_stage(*batch[1]);
             if (batch[1]->c.size() != batch[1]->gp.size())
                 batch[1]->build_acc_gp();
 #pragma omp parallel num_threads(ntop)
@@ -1452,12 +1880,16 @@ template <typename FL> struct BatchGEMMSeq {
             cumulative_nflop += batch[1]->nflop;
             clear();
         }
+        ps.nflop = cumulative_nflop - nflop;
     }
     // low mem mode for noise
     void auto_perform(const vector<GMatrix<FL>> &vs) {
+        ProfileScope ps("BatchGEMMSeq::auto_perform");
         assert(mode & SeqTypes::Tasked);
         int ntop = threading->activate_operator();
         assert(batch[0]->c.size() == 0);
+        if (trace != nullptr)
+            trace->add_stage(*batch[1]);
         if (batch[1]->c.size() != batch[1]->gp.size())
             batch[1]->build_acc_gp();
 #pragma omp parallel num_threads(ntop)
@@ -1488,6 +1920,7 @@ template <typename FL> struct BatchGEMMSeq {
         }
         threading->activate_normal();
         cumulative_nflop += batch[1]->nflop;
+        ps.nflop = batch[1]->nflop;
         clear();
     }
     // Directly perform batched DGEMM
@@ -1497,9 +1930,23 @@ template <typename FL> struct BatchGEMMSeq {
             if (b.rwork != 0)
                 memset(rwork, 0, sizeof(FL) * b.rwork);
             cumulative_nflop += b.nflop;
-            b.perform();
-            for (size_t ib = ipost; ib < ipost + b.ipost; ib++)
+            if (tuner != nullptr && tuner->tune_batch && b.n != 0) {
+                const int key = BatchGEMMAutoTuner::batch_bucket(
+                    b.nflop, (size_t)max(b.nk, (MKL_INT)b.n));
+                const int impl = tuner->batch_impl(key);
+                Timer t;
+                t.get_time();
+                b.perform(impl);
+                tuner->record_batch(key, impl, t.get_time(), b.nflop);
+            } else
+                b.perform();
+            if (trace != nullptr)
+                trace->add_stage(*b.batch, b.i, b.n);
+            for (size_t ib = ipost; ib < ipost + b.ipost; ib++) {
                 post_batch[ib]->perform();
+                if (trace != nullptr)
+                    trace->add_stage(*post_batch[ib]);
+            }
             ipost += b.ipost;
         }
         assert(ipost == post_batch.size());
@@ -1562,6 +2009,8 @@ template <typename FL> struct BatchGEMMSeq {
     // (in automatic mode)
     void operator()(const GMatrix<FL> &c, const GMatrix<FL> &v,
                     FL scale = 1.0) {
+        ProfileScope ps("BatchGEMMSeq::multiply");
+        const size_t nflop = cumulative_nflop;
         size_t cshift = c.data - (FL *)0;
         size_t vshift = v.data - (FL *)0;
         if (mode == SeqTypes::Auto) {
@@ -1611,6 +2060,10 @@ template <typename FL> struct BatchGEMMSeq {
             if (batch[0]->c.size() == 0 && batch[1]->c.size() == 0)
                 return;
             assert(max_rwork == 0 && max_work != 0);
+            if (trace != nullptr) {
+                trace->add_stage(*batch[0]);
+                trace->add_stage(*batch[1]);
+            }
             if (batch[0]->acidxs.size() != 0) {
                 batch[0]->build_acc_gp();
                 batch[1]->build_acc_gp();
@@ -1681,6 +2134,122 @@ template <typename FL> struct BatchGEMMSeq {
             cumulative_nflop += batch[1]->nflop;
         } else
             assert(false);
+        ps.nflop = cumulative_nflop - nflop;
+    }
+    // Matrix multiply vectors (cs) => vectors (vs)
+    // (in automatic mode)
+    // For SeqTypes::Tasked, each pair of operator blocks is applied to all
+    // vectors before moving on, so that operator data is only streamed once
+    // for all vectors. Other modes perform one multiplication per vector.
+    void operator()(const vector<GMatrix<FL>> &cs,
+                    const vector<GMatrix<FL>> &vs, FL scale = 1.0) {
+        assert(cs.size() == vs.size());
+        if (!(mode & SeqTypes::Tasked) || cs.size() == 1) {
+            for (size_t j = 0; j < cs.size(); j++)
+                (*this)(cs[j], vs[j], scale);
+            return;
+        }
+        ProfileScope ps("BatchGEMMSeq::block_multiply");
+        const size_t nflop = cumulative_nflop;
+        const int nv = (int)cs.size();
+        if (batch[0]->c.size() == 0 && batch[1]->c.size() == 0)
+            return;
+        assert(max_rwork == 0 && max_work != 0);
+        int ntop = threading->activate_operator();
+        // vts[tid * nv + j] is the thread copy of vs[j]
+        vector<GMatrix<FL>> vts;
+        vts.reserve(ntop * nv);
+        for (int tid = 0; tid < ntop; tid++)
+            vts.insert(vts.end(), vs.begin(), vs.end());
+        vector<GMatrix<FL>> works(ntop,
+                                  GMatrix<FL>(nullptr, (MKL_INT)max_work, 1));
+        vector<size_t> cshifts(nv);
+        for (int j = 0; j < nv; j++)
+            cshifts[j] = cs[j].data - (FL *)0;
+        if (trace != nullptr)
+            for (int j = 0; j < nv; j++) {
+                trace->add_stage(*batch[0]);
+                trace->add_stage(*batch[1]);
+            }
+        if (batch[0]->acidxs.size() != 0) {
+            batch[0]->build_acc_gp();
+            batch[1]->build_acc_gp();
+        }
+#pragma omp parallel num_threads(ntop)
+        {
+            int tid = threading->get_thread_id();
+            shared_ptr<VectorAllocator<FP>> d_alloc =
+                make_shared<VectorAllocator<FP>>();
+            if (tid != 0)
+                for (int j = 0; j < nv; j++)
+                    vts[tid * nv + j].allocate(d_alloc);
+            works[tid].allocate(d_alloc);
+            vector<size_t> t_vshifts(nv);
+            for (int j = 0; j < nv; j++)
+                t_vshifts[j] = vts[tid * nv + j].data - (FL *)0;
+            if (batch[0]->acidxs.size() == 0)
+#pragma omp for schedule(static)
+                for (int i = 0; i < (int)batch[0]->c.size(); i++)
+                    for (int j = 0; j < nv; j++) {
+                        batch[0]->perform_single(i, batch[0]->a[i] + cshifts[j],
+                                                 batch[0]->b[i],
+                                                 works[tid].data);
+                        batch[1]->perform_single(
+                            i, batch[1]->a[i], works[tid].data,
+                            batch[1]->c[i] + t_vshifts[j], scale);
+                    }
+            else {
+#pragma omp for schedule(static)
+                for (int i = 0; i < (int)batch[0]->gp.size(); i++) {
+                    const int k0z = batch[0]->acc_gp[i],
+                              k1z = batch[1]->acc_gp[i];
+                    const size_t wshift = works[tid].data - batch[0]->c[k0z];
+                    for (int j = 0; j < nv; j++) {
+                        if (!(batch[0]->acidxs[i] & 2))
+                            for (MKL_INT k0 = k0z; k0 < k0z + batch[0]->gp[i];
+                                 k0++)
+                                batch[0]->perform_single(
+                                    i, batch[0]->a[k0] + cshifts[j],
+                                    batch[0]->b[k0], batch[0]->c[k0] + wshift);
+                        else
+                            for (MKL_INT k0 = k0z; k0 < k0z + batch[0]->gp[i];
+                                 k0++)
+                                batch[0]->perform_single(
+                                    i, batch[0]->a[k0],
+                                    batch[0]->b[k0] + cshifts[j],
+                                    batch[0]->c[k0] + wshift);
+                        if (!(batch[0]->acidxs[i] & 1))
+                            for (MKL_INT k1 = k1z; k1 < k1z + batch[1]->gp[i];
+                                 k1++)
+                                batch[1]->perform_single(
+                                    i, batch[1]->a[k1],
+                                    batch[1]->b[k1] + wshift,
+                                    batch[1]->c[k1] + t_vshifts[j], scale);
+                        else
+                            for (MKL_INT k1 = k1z; k1 < k1z + batch[1]->gp[i];
+                                 k1++)
+                                batch[1]->perform_single(
+                                    i, batch[1]->a[k1] + wshift,
+                                    batch[1]->b[k1],
+                                    batch[1]->c[k1] + t_vshifts[j], scale);
+                    }
+                }
+            }
+#pragma omp single
+            for (int j = 0; j < nv; j++) {
+                vector<GMatrix<FL>> jvts(ntop, vs[j]);
+                for (int it = 0; it < ntop; it++)
+                    jvts[it] = vts[it * nv + j];
+                parallel_reduce(jvts, 0, ntop);
+            }
+            works[tid].deallocate(d_alloc);
+            if (tid != 0)
+                for (int j = nv - 1; j >= 0; j--)
+                    vts[tid * nv + j].deallocate(d_alloc);
+        }
+        threading->activate_normal();
+        cumulative_nflop += (batch[0]->nflop + batch[1]->nflop) * nv;
+        ps.nflop = cumulative_nflop - nflop;
     }
     // Clear all DGEMM parameters
     void clear() {
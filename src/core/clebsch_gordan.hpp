@@ -23,7 +23,10 @@
 #include <cassert>
 #include <cmath>
 #include <complex>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -54,19 +57,130 @@ struct TrivialCG {
     long double phase(int ta, int tb, int tc) const { return 1.0L; }
 };
 
+// Precomputed SU(2) recoupling coefficients shared by all SU2CG objects
+// 6j and CG symbols with all 2j <= max_tj are stored in flat arrays
+// 6j symbols with larger 2j and all 9j symbols are memoized on first use,
+// in hash maps keyed by the packed 2j tuple (7 bits per 2j)
+struct SU2CGTable {
+    static const int n_shards = 64;
+    static const int max_key_tj = 127;
+    int max_tj;
+    // flat 6j table indexed by (tja, tjb, tjc, tjd, tje, tjf)
+    vector<long double> w6j;
+    // flat CG table indexed by (tja, tjb, tjc, (tja + tma) / 2,
+    // (tjb + tmb) / 2), with tmc = tma + tmb
+    vector<long double> wcg;
+    mutex locks[n_shards];
+    unordered_map<uint64_t, long double> memo[n_shards];
+    SU2CGTable(int max_tj) : max_tj(max_tj) {
+        const size_t n = max_tj + 1;
+        w6j.resize(n * n * n * n * n * n);
+        wcg.resize(n * n * n * n * n);
+    }
+    bool in_range(int tj) const { return (unsigned)tj <= (unsigned)max_tj; }
+    size_t index_6j(int tja, int tjb, int tjc, int tjd, int tje,
+                    int tjf) const {
+        const size_t n = max_tj + 1;
+        return (((((size_t)tja * n + tjb) * n + tjc) * n + tjd) * n + tje) *
+                   n +
+               tjf;
+    }
+    size_t index_cg(int tja, int tjb, int tjc, int tma, int tmb) const {
+        const size_t n = max_tj + 1;
+        return ((((size_t)tja * n + tjb) * n + tjc) * n +
+                ((tja + tma) >> 1)) *
+                   n +
+               ((tjb + tmb) >> 1);
+    }
+    static bool packable(int tj) {
+        return (unsigned)tj <= (unsigned)max_key_tj;
+    }
+    static uint64_t pack(uint64_t key, int tj) { return (key << 7) | tj; }
+    static size_t shard(uint64_t key) {
+        return (size_t)(((key ^ (key >> 29)) * 0x9E3779B97F4A7C15ULL) >> 58);
+    }
+    bool find(uint64_t key, long double &r) {
+        const size_t ig = shard(key);
+        lock_guard<mutex> lock(locks[ig]);
+        auto it = memo[ig].find(key);
+        if (it == memo[ig].end())
+            return false;
+        r = it->second;
+        return true;
+    }
+    void insert(uint64_t key, long double r) {
+        const size_t ig = shard(key);
+        lock_guard<mutex> lock(locks[ig]);
+        memo[ig][key] = r;
+    }
+    size_t memo_size() {
+        size_t r = 0;
+        for (int ig = 0; ig < n_shards; ig++) {
+            lock_guard<mutex> lock(locks[ig]);
+            r += memo[ig].size();
+        }
+        return r;
+    }
+    void clear_memo() {
+        for (int ig = 0; ig < n_shards; ig++) {
+            lock_guard<mutex> lock(locks[ig]);
+            memo[ig].clear();
+        }
+    }
+};
+
 // CG factors for SU(2) symmetry
 struct SU2CG {
     shared_ptr<vector<double>> vdata;
     long double *sqrt_fact;
     int n_sf;
-    SU2CG(int n_sqrt_fact = 200) : n_sf(n_sqrt_fact) {
+    // precomputed coefficients (nullptr for direct evaluation only)
+    shared_ptr<SU2CGTable> table;
+    SU2CG(int n_sqrt_fact = 200) : SU2CG(n_sqrt_fact, max_table_twoj()) {}
+    SU2CG(int n_sqrt_fact, int max_tj) : n_sf(n_sqrt_fact) {
         vdata = make_shared<vector<double>>(n_sf * 2);
         sqrt_fact = (long double *)vdata->data();
         sqrt_fact[0] = 1;
         for (int i = 1; i < n_sf; i++)
             sqrt_fact[i] = sqrt_fact[i - 1] * sqrtl(i);
+        if (max_tj >= 0)
+            table = shared_table(max_tj);
     }
     virtual ~SU2CG() = default;
+    // Largest 2j in the prefilled 6j / CG tables for new SU2CG objects
+    // (negative to disable tables and memoization)
+    static int &max_table_twoj() {
+        static int max_tj = 6;
+        return max_tj;
+    }
+    // Tables are built once for each max_tj and shared by all SU2CG objects
+    static shared_ptr<SU2CGTable> shared_table(int max_tj) {
+        static mutex lock;
+        static shared_ptr<SU2CGTable> table;
+        lock_guard<mutex> guard(lock);
+        if (table == nullptr || table->max_tj != max_tj) {
+            table = make_shared<SU2CGTable>(max_tj);
+            SU2CG dcg(max(200, 4 * max_tj + 4), -1);
+            for (int tja = 0; tja <= max_tj; tja++)
+                for (int tjb = 0; tjb <= max_tj; tjb++)
+                    for (int tjc = 0; tjc <= max_tj; tjc++) {
+                        for (int tjd = 0; tjd <= max_tj; tjd++)
+                            for (int tje = 0; tje <= max_tj; tje++)
+                                for (int tjf = 0; tjf <= max_tj; tjf++)
+                                    table->w6j[table->index_6j(
+                                        tja, tjb, tjc, tjd, tje, tjf)] =
+                                        dcg.wigner_6j_direct(tja, tjb, tjc,
+                                                             tjd, tje, tjf);
+                        for (int tma = -tja; tma <= tja; tma += 2)
+                            for (int tmb = -tjb; tmb <= tjb; tmb += 2)
+                                table->wcg[table->index_cg(tja, tjb, tjc, tma,
+                                                           tmb)] =
+                                    dcg.cg_direct(tja, tjb, tjc, tma, tmb,
+                                                  tma + tmb);
+                    }
+        }
+        return table;
+    }
     static bool triangle(int tja, int tjb, int tjc) {
         return !((tja + tjb + tjc) & 1) && tjc <= tja + tjb &&
                tjc >= abs(tja - tjb);
@@ -78,6 +192,15 @@ struct SU2CG {
                sqrt_fact[(tja + tjb + tjc + 2) >> 1];
     }
     long double cg(int tja, int tjb, int tjc, int tma, int tmb, int tmc) const {
+        if (table != nullptr && tmc == tma + tmb && table->in_range(tja) &&
+            table->in_range(tjb) && table->in_range(tjc) && tma >= -tja &&
+            tma <= tja && !((tja + tma) & 1) && tmb >= -tjb && tmb <= tjb &&
+            !((tjb + tmb) & 1))
+            return table->wcg[table->index_cg(tja, tjb, tjc, tma, tmb)];
+        return cg_direct(tja, tjb, tjc, tma, tmb, tmc);
+    }
+    long double cg_direct(int tja, int tjb, int tjc, int tma, int tmb,
+                          int tmc) const {
         return (1 - ((tmc + tja - tjb) & 2)) * sqrtl(tjc + 1) *
                wigner_3j(tja, tjb, tjc, tma, tmb, -tmc);
     }
@@ -115,10 +238,37 @@ struct SU2CG {
         }
         return r;
     }
-    // Albert Messiah, Quantum Mechanics. Vol 2. Eq. (C.36)
-    // Adapted from Sebastian's CheMPS2 code Wigner.cpp
     long double wigner_6j(int tja, int tjb, int tjc, int tjd, int tje,
                           int tjf) const {
+        if (table == nullptr)
+            return wigner_6j_direct(tja, tjb, tjc, tjd, tje, tjf);
+        if (table->in_range(tja) && table->in_range(tjb) &&
+            table->in_range(tjc) && table->in_range(tjd) &&
+            table->in_range(tje) && table->in_range(tjf))
+            return table->w6j[table->index_6j(tja, tjb, tjc, tjd, tje, tjf)];
+        if (!triangle(tja, tjb, tjc) || !triangle(tja, tje, tjf) ||
+            !triangle(tjd, tjb, tjf) || !triangle(tjd, tje, tjc))
+            return 0;
+        if (!SU2CGTable::packable(tja) || !SU2CGTable::packable(tjb) ||
+            !SU2CGTable::packable(tjc) || !SU2CGTable::packable(tjd) ||
+            !SU2CGTable::packable(tje) || !SU2CGTable::packable(tjf))
+            return wigner_6j_direct(tja, tjb, tjc, tjd, tje, tjf);
+        // the highest bit separates 6j keys from 9j keys
+        uint64_t key = 0;
+        for (int tj : {tja, tjb, tjc, tjd, tje, tjf})
+            key = SU2CGTable::pack(key, tj);
+        key |= 1ULL << 63;
+        long double r;
+        if (!table->find(key, r)) {
+            r = wigner_6j_direct(tja, tjb, tjc, tjd, tje, tjf);
+            table->insert(key, r);
+        }
+        return r;
+    }
+    // Albert Messiah, Quantum Mechanics. Vol 2. Eq. (C.36)
+    // Adapted from Sebastian's CheMPS2 code Wigner.cpp
+    long double wigner_6j_direct(int tja, int tjb, int tjc, int tjd, int tje,
+                                 int tjf) const {
         if (!triangle(tja, tjb, tjc) || !triangle(tja, tje, tjf) ||
             !triangle(tjd, tjb, tjf) || !triangle(tjd, tje, tjc))
             return 0;
@@ -152,14 +302,42 @@ struct SU2CG {
         }
         return r;
     }
-    // Albert Messiah, Quantum Mechanics. Vol 2. Eq. (C.41)
-    // Adapted from Sebastian's CheMPS2 code Wigner.cpp
     long double wigner_9j(int tja, int tjb, int tjc, int tjd, int tje, int tjf,
                           int tjg, int tjh, int tji) const {
         if (!triangle(tja, tjb, tjc) || !triangle(tjd, tje, tjf) ||
             !triangle(tjg, tjh, tji) || !triangle(tja, tjd, tjg) ||
             !triangle(tjb, tje, tjh) || !triangle(tjc, tjf, tji))
             return 0;
+        if (table == nullptr || !SU2CGTable::packable(tja) ||
+            !SU2CGTable::packable(tjb) || !SU2CGTable::packable(tjc) ||
+            !SU2CGTable::packable(tjd) || !SU2CGTable::packable(tje) ||
+            !SU2CGTable::packable(tjf) || !SU2CGTable::packable(tjg) ||
+            !SU2CGTable::packable(tjh) || !SU2CGTable::packable(tji))
+            return wigner_9j_sum(tja, tjb, tjc, tjd, tje, tjf, tjg, tjh, tji);
+        uint64_t key = 0;
+        for (int tj : {tja, tjb, tjc, tjd, tje, tjf, tjg, tjh, tji})
+            key = SU2CGTable::pack(key, tj);
+        long double r;
+        if (!table->find(key, r)) {
+            r = wigner_9j_sum(tja, tjb, tjc, tjd, tje, tjf, tjg, tjh, tji);
+            table->insert(key, r);
+        }
+        return r;
+    }
+    long double wigner_9j_direct(int tja, int tjb, int tjc, int tjd, int tje,
+                                 int tjf, int tjg, int tjh, int tji) const {
+        if (!triangle(tja, tjb, tjc) || !triangle(tjd, tje, tjf) ||
+            !triangle(tjg, tjh, tji) || !triangle(tja, tjd, tjg) ||
+            !triangle(tjb, tje, tjh) || !triangle(tjc, tjf, tji))
+            return 0;
+        return wigner_9j_sum(tja, tjb, tjc, tjd, tje, tjf, tjg, tjh, tji,
+                             false);
+    }
+    // Albert Messiah, Quantum Mechanics. Vol 2. Eq. (C.41)
+    // Adapted from Sebastian's CheMPS2 code Wigner.cpp
+    long double wigner_9j_sum(int tja, int tjb, int tjc, int tjd, int tje,
+                              int tjf, int tjg, int tjh, int tji,
+                              bool use_table = true) const {
         const int alpha1 = abs(tja - tji), alpha2 = abs(tjd - tjh),
                   alpha3 = abs(tjb - tjf);
         const int beta1 = tja + tji, beta2 = tjd + tjh, beta3 = tjb + tjf;
@@ -167,9 +345,14 @@ struct SU2CG {
         const int min_beta = min(beta1, min(beta2, beta3));
         long double r = 0;
         for (int tg = max_alpha; tg <= min_beta; tg += 2) {
-            r += (tg + 1) * wigner_6j(tja, tjb, tjc, tjf, tji, tg) *
-                 wigner_6j(tjd, tje, tjf, tjb, tg, tjh) *
-                 wigner_6j(tjg, tjh, tji, tg, tja, tjd);
+            if (use_table)
+                r += (tg + 1) * wigner_6j(tja, tjb, tjc, tjf, tji, tg) *
+                     wigner_6j(tjd, tje, tjf, tjb, tg, tjh) *
+                     wigner_6j(tjg, tjh, tji, tg, tja, tjd);
+            else
+                r += (tg + 1) * wigner_6j_direct(tja, tjb, tjc, tjf, tji, tg) *
+                     wigner_6j_direct(tjd, tje, tjf, tjb, tg, tjh) *
+                     wigner_6j_direct(tjg, tjh, tji, tg, tja, tjd);
         }
         return ((max_alpha & 1) ? -1 : 1) * r;
     }
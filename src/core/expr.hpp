@@ -1311,6 +1311,73 @@ inline ostream &operator<<(ostream &os, const shared_ptr<OpExpr<S>> &c) {
     return os;
 }
 
+// Translation between expressions with different precision
+template <typename S, typename FL1, typename FL2> struct TransOpExpr {
+    static shared_ptr<OpElement<S, FL2>>
+    forward(const shared_ptr<OpElement<S, FL1>> &x) {
+        if (x == nullptr)
+            return nullptr;
+        return make_shared<OpElement<S, FL2>>(x->name, x->site_index,
+                                              x->q_label, (FL2)x->factor);
+    }
+    static shared_ptr<OpProduct<S, FL2>>
+    forward(const shared_ptr<OpProduct<S, FL1>> &x) {
+        if (x->get_type() == OpTypes::Prod)
+            return make_shared<OpProduct<S, FL2>>(
+                forward(x->a), forward(x->b), (FL2)x->factor, x->conj);
+        shared_ptr<OpSumProd<S, FL1>> op =
+            dynamic_pointer_cast<OpSumProd<S, FL1>>(x);
+        vector<shared_ptr<OpElement<S, FL2>>> ops(op->ops.size());
+        for (size_t i = 0; i < op->ops.size(); i++)
+            ops[i] = forward(op->ops[i]);
+        if (op->a == nullptr)
+            return make_shared<OpSumProd<S, FL2>>(ops, forward(op->b),
+                                                  op->conjs, (FL2)op->factor,
+                                                  op->conj, forward(op->c));
+        else if (op->b == nullptr)
+            return make_shared<OpSumProd<S, FL2>>(forward(op->a), ops,
+                                                  op->conjs, (FL2)op->factor,
+                                                  op->conj, forward(op->c));
+        else
+            return make_shared<OpSumProd<S, FL2>>(
+                forward(op->a), forward(op->b), ops, op->conjs,
+                (FL2)op->factor, op->conj);
+    }
+    static shared_ptr<OpExpr<S>> forward(const shared_ptr<OpExpr<S>> &x) {
+        if (x == nullptr)
+            return nullptr;
+        switch (x->get_type()) {
+        case OpTypes::Elem:
+            return forward(dynamic_pointer_cast<OpElement<S, FL1>>(x));
+        case OpTypes::Prod:
+        case OpTypes::SumProd:
+            return forward(dynamic_pointer_cast<OpProduct<S, FL1>>(x));
+        case OpTypes::Sum: {
+            shared_ptr<OpSum<S, FL1>> op =
+                dynamic_pointer_cast<OpSum<S, FL1>>(x);
+            vector<shared_ptr<OpProduct<S, FL2>>> strings(op->strings.size());
+            for (size_t i = 0; i < op->strings.size(); i++)
+                strings[i] = forward(op->strings[i]);
+            return make_shared<OpSum<S, FL2>>(strings);
+        }
+        case OpTypes::ElemRef: {
+            shared_ptr<OpElementRef<S, FL1>> op =
+                dynamic_pointer_cast<OpElementRef<S, FL1>>(x);
+            return make_shared<OpElementRef<S, FL2>>(forward(op->op),
+                                                     op->trans, op->factor);
+        }
+        case OpTypes::ExprRef: {
+            shared_ptr<OpExprRef<S>> op = dynamic_pointer_cast<OpExprRef<S>>(x);
+            return make_shared<OpExprRef<S>>(forward(op->op), op->is_local,
+                                             forward(op->orig));
+        }
+        default:
+            // zero and counter do not depend on precision
+            return x;
+        }
+    }
+};
+
 } // namespace block2
 
 namespace std {
@@ -23,6 +23,12 @@
 #pragma once
 
 #include "threading.hpp"
+#if (defined(__x86_64__) || defined(__i386__)) &&                             \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(__EMSCRIPTEN__)
+#define _HAS_FPC_SIMD
+#include <immintrin.h>
+#endif
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
@@ -137,6 +143,20 @@ template <typename T, typename U> struct BitsCodec {
         } else
             i_offset += l;
     }
+    /** Encode data and write into the array. Same as encode, but the number
+     * of bits can be equal to the number of bits in single array element.
+     * @param v The data to encode (no bits should be set above l bits).
+     * @param l The number of bits of the data.
+     */
+    void encode_bits(U v, int l) {
+        buf |= v << i_offset;
+        if (i_offset + l >= i_length) {
+            op_data[d_offset++] = (T &)buf;
+            buf = i_offset == 0 ? 0 : v >> (i_length - i_offset);
+            i_offset += l - i_length;
+        } else
+            i_offset += l;
+    }
     /** Finalize encoding. */
     size_t finish_encode() {
         op_data[d_offset++] = (T &)buf;
@@ -144,6 +164,316 @@ template <typename T, typename U> struct BitsCodec {
     }
 };
 
+/** Block kernels for FPCodec. The scalar versions are used when SIMD
+ * instructions are not available.
+ * @tparam U The representation integer type.
+ * @tparam mbits Number of bits in significand.
+ * @tparam ebits Number of bits in exponent.
+ */
+template <typename U, int mbits, int ebits> struct FPCodecKernels {
+    static const U e = U(1) << mbits; //!< Exponent least significant bit mask.
+    static const U x = ~(e + (e << ebits) - 1); //!< Exponent mask.
+    /** Update the range of the exponent part in an array.
+     * @param p The array in integer representation.
+     * @param n The length of the array.
+     * @param min_u The minimal exponent (input and output).
+     * @param max_u The maximal exponent (input and output).
+     */
+    static void exponent_range(const U *p, size_t n, U &min_u, U &max_u) {
+        for (size_t i = 0; i < n; i++) {
+            max_u = max(max_u, p[i] & x);
+            min_u = min(min_u, p[i] & x);
+        }
+    }
+    /** Split numbers into variable-length bit fields for encoding. For each
+     * number, the field is sign bit, exponent offset (ldu bits) and leading
+     * significand bits, from the least significant bit.
+     * @param p The array in integer representation.
+     * @param n The length of the array.
+     * @param min_u The minimal exponent.
+     * @param prec_u The exponent of the precision.
+     * @param ldu Number of bits for exponent offsets.
+     * @param w Output fields.
+     * @param l Output number of bits in each field.
+     */
+    static void pack(const U *p, size_t n, U min_u, U prec_u, int ldu, U *w,
+                     U *l) {
+        for (size_t i = 0; i < n; i++) {
+            const U uex = p[i] & x;
+            const U sm = uex <= prec_u ? 0
+                                       : min((uex - prec_u) >> mbits, (U)mbits);
+            w[i] = (p[i] >> (mbits + ebits)) |
+                   ((uex >= min_u ? (uex - min_u) >> mbits : 0) << 1) |
+                   (((p[i] & (e - 1)) >> (mbits - sm)) << (1 + ldu));
+            l[i] = 1 + ldu + sm;
+        }
+    }
+    /** Assemble numbers from decoded bit fields.
+     * @param c Sign bit and exponent offset of each number.
+     * @param r Leading significand bits of each number.
+     * @param n The length of the array.
+     * @param min_u The minimal exponent (shifted to the least significant
+     * bits).
+     * @param prec_ud The exponent of the precision (shifted to the least
+     * significant bits).
+     * @param p Output array in integer representation.
+     */
+    static void unpack(const U *c, const U *r, size_t n, U min_u, U prec_ud,
+                       U *p) {
+        for (size_t i = 0; i < n; i++) {
+            const U uex = (c[i] >> 1) + min_u;
+            const U sm = min(uex - prec_ud, (U)mbits);
+            p[i] = c[i] >> 1 == 0 && min_u == prec_ud
+                       ? 0
+                       : ((c[i] & 1) << (mbits + ebits)) | (uex << mbits) |
+                             (r[i] << (mbits - sm));
+        }
+    }
+};
+
+#ifdef _HAS_FPC_SIMD
+
+/** AVX2 block kernels for double precision FPCodec. */
+struct FPCodecAVX2Kernels {
+    typedef uint64_t U;
+    static const int mbits = 52, ebits = 11;
+    static const U e = U(1) << mbits, x = ~(e + (e << ebits) - 1);
+    __attribute__((target("avx2"))) static void
+    exponent_range(const U *p, size_t n, U &min_u, U &max_u) {
+        // exponents are non-negative as signed integers
+        const __m256i vx = _mm256_set1_epi64x((long long)x);
+        __m256i vmn = _mm256_set1_epi64x((long long)min_u);
+        __m256i vmx = _mm256_set1_epi64x((long long)max_u);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i v = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)(p + i)), vx);
+            vmn = _mm256_blendv_epi8(vmn, v, _mm256_cmpgt_epi64(vmn, v));
+            vmx = _mm256_blendv_epi8(vmx, v, _mm256_cmpgt_epi64(v, vmx));
+        }
+        U mn[4], mx[4];
+        _mm256_storeu_si256((__m256i *)mn, vmn);
+        _mm256_storeu_si256((__m256i *)mx, vmx);
+        for (int j = 0; j < 4; j++)
+            min_u = min(min_u, mn[j]), max_u = max(max_u, mx[j]);
+        FPCodecKernels<U, mbits, ebits>::exponent_range(p + i, n - i, min_u,
+                                                        max_u);
+    }
+    __attribute__((target("avx2"))) static void
+    pack(const U *p, size_t n, U min_u, U prec_u, int ldu, U *w, U *l) {
+        const __m256i vx = _mm256_set1_epi64x((long long)x);
+        const __m256i vmant = _mm256_set1_epi64x((long long)(e - 1));
+        const __m256i vmin = _mm256_set1_epi64x((long long)min_u);
+        const __m256i vprec = _mm256_set1_epi64x((long long)prec_u);
+        const __m256i vm = _mm256_set1_epi64x(mbits);
+        const __m256i vl = _mm256_set1_epi64x(1 + ldu);
+        const __m128i sl = _mm_cvtsi32_si128(1 + ldu);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i u = _mm256_loadu_si256((const __m256i *)(p + i));
+            __m256i uex = _mm256_and_si256(u, vx);
+            __m256i ex = _mm256_andnot_si256(
+                _mm256_cmpgt_epi64(vmin, uex),
+                _mm256_srli_epi64(_mm256_sub_epi64(uex, vmin), mbits));
+            __m256i sm = _mm256_srli_epi64(_mm256_sub_epi64(uex, vprec), mbits);
+            sm = _mm256_blendv_epi8(sm, vm, _mm256_cmpgt_epi64(sm, vm));
+            sm = _mm256_and_si256(sm, _mm256_cmpgt_epi64(uex, vprec));
+            __m256i r = _mm256_srlv_epi64(_mm256_and_si256(u, vmant),
+                                          _mm256_sub_epi64(vm, sm));
+            __m256i v = _mm256_or_si256(
+                _mm256_or_si256(_mm256_srli_epi64(u, mbits + ebits),
+                                _mm256_slli_epi64(ex, 1)),
+                _mm256_sll_epi64(r, sl));
+            _mm256_storeu_si256((__m256i *)(w + i), v);
+            _mm256_storeu_si256((__m256i *)(l + i), _mm256_add_epi64(vl, sm));
+        }
+        FPCodecKernels<U, mbits, ebits>::pack(p + i, n - i, min_u, prec_u, ldu,
+                                              w + i, l + i);
+    }
+    __attribute__((target("avx2"))) static void
+    unpack(const U *c, const U *r, size_t n, U min_u, U prec_ud, U *p) {
+        const __m256i vmin = _mm256_set1_epi64x((long long)min_u);
+        const __m256i vprec = _mm256_set1_epi64x((long long)prec_ud);
+        const __m256i vm = _mm256_set1_epi64x(mbits);
+        const __m256i vone = _mm256_set1_epi64x(1);
+        const __m256i vzero = _mm256_setzero_si256();
+        const bool zmin = min_u == prec_ud;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i vc = _mm256_loadu_si256((const __m256i *)(c + i));
+            __m256i vr = _mm256_loadu_si256((const __m256i *)(r + i));
+            __m256i ex = _mm256_srli_epi64(vc, 1);
+            __m256i uex = _mm256_add_epi64(ex, vmin);
+            __m256i sm = _mm256_sub_epi64(uex, vprec);
+            sm = _mm256_blendv_epi8(sm, vm, _mm256_cmpgt_epi64(sm, vm));
+            __m256i v = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_slli_epi64(_mm256_and_si256(vc, vone),
+                                      mbits + ebits),
+                    _mm256_slli_epi64(uex, mbits)),
+                _mm256_sllv_epi64(vr, _mm256_sub_epi64(vm, sm)));
+            if (zmin)
+                v = _mm256_andnot_si256(_mm256_cmpeq_epi64(ex, vzero), v);
+            _mm256_storeu_si256((__m256i *)(p + i), v);
+        }
+        FPCodecKernels<U, mbits, ebits>::unpack(c + i, r + i, n - i, min_u,
+                                                prec_ud, p + i);
+    }
+};
+
+/** AVX-512 block kernels for double precision FPCodec. */
+struct FPCodecAVX512Kernels {
+    typedef uint64_t U;
+    static const int mbits = 52, ebits = 11;
+    static const U e = U(1) << mbits, x = ~(e + (e << ebits) - 1);
+    __attribute__((target("avx512f"))) static void
+    exponent_range(const U *p, size_t n, U &min_u, U &max_u) {
+        const __m512i vx = _mm512_set1_epi64((long long)x);
+        __m512i vmn = _mm512_set1_epi64((long long)min_u);
+        __m512i vmx = _mm512_set1_epi64((long long)max_u);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512i v = _mm512_and_si512(_mm512_loadu_si512(p + i), vx);
+            vmn = _mm512_min_epu64(vmn, v);
+            vmx = _mm512_max_epu64(vmx, v);
+        }
+        U mn[8], mx[8];
+        _mm512_storeu_si512(mn, vmn);
+        _mm512_storeu_si512(mx, vmx);
+        for (int j = 0; j < 8; j++)
+            min_u = min(min_u, mn[j]), max_u = max(max_u, mx[j]);
+        FPCodecKernels<U, mbits, ebits>::exponent_range(p + i, n - i, min_u,
+                                                        max_u);
+    }
+    __attribute__((target("avx512f"))) static void
+    pack(const U *p, size_t n, U min_u, U prec_u, int ldu, U *w, U *l) {
+        const __m512i vx = _mm512_set1_epi64((long long)x);
+        const __m512i vmant = _mm512_set1_epi64((long long)(e - 1));
+        const __m512i vmin = _mm512_set1_epi64((long long)min_u);
+        const __m512i vprec = _mm512_set1_epi64((long long)prec_u);
+        const __m512i vm = _mm512_set1_epi64(mbits);
+        const __m512i vl = _mm512_set1_epi64(1 + ldu);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512i u = _mm512_loadu_si512(p + i);
+            __m512i uex = _mm512_and_si512(u, vx);
+            __m512i ex = _mm512_maskz_srli_epi64(
+                _mm512_cmpge_epu64_mask(uex, vmin),
+                _mm512_sub_epi64(uex, vmin), mbits);
+            __m512i sm = _mm512_maskz_min_epu64(
+                _mm512_cmpgt_epu64_mask(uex, vprec),
+                _mm512_srli_epi64(_mm512_sub_epi64(uex, vprec), mbits), vm);
+            __m512i r = _mm512_srlv_epi64(_mm512_and_si512(u, vmant),
+                                          _mm512_sub_epi64(vm, sm));
+            __m512i v = _mm512_or_si512(
+                _mm512_or_si512(_mm512_srli_epi64(u, mbits + ebits),
+                                _mm512_slli_epi64(ex, 1)),
+                _mm512_sllv_epi64(r, vl));
+            _mm512_storeu_si512(w + i, v);
+            _mm512_storeu_si512(l + i, _mm512_add_epi64(vl, sm));
+        }
+        FPCodecKernels<U, mbits, ebits>::pack(p + i, n - i, min_u, prec_u, ldu,
+                                              w + i, l + i);
+    }
+    __attribute__((target("avx512f"))) static void
+    unpack(const U *c, const U *r, size_t n, U min_u, U prec_ud, U *p) {
+        const __m512i vmin = _mm512_set1_epi64((long long)min_u);
+        const __m512i vprec = _mm512_set1_epi64((long long)prec_ud);
+        const __m512i vm = _mm512_set1_epi64(mbits);
+        const __m512i vone = _mm512_set1_epi64(1);
+        const bool zmin = min_u == prec_ud;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512i vc = _mm512_loadu_si512(c + i);
+            __m512i vr = _mm512_loadu_si512(r + i);
+            __m512i ex = _mm512_srli_epi64(vc, 1);
+            __m512i uex = _mm512_add_epi64(ex, vmin);
+            __m512i sm = _mm512_min_epu64(_mm512_sub_epi64(uex, vprec), vm);
+            __m512i v = _mm512_or_si512(
+                _mm512_or_si512(
+                    _mm512_slli_epi64(_mm512_and_si512(vc, vone),
+                                      mbits + ebits),
+                    _mm512_slli_epi64(uex, mbits)),
+                _mm512_sllv_epi64(vr, _mm512_sub_epi64(vm, sm)));
+            if (zmin)
+                v = _mm512_maskz_mov_epi64(_mm512_test_epi64_mask(ex, ex), v);
+            _mm512_storeu_si512(p + i, v);
+        }
+        FPCodecKernels<U, mbits, ebits>::unpack(c + i, r + i, n - i, min_u,
+                                                prec_ud, p + i);
+    }
+};
+
+#endif
+
+/** Select block kernels for FPCodec according to the SIMD level.
+ * SIMD kernels are only available for double precision.
+ * @tparam U The representation integer type.
+ * @tparam mbits Number of bits in significand.
+ * @tparam ebits Number of bits in exponent.
+ */
+template <typename U, int mbits, int ebits> struct FPCodecDispatch {
+    typedef FPCodecKernels<U, mbits, ebits> K;
+    /** Get the highest SIMD level supported by the CPU.
+     * @return 0 (scalar), 1 (AVX2), or 2 (AVX-512).
+     */
+    static int max_simd_level() { return 0; }
+    static void exponent_range(int simd, const U *p, size_t n, U &min_u,
+                               U &max_u) {
+        K::exponent_range(p, n, min_u, max_u);
+    }
+    static void pack(int simd, const U *p, size_t n, U min_u, U prec_u,
+                     int ldu, U *w, U *l) {
+        K::pack(p, n, min_u, prec_u, ldu, w, l);
+    }
+    static void unpack(int simd, const U *c, const U *r, size_t n, U min_u,
+                       U prec_ud, U *p) {
+        K::unpack(c, r, n, min_u, prec_ud, p);
+    }
+};
+
+#ifdef _HAS_FPC_SIMD
+
+template <> struct FPCodecDispatch<uint64_t, 52, 11> {
+    typedef uint64_t U;
+    typedef FPCodecKernels<U, 52, 11> K;
+    static int max_simd_level() {
+        static const int level = __builtin_cpu_supports("avx512f")
+                                     ? 2
+                                     : (__builtin_cpu_supports("avx2") ? 1 : 0);
+        return level;
+    }
+    static void exponent_range(int simd, const U *p, size_t n, U &min_u,
+                               U &max_u) {
+        if (simd >= 2)
+            FPCodecAVX512Kernels::exponent_range(p, n, min_u, max_u);
+        else if (simd == 1)
+            FPCodecAVX2Kernels::exponent_range(p, n, min_u, max_u);
+        else
+            K::exponent_range(p, n, min_u, max_u);
+    }
+    static void pack(int simd, const U *p, size_t n, U min_u, U prec_u,
+                     int ldu, U *w, U *l) {
+        if (simd >= 2)
+            FPCodecAVX512Kernels::pack(p, n, min_u, prec_u, ldu, w, l);
+        else if (simd == 1)
+            FPCodecAVX2Kernels::pack(p, n, min_u, prec_u, ldu, w, l);
+        else
+            K::pack(p, n, min_u, prec_u, ldu, w, l);
+    }
+    static void unpack(int simd, const U *c, const U *r, size_t n, U min_u,
+                       U prec_ud, U *p) {
+        if (simd >= 2)
+            FPCodecAVX512Kernels::unpack(c, r, n, min_u, prec_ud, p);
+        else if (simd == 1)
+            FPCodecAVX2Kernels::unpack(c, r, n, min_u, prec_ud, p);
+        else
+            K::unpack(c, r, n, min_u, prec_ud, p);
+    }
+};
+
+#endif
+
 /** Codec for compressing/decompressing array of floating-point numbers.
  * @tparam T Floating type to implement.
  * @tparam U The corresponding integer type.
@@ -172,6 +502,12 @@ struct FPCodec {
                               //!< processed at one time.
     size_t n_parallel_chunks =
         4096; //!< Number of chunks to be processed in the same batch.
+    int simd_level = -1; //!< SIMD instruction set for the block kernels (0 =
+                         //!< scalar, 1 = AVX2, 2 = AVX-512). If negative, the
+                         //!< best one supported by the CPU is used.
+    static const size_t block_size =
+        256; //!< Number of elements in each block for the block kernels.
+    typedef FPCodecDispatch<U, mbits, ebits> D;
     /** Default constructor. */
     FPCodec() : prec(0), prec_u(0) {}
     /** Constructor.
@@ -200,21 +536,17 @@ struct FPCodec {
         enc.decode(prec_ud, ebits);
         enc.decode(min_u, ebits);
         enc.decode(ldu, ebits);
-        for (size_t i = 0; i < len; i++) {
-            U uex;
-            U &udata = (U &)op_data[i];
-            enc.decode(udata, 1);
-            udata <<= ebits + mbits;
-            enc.decode(uex, ldu);
-            if (uex == 0 && min_u == prec_ud)
-                udata = 0;
-            else {
-                uex += min_u;
-                udata |= uex << mbits;
-                int smbits = min((int)(uex - prec_ud), mbits);
-                enc.decode(uex, smbits);
-                udata |= uex << (mbits - smbits);
+        const int simd = get_simd_level();
+        U c[block_size], r[block_size];
+        for (size_t i = 0; i < len; i += block_size) {
+            const size_t nb = min((size_t)block_size, len - i);
+            for (size_t j = 0; j < nb; j++) {
+                // sign bit and exponent offset
+                enc.decode(c[j], ldu + 1);
+                enc.decode(r[j],
+                           min((int)((c[j] >> 1) + min_u - prec_ud), mbits));
             }
+            D::unpack(simd, c, r, nb, min_u, prec_ud, (U *)op_data + i);
         }
         return enc.d_offset;
     }
@@ -227,10 +559,8 @@ struct FPCodec {
      */
     size_t encode(T *ip_data, size_t len, T *op_data) const {
         U max_u = 0, min_u = x, prec_ud = prec_u >> mbits;
-        for (size_t i = 0; i < len; i++) {
-            max_u = max(max_u, (U &)ip_data[i] & x);
-            min_u = min(min_u, (U &)ip_data[i] & x);
-        }
+        const int simd = get_simd_level();
+        D::exponent_range(simd, (const U *)ip_data, len, min_u, max_u);
         if (min_u < prec_u)
             min_u = prec_u;
         int diff_u = (max_u - min_u) >> mbits;
@@ -241,20 +571,22 @@ struct FPCodec {
         enc.encode(prec_ud, ebits);
         enc.encode(min_u >> mbits, ebits);
         enc.encode(ldu, ebits);
-        for (size_t i = 0; i < len; i++) {
-            U udata = (U &)ip_data[i];
-            U uex = udata & x;
-            enc.encode(!!(udata & s), 1);
-            enc.encode(uex >= min_u ? (uex - min_u) >> mbits : 0, ldu);
-            if (uex <= prec_u)
-                continue;
-            else {
-                int smbits = min((int)((uex - prec_u) >> mbits), mbits);
-                enc.encode((udata & (e - 1)) >> (mbits - smbits), smbits);
-            }
+        U w[block_size], l[block_size];
+        for (size_t i = 0; i < len; i += block_size) {
+            const size_t nb = min((size_t)block_size, len - i);
+            D::pack(simd, (const U *)ip_data + i, nb, min_u, prec_u, ldu, w, l);
+            for (size_t j = 0; j < nb; j++)
+                enc.encode_bits(w[j], (int)l[j]);
         }
         return enc.finish_encode();
     }
+    /** Get the SIMD instruction set used for the block kernels.
+     * @return 0 (scalar), 1 (AVX2), or 2 (AVX-512).
+     */
+    int get_simd_level() const {
+        return simd_level < 0 ? D::max_simd_level()
+                              : min(simd_level, D::max_simd_level());
+    }
     /** Compress array of floating-point data and write into file stream.
      * @param ofs Output stream.
      * @param data The original floating-point array.
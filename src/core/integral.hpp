@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "integral_binary.hpp"
 #include "threading.hpp"
 #include "utils.hpp"
 #include <array>
@@ -549,6 +550,8 @@ template <typename FL> struct FCIDUMP {
     FL *data;
     size_t total_memory;
     bool uhf, general;
+    // memory-mapped binary integral file (used instead of vdata)
+    shared_ptr<MappedIntegralFile> mdata;
     FCIDUMP() : const_e(0.0), uhf(false), total_memory(0), vdata(nullptr) {}
     // Initialize integrals: U(1) case
     // Two-electron integrals can be three general rank-4 arrays
@@ -741,20 +744,10 @@ template <typename FL> struct FCIDUMP {
             throw runtime_error("FCIDUMP::write on '" + filename + "' failed.");
         ofs.close();
     }
-    // Parsing a FCIDUMP file
-    virtual void read(const string &filename) {
-        params.clear();
-        ts.clear();
-        vs.clear();
-        vabs.clear();
-        const_e = (typename const_fl_type<FL>::FL)0.0;
-        ifstream ifs(filename.c_str());
-        if (!ifs.good())
-            throw runtime_error("FCIDUMP::read on '" + filename + "' failed.");
-        vector<string> lines = Parsing::readlines(&ifs);
-        if (ifs.bad())
-            throw runtime_error("FCIDUMP::read on '" + filename + "' failed.");
-        ifs.close();
+    // Parsing the namelist of a FCIDUMP file
+    // returns the index of the first line after the namelist
+    static size_t parse_params(vector<string> &lines,
+                               map<string, string> &params) {
         vector<string> pars;
         size_t il = 0;
         for (; il < lines.size(); il++) {
@@ -786,9 +779,14 @@ template <typename FL> struct FCIDUMP {
                                         : params[p_key] + "," + cc;
             }
         }
-        size_t int_sz = lines.size() > il ? lines.size() - il : 0;
-        vector<array<uint16_t, 4>> int_idx(int_sz);
-        vector<FL> int_val(int_sz);
+        return il;
+    }
+    // Parsing integral lines [il, il + int_sz) of a FCIDUMP file
+    void parse_integrals(vector<string> &lines, size_t il, size_t int_sz,
+                         vector<array<uint16_t, 4>> &int_idx,
+                         vector<FL> &int_val) {
+        int_idx.resize(int_sz);
+        int_val.resize(int_sz);
         int ntg = threading->activate_global();
 #pragma omp parallel for schedule(static) num_threads(ntg)
         for (int64_t ill = 0; ill < (int64_t)int_sz; ill++) {
@@ -809,33 +807,76 @@ template <typename FL> struct FCIDUMP {
             }
         }
         threading->activate_normal();
+    }
+    // Create integral arrays (without memory) according to params
+    void init_arrays() {
+        ts.clear();
+        vs.clear();
+        vabs.clear();
+        vgs.clear();
         uint16_t n = (uint16_t)Parsing::to_int(params["norb"]);
         uhf = params.count("iuhf") != 0 && Parsing::to_int(params["iuhf"]) == 1;
         general = params.count("igeneral") != 0 &&
                   Parsing::to_int(params["igeneral"]) == 1;
-        if (!uhf) {
-            ts.push_back(TInt<FL>(n));
-            ts[0].general = params.count("itgeneral") != 0 &&
-                            Parsing::to_int(params["itgeneral"]) == 1;
-            if (!general) {
+        bool tgeneral = params.count("itgeneral") != 0 &&
+                        Parsing::to_int(params["itgeneral"]) == 1;
+        for (int i = 0; i < (uhf ? 2 : 1); i++)
+            ts.push_back(TInt<FL>(n, tgeneral));
+        if (!general) {
+            for (int i = 0; i < (uhf ? 2 : 1); i++)
                 vs.push_back(V8Int<FL>(n));
-                total_memory = ts[0].size() + vs[0].size();
-                vdata = make_shared<vector<FL>>(total_memory);
-                data = vdata->data();
-                ts[0].data = data;
-                vs[0].data = data + ts[0].size();
-                ts[0].clear();
-                vs[0].clear();
-            } else {
+            if (uhf)
+                vabs.push_back(V4Int<FL>(n));
+        } else
+            for (int i = 0; i < (uhf ? 3 : 1); i++)
                 vgs.push_back(V1Int<FL>(n));
-                total_memory = ts[0].size() + vgs[0].size();
-                vdata = make_shared<vector<FL>>(total_memory);
-                data = vdata->data();
-                ts[0].data = data;
-                vgs[0].data = data + ts[0].size();
-                ts[0].clear();
-                vgs[0].clear();
-            }
+    }
+    // Set data pointers of all integral arrays (in storage order)
+    template <typename F> void set_array_data(F f) {
+        size_t ia = 0;
+        for (auto &x : ts)
+            x.data = f(ia++);
+        for (auto &x : vs)
+            x.data = f(ia++);
+        for (auto &x : vabs)
+            x.data = f(ia++);
+        for (auto &x : vgs)
+            x.data = f(ia++);
+    }
+    // Data pointers of all integral arrays (in storage order)
+    vector<FL *> array_data() const {
+        vector<FL *> ptrs;
+        for (auto &x : ts)
+            ptrs.push_back(x.data);
+        for (auto &x : vs)
+            ptrs.push_back(x.data);
+        for (auto &x : vabs)
+            ptrs.push_back(x.data);
+        for (auto &x : vgs)
+            ptrs.push_back(x.data);
+        return ptrs;
+    }
+    // Allocate zeroed memory for all integral arrays
+    void allocate_arrays() {
+        vector<IntegralSection> sections = binary_header().sections;
+        total_memory = 0;
+        for (auto &s : sections)
+            total_memory += s.len;
+        vdata = make_shared<vector<FL>>(total_memory);
+        mdata = nullptr;
+        data = vdata->data();
+        size_t offset = 0;
+        set_array_data([this, &offset, &sections](size_t ia) {
+            FL *p = data + offset;
+            offset += sections[ia].len;
+            return p;
+        });
+    }
+    // Storing parsed integrals into arrays
+    // ip: number of separating lines (with zero indices) seen so far
+    void assign_integrals(const vector<array<uint16_t, 4>> &int_idx,
+                          const vector<FL> &int_val, int &ip) {
+        if (!uhf) {
             for (size_t i = 0; i < int_val.size(); i++) {
                 if (int_idx[i][0] == numeric_limits<uint16_t>::max())
                     continue;
@@ -855,41 +896,6 @@ template <typename FL> struct FCIDUMP {
                            int_idx[i][2] - 1, int_idx[i][3] - 1) = int_val[i];
             }
         } else {
-            ts.push_back(TInt<FL>(n));
-            ts.push_back(TInt<FL>(n));
-            ts[0].general = ts[1].general =
-                params.count("itgeneral") != 0 &&
-                Parsing::to_int(params["itgeneral"]) == 1;
-            if (!general) {
-                vs.push_back(V8Int<FL>(n));
-                vs.push_back(V8Int<FL>(n));
-                vabs.push_back(V4Int<FL>(n));
-                total_memory =
-                    ((ts[0].size() + vs[0].size()) << 1) + vabs[0].size();
-                vdata = make_shared<vector<FL>>(total_memory);
-                data = vdata->data();
-                ts[0].data = data;
-                ts[1].data = data + ts[0].size();
-                vs[0].data = data + (ts[0].size() << 1);
-                vs[1].data = data + (ts[0].size() << 1) + vs[0].size();
-                vabs[0].data = data + ((ts[0].size() + vs[0].size()) << 1);
-                ts[0].clear(), ts[1].clear();
-                vs[0].clear(), vs[1].clear(), vabs[0].clear();
-            } else {
-                for (int i = 0; i < 3; i++)
-                    vgs.push_back(V1Int<FL>(n));
-                total_memory = ts[0].size() * 2 + vgs[0].size() * 3;
-                vdata = make_shared<vector<FL>>(total_memory);
-                data = vdata->data();
-                ts[0].data = data;
-                ts[1].data = data + ts[0].size();
-                vgs[0].data = data + (ts[0].size() << 1);
-                vgs[1].data = data + (ts[0].size() << 1) + vgs[0].size();
-                vgs[2].data = data + (ts[0].size() << 1) + (vgs[0].size() << 1);
-                ts[0].clear(), ts[1].clear();
-                vgs[0].clear(), vgs[1].clear(), vgs[2].clear();
-            }
-            int ip = 0;
             for (size_t i = 0; i < int_val.size(); i++) {
                 if (int_idx[i][0] == numeric_limits<uint16_t>::max())
                     continue;
@@ -922,6 +928,241 @@ template <typename FL> struct FCIDUMP {
             }
         }
     }
+    // Parsing a FCIDUMP file (text or binary integral file)
+    virtual void read(const string &filename) {
+        if (BinaryIntegralHeader::is_binary(filename)) {
+            read_binary(filename);
+            return;
+        }
+        params.clear();
+        ts.clear();
+        vs.clear();
+        vabs.clear();
+        vgs.clear();
+        const_e = (typename const_fl_type<FL>::FL)0.0;
+        ifstream ifs(filename.c_str());
+        if (!ifs.good())
+            throw runtime_error("FCIDUMP::read on '" + filename + "' failed.");
+        vector<string> lines = Parsing::readlines(&ifs);
+        if (ifs.bad())
+            throw runtime_error("FCIDUMP::read on '" + filename + "' failed.");
+        ifs.close();
+        size_t il = parse_params(lines, params);
+        size_t int_sz = lines.size() > il ? lines.size() - il : 0;
+        vector<array<uint16_t, 4>> int_idx;
+        vector<FL> int_val;
+        parse_integrals(lines, il, int_sz, int_idx, int_val);
+        init_arrays();
+        allocate_arrays();
+        int ip = 0;
+        assign_integrals(int_idx, int_val, ip);
+    }
+    // Description of all integral arrays for binary integral file
+    BinaryIntegralHeader binary_header() const {
+        BinaryIntegralHeader hdr;
+        hdr.fl_size = (uint8_t)sizeof(FL);
+        hdr.is_complex = is_complex<FL>::value;
+        hdr.uhf = uhf, hdr.general = general;
+        hdr.const_e = BinaryIntegralHeader::const_to_string(const_e);
+        hdr.params = params;
+        for (auto &x : ts)
+            hdr.sections.push_back(IntegralSection(IntegralArrayTypes::T, x.n,
+                                                   x.size(), x.general));
+        for (auto &x : vs)
+            hdr.sections.push_back(
+                IntegralSection(IntegralArrayTypes::V8, x.n, x.size()));
+        for (auto &x : vabs)
+            hdr.sections.push_back(
+                IntegralSection(IntegralArrayTypes::V4, x.n, x.size()));
+        for (auto &x : vgs)
+            hdr.sections.push_back(
+                IntegralSection(IntegralArrayTypes::V1, x.n, x.size()));
+        return hdr;
+    }
+    // Writing binary integral file to disk
+    // prec: if nonzero, integral arrays are compressed using FPCodec
+    //   (compressed files can be read but not memory-mapped)
+    virtual void write_binary(const string &filename, FP prec = 0) const {
+        BinaryIntegralHeader hdr = binary_header();
+        vector<FL *> ptrs = array_data();
+        ofstream ofs(filename.c_str(), ios::binary);
+        if (!ofs.good())
+            throw runtime_error("FCIDUMP::write_binary on '" + filename +
+                                "' failed.");
+        if (prec == (FP)0.0) {
+            hdr.layout();
+            hdr.write(ofs);
+            for (size_t i = 0; i < ptrs.size(); i++) {
+                const IntegralSection &s = hdr.sections[i];
+                vector<char> pad(s.offset - (uint64_t)ofs.tellp(), 0);
+                ofs.write(pad.data(), pad.size());
+                ofs.write((char *)ptrs[i], s.nbytes);
+            }
+        } else {
+            const int cpx_sz = sizeof(FL) / sizeof(FP);
+            FPCodec<FP> fpc(prec);
+            for (auto &s : hdr.sections)
+                s.compressed = 1;
+            hdr.write(ofs);
+            for (size_t i = 0; i < ptrs.size(); i++) {
+                IntegralSection &s = hdr.sections[i];
+                s.offset = ofs.tellp();
+                fpc.write_array(ofs, (FP *)ptrs[i], s.len * cpx_sz);
+                s.nbytes = (uint64_t)ofs.tellp() - s.offset;
+            }
+            ofs.seekp(0);
+            hdr.write(ofs);
+        }
+        if (!ofs.good())
+            throw runtime_error("FCIDUMP::write_binary on '" + filename +
+                                "' failed.");
+        ofs.close();
+    }
+    // Reading binary integral file
+    // use_mmap: if true, uncompressed integral arrays are used in place
+    //   from a private (copy-on-write) memory mapping of the file
+    virtual void read_binary(const string &filename, bool use_mmap = true) {
+        ifstream ifs(filename.c_str(), ios::binary);
+        if (!ifs.good())
+            throw runtime_error("FCIDUMP::read_binary on '" + filename +
+                                "' failed.");
+        BinaryIntegralHeader hdr;
+        hdr.read(ifs);
+        if (hdr.fl_size != sizeof(FL) || hdr.is_complex != is_complex<FL>::value)
+            throw runtime_error("FCIDUMP::read_binary on '" + filename +
+                                "' : float type does not match.");
+        params = hdr.params;
+        const_e = BinaryIntegralHeader::const_from_string<
+            typename const_fl_type<FL>::FL>(hdr.const_e);
+        uhf = hdr.uhf, general = hdr.general;
+        ts.clear();
+        vs.clear();
+        vabs.clear();
+        vgs.clear();
+        bool compressed = false;
+        for (auto &s : hdr.sections) {
+            if (s.type == IntegralArrayTypes::T)
+                ts.push_back(TInt<FL>((uint16_t)s.n, s.general));
+            else if (s.type == IntegralArrayTypes::V8)
+                vs.push_back(V8Int<FL>(s.n));
+            else if (s.type == IntegralArrayTypes::V4)
+                vabs.push_back(V4Int<FL>(s.n));
+            else
+                vgs.push_back(V1Int<FL>(s.n));
+            compressed = compressed || s.compressed;
+        }
+        vector<IntegralSection> sections = binary_header().sections;
+        for (size_t i = 0; i < sections.size(); i++)
+            if (sections[i].type != hdr.sections[i].type ||
+                sections[i].len != hdr.sections[i].len)
+                throw runtime_error("FCIDUMP::read_binary on '" + filename +
+                                    "' : sections are not in storage order.");
+        if (use_mmap && !compressed) {
+            vdata = nullptr;
+            mdata = make_shared<MappedIntegralFile>(filename);
+            data = (FL *)(mdata->ptr + hdr.sections[0].offset);
+            total_memory = (size_t)(hdr.sections.back().offset +
+                                    hdr.sections.back().nbytes -
+                                    hdr.sections[0].offset) /
+                           sizeof(FL);
+            set_array_data([this, &hdr](size_t ia) {
+                return (FL *)(mdata->ptr + hdr.sections[ia].offset);
+            });
+        } else {
+            const int cpx_sz = sizeof(FL) / sizeof(FP);
+            FPCodec<FP> fpc;
+            allocate_arrays();
+            vector<FL *> ptrs = array_data();
+            for (size_t i = 0; i < ptrs.size(); i++) {
+                const IntegralSection &s = hdr.sections[i];
+                ifs.seekg(s.offset);
+                if (s.compressed)
+                    fpc.read_array(ifs, (FP *)ptrs[i], s.len * cpx_sz);
+                else
+                    ifs.read((char *)ptrs[i], s.nbytes);
+            }
+            if (!ifs.good())
+                throw runtime_error("FCIDUMP::read_binary on '" + filename +
+                                    "' failed.");
+        }
+    }
+    // Converting FCIDUMP text file to binary integral file
+    // The text file is parsed in batches of batch_size lines, and integrals
+    // are written directly into the memory-mapped output file, so the memory
+    // cost does not scale with the size of the text or the integral arrays
+    // prec: if nonzero, integral arrays are compressed using FPCodec
+    static void convert_to_binary(const string &text_filename,
+                                  const string &filename, FP prec = 0,
+                                  size_t batch_size = 1 << 20) {
+        if (!MappedIntegralFile::supported()) {
+            FCIDUMP fd;
+            fd.read(text_filename);
+            fd.write_binary(filename, prec);
+            return;
+        } else if (prec != (FP)0.0) {
+            const string tmp_filename = filename + ".tmp";
+            convert_to_binary(text_filename, tmp_filename, 0, batch_size);
+            FCIDUMP fd;
+            fd.read_binary(tmp_filename);
+            fd.write_binary(filename, prec);
+            fd.deallocate();
+            Parsing::remove_file(tmp_filename);
+            return;
+        }
+        ifstream ifs(text_filename.c_str());
+        if (!ifs.good())
+            throw runtime_error("FCIDUMP::convert_to_binary on '" +
+                                text_filename + "' failed.");
+        FCIDUMP fd;
+        vector<string> lines;
+        string line;
+        while (getline(ifs, line)) {
+            lines.push_back(line);
+            string l(Parsing::lower(line));
+            if (l.find("/") != string::npos || l.find("&end") != string::npos)
+                break;
+        }
+        parse_params(lines, fd.params);
+        fd.init_arrays();
+        BinaryIntegralHeader hdr = fd.binary_header();
+        uint64_t file_size = hdr.layout();
+        ofstream ofs(filename.c_str(), ios::binary);
+        hdr.write(ofs);
+        ofs.seekp(file_size - 1);
+        ofs.put(0);
+        if (!ofs.good())
+            throw runtime_error("FCIDUMP::convert_to_binary on '" + filename +
+                                "' failed.");
+        ofs.close();
+        // integral arrays are initially zero (from the sparse file)
+        fd.mdata = make_shared<MappedIntegralFile>(filename, true);
+        fd.set_array_data([&fd, &hdr](size_t ia) {
+            return (FL *)(fd.mdata->ptr + hdr.sections[ia].offset);
+        });
+        vector<array<uint16_t, 4>> int_idx;
+        vector<FL> int_val;
+        int ip = 0;
+        for (;;) {
+            lines.clear();
+            while (lines.size() < batch_size && getline(ifs, line))
+                lines.push_back(line);
+            if (lines.size() == 0)
+                break;
+            fd.parse_integrals(lines, 0, lines.size(), int_idx, int_val);
+            fd.assign_integrals(int_idx, int_val, ip);
+        }
+        if (ifs.bad())
+            throw runtime_error("FCIDUMP::convert_to_binary on '" +
+                                text_filename + "' failed.");
+        fd.mdata = nullptr;
+        // const_e is only known at the end (fixed-length text in header)
+        hdr.const_e = BinaryIntegralHeader::const_to_string(fd.const_e);
+        fstream fs(filename.c_str(), ios::in | ios::out | ios::binary);
+        hdr.write(fs);
+        if (!fs.good())
+            throw runtime_error("FCIDUMP::convert_to_binary on '" + filename +
+                                "' failed.");
+    }
     // Remove small integral elements
     virtual FP truncate_small(FP tol) {
         uint16_t n = n_sites();
@@ -1380,6 +1621,7 @@ template <typename FL> struct FCIDUMP {
             rvs[i].reorder(vs[i], ord);
         }
         vdata = rdata;
+        mdata = nullptr;
         data = rdata->data();
         ts = rts, vgs = rvgs, vabs = rvabs, vs = rvs;
         if (params.count("orbsym"))
@@ -1431,12 +1673,14 @@ template <typename FL> struct FCIDUMP {
             rvs[i].rotate(vs[i], rot_mat);
         }
         vdata = rdata;
+        mdata = nullptr;
         data = rdata->data();
         ts = rts, vgs = rvgs, vabs = rvabs, vs = rvs;
     }
     virtual shared_ptr<FCIDUMP> deep_copy() const {
         shared_ptr<FCIDUMP> fcidump = make_shared<FCIDUMP>(*this);
-        fcidump->vdata = make_shared<vector<FL>>(*vdata);
+        fcidump->vdata = make_shared<vector<FL>>(data, data + total_memory);
+        fcidump->mdata = nullptr;
         fcidump->data = fcidump->vdata->data();
         vector<TInt<FL>> rts(ts);
         vector<V1Int<FL>> rvgs(vgs);
@@ -1479,6 +1723,7 @@ template <typename FL> struct FCIDUMP {
     virtual void deallocate() {
         assert(total_memory != 0);
         vdata = nullptr;
+        mdata = nullptr;
         data = nullptr;
         ts.clear();
         vs.clear();
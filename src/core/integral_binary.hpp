@@ -0,0 +1,272 @@
+
+/*
+ * block2: Efficient MPO implementation of quantum chemistry DMRG
+ * Copyright (C) 2020-2021 Huanchen Zhai <hczhai@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/** Binary file format for integrals (memory-mappable alternative to FCIDUMP
+ * text files). */
+
+#pragma once
+
+#include "fp_codec.hpp"
+#include "utils.hpp"
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define _HAS_MMAP_INTEGRAL
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace block2 {
+
+/** Kinds of integral arrays in the binary integral file. */
+enum struct IntegralArrayTypes : uint8_t {
+    T = 0,  //!< One-electron integrals (TInt).
+    V8 = 1, //!< Two-electron integrals with 8-fold symmetry (V8Int).
+    V4 = 2, //!< Two-electron integrals with 4-fold symmetry (V4Int).
+    V1 = 3  //!< Two-electron integrals without symmetry (V1Int).
+};
+
+/** Description of one integral array (section) in the binary integral file.
+ */
+struct IntegralSection {
+    IntegralArrayTypes type; //!< Kind of the integral array.
+    uint8_t general;    //!< Whether the one-electron array has no symmetry.
+    uint8_t compressed; //!< Whether the payload is written by FPCodec.
+    uint8_t reserved;   //!< Unused (padding).
+    uint32_t n;         //!< Number of orbitals.
+    uint64_t len;       //!< Number of (FL) elements in the array.
+    uint64_t offset;    //!< Position of the payload in the file (in bytes).
+    uint64_t nbytes;    //!< Size of the payload in the file (in bytes).
+    IntegralSection() : IntegralSection(IntegralArrayTypes::T, 0, 0) {}
+    IntegralSection(IntegralArrayTypes type, uint32_t n, uint64_t len,
+                    bool general = false)
+        : type(type), general(general), compressed(0), reserved(0), n(n),
+          len(len), offset(0), nbytes(0) {}
+};
+
+static_assert(sizeof(IntegralSection) == 32,
+              "IntegralSection must have a fixed binary layout");
+
+/** Header of the binary integral file.
+ * File layout: header | params | section table | payloads.
+ * Uncompressed payloads start at page-aligned offsets, so that the whole file
+ * can be memory-mapped and used in place.
+ */
+struct BinaryIntegralHeader {
+    static const uint32_t version = 1; //!< Version of the file format.
+    static const size_t alignment =
+        4096; //!< Alignment of the payloads (in bytes).
+    uint8_t fl_size = 0;    //!< sizeof(FL) of the stored arrays.
+    uint8_t is_complex = 0; //!< Whether the stored arrays are complex.
+    uint8_t uhf = 0;        //!< Whether the integrals are spin-unrestricted.
+    uint8_t general = 0; //!< Whether the two-electron arrays have no symmetry.
+    string const_e;      //!< Constant energy (as text, with full precision).
+    map<string, string> params; //!< FCIDUMP namelist (including orbsym).
+    vector<IntegralSection> sections; //!< Integral arrays.
+    /** Get the magic string at the beginning of the file. */
+    static const char *magic() { return "B2INTBIN"; }
+    /** Check whether a file is in binary integral format.
+     * @param filename The file name.
+     * @return true if the file starts with the magic string.
+     */
+    static bool is_binary(const string &filename) {
+        ifstream ifs(filename.c_str(), ios::binary);
+        char mg[8];
+        if (!ifs.good() || !ifs.read(mg, 8))
+            return false;
+        return memcmp(mg, magic(), 8) == 0;
+    }
+    /** Round a file position up to the payload alignment. */
+    static uint64_t align(uint64_t x) {
+        return (x + alignment - 1) / alignment * alignment;
+    }
+    static void write_string(ostream &ofs, const string &x) {
+        uint64_t l = x.length();
+        ofs.write((char *)&l, sizeof(l));
+        ofs.write(x.c_str(), l);
+    }
+    static string read_string(istream &ifs) {
+        uint64_t l = 0;
+        ifs.read((char *)&l, sizeof(l));
+        string x(l, ' ');
+        ifs.read(&x[0], l);
+        return x;
+    }
+    /** Size of the header, params and section table (in bytes). */
+    size_t size() const {
+        stringstream ss;
+        write(ss);
+        return (size_t)ss.tellp();
+    }
+    /** Assign page-aligned offsets to all (uncompressed) payloads.
+     * @return Total size of the file (in bytes).
+     */
+    uint64_t layout() {
+        uint64_t offset = size();
+        for (auto &s : sections) {
+            s.offset = align(offset);
+            s.nbytes = s.len * fl_size;
+            offset = s.offset + s.nbytes;
+        }
+        return offset;
+    }
+    void write(ostream &ofs) const {
+        ofs.write(magic(), 8);
+        uint32_t ver = version;
+        ofs.write((char *)&ver, sizeof(ver));
+        uint8_t flags[4] = {fl_size, is_complex, uhf, general};
+        ofs.write((char *)flags, sizeof(flags));
+        write_string(ofs, const_e);
+        uint64_t np = params.size(), ns = sections.size();
+        ofs.write((char *)&np, sizeof(np));
+        for (auto &p : params)
+            write_string(ofs, p.first), write_string(ofs, p.second);
+        ofs.write((char *)&ns, sizeof(ns));
+        ofs.write((char *)sections.data(), sizeof(IntegralSection) * ns);
+    }
+    void read(istream &ifs) {
+        char mg[8];
+        ifs.read(mg, 8);
+        if (!ifs.good() || memcmp(mg, magic(), 8) != 0)
+            throw runtime_error("BinaryIntegralHeader::read bad magic.");
+        uint32_t ver = 0;
+        ifs.read((char *)&ver, sizeof(ver));
+        if (ver != version)
+            throw runtime_error(
+                "BinaryIntegralHeader::read unsupported version " +
+                Parsing::to_string(ver) + ".");
+        uint8_t flags[4];
+        ifs.read((char *)flags, sizeof(flags));
+        fl_size = flags[0], is_complex = flags[1], uhf = flags[2],
+        general = flags[3];
+        const_e = read_string(ifs);
+        uint64_t np = 0, ns = 0;
+        ifs.read((char *)&np, sizeof(np));
+        params.clear();
+        for (uint64_t i = 0; i < np; i++) {
+            string k = read_string(ifs);
+            params[k] = read_string(ifs);
+        }
+        ifs.read((char *)&ns, sizeof(ns));
+        sections.resize(ns);
+        ifs.read((char *)sections.data(), sizeof(IntegralSection) * ns);
+        if (!ifs.good())
+            throw runtime_error("BinaryIntegralHeader::read failed.");
+    }
+    /** Get the constant energy as text. The text has a fixed length, so
+     * that the header can be rewritten in place once the constant is known.
+     * @param x The constant energy.
+     */
+    template <typename T> static string const_to_string(T x) {
+        const int prec = numeric_limits<long double>::max_digits10;
+        stringstream ss;
+        ss << scientific << setprecision(prec) << setw(prec + 10)
+           << (long double)real(x) << setw(prec + 10) << (long double)imag(x);
+        return ss.str();
+    }
+    template <typename T>
+    static typename enable_if<!block2::is_complex<T>::value, T>::type
+    const_from_string(const string &x) {
+        stringstream ss(x);
+        long double re = 0, im = 0;
+        ss >> re >> im;
+        return (T)re;
+    }
+    template <typename T>
+    static typename enable_if<block2::is_complex<T>::value, T>::type
+    const_from_string(const string &x) {
+        stringstream ss(x);
+        long double re = 0, im = 0;
+        ss >> re >> im;
+        return T((typename T::value_type)re, (typename T::value_type)im);
+    }
+};
+
+/** Memory mapping of a whole file. When memory mapping is not supported,
+ * the read-only mapping is emulated by reading the file into memory.
+ */
+struct MappedIntegralFile {
+    char *ptr = nullptr; //!< Beginning of the file in memory.
+    size_t len = 0;      //!< Size of the file.
+    vector<char> buf;    //!< Storage when memory mapping is not supported.
+    /** Constructor.
+     * @param filename The file name.
+     * @param shared If true, changes are written back to the file.
+     * Otherwise the mapping is private and copy-on-write.
+     */
+    MappedIntegralFile(const string &filename, bool shared = false) {
+#ifdef _HAS_MMAP_INTEGRAL
+        int fd = open(filename.c_str(), shared ? O_RDWR : O_RDONLY);
+        if (fd == -1)
+            throw runtime_error("MappedIntegralFile on '" + filename +
+                                "' failed.");
+        len = (size_t)lseek(fd, 0, SEEK_END);
+        void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                       shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED)
+            throw runtime_error("MappedIntegralFile on '" + filename +
+                                "' failed.");
+        ptr = (char *)p;
+#else
+        if (shared)
+            throw runtime_error("MappedIntegralFile shared mapping is not "
+                                "supported on this platform.");
+        ifstream ifs(filename.c_str(), ios::binary);
+        if (!ifs.good())
+            throw runtime_error("MappedIntegralFile on '" + filename +
+                                "' failed.");
+        ifs.seekg(0, ios::end);
+        len = (size_t)ifs.tellg();
+        ifs.seekg(0, ios::beg);
+        buf.resize(len);
+        ifs.read(buf.data(), len);
+        ptr = buf.data();
+#endif
+    }
+    MappedIntegralFile(const MappedIntegralFile &) = delete;
+    MappedIntegralFile &operator=(const MappedIntegralFile &) = delete;
+    ~MappedIntegralFile() {
+#ifdef _HAS_MMAP_INTEGRAL
+        if (ptr != nullptr)
+            munmap(ptr, len);
+#endif
+    }
+    /** Whether the platform supports memory mapping. */
+    static bool supported() {
+#ifdef _HAS_MMAP_INTEGRAL
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+} // namespace block2
@@ -569,8 +569,154 @@ template <typename FL> struct CompressedFCIDUMP : FCIDUMP<FL> {
             throw runtime_error("FCIDUMP::write on '" + filename + "' failed.");
         ofs.close();
     }
-    // Parsing a FCIDUMP file
+    // Compressed array without the multi-threading wrapper
+    static shared_ptr<CompressedVector<FP>>
+    base_vector(const shared_ptr<CompressedVector<FP>> &cv) {
+        shared_ptr<CompressedVectorMT<FP>> mcv =
+            dynamic_pointer_cast<CompressedVectorMT<FP>>(cv);
+        return mcv != nullptr ? mcv->ref_cv : cv;
+    }
+    // Compressed arrays of all integrals (in storage order)
+    vector<shared_ptr<CompressedVector<FP>>> array_data() const {
+        vector<shared_ptr<CompressedVector<FP>>> cvs;
+        for (auto &x : cps_ts)
+            cvs.push_back(base_vector(x.cps_data));
+        for (auto &x : cps_vs)
+            cvs.push_back(base_vector(x.cps_data));
+        for (auto &x : cps_vabs)
+            cvs.push_back(base_vector(x.cps_data));
+        for (auto &x : cps_vgs)
+            cvs.push_back(base_vector(x.cps_data));
+        return cvs;
+    }
+    // Writing binary integral file to disk
+    // The compressed chunks are written as they are (prec is not used)
+    void write_binary(const string &filename, FP prec = 0) const override {
+        BinaryIntegralHeader hdr;
+        hdr.fl_size = (uint8_t)sizeof(FL);
+        hdr.is_complex = is_complex<FL>::value;
+        hdr.uhf = uhf, hdr.general = general;
+        hdr.const_e = BinaryIntegralHeader::const_to_string(const_e);
+        hdr.params = params;
+        for (auto &x : cps_ts)
+            hdr.sections.push_back(IntegralSection(IntegralArrayTypes::T, x.n,
+                                                   x.size(), x.general));
+        for (auto &x : cps_vs)
+            hdr.sections.push_back(
+                IntegralSection(IntegralArrayTypes::V8, x.n, x.size()));
+        for (auto &x : cps_vabs)
+            hdr.sections.push_back(
+                IntegralSection(IntegralArrayTypes::V4, x.n, x.size()));
+        for (auto &x : cps_vgs)
+            hdr.sections.push_back(
+                IntegralSection(IntegralArrayTypes::V1, x.n, x.size()));
+        for (auto &s : hdr.sections)
+            s.compressed = 1;
+        vector<shared_ptr<CompressedVector<FP>>> cvs = array_data();
+        ofstream ofs(filename.c_str(), ios::binary);
+        if (!ofs.good())
+            throw runtime_error("FCIDUMP::write_binary on '" + filename +
+                                "' failed.");
+        hdr.write(ofs);
+        // same layout as FPCodec::write_array
+        const string magic = "fpc", tail = "end";
+        for (size_t i = 0; i < cvs.size(); i++) {
+            IntegralSection &s = hdr.sections[i];
+            cvs[i]->finalize();
+            s.offset = ofs.tellp();
+            ofs.write((char *)magic.c_str(), 4);
+            ofs.write((char *)&cvs[i]->chunk_size, sizeof(size_t));
+            for (auto &cp : cvs[i]->cp_data) {
+                size_t cplen = cp.size();
+                ofs.write((char *)&cplen, sizeof(cplen));
+                ofs.write((char *)cp.data(), sizeof(FP) * cplen);
+            }
+            ofs.write((char *)tail.c_str(), 4);
+            s.nbytes = (uint64_t)ofs.tellp() - s.offset;
+        }
+        ofs.seekp(0);
+        hdr.write(ofs);
+        if (!ofs.good())
+            throw runtime_error("FCIDUMP::write_binary on '" + filename +
+                                "' failed.");
+        ofs.close();
+    }
+    // Reading binary integral file
+    // Compressed arrays are read directly. Uncompressed arrays are compressed
+    // chunk by chunk from the memory-mapped file (use_mmap is not used)
+    void read_binary(const string &filename, bool use_mmap = true) override {
+        ifstream ifs(filename.c_str(), ios::binary);
+        if (!ifs.good())
+            throw runtime_error("FCIDUMP::read_binary on '" + filename +
+                                "' failed.");
+        BinaryIntegralHeader hdr;
+        hdr.read(ifs);
+        if (hdr.fl_size != sizeof(FL) || hdr.is_complex != is_complex<FL>::value)
+            throw runtime_error("FCIDUMP::read_binary on '" + filename +
+                                "' : float type does not match.");
+        params = hdr.params;
+        const_e = BinaryIntegralHeader::const_from_string<
+            typename const_fl_type<FL>::FL>(hdr.const_e);
+        uhf = hdr.uhf, general = hdr.general;
+        cps_ts.clear();
+        cps_vs.clear();
+        cps_vabs.clear();
+        cps_vgs.clear();
+        shared_ptr<MappedIntegralFile> mfile = nullptr;
+        vector<shared_ptr<CompressedVector<FP>>> cvs;
+        for (auto &s : hdr.sections) {
+            shared_ptr<CompressedVector<FP>> cv;
+            if (s.compressed) {
+                ifs.seekg(s.offset);
+                cv = make_shared<CompressedVector<FP>>(ifs, s.len * cpx_sz,
+                                                       prec, ncache);
+            } else {
+                if (mfile == nullptr)
+                    mfile = make_shared<MappedIntegralFile>(filename);
+                cv = make_shared<CompressedVector<FP>>(s.len * cpx_sz, prec,
+                                                       chunk_size, ncache);
+                FP *arr = (FP *)(mfile->ptr + s.offset);
+                size_t nchunk = (size_t)(cv->arr_len / chunk_size +
+                                         !!(cv->arr_len % chunk_size));
+                cv->cp_data.resize(nchunk);
+                int ntg = threading->activate_global();
+#pragma omp parallel for schedule(static) num_threads(ntg)
+                for (int64_t ic = 0; ic < (int64_t)nchunk; ic++) {
+                    size_t alen =
+                        min(chunk_size, cv->arr_len - ic * chunk_size);
+                    vector<FP> &cp = cv->cp_data[ic];
+                    cp.resize(alen + 1);
+                    cp.resize(
+                        cv->fpc.encode(arr + ic * chunk_size, alen, cp.data()));
+                    cp.shrink_to_fit();
+                }
+                threading->activate_normal();
+            }
+            if (s.type == IntegralArrayTypes::T) {
+                cps_ts.push_back(CompressedTInt<FL>((uint16_t)s.n, s.general));
+                cps_ts.back().cps_data = cv;
+            } else if (s.type == IntegralArrayTypes::V8) {
+                cps_vs.push_back(CompressedV8Int<FL>(s.n));
+                cps_vs.back().cps_data = cv;
+            } else if (s.type == IntegralArrayTypes::V4) {
+                cps_vabs.push_back(CompressedV4Int<FL>(s.n));
+                cps_vabs.back().cps_data = cv;
+            } else {
+                cps_vgs.push_back(CompressedV1Int<FL>(s.n));
+                cps_vgs.back().cps_data = cv;
+            }
+        }
+        if (!ifs.good())
+            throw runtime_error("FCIDUMP::read_binary on '" + filename +
+                                "' failed.");
+        freeze();
+    }
+    // Parsing a FCIDUMP file (text or binary integral file)
     void read(const string &filename) override {
+        if (BinaryIntegralHeader::is_binary(filename)) {
+            read_binary(filename);
+            return;
+        }
         params.clear();
         cps_ts.clear();
         cps_vs.clear();
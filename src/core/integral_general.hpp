@@ -33,6 +33,7 @@
 #include <map>
 #include <stdexcept>
 #include <string>
+#include <typeinfo>
 #include <unordered_map>
 #include <vector>
 
@@ -55,6 +56,122 @@ template <typename FL> struct GeneralFCIDUMP {
     GeneralFCIDUMP() : elem_type(ElemOpTypes::SU2) {}
     GeneralFCIDUMP(ElemOpTypes elem_type) : elem_type(elem_type) {}
     virtual ~GeneralFCIDUMP() = default;
+    // Collect terms (i, j, k, l) of two-electron integrals in lexicographic
+    // order using all threads. f(arr, x) sets x to the integral and returns
+    // whether it is significant. Contiguous ranges of (i, j) are assigned to
+    // threads, and the per-thread buffers are concatenated in thread order,
+    // so that the result does not depend on the number of threads.
+    // hint: estimated number of terms (for pre-sizing the buffers)
+    template <typename F>
+    static void add_qc_two_body_term(uint16_t n, F f, FL factor,
+                                     vector<uint16_t> &idx, vector<FL> &dt,
+                                     size_t hint = 0) {
+        int ntg = threading->activate_global();
+        const size_t nrow = (size_t)n * n;
+        const size_t prow = nrow / ntg + !!(nrow % ntg);
+        vector<vector<uint16_t>> pidx(ntg);
+        vector<vector<FL>> pdt(ntg);
+        vector<size_t> ms(ntg + 1, 0);
+#pragma omp parallel num_threads(ntg)
+        {
+            int tid = threading->get_thread_id();
+            pidx[tid].reserve(hint / ntg * 4);
+            pdt[tid].reserve(hint / ntg);
+            array<uint16_t, 4> arr;
+            FL x;
+            for (size_t ir = prow * tid; ir < min(nrow, prow * (tid + 1));
+                 ir++) {
+                arr[0] = (uint16_t)(ir / n), arr[1] = (uint16_t)(ir % n);
+                for (arr[2] = 0; arr[2] < n; arr[2]++)
+                    for (arr[3] = 0; arr[3] < n; arr[3]++)
+                        if (f(arr, x)) {
+                            pidx[tid].insert(pidx[tid].end(), arr.begin(),
+                                             arr.end());
+                            pdt[tid].push_back(factor * x);
+                        }
+            }
+            ms[tid + 1] = pdt[tid].size();
+#pragma omp barrier
+#pragma omp single
+            {
+                for (int i = 0; i < ntg; i++)
+                    ms[i + 1] += ms[i];
+                idx.resize(ms[ntg] * 4);
+                dt.resize(ms[ntg]);
+            }
+            if (pdt[tid].size() != 0) {
+                memcpy(idx.data() + ms[tid] * 4, pidx[tid].data(),
+                       sizeof(uint16_t) * pidx[tid].size());
+                memcpy(dt.data() + ms[tid], pdt[tid].data(),
+                       sizeof(FL) * pdt[tid].size());
+            }
+            vector<uint16_t>().swap(pidx[tid]);
+            vector<FL>().swap(pdt[tid]);
+        }
+        threading->activate_normal();
+    }
+    // Cutoff test for each stored (symmetry-unique) element of V8Int or
+    // V4Int, so that abs is evaluated once instead of up to 8 times
+    template <typename VInt>
+    static vector<uint8_t> significant_elements(const VInt &v, FP cutoff,
+                                                size_t &count) {
+        vector<uint8_t> nz(v.size());
+        count = 0;
+        int ntg = threading->activate_global();
+#pragma omp parallel for schedule(static) num_threads(ntg) reduction(+ : count)
+        for (int64_t i = 0; i < (int64_t)v.size(); i++)
+            count += (nz[i] = abs(v.data[i]) > cutoff);
+        threading->activate_normal();
+        return nz;
+    }
+    // Two-electron integrals v(i, l, j, k) (sz = false)
+    // or v(si, sj, i, l, j, k) (sz = true) -> terms (i, j, k, l)
+    static void add_qc_two_body_term(const shared_ptr<FCIDUMP<FL>> &fcidump,
+                                     bool sz, uint8_t si, uint8_t sj,
+                                     FP cutoff, FL factor,
+                                     vector<uint16_t> &idx, vector<FL> &dt) {
+        uint16_t n = fcidump->n_sites();
+        // integral arrays are only accessed directly when v is not overridden
+        if (typeid(*fcidump) == typeid(FCIDUMP<FL>) && !fcidump->general) {
+            size_t count = 0;
+            if (!sz || !fcidump->uhf || si == sj) {
+                const V8Int<FL> &v8 = fcidump->vs[sz && fcidump->uhf ? si : 0];
+                vector<uint8_t> nz = significant_elements(v8, cutoff, count);
+                add_qc_two_body_term(
+                    n,
+                    [&v8, &nz](const array<uint16_t, 4> &arr, FL &x) {
+                        size_t p = v8.find_index(arr[0], arr[3], arr[1], arr[2]);
+                        x = v8.data[p];
+                        return (bool)nz[p];
+                    },
+                    factor, idx, dt, count * 8);
+            } else {
+                const V4Int<FL> &v4 = fcidump->vabs[0];
+                vector<uint8_t> nz = significant_elements(v4, cutoff, count);
+                const bool swap = si == 1;
+                add_qc_two_body_term(
+                    n,
+                    [&v4, &nz, swap](const array<uint16_t, 4> &arr, FL &x) {
+                        size_t p = swap ? v4.find_index(arr[1], arr[2], arr[0],
+                                                        arr[3])
+                                        : v4.find_index(arr[0], arr[3], arr[1],
+                                                        arr[2]);
+                        x = v4.data[p];
+                        return (bool)nz[p];
+                    },
+                    factor, idx, dt, count * 4);
+            }
+        } else
+            add_qc_two_body_term(
+                n,
+                [&fcidump, sz, si, sj, cutoff](const array<uint16_t, 4> &arr,
+                                               FL &x) {
+                    x = sz ? fcidump->v(si, sj, arr[0], arr[3], arr[1], arr[2])
+                           : fcidump->v(arr[0], arr[3], arr[1], arr[2]);
+                    return abs(x) > cutoff;
+                },
+                factor, idx, dt);
+    }
     static shared_ptr<GeneralFCIDUMP>
     initialize_from_qc(const shared_ptr<FCIDUMP<FL>> &fcidump,
                        ElemOpTypes elem_type, FP cutoff = (FP)0.0) {
@@ -70,16 +187,8 @@ template <typename FL> struct GeneralFCIDUMP {
             auto *idx = &r->indices.back();
             auto *dt = &r->data.back();
             array<uint16_t, 4> arr;
-            for (arr[0] = 0; arr[0] < n; arr[0]++)
-                for (arr[1] = 0; arr[1] < n; arr[1]++)
-                    for (arr[2] = 0; arr[2] < n; arr[2]++)
-                        for (arr[3] = 0; arr[3] < n; arr[3]++)
-                            if (abs(fcidump->v(arr[0], arr[3], arr[1],
-                                               arr[2])) > cutoff) {
-                                idx->insert(idx->end(), arr.begin(), arr.end());
-                                dt->push_back(
-                                    fcidump->v(arr[0], arr[3], arr[1], arr[2]));
-                            }
+            add_qc_two_body_term(fcidump, false, 0, 0, cutoff, (FL)1.0, *idx,
+                                 *dt);
             r->exprs.push_back("(C+D)0");
             r->indices.push_back(vector<uint16_t>());
             r->data.push_back(vector<FL>());
@@ -99,23 +208,9 @@ template <typename FL> struct GeneralFCIDUMP {
                 for (uint8_t sj = 0; sj < 2; sj++) {
                     r->indices.push_back(vector<uint16_t>());
                     r->data.push_back(vector<FL>());
-                    auto *idx = &r->indices.back();
-                    auto *dt = &r->data.back();
-                    array<uint16_t, 4> arr;
-                    for (arr[0] = 0; arr[0] < n; arr[0]++)
-                        for (arr[1] = 0; arr[1] < n; arr[1]++)
-                            for (arr[2] = 0; arr[2] < n; arr[2]++)
-                                for (arr[3] = 0; arr[3] < n; arr[3]++)
-                                    if (abs(fcidump->v(si, sj, arr[0], arr[3],
-                                                       arr[1], arr[2])) >
-                                        cutoff) {
-                                        idx->insert(idx->end(), arr.begin(),
-                                                    arr.end());
-                                        dt->push_back((FL)0.5 *
-                                                      fcidump->v(si, sj, arr[0],
-                                                                 arr[3], arr[1],
-                                                                 arr[2]));
-                                    }
+                    add_qc_two_body_term(fcidump, true, si, sj, cutoff,
+                                         (FL)0.5, r->indices.back(),
+                                         r->data.back());
                 }
             r->exprs.push_back("cd");
             r->exprs.push_back("CD");
@@ -140,17 +235,8 @@ template <typename FL> struct GeneralFCIDUMP {
             auto *idx = &r->indices.back();
             auto *dt = &r->data.back();
             array<uint16_t, 4> arr;
-            for (arr[0] = 0; arr[0] < n; arr[0]++)
-                for (arr[1] = 0; arr[1] < n; arr[1]++)
-                    for (arr[2] = 0; arr[2] < n; arr[2]++)
-                        for (arr[3] = 0; arr[3] < n; arr[3]++)
-                            if (abs(fcidump->v(arr[0], arr[3], arr[1],
-                                               arr[2])) > cutoff) {
-                                idx->insert(idx->end(), arr.begin(), arr.end());
-                                dt->push_back(
-                                    (FL)0.5 *
-                                    fcidump->v(arr[0], arr[3], arr[1], arr[2]));
-                            }
+            add_qc_two_body_term(fcidump, false, 0, 0, cutoff, (FL)0.5, *idx,
+                                 *dt);
             r->exprs.push_back("CD");
             r->indices.push_back(vector<uint16_t>());
             r->data.push_back(vector<FL>());
@@ -30,6 +30,29 @@ using namespace std;
 
 namespace block2 {
 
+// Krylov subspace carried between linear solves whose operators only differ
+// by a scalar shift (for example, Green's function at several frequencies)
+// GCROT(m, k): cs = (op + shift) us, cs orthonormal
+// other solvers: us are the latest solutions, cs = (op + shift) us
+// deflated CG: us are approximate eigenvectors of op (cs not used)
+// empty cs with nonzero nk: us only (for example, transformed from the
+// previous site), cs is rebuilt by the next solve
+template <typename FL> struct KrylovRecycleSpace {
+    vector<FL> us, cs;
+    // vector size, number of vectors, and shift when cs was built
+    size_t n = 0;
+    int nk = 0;
+    FL shift = 0.0;
+    // max number of latest solutions kept by other solvers
+    int max_nk = 4;
+    KrylovRecycleSpace() {}
+    bool matches(size_t xn) const { return nk != 0 && n == xn; }
+    void clear() {
+        us.clear(), cs.clear();
+        n = 0, nk = 0, shift = 0.0;
+    }
+};
+
 template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
     using GMatrixFunctions<FL>::copy;
     using GMatrixFunctions<FL>::iadd;
@@ -75,8 +98,8 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
                                        const GMatrix<FL> &c, FP ld,
                                        const GDiagonalMatrix<FL> &aa) {
         assert(aa.size() == c.size());
-        shared_ptr<VectorAllocator<FP>> x_alloc =
-            make_shared<VectorAllocator<FP>>();
+        shared_ptr<ArenaAllocator<FP>> x_alloc =
+            make_shared<ArenaAllocator<FP>>();
         GMatrix<FL> t(nullptr, c.m, c.n);
         t.allocate(x_alloc);
         copy(t, c);
@@ -93,8 +116,8 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
     static void olsen_precondition(const GMatrix<FL> &q, const GMatrix<FL> &c,
                                    FP ld, const GDiagonalMatrix<FL> &aa) {
         assert(aa.size() == c.size());
-        shared_ptr<VectorAllocator<FP>> x_alloc =
-            make_shared<VectorAllocator<FP>>();
+        shared_ptr<ArenaAllocator<FP>> x_alloc =
+            make_shared<ArenaAllocator<FP>>();
         GMatrix<FL> t(nullptr, c.m, c.n);
         t.allocate(x_alloc);
         copy(t, c);
@@ -520,10 +543,10 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
         const vector<FP> &proj_weights = vector<FP>(),
         FP imag_cutoff = (FP)1E-3) {
         assert(!(davidson_type & DavidsonTypes::Harmonic));
-        shared_ptr<VectorAllocator<FL>> d_alloc =
-            make_shared<VectorAllocator<FL>>();
-        shared_ptr<VectorAllocator<FP>> x_alloc =
-            make_shared<VectorAllocator<FP>>();
+        shared_ptr<ArenaAllocator<FL>> d_alloc =
+            make_shared<ArenaAllocator<FL>>();
+        shared_ptr<ArenaAllocator<FP>> x_alloc =
+            make_shared<ArenaAllocator<FP>>();
         int k = (int)vs.size(), nor = (int)ors.size(), nwg = 0;
         int orig_k = k;
         assert(!(davidson_type & DavidsonTypes::Exact));
@@ -861,6 +884,8 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
     // aa: diag elements of a (for precondition)
     // bs: input/output vector
     // ors: orthogonal states to be projected out
+    // stall_max_iter: if positive, stop (as for soft_max_iter) when the
+    //   residual of the current root is not halved within this many iterations
     template <typename MatMul, typename PComm>
     static vector<FP>
     davidson(MatMul &op, const GDiagonalMatrix<FL> &aa, vector<GMatrix<FL>> &vs,
@@ -871,7 +896,7 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
              int deflation_max_size = 50,
              const vector<GMatrix<FL>> &ors = vector<GMatrix<FL>>(),
              const vector<FP> &proj_weights = vector<FP>(),
-             FP imag_cutoff = (FP)1E-3) {
+             FP imag_cutoff = (FP)1E-3, int stall_max_iter = -1) {
         assert(!(davidson_type & DavidsonTypes::Harmonic));
         shared_ptr<VectorAllocator<FL>> d_alloc =
             make_shared<VectorAllocator<FL>>();
@@ -886,6 +911,20 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
                 op, aa, vs, davidson_type, ndav, iprint, pcomm, conv_thrd,
                 rel_conv_thrd, max_iter, soft_max_iter, deflation_min_size,
                 deflation_max_size, imag_cutoff);
+        if ((davidson_type & DavidsonTypes::Lanczos) ||
+            (davidson_type & DavidsonTypes::LOBPCG))
+            assert(!(davidson_type & DavidsonTypes::GreaterThan) &&
+                   !(davidson_type & DavidsonTypes::LessThan) &&
+                   !(davidson_type & DavidsonTypes::CloseTo));
+        if (davidson_type & DavidsonTypes::Lanczos)
+            return thick_restart_lanczos(
+                op, vs, davidson_type, ndav, iprint, pcomm, conv_thrd,
+                rel_conv_thrd, max_iter, soft_max_iter, deflation_min_size,
+                deflation_max_size, ors, proj_weights);
+        if (davidson_type & DavidsonTypes::LOBPCG)
+            return lobpcg(op, aa, vs, davidson_type, ndav, iprint, pcomm,
+                          conv_thrd, rel_conv_thrd, max_iter, soft_max_iter,
+                          ors, proj_weights);
         // if proj_weights is empty or ElementProj, then projection is done by
         // (1 - |v><v|). if proj_weights is not empty, projection is done by
         // change H to (H + w |v><v|)
@@ -959,6 +998,9 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
         if (pcomm == nullptr || pcomm->root == pcomm->rank)
             q.allocate(x_alloc);
         int ck = 0, msig = 0, xiter = 0;
+        int stall_ck = -1, stall_iter = 0;
+        bool stalled = false;
+        FP stall_qq = 0;
         FL qq;
         if (iprint)
             cout << endl;
@@ -1146,13 +1188,19 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
                     copy(bs[m], q);
                 }
                 m++;
+                if (stall_max_iter > 0) {
+                    if (ck != stall_ck || abs(qq) < stall_qq * (FP)0.5)
+                        stall_ck = ck, stall_qq = abs(qq), stall_iter = 0;
+                    else if (++stall_iter >= stall_max_iter)
+                        stalled = true;
+                }
             }
-            if (xiter == soft_max_iter)
+            if (xiter == soft_max_iter || stalled)
                 break;
         }
-        if (xiter == soft_max_iter)
+        if (xiter == soft_max_iter || stalled)
             eigvals.resize(k, 0);
-        if (xiter == max_iter) {
+        if (xiter == max_iter && !stalled) {
             cout << "Error : only " << ck << " converged!" << endl;
             assert(false);
         }
@@ -1171,6 +1219,784 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
         ndav = xiter;
         return eigvals;
     }
+    // Block Davidson algorithm
+    // Corrections for all unconverged roots are added in the same iteration
+    // and multiplied in one call of op, so that a can be applied to several
+    // vectors in one pass
+    // op(bs, sigmas): [sigmas[i]] = [a] x [bs[i]] for all i
+    // aa: diag elements of a (for precondition)
+    // vs: input/output vectors
+    // ors: orthogonal states to be projected out
+    template <typename BlockMatMul, typename PComm>
+    static vector<FP> block_davidson(
+        BlockMatMul &op, const GDiagonalMatrix<FL> &aa, vector<GMatrix<FL>> &vs,
+        FP shift, DavidsonTypes davidson_type, int &ndav, bool iprint = false,
+        const PComm &pcomm = nullptr, FP conv_thrd = 5E-6,
+        FP rel_conv_thrd = 0.0, int max_iter = 5000, int soft_max_iter = -1,
+        int deflation_min_size = 2, int deflation_max_size = 50,
+        const vector<GMatrix<FL>> &ors = vector<GMatrix<FL>>(),
+        const vector<FP> &proj_weights = vector<FP>()) {
+        assert(!(davidson_type & DavidsonTypes::Harmonic));
+        if ((davidson_type & DavidsonTypes::Exact) ||
+            (davidson_type & DavidsonTypes::NonHermitian) ||
+            (davidson_type & DavidsonTypes::Lanczos) ||
+            (davidson_type & DavidsonTypes::LOBPCG)) {
+            const function<void(const GMatrix<FL> &, const GMatrix<FL> &)> &f =
+                [&op](const GMatrix<FL> &b, const GMatrix<FL> &c) {
+                    op(vector<GMatrix<FL>>{b}, vector<GMatrix<FL>>{c});
+                };
+            return davidson(f, aa, vs, shift, davidson_type, ndav, iprint,
+                            pcomm, conv_thrd, rel_conv_thrd, max_iter,
+                            soft_max_iter, deflation_min_size,
+                            deflation_max_size, ors, proj_weights);
+        }
+        shared_ptr<VectorAllocator<FL>> d_alloc =
+            make_shared<VectorAllocator<FL>>();
+        shared_ptr<VectorAllocator<FP>> x_alloc =
+            make_shared<VectorAllocator<FP>>();
+        int k = (int)vs.size(), nor = (int)ors.size(), nwg = 0;
+        if (davidson_type & DavidsonTypes::ElementProj)
+            ;
+        else if (proj_weights.size() != 0) {
+            assert(proj_weights.size() == ors.size());
+            nwg = (int)ors.size(), nor = 0;
+        }
+        if (deflation_min_size < k)
+            deflation_min_size = k;
+        // room for one correction per root after deflation
+        if (deflation_max_size < deflation_min_size + k)
+            deflation_max_size = deflation_min_size + k;
+        GMatrix<FL> pbs(nullptr, (MKL_INT)(deflation_max_size * vs[0].size()),
+                        1);
+        GMatrix<FL> pss(nullptr, (MKL_INT)(deflation_max_size * vs[0].size()),
+                        1);
+        pbs.data = d_alloc->allocate(deflation_max_size * vs[0].size());
+        pss.data = d_alloc->allocate(deflation_max_size * vs[0].size());
+        vector<GMatrix<FL>> bs(deflation_max_size,
+                               GMatrix<FL>(nullptr, vs[0].m, vs[0].n));
+        vector<GMatrix<FL>> sigmas(deflation_max_size,
+                                   GMatrix<FL>(nullptr, vs[0].m, vs[0].n));
+        vector<FL> or_normsqs(nor);
+        for (int i = 0; i < nor; i++) {
+            for (int j = 0; j < i; j++)
+                if (abs(or_normsqs[j]) > 1E-14)
+                    iadd(ors[i], ors[j],
+                         -complex_dot(ors[j], ors[i]) / or_normsqs[j]);
+            or_normsqs[i] = complex_dot(ors[i], ors[i]);
+        }
+        for (int i = 0; i < deflation_max_size; i++) {
+            bs[i].data = pbs.data + bs[i].size() * i;
+            sigmas[i].data = pss.data + sigmas[i].size() * i;
+        }
+        for (int i = 0; i < k; i++)
+            copy(bs[i], vs[i]);
+        int m = k;
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < i; j++)
+                iadd(bs[i], bs[j], -complex_dot(bs[j], bs[i]));
+            FL normx = norm(bs[i]);
+            if (abs(normx * normx) < 1E-14 && i > 0) {
+                m = i;
+                if (iprint)
+                    cout << "Block Davidson: keeping only " << m
+                         << " initials." << endl;
+                break;
+            }
+            iscale(bs[i], (FP)1.0 / normx);
+        }
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < nor; j++)
+                if (abs(or_normsqs[j]) > 1E-14)
+                    iadd(bs[i], ors[j],
+                         -complex_dot(ors[j], bs[i]) / or_normsqs[j]);
+            FL normx = norm(bs[i]);
+            if (abs(normx * normx) < 1E-14) {
+                stringstream ss;
+                ss << "Cannot generate initial guess " << i
+                   << " for Davidson unitary to all given states (you are "
+                      "possibly targeting a global symmetry sector with no "
+                      "states or MPS has zero norm)!";
+                throw runtime_error(ss.str());
+            }
+            iscale(bs[i], (FP)1.0 / normx);
+        }
+        vector<FP> eigvals(k, 0);
+        vector<int> eigval_idxs(deflation_max_size);
+        for (int i = 0; i < deflation_max_size; i++)
+            eigval_idxs[i] = i;
+        vector<GMatrix<FL>> qs(k, GMatrix<FL>(nullptr, bs[0].m, bs[0].n));
+        if (pcomm == nullptr || pcomm->root == pcomm->rank)
+            for (int i = 0; i < k; i++)
+                qs[i].allocate(x_alloc);
+        // status: converged roots, subspace size, multiplied size, finished
+        int xiter = 0, msig = 0, status[4] = {0, m, 0, 0};
+        if (iprint)
+            cout << endl;
+        while (xiter < max_iter &&
+               (soft_max_iter == -1 || xiter < soft_max_iter)) {
+            xiter++;
+            if (pcomm != nullptr && xiter != 1)
+                pcomm->broadcast(pbs.data + bs[0].size() * msig,
+                                 bs[0].size() * (m - msig), pcomm->root);
+            for (int i = msig; i < m; i++)
+                sigmas[i].clear();
+            op(vector<GMatrix<FL>>(bs.begin() + msig, bs.begin() + m),
+               vector<GMatrix<FL>>(sigmas.begin() + msig, sigmas.begin() + m));
+            for (int i = msig; i < m; i++)
+                for (int j = 0; j < nwg; j++)
+                    iadd(sigmas[i], ors[j],
+                         complex_dot(ors[j], bs[i]) * proj_weights[j]);
+            msig = m;
+            if (pcomm == nullptr || pcomm->root == pcomm->rank) {
+                GDiagonalMatrix<FP> ld(nullptr, m);
+                GMatrix<FL> alpha(nullptr, m, m);
+                ld.allocate(x_alloc);
+                alpha.allocate(x_alloc);
+                vector<GMatrix<FL>> tmp(m,
+                                        GMatrix<FL>(nullptr, bs[0].m, bs[0].n));
+                for (int i = 0; i < m; i++)
+                    tmp[i].allocate(x_alloc);
+                int ntg = threading->activate_global();
+#pragma omp parallel num_threads(ntg)
+                {
+#ifdef _MSC_VER
+#pragma omp for schedule(dynamic)
+                    for (int ij = 0; ij < m * m; ij++) {
+                        int i = ij / m, j = ij % m;
+#else
+#pragma omp for schedule(dynamic) collapse(2)
+                    for (int i = 0; i < m; i++)
+                        for (int j = 0; j < m; j++) {
+#endif
+                        if (j <= i)
+                            alpha(i, j) = complex_dot(bs[i], sigmas[j]);
+                    }
+#pragma omp single
+                    eigs(alpha, ld);
+#pragma omp for schedule(static)
+                    for (int j = 0; j < m; j++) {
+                        copy(tmp[j], sigmas[j]);
+                        iscale(sigmas[j], alpha(j, j));
+                    }
+#pragma omp for schedule(static)
+                    for (int j = 0; j < m; j++)
+                        for (int i = 0; i < m; i++)
+                            if (i != j)
+                                iadd(sigmas[j], tmp[i], alpha(j, i));
+#pragma omp for schedule(static)
+                    for (int j = 0; j < m; j++) {
+                        copy(tmp[j], bs[j]);
+                        iscale(bs[j], alpha(j, j));
+                    }
+#pragma omp for schedule(static)
+                    for (int j = 0; j < m; j++)
+                        for (int i = 0; i < m; i++)
+                            if (i != j)
+                                iadd(bs[j], tmp[i], alpha(j, i));
+                }
+                threading->activate_normal();
+                alpha.deallocate(x_alloc);
+                for (int i = 0; i < m; i++)
+                    eigval_idxs[i] = i;
+                if (davidson_type & DavidsonTypes::CloseTo)
+                    sort(eigval_idxs.begin(), eigval_idxs.begin() + m,
+                         [&ld, shift](int i, int j) {
+                             return abs(ld.data[i] - shift) <
+                                    abs(ld.data[j] - shift);
+                         });
+                else if (davidson_type & DavidsonTypes::LessThan)
+                    sort(eigval_idxs.begin(), eigval_idxs.begin() + m,
+                         [&ld, shift](int i, int j) {
+                             if ((shift >= ld.data[i]) != (shift >= ld.data[j]))
+                                 return shift >= ld.data[i];
+                             else if (shift >= ld.data[i])
+                                 return shift - ld.data[i] < shift - ld.data[j];
+                             else
+                                 return ld.data[i] - shift > ld.data[j] - shift;
+                         });
+                else if (davidson_type & DavidsonTypes::GreaterThan)
+                    sort(eigval_idxs.begin(), eigval_idxs.begin() + m,
+                         [&ld, shift](int i, int j) {
+                             if ((shift > ld.data[i]) != (shift > ld.data[j]))
+                                 return shift > ld.data[j];
+                             else if (shift > ld.data[i])
+                                 return shift - ld.data[i] > shift - ld.data[j];
+                             else
+                                 return ld.data[i] - shift < ld.data[j] - shift;
+                         });
+                // residuals of the lowest k roots
+                int kk = min(k, m), nq = 0, ck = 0;
+                FP max_qq = 0;
+                for (int i = 0; i < kk; i++) {
+                    int ii = eigval_idxs[i];
+                    eigvals[i] = ld.data[ii];
+                    copy(qs[nq], sigmas[ii]);
+                    iadd(qs[nq], bs[ii], -ld(ii, ii));
+                    for (int j = 0; j < nor; j++)
+                        if (abs(or_normsqs[j]) > 1E-14)
+                            iadd(qs[nq], ors[j],
+                                 -complex_dot(ors[j], qs[nq]) / or_normsqs[j]);
+                    FP qq = abs(complex_dot(qs[nq], qs[nq]));
+                    max_qq = max(max_qq, qq);
+                    if (qq < conv_thrd + abs(ld(ii, ii)) * abs(ld(ii, ii)) *
+                                             rel_conv_thrd * rel_conv_thrd) {
+                        ck += (ck == i);
+                        continue;
+                    }
+                    if (davidson_type & DavidsonTypes::DavidsonPrecond)
+                        davidson_precondition(qs[nq], ld.data[ii], aa);
+                    else if (!(davidson_type & DavidsonTypes::NoPrecond))
+                        olsen_precondition(qs[nq], bs[ii], ld.data[ii], aa);
+                    nq++;
+                }
+                if (iprint)
+                    cout << setw(6) << xiter << setw(6) << m << setw(6) << ck
+                         << fixed << setw(15) << setprecision(8)
+                         << eigvals[min(ck, kk - 1)] << scientific << setw(13)
+                         << setprecision(2) << max_qq << endl;
+                status[0] = ck;
+                if ((ck == kk && m >= k) || nq == 0)
+                    status[3] = 1;
+                else {
+                    if (m + nq > deflation_max_size) {
+                        // keep the best Ritz vectors
+                        int mx = deflation_min_size;
+                        for (int j = 0; j < mx; j++)
+                            copy(tmp[j], bs[eigval_idxs[j]]);
+                        for (int j = 0; j < mx; j++)
+                            copy(bs[j], tmp[j]);
+                        for (int j = 0; j < mx; j++)
+                            copy(tmp[j], sigmas[eigval_idxs[j]]);
+                        for (int j = 0; j < mx; j++)
+                            copy(sigmas[j], tmp[j]);
+                        for (int j = 0; j < m; j++)
+                            eigval_idxs[j] = j;
+                        m = msig = mx;
+                    }
+                    for (int i = 0; i < nq; i++) {
+                        for (int it = 0; it < 2; it++) {
+                            for (int j = 0; j < m; j++)
+                                iadd(qs[i], bs[j], -complex_dot(bs[j], qs[i]));
+                            for (int j = 0; j < nor; j++)
+                                if (abs(or_normsqs[j]) > 1E-14)
+                                    iadd(qs[i], ors[j],
+                                         -complex_dot(ors[j], qs[i]) /
+                                             or_normsqs[j]);
+                        }
+                        FP normq = norm(qs[i]);
+                        if (normq * normq < 1E-14)
+                            continue;
+                        iscale(qs[i], (FP)1.0 / normq);
+                        copy(bs[m++], qs[i]);
+                    }
+                    if (m == msig)
+                        status[3] = 1;
+                }
+                status[1] = m, status[2] = msig;
+                for (int i = (int)tmp.size() - 1; i >= 0; i--)
+                    tmp[i].deallocate(x_alloc);
+                ld.deallocate(x_alloc);
+            }
+            if (pcomm != nullptr) {
+                pcomm->broadcast(status, 4, pcomm->root);
+                m = status[1], msig = status[2];
+            }
+            if (status[3])
+                break;
+            if (xiter == soft_max_iter)
+                break;
+        }
+        if (xiter == max_iter && status[0] < k) {
+            cout << "Error : only " << status[0] << " converged!" << endl;
+            assert(false);
+        }
+        if (pcomm == nullptr || pcomm->root == pcomm->rank)
+            for (int i = 0; i < k; i++)
+                copy(vs[i], bs[eigval_idxs[i]]);
+        if (pcomm != nullptr) {
+            pcomm->broadcast(eigvals.data(), eigvals.size(), pcomm->root);
+            for (int j = 0; j < k; j++)
+                pcomm->broadcast(vs[j].data, vs[j].size(), pcomm->root);
+        }
+        if (pcomm == nullptr || pcomm->root == pcomm->rank)
+            for (int i = k - 1; i >= 0; i--)
+                qs[i].deallocate(x_alloc);
+        d_alloc->deallocate(pss.data, deflation_max_size * vs[0].size());
+        d_alloc->deallocate(pbs.data, deflation_max_size * vs[0].size());
+        ndav = xiter;
+        return eigvals;
+    }
+    // ys[j] = sum_i coef(j, i) xs[i], in place (ys may alias xs)
+    // only a slice of the vectors is held in scratch at a time
+    static void rotate_vectors(const vector<GMatrix<FL>> &xs,
+                               const GMatrix<FL> &coef,
+                               const vector<GMatrix<FL>> &ys) {
+        assert(coef.m == (MKL_INT)ys.size() && coef.n == (MKL_INT)xs.size());
+        if (xs.size() == 0 || ys.size() == 0)
+            return;
+        const MKL_INT n = (MKL_INT)xs[0].size(), blk = min(n, (MKL_INT)4096);
+        vector<FL> tx((size_t)coef.n * blk), ty((size_t)coef.m * blk);
+        for (MKL_INT e0 = 0; e0 < n; e0 += blk) {
+            const MKL_INT eb = min(blk, n - e0);
+            GMatrix<FL> gx(tx.data(), coef.n, eb), gy(ty.data(), coef.m, eb);
+            for (MKL_INT i = 0; i < coef.n; i++)
+                memcpy(gx.data + i * eb, xs[i].data + e0, sizeof(FL) * eb);
+            multiply(coef, false, gx, false, gy, 1.0, 0.0);
+            for (MKL_INT j = 0; j < coef.m; j++)
+                memcpy(ys[j].data + e0, gy.data + j * eb, sizeof(FL) * eb);
+        }
+    }
+    // Thick-restart Lanczos algorithm for the lowest eigenvalues
+    // K. Wu, H. Simon, SIAM J. Matrix Anal. Appl. 22, 602-616 (2000).
+    // All vs start the Krylov sequence (band Lanczos), so that k > 1 roots
+    // are not missed when one guess has small overlap with its root.
+    // Only the Lanczos vectors are stored (no sigma vectors), so that
+    // deflation_max_size + k vectors are needed (davidson needs about three
+    // times as many). Full reorthogonalization is used.
+    // vs: input/output vectors
+    // ors: orthogonal states to be projected out
+    template <typename MatMul, typename PComm>
+    static vector<FP> thick_restart_lanczos(
+        MatMul &op, vector<GMatrix<FL>> &vs, DavidsonTypes davidson_type,
+        int &ndav, bool iprint = false, const PComm &pcomm = nullptr,
+        FP conv_thrd = 5E-6, FP rel_conv_thrd = 0.0, int max_iter = 5000,
+        int soft_max_iter = -1, int deflation_min_size = 2,
+        int deflation_max_size = 50,
+        const vector<GMatrix<FL>> &ors = vector<GMatrix<FL>>(),
+        const vector<FP> &proj_weights = vector<FP>()) {
+        shared_ptr<VectorAllocator<FL>> d_alloc =
+            make_shared<VectorAllocator<FL>>();
+        int k = (int)vs.size(), nor = (int)ors.size(), nwg = 0;
+        if (davidson_type & DavidsonTypes::ElementProj)
+            ;
+        else if (proj_weights.size() != 0) {
+            assert(proj_weights.size() == ors.size());
+            nwg = (int)ors.size(), nor = 0;
+        }
+        if (deflation_min_size < k)
+            deflation_min_size = k;
+        // room for at least two new Lanczos vectors after restart
+        if (deflation_max_size < deflation_min_size + 2)
+            deflation_max_size = deflation_min_size + 2;
+        // vectors [0, m) are multiplied, [m, m + q) are pending
+        const int nbs = deflation_max_size + k;
+        GMatrix<FL> pbs(nullptr, (MKL_INT)(nbs * vs[0].size()), 1);
+        pbs.data = d_alloc->allocate(nbs * vs[0].size());
+        vector<GMatrix<FL>> bs(nbs, GMatrix<FL>(nullptr, vs[0].m, vs[0].n));
+        for (int i = 0; i < nbs; i++)
+            bs[i].data = pbs.data + bs[i].size() * i;
+        vector<FL> or_normsqs(nor);
+        for (int i = 0; i < nor; i++) {
+            for (int j = 0; j < i; j++)
+                if (abs(or_normsqs[j]) > 1E-14)
+                    iadd(ors[i], ors[j],
+                         -complex_dot(ors[j], ors[i]) / or_normsqs[j]);
+            or_normsqs[i] = complex_dot(ors[i], ors[i]);
+        }
+        // orthogonalize x against bs[0:nx] and ors (twice)
+        auto orthogonalize = [&](const GMatrix<FL> &x, int nx) {
+            for (int it = 0; it < 2; it++) {
+                for (int i = 0; i < nx; i++)
+                    iadd(x, bs[i], -complex_dot(bs[i], x));
+                for (int j = 0; j < nor; j++)
+                    if (abs(or_normsqs[j]) > 1E-14)
+                        iadd(x, ors[j],
+                             -complex_dot(ors[j], x) / or_normsqs[j]);
+            }
+        };
+        int m = 0, q = 0;
+        for (int i = 0; i < k; i++) {
+            copy(bs[q], vs[i]);
+            orthogonalize(bs[q], q);
+            FP normx = norm(bs[q]);
+            if (normx * normx < 1E-14) {
+                if (q != 0)
+                    continue;
+                stringstream ss;
+                ss << "Cannot generate initial guess " << i
+                   << " for Lanczos unitary to all given states (you are "
+                      "possibly targeting a global symmetry sector with no "
+                      "states or MPS has zero norm)!";
+                throw runtime_error(ss.str());
+            }
+            iscale(bs[q++], (FP)1.0 / normx);
+        }
+        if (iprint && q != k)
+            cout << "Lanczos: keeping only " << q << " initials." << endl;
+        // hm(i, j) = <bs[i]|H|bs[j]> for multiplied j
+        // alpha/ld: Ritz vectors/values of hm[0:m, 0:m]
+        vector<FL> thm((size_t)nbs * nbs), talpha((size_t)nbs * nbs);
+        vector<FL> tcoup((size_t)k * nbs);
+        vector<FP> tld(nbs);
+        GMatrix<FL> hm(thm.data(), nbs, nbs);
+        GMatrix<FL> alpha(talpha.data(), 0, 0);
+        vector<FP> eigvals(k, 0);
+        // status: converged roots, multiplied size, pending size, finished
+        int xiter = 0, status[4] = {0, 0, q, 0};
+        if (iprint)
+            cout << endl;
+        while (xiter < max_iter &&
+               (soft_max_iter == -1 || xiter < soft_max_iter)) {
+            xiter++;
+            if (m + q == nbs) {
+                // keep the lowest Ritz vectors (about half of the space and
+                // at least k + 1) and the pending vectors
+                const int p = max(max(k + 1, deflation_min_size),
+                                  deflation_max_size / 2);
+                if (pcomm == nullptr || pcomm->root == pcomm->rank) {
+                    GMatrix<FL> coup(tcoup.data(), q, p);
+                    for (int u = 0; u < q; u++)
+                        for (int i = 0; i < p; i++) {
+                            coup(u, i) = 0.0;
+                            for (int j = 0; j < m; j++)
+                                coup(u, i) += hm(m + u, j) * alpha(i, j);
+                        }
+                    rotate_vectors(
+                        vector<GMatrix<FL>>(bs.begin(), bs.begin() + m),
+                        GMatrix<FL>(alpha.data, p, m),
+                        vector<GMatrix<FL>>(bs.begin(), bs.begin() + p));
+                    for (int u = 0; u < q; u++)
+                        copy(bs[p + u], bs[m + u]);
+                    for (int i = 0; i < p; i++) {
+                        for (int j = 0; j < p; j++)
+                            hm(i, j) = i == j ? (FL)tld[i] : (FL)0.0;
+                        for (int u = 0; u < q; u++)
+                            hm(p + u, i) = coup(u, i);
+                    }
+                }
+                m = p;
+            }
+            if (pcomm != nullptr && xiter != 1)
+                pcomm->broadcast(bs[m].data, bs[m].size(), pcomm->root);
+            const GMatrix<FL> &w = bs[m + q];
+            w.clear();
+            op(bs[m], w);
+            for (int j = 0; j < nwg; j++)
+                iadd(w, ors[j], complex_dot(ors[j], bs[m]) * proj_weights[j]);
+            m++, q--;
+            if (pcomm == nullptr || pcomm->root == pcomm->rank) {
+                for (int i = 0; i < m + q; i++) {
+                    hm(i, m - 1) = complex_dot(bs[i], w);
+                    if (i < m)
+                        hm(m - 1, i) = xconj<FL>(hm(i, m - 1));
+                }
+                for (int i = 0; i < m + q; i++)
+                    iadd(w, bs[i], -hm(i, m - 1));
+                orthogonalize(w, m + q);
+                FP beta = norm(w);
+                for (int j = 0; j < m; j++)
+                    hm(m + q, j) = 0.0;
+                if (beta * beta >= 1E-14) {
+                    iscale(w, (FP)1.0 / beta);
+                    hm(m + q, m - 1) = beta;
+                    q++;
+                }
+                alpha = GMatrix<FL>(talpha.data(), m, m);
+                GDiagonalMatrix<FP> ld(tld.data(), m);
+                for (int i = 0; i < m; i++)
+                    for (int j = 0; j <= i; j++)
+                        alpha(i, j) = hm(i, j);
+                eigs(alpha, ld);
+                // residual of Ritz vector i is sum_u bs[u] (hm x alpha[i])_u
+                // over pending vectors u
+                int kk = min(k, m), ck = 0;
+                FP max_qq = 0;
+                for (int i = 0; i < kk; i++) {
+                    eigvals[i] = ld.data[i];
+                    FP qq = 0;
+                    for (int u = m; u < m + q; u++) {
+                        FL r = 0.0;
+                        for (int j = 0; j < m; j++)
+                            r += hm(u, j) * alpha(i, j);
+                        qq += abs(r) * abs(r);
+                    }
+                    max_qq = max(max_qq, qq);
+                    if (qq < conv_thrd + abs(ld.data[i]) * abs(ld.data[i]) *
+                                             rel_conv_thrd * rel_conv_thrd)
+                        ck += (ck == i);
+                }
+                if (iprint)
+                    cout << setw(6) << xiter << setw(6) << m << setw(6) << ck
+                         << fixed << setw(15) << setprecision(8)
+                         << eigvals[min(ck, kk - 1)] << scientific << setw(13)
+                         << setprecision(2) << max_qq << endl;
+                status[0] = ck;
+                status[3] = ck == kk && m >= k;
+                if (!status[3] && q == 0) {
+                    // invariant subspace: continue from a random direction
+                    const GMatrix<FL> &x = bs[m];
+                    RandomMT rgen(xiter);
+                    rgen.fill<FP>((FP *)x.data, x.size() * cpx_sz, -1.0, 1.0);
+                    orthogonalize(x, m);
+                    FP normx = norm(x);
+                    // the whole space has been spanned
+                    if (normx * normx < 1E-14)
+                        status[0] = kk, status[3] = 1;
+                    else {
+                        iscale(x, (FP)1.0 / normx);
+                        for (int j = 0; j < m; j++)
+                            hm(m, j) = 0.0;
+                        q = 1;
+                    }
+                }
+                status[1] = m, status[2] = q;
+            }
+            if (pcomm != nullptr) {
+                pcomm->broadcast(status, 4, pcomm->root);
+                m = status[1], q = status[2];
+            }
+            if (status[3])
+                break;
+            if (xiter == soft_max_iter)
+                break;
+        }
+        if (xiter == max_iter && status[0] < k) {
+            cout << "Error : only " << status[0] << " converged!" << endl;
+            assert(false);
+        }
+        if (pcomm == nullptr || pcomm->root == pcomm->rank) {
+            const int kk = min(k, m);
+            rotate_vectors(vector<GMatrix<FL>>(bs.begin(), bs.begin() + m),
+                           GMatrix<FL>(alpha.data, kk, m),
+                           vector<GMatrix<FL>>(bs.begin(), bs.begin() + kk));
+            for (int i = 0; i < kk; i++)
+                copy(vs[i], bs[i]);
+        }
+        if (pcomm != nullptr) {
+            pcomm->broadcast(eigvals.data(), eigvals.size(), pcomm->root);
+            for (int j = 0; j < k; j++)
+                pcomm->broadcast(vs[j].data, vs[j].size(), pcomm->root);
+        }
+        d_alloc->deallocate(pbs.data, nbs * vs[0].size());
+        ndav = xiter;
+        return eigvals;
+    }
+    // LOBPCG algorithm for the lowest eigenvalues
+    // A.V. Knyazev, SIAM J. Sci. Comput. 23, 517-541 (2001).
+    // U. Hetmaniuk, R. Lehoucq, J. Comput. Phys. 218, 324-332 (2006).
+    // The search space is [X, W, P] with at most 3k vectors, so that 6k
+    // vectors (with sigmas) are stored independent of deflation_max_size.
+    // Converged roots are soft-locked (kept in X but not corrected).
+    // aa: diag elements of a (for precondition)
+    // vs: input/output vectors
+    // ors: orthogonal states to be projected out
+    template <typename MatMul, typename PComm>
+    static vector<FP>
+    lobpcg(MatMul &op, const GDiagonalMatrix<FL> &aa, vector<GMatrix<FL>> &vs,
+           DavidsonTypes davidson_type, int &ndav, bool iprint = false,
+           const PComm &pcomm = nullptr, FP conv_thrd = 5E-6,
+           FP rel_conv_thrd = 0.0, int max_iter = 5000, int soft_max_iter = -1,
+           const vector<GMatrix<FL>> &ors = vector<GMatrix<FL>>(),
+           const vector<FP> &proj_weights = vector<FP>()) {
+        shared_ptr<VectorAllocator<FL>> d_alloc =
+            make_shared<VectorAllocator<FL>>();
+        int k = (int)vs.size(), nor = (int)ors.size(), nwg = 0;
+        if (davidson_type & DavidsonTypes::ElementProj)
+            ;
+        else if (proj_weights.size() != 0) {
+            assert(proj_weights.size() == ors.size());
+            nwg = (int)ors.size(), nor = 0;
+        }
+        // bs/sigmas: X in [0, k), W in [k, 2k), P in [2k, 3k)
+        GMatrix<FL> pbs(nullptr, (MKL_INT)(3 * k * vs[0].size()), 1);
+        GMatrix<FL> pss(nullptr, (MKL_INT)(3 * k * vs[0].size()), 1);
+        pbs.data = d_alloc->allocate(3 * k * vs[0].size());
+        pss.data = d_alloc->allocate(3 * k * vs[0].size());
+        vector<GMatrix<FL>> bs(3 * k, GMatrix<FL>(nullptr, vs[0].m, vs[0].n));
+        vector<GMatrix<FL>> sigmas(3 * k,
+                                   GMatrix<FL>(nullptr, vs[0].m, vs[0].n));
+        for (int i = 0; i < 3 * k; i++) {
+            bs[i].data = pbs.data + bs[i].size() * i;
+            sigmas[i].data = pss.data + sigmas[i].size() * i;
+        }
+        vector<FL> or_normsqs(nor);
+        for (int i = 0; i < nor; i++) {
+            for (int j = 0; j < i; j++)
+                if (abs(or_normsqs[j]) > 1E-14)
+                    iadd(ors[i], ors[j],
+                         -complex_dot(ors[j], ors[i]) / or_normsqs[j]);
+            or_normsqs[i] = complex_dot(ors[i], ors[i]);
+        }
+        // orthonormalize x against xs[0:nx], ors, and (optionally) update
+        // its sigma vector in the same way; returns false if x is dependent
+        auto orthonormalize = [&](const GMatrix<FL> &x, const GMatrix<FL> &sx,
+                                  const vector<int> &xidx) -> bool {
+            FP normx = norm(x);
+            if (normx * normx < 1E-28)
+                return false;
+            iscale(x, (FP)1.0 / normx);
+            if (sx.data != nullptr)
+                iscale(sx, (FP)1.0 / normx);
+            for (int it = 0; it < 2; it++) {
+                for (int j : xidx) {
+                    FL c = complex_dot(bs[j], x);
+                    iadd(x, bs[j], -c);
+                    if (sx.data != nullptr)
+                        iadd(sx, sigmas[j], -c);
+                }
+                for (int j = 0; j < nor; j++)
+                    if (abs(or_normsqs[j]) > 1E-14)
+                        iadd(x, ors[j],
+                             -complex_dot(ors[j], x) / or_normsqs[j]);
+            }
+            normx = norm(x);
+            if (normx * normx < 1E-14)
+                return false;
+            iscale(x, (FP)1.0 / normx);
+            if (sx.data != nullptr)
+                iscale(sx, (FP)1.0 / normx);
+            return true;
+        };
+        const GMatrix<FL> no_sigma(nullptr, 0, 0);
+        vector<int> xidx;
+        for (int i = 0; i < k; i++) {
+            copy(bs[i], vs[i]);
+            if (!orthonormalize(bs[i], no_sigma, xidx)) {
+                // same random vector on all procs
+                RandomMT rgen(i + 1);
+                rgen.fill<FP>((FP *)bs[i].data, bs[i].size() * cpx_sz, -1.0,
+                              1.0);
+                if (!orthonormalize(bs[i], no_sigma, xidx)) {
+                    stringstream ss;
+                    ss << "Cannot generate initial guess " << i
+                       << " for LOBPCG unitary to all given states!";
+                    throw runtime_error(ss.str());
+                }
+            }
+            xidx.push_back(i);
+        }
+        vector<FP> eigvals(k, 0);
+        vector<FL> talpha((size_t)9 * k * k), tcoef((size_t)6 * k * k);
+        vector<FP> tld(3 * k);
+        // status: converged roots, number of W, number of P, finished
+        int xiter = 0, status[4] = {0, 0, 0, 0};
+        int &nw = status[1], &np = status[2];
+        if (iprint)
+            cout << endl;
+        while (xiter < max_iter &&
+               (soft_max_iter == -1 || xiter < soft_max_iter)) {
+            xiter++;
+            // X is multiplied in the first iteration, then only W
+            const int ia = xiter == 1 ? 0 : k, na = xiter == 1 ? k : nw;
+            if (pcomm != nullptr && xiter != 1)
+                pcomm->broadcast(bs[k].data, bs[k].size() * nw, pcomm->root);
+            for (int i = ia; i < ia + na; i++) {
+                sigmas[i].clear();
+                op(bs[i], sigmas[i]);
+                for (int j = 0; j < nwg; j++)
+                    iadd(sigmas[i], ors[j],
+                         complex_dot(ors[j], bs[i]) * proj_weights[j]);
+            }
+            if (pcomm == nullptr || pcomm->root == pcomm->rank) {
+                // Rayleigh-Ritz in the orthonormal basis [X, W, P]
+                vector<int> sidx;
+                for (int i = 0; i < k; i++)
+                    sidx.push_back(i);
+                for (int i = 0; i < nw; i++)
+                    sidx.push_back(k + i);
+                for (int i = 0; i < np; i++)
+                    sidx.push_back(2 * k + i);
+                const int ms = (int)sidx.size();
+                vector<GMatrix<FL>> ss, sgs;
+                for (int i : sidx)
+                    ss.push_back(bs[i]), sgs.push_back(sigmas[i]);
+                GMatrix<FL> alpha(talpha.data(), ms, ms);
+                GDiagonalMatrix<FP> ld(tld.data(), ms);
+                for (int i = 0; i < ms; i++)
+                    for (int j = 0; j <= i; j++)
+                        alpha(i, j) = complex_dot(ss[i], sgs[j]);
+                eigs(alpha, ld);
+                // new X = S c, new P = [W, P] c (without the X part)
+                const int nxp = ms > k ? 2 * k : k;
+                GMatrix<FL> coef(tcoef.data(), nxp, ms);
+                vector<GMatrix<FL>> xps, sxps;
+                for (int j = 0; j < nxp; j++) {
+                    for (int i = 0; i < ms; i++)
+                        coef(j, i) = j >= k && i < k ? (FL)0.0
+                                                     : alpha(j % k, i);
+                    const int jj = j < k ? j : k + j;
+                    xps.push_back(bs[jj]), sxps.push_back(sigmas[jj]);
+                }
+                rotate_vectors(ss, coef, xps);
+                rotate_vectors(sgs, coef, sxps);
+                np = nxp - k;
+                // residuals and preconditioned corrections in W
+                int ck = 0;
+                FP max_qq = 0;
+                nw = 0;
+                for (int j = 0; j < k; j++) {
+                    eigvals[j] = ld.data[j];
+                    const GMatrix<FL> &r = bs[k + nw];
+                    copy(r, sigmas[j]);
+                    iadd(r, bs[j], -ld.data[j]);
+                    for (int i = 0; i < nor; i++)
+                        if (abs(or_normsqs[i]) > 1E-14)
+                            iadd(r, ors[i],
+                                 -complex_dot(ors[i], r) / or_normsqs[i]);
+                    FP qq = abs(complex_dot(r, r));
+                    max_qq = max(max_qq, qq);
+                    if (qq < conv_thrd + abs(ld.data[j]) * abs(ld.data[j]) *
+                                             rel_conv_thrd * rel_conv_thrd) {
+                        ck += (ck == j);
+                        continue;
+                    }
+                    if (davidson_type & DavidsonTypes::DavidsonPrecond)
+                        davidson_precondition(r, ld.data[j], aa);
+                    else if (!(davidson_type & DavidsonTypes::NoPrecond))
+                        olsen_precondition(r, bs[j], ld.data[j], aa);
+                    nw++;
+                }
+                if (iprint)
+                    cout << setw(6) << xiter << setw(6) << ms << setw(6) << ck
+                         << fixed << setw(15) << setprecision(8)
+                         << eigvals[min(ck, k - 1)] << scientific << setw(13)
+                         << setprecision(2) << max_qq << endl;
+                status[0] = ck;
+                // P against X, then W against X and P
+                int mp = 0, mw = 0;
+                for (int i = 0; i < np && nw != 0; i++) {
+                    if (mp != i) {
+                        copy(bs[2 * k + mp], bs[2 * k + i]);
+                        copy(sigmas[2 * k + mp], sigmas[2 * k + i]);
+                    }
+                    if (orthonormalize(bs[2 * k + mp], sigmas[2 * k + mp],
+                                       xidx))
+                        xidx.push_back(2 * k + mp++);
+                }
+                for (int i = 0; i < nw; i++) {
+                    if (mw != i)
+                        copy(bs[k + mw], bs[k + i]);
+                    if (orthonormalize(bs[k + mw], no_sigma, xidx))
+                        xidx.push_back(k + mw++);
+                }
+                xidx.resize(k);
+                np = mp, nw = mw;
+                status[3] = nw == 0;
+            }
+            if (pcomm != nullptr)
+                pcomm->broadcast(status, 4, pcomm->root);
+            if (status[3])
+                break;
+            if (xiter == soft_max_iter)
+                break;
+        }
+        if (xiter == max_iter && status[0] < k) {
+            cout << "Error : only " << status[0] << " converged!" << endl;
+            assert(false);
+        }
+        if (pcomm == nullptr || pcomm->root == pcomm->rank)
+            for (int i = 0; i < k; i++)
+                copy(vs[i], bs[i]);
+        if (pcomm != nullptr) {
+            pcomm->broadcast(eigvals.data(), eigvals.size(), pcomm->root);
+            for (int j = 0; j < k; j++)
+                pcomm->broadcast(vs[j].data, vs[j].size(), pcomm->root);
+        }
+        d_alloc->deallocate(pss.data, 3 * k * vs[0].size());
+        d_alloc->deallocate(pbs.data, 3 * k * vs[0].size());
+        ndav = xiter;
+        return eigvals;
+    }
     // Harmonic Davidson algorithm
     // aa: diag elements of a (for precondition)
     // bs: input/output vector
@@ -2296,15 +3122,133 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
             pcomm->broadcast(x.data, x.size(), pcomm->root);
         return func;
     }
+    // Build cs = (op + consta) us for a recycle space holding only us
+    // shift: the scalar part of op (stored in recycle->shift)
+    // returns the number of multiplications
+    template <typename MatMul>
+    static int
+    recycle_build_images(MatMul &op, const GMatrix<FL> &x, FL consta,
+                         const shared_ptr<KrylovRecycleSpace<FL>> &recycle,
+                         FL shift) {
+        if (recycle->nk == 0 || recycle->cs.size() != 0)
+            return 0;
+        recycle->cs.resize(recycle->us.size());
+        for (int i = 0; i < recycle->nk; i++) {
+            GMatrix<FL> u(recycle->us.data() + recycle->n * i, x.m, x.n);
+            GMatrix<FL> c(recycle->cs.data() + recycle->n * i, x.m, x.n);
+            c.clear();
+            op(u, c);
+            if (consta != (FP)0.0)
+                iadd(c, u, consta);
+        }
+        recycle->shift = shift;
+        return recycle->nk;
+    }
+    // Minimal residual correction of the initial guess x for
+    // (op + consta) x = b in the space spanned by recycle->us
+    // (for solvers without their own recycled subspace)
+    // shift: the scalar part of op that changes between solves sharing recycle
+    // returns the number of multiplications
+    template <typename MatMul, typename PComm>
+    static int
+    recycle_initial_guess(MatMul &op, GMatrix<FL> x, GMatrix<FL> b, FL consta,
+                          const shared_ptr<KrylovRecycleSpace<FL>> &recycle,
+                          FL shift, const PComm &pcomm) {
+        if (recycle == nullptr || !recycle->matches(x.size()) ||
+            pcomm != nullptr)
+            return 0;
+        int nmult = recycle_build_images(op, x, consta, recycle, shift);
+        GMatrix<FL> r(nullptr, x.m, x.n);
+        r.allocate();
+        r.clear();
+        op(x, r);
+        nmult++;
+        if (consta != (FP)0.0)
+            iadd(r, x, consta);
+        iscale(r, -1);
+        iadd(r, b, 1); // r = b - Ax
+        vector<FL> pcus(x.size() * 2 * recycle->nk);
+        vector<GMatrix<FL>> cvs, uzs;
+        for (int i = 0; i < recycle->nk; i++) {
+            int j = (int)cvs.size();
+            cvs.push_back(GMatrix<FL>(pcus.data() + x.size() * 2 * j, x.m, x.n));
+            uzs.push_back(
+                GMatrix<FL>(pcus.data() + x.size() * (2 * j + 1), x.m, x.n));
+            copy(cvs[j],
+                 GMatrix<FL>(recycle->cs.data() + x.size() * i, x.m, x.n));
+            copy(uzs[j],
+                 GMatrix<FL>(recycle->us.data() + x.size() * i, x.m, x.n));
+            iadd(cvs[j], uzs[j], shift - recycle->shift);
+            for (int it = 0; it < 2; it++)
+                for (int k = 0; k < j; k++) {
+                    FL c = complex_dot(cvs[k], cvs[j]);
+                    iadd(cvs[j], cvs[k], -c);
+                    iadd(uzs[j], uzs[k], -c);
+                }
+            FP alpha = norm(cvs[j]);
+            if (alpha * alpha < 1E-14) {
+                cvs.pop_back(), uzs.pop_back();
+                continue;
+            }
+            iscale(cvs[j], (FP)1.0 / alpha);
+            iscale(uzs[j], (FP)1.0 / alpha);
+            FL gamma = complex_dot(cvs[j], r);
+            iadd(r, cvs[j], -gamma);
+            iadd(x, uzs[j], gamma);
+        }
+        r.deallocate();
+        return nmult;
+    }
+    // Append the (normalized) solution x of (op + consta) x = b to recycle,
+    // keeping at most recycle->max_nk latest vectors
+    // returns the number of multiplications
+    template <typename MatMul, typename PComm>
+    static int
+    recycle_add_solution(MatMul &op, const GMatrix<FL> &x, FL consta,
+                         const shared_ptr<KrylovRecycleSpace<FL>> &recycle,
+                         FL shift, const PComm &pcomm) {
+        const int max_k = recycle == nullptr ? 0 : recycle->max_nk;
+        if (max_k <= 0 || pcomm != nullptr)
+            return 0;
+        if (!recycle->matches(x.size()))
+            recycle->clear(), recycle->n = x.size(), recycle->shift = shift;
+        int nmult = recycle_build_images(op, x, consta, recycle, shift);
+        FP alpha = norm(x);
+        if (alpha * alpha < 1E-14)
+            return nmult;
+        const size_t n = recycle->n;
+        recycle->us.resize(n * (recycle->nk + 1));
+        recycle->cs.resize(n * (recycle->nk + 1));
+        GMatrix<FL> u(recycle->us.data() + n * recycle->nk, x.m, x.n);
+        GMatrix<FL> c(recycle->cs.data() + n * recycle->nk, x.m, x.n);
+        iadd(u, x, (FP)1.0 / alpha, false, 0.0);
+        c.clear();
+        op(u, c);
+        nmult++;
+        iadd(c, u, consta + recycle->shift - shift);
+        recycle->nk++;
+        if (recycle->nk > max_k) {
+            const size_t nx = n * (recycle->nk - max_k);
+            recycle->us.erase(recycle->us.begin(), recycle->us.begin() + nx);
+            recycle->cs.erase(recycle->cs.begin(), recycle->cs.begin() + nx);
+            recycle->nk = max_k;
+        }
+        return nmult;
+    }
     // GCROT(m, k) method for solving x in linear equation H x = b
     // aa should include the effect of consta
     // op should not include the effect of consta
+    // recycle: if not null, the k vectors are read from and written to it
+    // shift: the scalar part of op that changes between solves sharing
+    //   recycle (cs is updated without extra multiplications)
     template <typename MatMul, typename PComm>
-    static FL gcrotmk(MatMul &op, const GDiagonalMatrix<FL> &aa, GMatrix<FL> x,
-                      GMatrix<FL> b, int &nmult, int &niter, int m = 20,
-                      int k = -1, FL consta = 0.0, bool iprint = false,
-                      const PComm &pcomm = nullptr, FP conv_thrd = 5E-6,
-                      int max_iter = 5000, int soft_max_iter = -1) {
+    static FL
+    gcrotmk(MatMul &op, const GDiagonalMatrix<FL> &aa, GMatrix<FL> x,
+            GMatrix<FL> b, int &nmult, int &niter, int m = 20, int k = -1,
+            FL consta = 0.0, bool iprint = false, const PComm &pcomm = nullptr,
+            FP conv_thrd = 5E-6, int max_iter = 5000, int soft_max_iter = -1,
+            const shared_ptr<KrylovRecycleSpace<FL>> &recycle = nullptr,
+            FL shift = 0.0) {
         GMatrix<FL> r(nullptr, x.m, x.n), w(nullptr, x.m, x.n);
         FL ff[3];
         FL &beta = ff[0], &rr = ff[1], &func = ff[2];
@@ -2335,7 +3279,47 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
             cvs[i].data = pcus.data() + cvs[i].size() * i;
             uzs[i].data = pcus.data() + uzs[i].size() * (i + nn);
         }
-        int ncs = 0, icu = 0;
+        int ncs = 0, icu = 0, nrb = 0;
+        // only us is available (serial only)
+        if (pcomm == nullptr && recycle != nullptr &&
+            recycle->matches(x.size()))
+            nrb = recycle_build_images(op, x, consta, recycle, shift);
+        if (recycle != nullptr && recycle->matches(x.size())) {
+            if (pcomm == nullptr || pcomm->root == pcomm->rank) {
+                // cs = (op + shift) us for the new shift, then
+                // orthonormalize cs and deflate the initial residual
+                for (int i = 0; i < min(recycle->nk, k); i++) {
+                    copy(cvs[ncs], GMatrix<FL>(recycle->cs.data() +
+                                                   x.size() * i,
+                                               x.m, x.n));
+                    copy(uzs[ncs], GMatrix<FL>(recycle->us.data() +
+                                                   x.size() * i,
+                                               x.m, x.n));
+                    iadd(cvs[ncs], uzs[ncs], shift - recycle->shift);
+                    for (int it = 0; it < 2; it++)
+                        for (int j = 0; j < ncs; j++) {
+                            FL c = complex_dot(cvs[j], cvs[ncs]);
+                            iadd(cvs[ncs], cvs[j], -c);
+                            iadd(uzs[ncs], uzs[j], -c);
+                        }
+                    FP alpha = norm(cvs[ncs]);
+                    if (alpha * alpha < 1E-14)
+                        continue;
+                    iscale(cvs[ncs], (FP)1.0 / alpha);
+                    iscale(uzs[ncs], (FP)1.0 / alpha);
+                    FL gamma = complex_dot(cvs[ncs], r);
+                    iadd(r, cvs[ncs], -gamma);
+                    iadd(x, uzs[ncs], gamma);
+                    ncs++;
+                }
+                func = complex_dot(x, b);
+                beta = norm(r);
+            }
+            if (pcomm != nullptr) {
+                pcomm->broadcast(&ncs, 1, pcomm->root);
+                pcomm->broadcast(&beta, 3, pcomm->root);
+            }
+        }
         GMatrix<FL> bmat(nullptr, k, k + m);
         GMatrix<FL> hmat(nullptr, k + m + 1, k + m);
         GMatrix<FL> ys(nullptr, k + m, 1);
@@ -2431,7 +3415,22 @@ template <typename FL> struct IterativeMatrixFunctions : GMatrixFunctions<FL> {
             cout << "Error : linear solver GCROT(m, k) not converged!" << endl;
             assert(false);
         }
-        nmult = jiter;
+        if (recycle != nullptr) {
+            recycle->n = x.size(), recycle->nk = ncs, recycle->shift = shift;
+            if (pcomm == nullptr || pcomm->root == pcomm->rank) {
+                recycle->us.resize(x.size() * ncs);
+                recycle->cs.resize(x.size() * ncs);
+                for (int i = 0; i < ncs; i++) {
+                    copy(GMatrix<FL>(recycle->us.data() + x.size() * i, x.m,
+                                     x.n),
+                         uzs[(icu + i) % nn]);
+                    copy(GMatrix<FL>(recycle->cs.data() + x.size() * i, x.m,
+                                     x.n),
+                         cvs[(icu + i) % nn]);
+                }
+            }
+        }
+        nmult = jiter + nrb;
         niter = xiter + 1;
         hys.deallocate();
         bys.deallocate();
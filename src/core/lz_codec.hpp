@@ -0,0 +1,378 @@
+/*
+ * block2: Efficient MPO implementation of quantum chemistry DMRG
+ * Copyright (C) 2020-2021 Huanchen Zhai <hczhai@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/** Lossless compression algorithms. */
+
+#pragma once
+
+#include "threading.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace block2 {
+
+/** Lossless codec for compressing/decompressing arrays. Each chunk of the
+ * array is first byte-shuffled (the k-th bytes of all elements are grouped
+ * together, so that sign/exponent bytes of floating-point numbers and high
+ * bytes of integers form long runs), and then compressed using a fast
+ * LZ77-type algorithm (with a byte-oriented sequence format similar to LZ4).
+ * Chunks are processed in parallel. Chunks that cannot be compressed are
+ * stored as they are.
+ */
+struct LZCodec {
+    static const int hash_log = 14; //!< Log2 of the size of the hash table.
+    static const size_t min_match = 4;      //!< Minimal length of matches.
+    static const size_t max_offset = 65535; //!< Maximal distance of matches.
+    static const size_t raw_flag =
+        (size_t)1 << (sizeof(size_t) * 8 - 1); //!< Flag for raw chunks.
+    mutable size_t ndata = 0, //!< Number of bytes that have been compressed.
+        ncpsd = 0;            //!< Number of bytes of the compressed data.
+    mutable size_t ncpsd_last =
+        0; //!< Number of bytes of the compressed data written in the last call.
+    size_t chunk_size = 1 << 16; //!< Number of bytes in each chunk.
+    size_t n_parallel_chunks =
+        1024; //!< Number of chunks to be processed in the same batch.
+    bool shuffle =
+        true; //!< Whether byte shuffling should be used when writing.
+    /** Default constructor. */
+    LZCodec() {}
+    /** Constructor.
+     * @param chunk_size Number of bytes in each chunk.
+     * @param shuffle Whether byte shuffling should be used.
+     */
+    LZCodec(size_t chunk_size, bool shuffle = true)
+        : chunk_size(chunk_size), shuffle(shuffle) {}
+    /** Upper bound of the size of compressed data.
+     * @param n Number of bytes in the original data.
+     * @return Maximal number of bytes in the compressed data.
+     */
+    static size_t compress_bound(size_t n) { return n + n / 255 + 16; }
+    /** Group the k-th bytes of all elements together. Trailing bytes not
+     * forming a whole element are copied unchanged.
+     * @param ip Input data.
+     * @param n Number of bytes.
+     * @param elem Number of bytes in each element.
+     * @param op Output data.
+     */
+    static void shuffle_bytes(const uint8_t *ip, size_t n, size_t elem,
+                              uint8_t *op) {
+        const size_t nel = n / elem;
+        for (size_t j = 0; j < elem; j++)
+            for (size_t i = 0; i < nel; i++)
+                op[j * nel + i] = ip[i * elem + j];
+        memcpy(op + nel * elem, ip + nel * elem, n - nel * elem);
+    }
+    /** Inverse of shuffle_bytes.
+     * @param ip Input (shuffled) data.
+     * @param n Number of bytes.
+     * @param elem Number of bytes in each element.
+     * @param op Output data.
+     */
+    static void unshuffle_bytes(const uint8_t *ip, size_t n, size_t elem,
+                                uint8_t *op) {
+        const size_t nel = n / elem;
+        for (size_t j = 0; j < elem; j++)
+            for (size_t i = 0; i < nel; i++)
+                op[i * elem + j] = ip[j * nel + i];
+        memcpy(op + nel * elem, ip + nel * elem, n - nel * elem);
+    }
+    static uint32_t read32(const uint8_t *p) {
+        uint32_t x;
+        memcpy(&x, p, sizeof(x));
+        return x;
+    }
+    static uint8_t *write_length(uint8_t *op, size_t l) {
+        for (; l >= 255; l -= 255)
+            *op++ = 255;
+        *op++ = (uint8_t)l;
+        return op;
+    }
+    static uint8_t *write_sequence(uint8_t *op, const uint8_t *lit,
+                                   size_t nlit, size_t offset, size_t ml) {
+        uint8_t *token = op++;
+        *token = (uint8_t)(min(nlit, (size_t)15) << 4);
+        if (nlit >= 15)
+            op = write_length(op, nlit - 15);
+        memcpy(op, lit, nlit);
+        op += nlit;
+        if (ml != 0) {
+            *op++ = (uint8_t)(offset & 0xFF);
+            *op++ = (uint8_t)(offset >> 8);
+            ml -= min_match;
+            *token |= (uint8_t)min(ml, (size_t)15);
+            if (ml >= 15)
+                op = write_length(op, ml - 15);
+        }
+        return op;
+    }
+    /** Compress data. Each sequence in the output is: a token byte (high 4
+     * bits: number of literals, low 4 bits: match length minus 4, extended by
+     * bytes of 255 when equal to 15), the literals, and (except for the last
+     * sequence) a 2-byte little-endian match offset.
+     * @param ip Input data.
+     * @param n Number of bytes in the input data.
+     * @param op Output data. Memory should be pre-allocated with length >=
+     * compress_bound(n).
+     * @return Number of bytes in the compressed data.
+     */
+    static size_t compress(const uint8_t *ip, size_t n, uint8_t *op) {
+        uint8_t *const op_start = op;
+        size_t anchor = 0;
+        if (n > 12) {
+            vector<uint32_t> htab((size_t)1 << hash_log, 0);
+            // the last match must start at least 12 bytes before the end
+            // and the last 5 bytes are always literals
+            const size_t mf_limit = n - 12, m_limit = n - 5;
+            for (size_t i = 0; i < mf_limit;) {
+                const uint32_t seq = read32(ip + i);
+                const uint32_t h = (seq * 2654435761U) >> (32 - hash_log);
+                const size_t ref = htab[h];
+                htab[h] = (uint32_t)(i + 1);
+                if (ref != 0 && i + 1 - ref <= max_offset &&
+                    read32(ip + ref - 1) == seq) {
+                    size_t ml = min_match;
+                    while (i + ml < m_limit && ip[ref - 1 + ml] == ip[i + ml])
+                        ml++;
+                    op = write_sequence(op, ip + anchor, i - anchor,
+                                        i + 1 - ref, ml);
+                    i += ml;
+                    anchor = i;
+                } else
+                    i += 1 + ((i - anchor) >> 6);
+            }
+        }
+        op = write_sequence(op, ip + anchor, n - anchor, 0, 0);
+        return (size_t)(op - op_start);
+    }
+    /** Decompress data.
+     * @param ip Compressed data.
+     * @param cn Number of bytes in the compressed data.
+     * @param op Output data. Memory should be pre-allocated with length = n.
+     * @param n Number of bytes in the original data.
+     */
+    static void decompress(const uint8_t *ip, size_t cn, uint8_t *op,
+                           size_t n) {
+        size_t ipos = 0, opos = 0;
+        const string err = "LZCodec::decompress: corrupted data.";
+        while (true) {
+            if (ipos >= cn)
+                throw runtime_error(err);
+            const uint8_t token = ip[ipos++];
+            size_t nlit = token >> 4, ml = token & 15;
+            if (nlit == 15)
+                for (uint8_t b = 255; b == 255; nlit += b) {
+                    if (ipos >= cn)
+                        throw runtime_error(err);
+                    b = ip[ipos++];
+                }
+            if (nlit > cn - ipos || nlit > n - opos)
+                throw runtime_error(err);
+            memcpy(op + opos, ip + ipos, nlit);
+            ipos += nlit, opos += nlit;
+            if (ipos == cn)
+                break;
+            if (cn - ipos < 2)
+                throw runtime_error(err);
+            const size_t offset = ip[ipos] | ((size_t)ip[ipos + 1] << 8);
+            ipos += 2;
+            if (ml == 15)
+                for (uint8_t b = 255; b == 255; ml += b) {
+                    if (ipos >= cn)
+                        throw runtime_error(err);
+                    b = ip[ipos++];
+                }
+            ml += min_match;
+            if (offset == 0 || offset > opos || ml > n - opos)
+                throw runtime_error(err);
+            // the match may overlap with the output
+            if (offset >= ml)
+                memcpy(op + opos, op + opos - offset, ml);
+            else
+                for (size_t k = 0; k < ml; k++)
+                    op[opos + k] = op[opos + k - offset];
+            opos += ml;
+        }
+        if (opos != n)
+            throw runtime_error(err);
+    }
+    /** Compress data and write into file stream.
+     * @param ofs Output stream.
+     * @param data The original data.
+     * @param n Number of bytes in the original data.
+     * @param elem Number of bytes in each element (for byte shuffling).
+     */
+    void write_data(ostream &ofs, const void *data, size_t n,
+                    size_t elem) const {
+        const string magic = "lzc", tail = "end";
+        // each chunk must contain whole elements
+        const size_t csz = max(chunk_size / elem, (size_t)1) * elem;
+        // element size for shuffling (one if not shuffled)
+        const size_t selem = shuffle ? elem : 1;
+        ofs.write((char *)magic.c_str(), 4);
+        ofs.write((char *)&csz, sizeof(csz));
+        ofs.write((char *)&selem, sizeof(selem));
+        ndata += n;
+        const size_t nchunk = n / csz + !!(n % csz);
+        const size_t nbatch =
+            nchunk / n_parallel_chunks + !!(nchunk % n_parallel_chunks);
+        const size_t cb = compress_bound(csz);
+        uint8_t *pdata = new uint8_t[cb * min(nchunk, n_parallel_chunks)];
+        vector<size_t> cplens(n_parallel_chunks);
+        int ntg = threading->activate_global();
+        ncpsd_last = 0;
+#pragma omp parallel num_threads(ntg)
+        {
+            vector<uint8_t> sdata(selem > 1 ? csz : 0);
+            for (size_t ib = 0; ib < nbatch; ib++) {
+                size_t n_this_chunk =
+                    min(nchunk - ib * n_parallel_chunks, n_parallel_chunks);
+#pragma omp for schedule(static)
+                for (int ic = 0; ic < (int)n_this_chunk; ic++) {
+                    size_t offset = (ic + ib * n_parallel_chunks) * csz;
+                    size_t cklen = min(csz, n - offset);
+                    const uint8_t *ip = (const uint8_t *)data + offset;
+                    if (sdata.size() != 0) {
+                        shuffle_bytes(ip, cklen, elem, sdata.data());
+                        ip = sdata.data();
+                    }
+                    cplens[ic] = compress(ip, cklen, pdata + ic * cb);
+                    if (cplens[ic] >= cklen) {
+                        memcpy(pdata + ic * cb, (const uint8_t *)data + offset,
+                               cklen);
+                        cplens[ic] = cklen | raw_flag;
+                    }
+                }
+#pragma omp single
+                for (size_t ic = 0; ic < n_this_chunk; ic++) {
+                    size_t cplen = cplens[ic];
+                    ofs.write((char *)&cplen, sizeof(cplen));
+                    cplen &= ~raw_flag;
+                    ofs.write((char *)(pdata + ic * cb), cplen);
+                    ncpsd_last += cplen + sizeof(cplen);
+                }
+            }
+        }
+        ncpsd += ncpsd_last;
+        delete[] pdata;
+        threading->activate_normal();
+        ofs.write((char *)tail.c_str(), 4);
+    }
+    /** Read from file stream and decompress the data.
+     * @param ifs Input stream.
+     * @param data Output array for storing the original data. Memory should be
+     * pre-allocated with length = n.
+     * @param n Number of bytes in the original data.
+     */
+    void read_data(istream &ifs, void *data, size_t n) const {
+        string magic = "???";
+        size_t csz, elem;
+        ifs.read((char *)magic.c_str(), 4);
+        if (magic != "lzc")
+            throw runtime_error("LZCodec::read_data: wrong data format.");
+        ifs.read((char *)&csz, sizeof(csz));
+        ifs.read((char *)&elem, sizeof(elem));
+        if (!ifs.good() || csz == 0 || elem == 0)
+            throw runtime_error("LZCodec::read_data: wrong data format.");
+        const size_t nchunk = n / csz + !!(n % csz);
+        const size_t nbatch =
+            nchunk / n_parallel_chunks + !!(nchunk % n_parallel_chunks);
+        const size_t cb = compress_bound(csz);
+        uint8_t *pdata = new uint8_t[cb * min(nchunk, n_parallel_chunks)];
+        vector<size_t> cplens(n_parallel_chunks);
+        int ntg = threading->activate_global();
+        bool ok = true;
+#pragma omp parallel num_threads(ntg) reduction(&& : ok)
+        {
+            vector<uint8_t> sdata(elem > 1 ? csz : 0);
+            for (size_t ib = 0; ib < nbatch; ib++) {
+                size_t n_this_chunk =
+                    min(nchunk - ib * n_parallel_chunks, n_parallel_chunks);
+#pragma omp single
+                for (size_t ic = 0; ic < n_this_chunk; ic++) {
+                    size_t &cplen = cplens[ic];
+                    ifs.read((char *)&cplen, sizeof(cplen));
+                    if ((cplen & ~raw_flag) > cb) {
+                        ok = false;
+                        cplen = raw_flag;
+                    }
+                    ifs.read((char *)(pdata + ic * cb), cplen & ~raw_flag);
+                }
+#pragma omp for schedule(static)
+                for (int ic = 0; ic < (int)n_this_chunk; ic++) {
+                    size_t offset = (ic + ib * n_parallel_chunks) * csz;
+                    size_t cklen = min(csz, n - offset);
+                    uint8_t *op = (uint8_t *)data + offset;
+                    if (cplens[ic] & raw_flag) {
+                        if ((cplens[ic] & ~raw_flag) != cklen) {
+                            ok = false;
+                            continue;
+                        }
+                        memcpy(op, pdata + ic * cb, cklen);
+                        continue;
+                    }
+                    try {
+                        if (sdata.size() != 0) {
+                            decompress(pdata + ic * cb, cplens[ic],
+                                       sdata.data(), cklen);
+                            unshuffle_bytes(sdata.data(), cklen, elem, op);
+                        } else
+                            decompress(pdata + ic * cb, cplens[ic], op, cklen);
+                    } catch (const runtime_error &) {
+                        ok = false;
+                    }
+                }
+            }
+        }
+        delete[] pdata;
+        threading->activate_normal();
+        ifs.read((char *)magic.c_str(), 4);
+        if (!ok || magic != "end")
+            throw runtime_error("LZCodec::read_data: corrupted data.");
+    }
+    /** Compress array and write into file stream.
+     * @tparam T Element type.
+     * @param ofs Output stream.
+     * @param data The original array.
+     * @param len The length of the original array.
+     */
+    template <typename T>
+    void write_array(ostream &ofs, const T *data, size_t len) const {
+        write_data(ofs, data, sizeof(T) * len, sizeof(T));
+    }
+    /** Read from file stream and decompress the array.
+     * @tparam T Element type.
+     * @param ifs Input stream.
+     * @param data The array for storing the original data.
+     * @param len The length of the original array.
+     */
+    template <typename T>
+    void read_array(istream &ifs, T *data, size_t len) const {
+        read_data(ifs, data, sizeof(T) * len);
+    }
+};
+
+} // namespace block2
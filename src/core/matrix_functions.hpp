@@ -285,6 +285,9 @@ enum struct DavidsonTypes : uint16_t {
     Exact = 256,
     LeftEigen = 512,
     ElementProj = 1024,
+    Block = 2048,
+    Lanczos = 4096,
+    LOBPCG = 8192,
     ExactNonHermitian = 128 | 256,
     ExactNonHermitianLeftEigen = 128 | 256 | 512,
     NonHermitianDavidsonPrecond = 128 | 32,
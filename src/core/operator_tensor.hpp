@@ -267,4 +267,65 @@ struct DelayedOperatorTensor : OperatorTensor<S, FL> {
     }
 };
 
+// Translation between operator tensors with different precision
+// Only normal operator tensors with normal sparse matrices are supported,
+// otherwise nullptr is returned
+template <typename S, typename FL1, typename FL2> struct TransOperatorTensor {
+    static shared_ptr<Symbolic<S>> forward(const shared_ptr<Symbolic<S>> &mat) {
+        if (mat == nullptr)
+            return nullptr;
+        shared_ptr<Symbolic<S>> xmat = mat->copy();
+        for (auto &x : xmat->data)
+            x = TransOpExpr<S, FL1, FL2>::forward(x);
+        return xmat;
+    }
+    static shared_ptr<OperatorTensor<S, FL2>>
+    forward(const shared_ptr<OperatorTensor<S, FL1>> &opt) {
+        if (opt->get_type() != OperatorTensorTypes::Normal)
+            return nullptr;
+        for (auto &p : opt->ops)
+            if (p.second->get_type() != SparseMatrixTypes::Normal)
+                return nullptr;
+        shared_ptr<OperatorTensor<S, FL2>> xopt =
+            make_shared<OperatorTensor<S, FL2>>();
+        xopt->lmat = forward(opt->lmat);
+        xopt->rmat = opt->rmat == opt->lmat ? xopt->lmat : forward(opt->rmat);
+        // the same matrix can be shared by several symbols
+        unordered_map<SparseMatrix<S, FL1> *, shared_ptr<SparseMatrix<S, FL2>>>
+            xmats;
+        xopt->ops.reserve(opt->ops.size());
+        for (auto &p : opt->ops) {
+            shared_ptr<SparseMatrix<S, FL2>> &xmat = xmats[p.second.get()];
+            if (xmat == nullptr) {
+                if (p.second->data == nullptr) {
+                    xmat = make_shared<SparseMatrix<S, FL2>>();
+                    xmat->info = p.second->info;
+                    xmat->factor = (FL2)p.second->factor;
+                } else
+                    xmat = TransSparseMatrix<S, FL1, FL2>::forward(p.second);
+            }
+            xopt->ops[TransOpExpr<S, FL1, FL2>::forward(p.first)] = xmat;
+        }
+        return xopt;
+    }
+    static shared_ptr<DelayedOperatorTensor<S, FL2>>
+    forward(const shared_ptr<DelayedOperatorTensor<S, FL1>> &op) {
+        if (op->stacked_mat != nullptr || op->exprs.size() != 0)
+            return nullptr;
+        shared_ptr<DelayedOperatorTensor<S, FL2>> xop =
+            make_shared<DelayedOperatorTensor<S, FL2>>();
+        xop->lopt = forward(op->lopt);
+        xop->ropt = forward(op->ropt);
+        if (xop->lopt == nullptr || xop->ropt == nullptr)
+            return nullptr;
+        xop->dops.resize(op->dops.size());
+        for (size_t i = 0; i < op->dops.size(); i++)
+            xop->dops[i] = TransOpExpr<S, FL1, FL2>::forward(op->dops[i]);
+        xop->mat = forward(op->mat);
+        xop->lmat = forward(op->lmat);
+        xop->rmat = op->rmat == op->lmat ? xop->lmat : forward(op->rmat);
+        return xop;
+    }
+};
+
 } // namespace block2
@@ -126,12 +126,14 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
         if (comm == MPI_COMM_NULL)
             return;
         _t.get_time();
+        ProfileScope ps("MPICommunicator::idle");
         int ierr = MPI_Barrier(comm);
         assert(ierr == 0);
         tidle += _t.get_time();
     }
     void broadcast(double *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Bcast(data + offset, min(chunk_size, len - offset),
                                  MPI_DOUBLE, owner, comm);
@@ -141,6 +143,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void broadcast(complex<double> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Bcast((double *)(data + offset),
                                  min(chunk_size, len - offset) * 2, MPI_DOUBLE,
@@ -151,6 +154,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void broadcast(long double *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Bcast((double *)(data + offset),
                                  min(chunk_size, len - offset) * 2, MPI_DOUBLE,
@@ -161,6 +165,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void broadcast(complex<long double> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Bcast((double *)(data + offset),
                                  min(chunk_size, len - offset) * 4, MPI_DOUBLE,
@@ -171,6 +176,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void broadcast(float *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Bcast(data + offset, min(chunk_size, len - offset),
                                  MPI_FLOAT, owner, comm);
@@ -180,6 +186,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void broadcast(complex<float> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Bcast((float *)(data + offset),
                                  min(chunk_size, len - offset) * 2, MPI_FLOAT,
@@ -190,6 +197,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ibroadcast(double *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ibcast(data + offset, min(chunk_size, len - offset),
@@ -201,6 +209,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ibroadcast(complex<double> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ibcast((double *)(data + offset),
@@ -213,6 +222,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ibroadcast(float *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ibcast(data + offset, min(chunk_size, len - offset),
@@ -224,6 +234,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ibroadcast(complex<float> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ibcast((float *)(data + offset),
@@ -236,12 +247,14 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void broadcast(int *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         int ierr = MPI_Bcast(data, len, MPI_INT, owner, comm);
         assert(ierr == 0);
         tcomm += _t.get_time();
     }
     void broadcast(long long int *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         int ierr = MPI_Bcast(data, len, MPI_LONG_LONG, owner, comm);
         assert(ierr == 0);
         tcomm += _t.get_time();
@@ -299,6 +312,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_sum(double *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, data + offset,
                                      min(chunk_size, len - offset), MPI_DOUBLE,
@@ -309,6 +323,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_sum(complex<double> *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (double *)(data + offset),
                                      min(chunk_size, len - offset) * 2,
@@ -319,6 +334,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_sum(float *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, data + offset,
                                      min(chunk_size, len - offset), MPI_FLOAT,
@@ -329,6 +345,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_sum(complex<float> *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (float *)(data + offset),
                                      min(chunk_size, len - offset) * 2,
@@ -339,6 +356,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_max(double *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, data + offset,
                                      min(chunk_size, len - offset), MPI_DOUBLE,
@@ -349,6 +367,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_max(complex<double> *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (double *)data + offset,
                                      min(chunk_size, len - offset) * 2,
@@ -359,6 +378,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_max(float *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, data + offset,
                                      min(chunk_size, len - offset), MPI_FLOAT,
@@ -369,6 +389,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_max(complex<float> *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (float *)data + offset,
                                      min(chunk_size, len - offset) * 2,
@@ -391,6 +412,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void reduce_max(uint64_t *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         int ierr = MPI_Reduce(rank == owner ? MPI_IN_PLACE : data, data, len,
                               MPI_UINT64_T, MPI_MAX, owner, comm);
         assert(ierr == 0);
@@ -398,6 +420,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_min(double *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, data + offset,
                                      min(chunk_size, len - offset), MPI_DOUBLE,
@@ -408,6 +431,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_min(complex<double> *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (double *)(data + offset),
                                      min(chunk_size, len - offset) * 2,
@@ -418,6 +442,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_min(long double *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (double *)(data + offset),
                                      min(chunk_size, len - offset) * 2,
@@ -428,6 +453,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_min(complex<long double> *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (double *)(data + offset),
                                      min(chunk_size, len - offset) * 4,
@@ -438,6 +464,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_min(float *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, data + offset,
                                      min(chunk_size, len - offset), MPI_FLOAT,
@@ -448,6 +475,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_min(complex<float> *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Allreduce(MPI_IN_PLACE, (float *)(data + offset),
                                      min(chunk_size, len - offset) * 2,
@@ -539,6 +567,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_sum(vector<S> &vs) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         uint32_t sz = (uint32_t)vs.size(), maxsz;
         int ierr = MPI_Allreduce(&sz, &maxsz, 1, MPI_UINT32_T, MPI_MAX, comm);
         assert(ierr == 0);
@@ -556,6 +585,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_logical_or(bool &v) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         int ierr =
             MPI_Allreduce(MPI_IN_PLACE, &v, 1, MPI_C_BOOL, MPI_LOR, comm);
         assert(ierr == 0);
@@ -563,6 +593,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_logical_or(char *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         int ierr =
             MPI_Allreduce(MPI_IN_PLACE, data, len, MPI_CHAR, MPI_LOR, comm);
         assert(ierr == 0);
@@ -570,6 +601,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void allreduce_xor(char *data, size_t len) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         int ierr =
             MPI_Allreduce(MPI_IN_PLACE, data, len, MPI_CHAR, MPI_BXOR, comm);
         assert(ierr == 0);
@@ -577,6 +609,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void reduce_sum(double *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Reduce(rank == owner ? MPI_IN_PLACE : data + offset,
                                   data + offset, min(chunk_size, len - offset),
@@ -587,6 +620,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void reduce_sum(complex<double> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Reduce(
                 rank == owner ? MPI_IN_PLACE : (double *)(data + offset),
@@ -598,6 +632,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void reduce_sum(float *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Reduce(rank == owner ? MPI_IN_PLACE : data + offset,
                                   data + offset, min(chunk_size, len - offset),
@@ -608,6 +643,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void reduce_sum(complex<float> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             int ierr = MPI_Reduce(
                 rank == owner ? MPI_IN_PLACE : (float *)(data + offset),
@@ -619,6 +655,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ireduce_sum(double *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ireduce(rank == owner ? MPI_IN_PLACE : data + offset,
@@ -631,6 +668,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ireduce_sum(complex<double> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ireduce(
@@ -644,6 +682,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ireduce_sum(float *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ireduce(rank == owner ? MPI_IN_PLACE : data + offset,
@@ -656,6 +695,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void ireduce_sum(complex<float> *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         for (size_t offset = 0; offset < len; offset += chunk_size) {
             MPI_Request req;
             int ierr = MPI_Ireduce(
@@ -669,6 +709,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void reduce_sum(uint64_t *data, size_t len, int owner) override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::comm");
         int ierr = MPI_Reduce(rank == owner ? MPI_IN_PLACE : data, data, len,
                               MPI_UINT64_T, MPI_SUM, owner, comm);
         assert(ierr == 0);
@@ -742,6 +783,7 @@ template <typename S> struct MPICommunicator : ParallelCommunicator<S> {
     }
     void waitall() override {
         _t.get_time();
+        ProfileScope ps("MPICommunicator::wait");
         int ierr =
             MPI_Waitall((int)reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
         assert(ierr == 0);
@@ -53,6 +53,13 @@ struct ParallelTensorFunctions : TensorFunctions<S, FL> {
         opf->seq->operator()(b, c, scale);
         rule->comm->allreduce_sum(c.data, c.size());
     }
+    void operator()(const vector<GMatrix<FL>> &bs,
+                    const vector<GMatrix<FL>> &cs,
+                    FL scale = (FL)1.0) override {
+        opf->seq->operator()(bs, cs, scale);
+        for (auto &c : cs)
+            rule->comm->allreduce_sum(c.data, c.size());
+    }
     // c = a
     void left_assign(const shared_ptr<OperatorTensor<S, FL>> &a,
                      shared_ptr<OperatorTensor<S, FL>> &c) const override {
@@ -0,0 +1,300 @@
+
+/*
+ * block2: Efficient MPO implementation of quantum chemistry DMRG
+ * Copyright (C) 2020-2021 Huanchen Zhai <hczhai@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/** Hierarchical performance profiler with Chrome trace (JSON) output. */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace block2 {
+
+/** One timed region or counter sample recorded by the profiler. */
+struct ProfileEvent {
+    const char *name; //!< Name of the region (must be a static string).
+    int64_t start,    //!< Starting time (in nanoseconds).
+        dur;          //!< Duration (in nanoseconds). Negative for counters.
+    int site;         //!< Site index or -1.
+    uint64_t nflop;   //!< Number of floating-point operations (or the value
+                      //!< of the counter).
+};
+
+/** Accumulated statistics of all regions with the same name. */
+struct ProfileStats {
+    double time = 0;    //!< Total time (in seconds).
+    size_t count = 0;   //!< Number of calls.
+    uint64_t nflop = 0; //!< Total number of floating-point operations.
+    /** Print the statistics.
+     * @param os The output stream.
+     * @param st The object to be printed.
+     * @return The output stream.
+     */
+    friend ostream &operator<<(ostream &os, const ProfileStats &st) {
+        os << fixed << setprecision(3) << setw(10) << st.time << " s "
+           << setw(10) << st.count << " calls";
+        if (st.nflop != 0)
+            os << " " << scientific << setprecision(3) << (double)st.nflop
+               << " flop " << fixed << setprecision(3) << setw(8)
+               << (st.time == 0 ? 0.0 : st.nflop / st.time / 1E9)
+               << " GFLOP/S";
+        return os;
+    }
+};
+
+/** Low-overhead thread-aware profiler. Regions are recorded by
+ * ProfileScope objects into per-thread buffers without locking, and can be
+ * written as a Chrome trace (JSON) file (loadable in chrome://tracing or
+ * Perfetto) or summarized per region name. When enabled is false, the cost
+ * of each region is one branch. */
+struct Profiler {
+    bool enabled = false; //!< Whether regions should be recorded.
+    int rank = 0; //!< MPI rank of this proc (used as pid in the trace).
+    int site = -1; //!< Current site index, attached to new regions.
+    string trace_prefix =
+        ""; //!< If not empty, sweep algorithms write one trace file per
+            //!< sweep, named ``<trace_prefix>.SWEEP.<i>.RANK.<r>.json``.
+    size_t id; //!< Unique id of this profiler.
+    int64_t t0; //!< Time origin (in nanoseconds).
+    mutable mutex mtx; //!< Mutex for registering thread buffers.
+    vector<shared_ptr<vector<ProfileEvent>>>
+        buffers; //!< Event buffers of all threads (indexed by profiler
+                 //!< thread id).
+    /** Default constructor. */
+    Profiler() : id(next_id()++), t0(now()) {}
+    /** Counter for assigning unique ids to profilers. */
+    static atomic<size_t> &next_id() {
+        static atomic<size_t> x(0);
+        return x;
+    }
+    /** Current monotonic time.
+     * @return Time in nanoseconds.
+     */
+    static int64_t now() {
+        return (int64_t)chrono::duration_cast<chrono::nanoseconds>(
+                   chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+    /** Get the event buffer of the calling thread, registering it if this
+     * is the first event of the thread.
+     * @return Profiler thread id and the event buffer.
+     */
+    pair<int, vector<ProfileEvent> *> thread_buffer() {
+        thread_local size_t cur_id = (size_t)-1;
+        thread_local pair<int, vector<ProfileEvent> *> cur(-1, nullptr);
+        if (cur_id != id) {
+            lock_guard<mutex> lock(mtx);
+            buffers.push_back(make_shared<vector<ProfileEvent>>());
+            buffers.back()->reserve(1024);
+            cur = make_pair((int)buffers.size() - 1, buffers.back().get());
+            cur_id = id;
+        }
+        return cur;
+    }
+    /** Record one timed region.
+     * @param name Name of the region (must be a static string).
+     * @param start Starting time (in nanoseconds).
+     * @param end Ending time (in nanoseconds).
+     * @param nflop Number of floating-point operations.
+     * @param site Site index or -1.
+     */
+    void record(const char *name, int64_t start, int64_t end,
+                uint64_t nflop = 0, int site = -1) {
+        ProfileEvent ev{name, start, end - start, site, nflop};
+        thread_buffer().second->push_back(ev);
+    }
+    /** Record the value of one counter at current time.
+     * @param name Name of the counter (must be a static string).
+     * @param value Value of the counter.
+     */
+    void counter(const char *name, uint64_t value) {
+        if (!enabled)
+            return;
+        ProfileEvent ev{name, now(), -1, site, value};
+        thread_buffer().second->push_back(ev);
+    }
+    /** Remove all recorded events and reset the time origin. Buffers of
+     * threads are kept. Must not be called when regions are being recorded
+     * in other threads. */
+    void clear() {
+        lock_guard<mutex> lock(mtx);
+        for (auto &b : buffers)
+            b->clear();
+        t0 = now();
+    }
+    /** Number of recorded events in all threads.
+     * @return The number of events.
+     */
+    size_t size() const {
+        lock_guard<mutex> lock(mtx);
+        size_t r = 0;
+        for (auto &b : buffers)
+            r += b->size();
+        return r;
+    }
+    /** Accumulated statistics of all regions, grouped by region name.
+     * @param tid If not -1, only regions in this profiler thread are used.
+     * @return A map from region name to statistics.
+     */
+    map<string, ProfileStats> summary(int tid = -1) const {
+        lock_guard<mutex> lock(mtx);
+        map<string, ProfileStats> r;
+        for (int it = 0; it < (int)buffers.size(); it++) {
+            if (tid != -1 && it != tid)
+                continue;
+            for (const auto &ev : *buffers[it]) {
+                if (ev.dur < 0)
+                    continue;
+                ProfileStats &st = r[ev.name];
+                st.time += ev.dur * 1E-9, st.count++, st.nflop += ev.nflop;
+            }
+        }
+        return r;
+    }
+    /** Write all recorded events as a Chrome trace (JSON) file. Regions are
+     * complete ("X") events and counters are counter ("C") events, with pid
+     * being the MPI rank and tid the profiler thread id.
+     * @param filename The filename.
+     */
+    void write_trace(const string &filename) const {
+        ofstream ofs(filename.c_str());
+        if (!ofs.good())
+            throw runtime_error("Profiler::write_trace on '" + filename +
+                                "' failed.");
+        write_trace_to(ofs);
+        if (!ofs.good())
+            throw runtime_error("Profiler::write_trace on '" + filename +
+                                "' failed.");
+        ofs.close();
+    }
+    /** Write all recorded events as Chrome trace (JSON) into output stream.
+     * @param os The output stream.
+     */
+    void write_trace_to(ostream &os) const {
+        lock_guard<mutex> lock(mtx);
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        os << fixed << setprecision(3);
+        bool first = true;
+        for (int it = 0; it < (int)buffers.size(); it++)
+            for (const auto &ev : *buffers[it]) {
+                os << (first ? "" : ",") << "\n{\"name\":\"" << ev.name
+                   << "\",\"pid\":" << rank << ",\"tid\":" << it
+                   << ",\"ts\":" << (ev.start - t0) * 1E-3;
+                if (ev.dur >= 0) {
+                    os << ",\"ph\":\"X\",\"dur\":" << ev.dur * 1E-3
+                       << ",\"args\":{\"site\":" << ev.site;
+                    if (ev.nflop != 0)
+                        os << ",\"nflop\":" << ev.nflop;
+                    os << "}}";
+                } else
+                    os << ",\"ph\":\"C\",\"args\":{\"value\":" << ev.nflop
+                       << "}}";
+                first = false;
+            }
+        os << "\n]}" << endl;
+    }
+    /** Write the trace of the last sweep if trace_prefix is set, and remove
+     * all recorded events.
+     * @param isweep The sweep index.
+     */
+    void write_sweep_trace(int isweep) {
+        if (!enabled || trace_prefix == "")
+            return;
+        stringstream ss;
+        ss << trace_prefix << ".SWEEP." << isweep << ".RANK." << rank
+           << ".json";
+        write_trace(ss.str());
+        clear();
+    }
+    /** Print the summary of all regions.
+     * @param os The output stream.
+     * @param prof The object to be printed.
+     * @return The output stream.
+     */
+    friend ostream &operator<<(ostream &os, const Profiler &prof) {
+        map<string, ProfileStats> st = prof.summary();
+        size_t w = 0;
+        for (auto &r : st)
+            w = max(w, r.first.length());
+        for (auto &r : st)
+            os << " " << setw(w) << left << r.first << right << " : "
+               << r.second << endl;
+        return os;
+    }
+};
+
+#ifdef _USE_GLOBAL_VARIABLE
+
+extern shared_ptr<Profiler> _g_profiler;
+
+/** Implementation of the ``profiler`` global variable. */
+inline shared_ptr<Profiler> &profiler_() { return _g_profiler; }
+
+#else
+
+/** Implementation of the ``profiler`` global variable. */
+inline shared_ptr<Profiler> &profiler_() {
+    static shared_ptr<Profiler> profiler = make_shared<Profiler>();
+    return profiler;
+}
+
+#endif
+
+/** Scoped profiler region. The region starts at construction and ends at
+ * destruction or when end is invoked. Nothing is recorded if the global
+ * profiler is not enabled at construction. */
+struct ProfileScope {
+    Profiler *prof; //!< The profiler or nullptr if not recording.
+    const char *name; //!< Name of the region (must be a static string).
+    int64_t start; //!< Starting time (in nanoseconds).
+    uint64_t nflop = 0; //!< Number of floating-point operations.
+    /** Constructor.
+     * @param name Name of the region (must be a static string).
+     */
+    ProfileScope(const char *name)
+        : prof(profiler_()->enabled ? profiler_().get() : nullptr),
+          name(name), start(prof != nullptr ? Profiler::now() : 0) {}
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+    /** End the region. Later invocations have no effects. */
+    void end() {
+        if (prof != nullptr)
+            prof->record(name, start, Profiler::now(), nflop, prof->site);
+        prof = nullptr;
+    }
+    /** Destructor. */
+    ~ProfileScope() { end(); }
+};
+
+} // namespace block2
@@ -0,0 +1,213 @@
+
+/*
+ * block2: Efficient MPO implementation of quantum chemistry DMRG
+ * Copyright (C) 2020-2021 Huanchen Zhai <hczhai@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/** Register-blocked microkernels for tiny dense matrix multiplications. */
+
+#pragma once
+
+#include "threading.hpp"
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace block2 {
+
+/** Microkernels for tiny row-major GEMM ``c = alpha * op(a) x op(b) + beta *
+ * c``, where ``op`` is either identity or transpose (no conjugation). Each
+ * output tile of at most ``tile x tile`` elements is computed by a kernel
+ * with compile-time tile sizes, so that the accumulators stay in registers
+ * and there is no BLAS call overhead.
+ * @tparam FL float point type.
+ */
+template <typename FL> struct SmallGEMM {
+    static const int tile = 4; //!< Maximal size of one output tile.
+    /** Whether a GEMM can be handled by the microkernels. Returns true for
+     * GEMM with all dimensions not larger than ``max_dim``, and for scaled
+     * vector additions (``n == 1`` and ``k == 1``) of length not larger than
+     * ``max_dim * max_dim``.
+     * @param m Number of rows in ``op(a)`` and ``c``.
+     * @param n Number of columns in ``op(b)`` and ``c``.
+     * @param k Number of columns in ``op(a)``.
+     * @param max_dim Maximal dimension of tiny GEMM (zero to disable).
+     * @return Whether the GEMM is tiny.
+     */
+    static bool is_small(MKL_INT m, MKL_INT n, MKL_INT k, int max_dim) {
+        return max_dim != 0 && m <= (MKL_INT)max_dim * max_dim &&
+               ((n == 1 && k == 1) ||
+                (m <= max_dim && n <= max_dim && k <= max_dim && k != 0));
+    }
+    /** Compute one output tile of size ``MR x NR``. */
+    template <int MR, int NR, bool TA, bool TB>
+    static void kernel(MKL_INT k, FL alpha, const FL *a, MKL_INT lda,
+                       const FL *b, MKL_INT ldb, FL beta, FL *c, MKL_INT ldc) {
+        FL acc[MR][NR];
+        for (int i = 0; i < MR; i++)
+            for (int j = 0; j < NR; j++)
+                acc[i][j] = (FL)0.0;
+        for (MKL_INT l = 0; l < k; l++) {
+            FL xa[MR], xb[NR];
+            for (int i = 0; i < MR; i++)
+                xa[i] = TA ? a[l * lda + i] : a[i * lda + l];
+            for (int j = 0; j < NR; j++)
+                xb[j] = TB ? b[j * ldb + l] : b[l * ldb + j];
+            for (int i = 0; i < MR; i++)
+                for (int j = 0; j < NR; j++)
+                    acc[i][j] += xa[i] * xb[j];
+        }
+        if (beta == (FL)0.0)
+            for (int i = 0; i < MR; i++)
+                for (int j = 0; j < NR; j++)
+                    c[i * ldc + j] = alpha * acc[i][j];
+        else
+            for (int i = 0; i < MR; i++)
+                for (int j = 0; j < NR; j++)
+                    c[i * ldc + j] = alpha * acc[i][j] + beta * c[i * ldc + j];
+    }
+    /** Compute one output tile with ``MR`` rows and ``nr`` columns. */
+    template <int MR, bool TA, bool TB>
+    static void row_kernel(MKL_INT nr, MKL_INT k, FL alpha, const FL *a,
+                           MKL_INT lda, const FL *b, MKL_INT ldb, FL beta,
+                           FL *c, MKL_INT ldc) {
+        switch (nr) {
+        case 1:
+            return kernel<MR, 1, TA, TB>(k, alpha, a, lda, b, ldb, beta, c,
+                                         ldc);
+        case 2:
+            return kernel<MR, 2, TA, TB>(k, alpha, a, lda, b, ldb, beta, c,
+                                         ldc);
+        case 3:
+            return kernel<MR, 3, TA, TB>(k, alpha, a, lda, b, ldb, beta, c,
+                                         ldc);
+        default:
+            return kernel<MR, tile, TA, TB>(k, alpha, a, lda, b, ldb, beta, c,
+                                            ldc);
+        }
+    }
+    /** Tiny GEMM with fixed transpose flags. */
+    template <bool TA, bool TB>
+    static void gemm(MKL_INT m, MKL_INT n, MKL_INT k, FL alpha, const FL *a,
+                     MKL_INT lda, const FL *b, MKL_INT ldb, FL beta, FL *c,
+                     MKL_INT ldc) {
+        for (MKL_INT i = 0; i < m; i += tile) {
+            const MKL_INT mr = min(m - i, (MKL_INT)tile);
+            const FL *pa = TA ? a + i : a + i * lda;
+            for (MKL_INT j = 0; j < n; j += tile) {
+                const MKL_INT nr = min(n - j, (MKL_INT)tile);
+                const FL *pb = TB ? b + j * ldb : b + j;
+                FL *pc = c + i * ldc + j;
+                switch (mr) {
+                case 1:
+                    row_kernel<1, TA, TB>(nr, k, alpha, pa, lda, pb, ldb, beta,
+                                          pc, ldc);
+                    break;
+                case 2:
+                    row_kernel<2, TA, TB>(nr, k, alpha, pa, lda, pb, ldb, beta,
+                                          pc, ldc);
+                    break;
+                case 3:
+                    row_kernel<3, TA, TB>(nr, k, alpha, pa, lda, pb, ldb, beta,
+                                          pc, ldc);
+                    break;
+                default:
+                    row_kernel<tile, TA, TB>(nr, k, alpha, pa, lda, pb, ldb,
+                                             beta, pc, ldc);
+                }
+            }
+        }
+    }
+    /** Scaled vector addition ``c[i] = alpha * a[i] * b + beta * c[i]``,
+     * which is a GEMM with ``n == 1`` and ``k == 1``. */
+    static void axpby(MKL_INT m, FL alpha, const FL *a, MKL_INT inca,
+                      const FL *b, FL beta, FL *c, MKL_INT incc) {
+        const FL x = alpha * b[0];
+        if (beta == (FL)0.0)
+            for (MKL_INT i = 0; i < m; i++)
+                c[i * incc] = x * a[i * inca];
+        else
+            for (MKL_INT i = 0; i < m; i++)
+                c[i * incc] = x * a[i * inca] + beta * c[i * incc];
+    }
+    /** Tiny row-major GEMM ``c = alpha * op(a) x op(b) + beta * c``.
+     * The caller must check ``is_small`` first.
+     * @param ta Whether ``a`` is transposed.
+     * @param tb Whether ``b`` is transposed.
+     * @param m Number of rows in ``op(a)`` and ``c``.
+     * @param n Number of columns in ``op(b)`` and ``c``.
+     * @param k Number of columns in ``op(a)``.
+     * @param alpha Scale factor for ``op(a) x op(b)``.
+     * @param a Pointer to matrix ``a``.
+     * @param lda Leading dimension of ``a``.
+     * @param b Pointer to matrix ``b``.
+     * @param ldb Leading dimension of ``b``.
+     * @param beta Scale factor for ``c``.
+     * @param c Pointer to matrix ``c``.
+     * @param ldc Leading dimension of ``c``.
+     */
+    static void multiply(bool ta, bool tb, MKL_INT m, MKL_INT n, MKL_INT k,
+                         FL alpha, const FL *a, MKL_INT lda, const FL *b,
+                         MKL_INT ldb, FL beta, FL *c, MKL_INT ldc) {
+        // same as BLAS, a and b are not referenced if alpha is zero
+        if (alpha == (FL)0.0) {
+            for (MKL_INT i = 0; i < m; i++)
+                for (MKL_INT j = 0; j < n; j++)
+                    c[i * ldc + j] =
+                        beta == (FL)0.0 ? (FL)0.0 : beta * c[i * ldc + j];
+            return;
+        }
+        if (n == 1 && k == 1)
+            return axpby(m, alpha, a, ta ? 1 : lda, b, beta, c, ldc);
+        if (!ta && !tb)
+            gemm<false, false>(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+        else if (!ta && tb)
+            gemm<false, true>(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+        else if (ta && !tb)
+            gemm<true, false>(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+        else
+            gemm<true, true>(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+    }
+    /** Read the shapes of all GEMM from a file written by
+     * ``BatchGEMMSeq::save_data``, for benchmarking.
+     * @param is The input stream.
+     * @return A list of ``(m, n, k)``.
+     */
+    static vector<array<MKL_INT, 3>> read_shapes(istream &is) {
+        vector<array<MKL_INT, 3>> r;
+        int simple = 0, cnt = 0;
+        is >> simple >> cnt;
+        string line;
+        getline(is, line);
+        while (getline(is, line)) {
+            const size_t ip = line.find("::");
+            stringstream ss(ip == string::npos ? line : line.substr(ip + 2));
+            array<MKL_INT, 3> x;
+            while (ss >> x[0] >> x[1] >> x[2])
+                r.push_back(x);
+        }
+        return r;
+    }
+};
+
+} // namespace block2
@@ -28,6 +28,7 @@
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <list>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -475,6 +476,8 @@ struct SparseMatrixInfo<
         }
     };
     shared_ptr<ConnectionInfo> cinfo;
+    // Hash index for find_state (nullptr for binary search)
+    shared_ptr<StateIndex> index;
     SparseMatrixInfo(const shared_ptr<Allocator<uint32_t>> &alloc = nullptr)
         : n(-1), cinfo(nullptr), alloc(alloc) {}
     SparseMatrixInfo
@@ -496,6 +499,9 @@ struct SparseMatrixInfo<
         memcpy(other.quanta, quanta,
                (n * (sizeof(S) >> 2) + n + _DBL_MEM_SIZE(n)) *
                    sizeof(uint32_t));
+        other.index = nullptr;
+        if (index != nullptr)
+            other.build_index();
     }
     void load_data(const string &filename) {
         ifstream ifs(filename.c_str(), ios::binary);
@@ -531,6 +537,7 @@ struct SparseMatrixInfo<
         n_states_ket = (ubond_t *)(ptr + n * (sizeof(S) >> 2)) + n;
         n_states_total = ptr + n * (sizeof(S) >> 2) + _DBL_MEM_SIZE(n);
         cinfo = nullptr;
+        build_index();
     }
     void save_data(const string &filename) const {
         if (Parsing::link_exists(filename))
@@ -680,6 +687,7 @@ struct SparseMatrixInfo<
         allocate(n);
         if (n != 0) {
             memcpy(quanta, qs.data(), n * sizeof(S));
+            build_index();
             if (trace_right)
                 for (size_t iw = 0; iw < wfn_infos.size(); iw++) {
                     shared_ptr<SparseMatrixInfo> wfn_info = wfn_infos[iw];
@@ -744,6 +752,7 @@ struct SparseMatrixInfo<
                 n_states_total[i + 1] =
                     n_states_total[i] +
                     (uint32_t)n_states_bra[i] * n_states_ket[i];
+            build_index();
         }
     }
     // Extract row or column StateInfo from SparseMatrixInfo
@@ -771,7 +780,17 @@ struct SparseMatrixInfo<
             accumulate(info->n_states, info->n_states + info->n, 0);
         return info;
     }
+    // Build hash index for find_state
+    // Must be called again after quanta is changed in place
+    void build_index() {
+        index = n >= StateIndex::min_n() ? make_shared<StateIndex>(quanta, n)
+                                         : nullptr;
+    }
     int find_state(S q, int start = 0) const {
+        if (index != nullptr && index->valid(quanta, n)) {
+            const int i = index->find(quanta, q);
+            return i >= start ? i : -1;
+        }
         auto p = lower_bound(quanta + start, quanta + n, q);
         if (p == quanta + n || *p != q)
             return -1;
@@ -796,6 +815,7 @@ struct SparseMatrixInfo<
                 n_states_total[i] + (uint32_t)n_states_bra[i] * n_states_ket[i];
             assert(n_states_total[i + 1] >= n_states_total[i]);
         }
+        build_index();
     }
     uint32_t get_total_memory() const {
         if (n == 0)
@@ -820,6 +840,7 @@ struct SparseMatrixInfo<
         n_states_total =
             ptr + length * (sizeof(S) >> 2) + _DBL_MEM_SIZE(length);
         n = length;
+        index = nullptr;
     }
     void deallocate() {
         assert(n != -1);
@@ -832,8 +853,10 @@ struct SparseMatrixInfo<
         n_states_ket = nullptr;
         n_states_total = nullptr;
         n = -1;
+        index = nullptr;
     }
     void reallocate(int length) {
+        index = nullptr;
         uint32_t *ptr = alloc->reallocate(
             (uint32_t *)quanta, n * (sizeof(S) >> 2) + n + _DBL_MEM_SIZE(n),
             length * (sizeof(S) >> 2) + length + _DBL_MEM_SIZE(length));
@@ -864,6 +887,184 @@ struct SparseMatrixInfo<
     }
 };
 
+// Cache of SparseMatrixInfo::ConnectionInfo tables for effective Hamiltonian
+// Entries are keyed by the full content of the inputs (delta quanta, sub
+// delta quanta and quanta of all involved SparseMatrixInfo), so a cached
+// table is only reused when recomputing would give the same result.
+// Least recently used entries are evicted when max_memory (in bytes) is
+// exceeded. Not thread-safe.
+template <typename S> struct ConnectionInfoCache {
+    typedef typename SparseMatrixInfo<S>::ConnectionInfo ConnectionInfo;
+    struct Entry {
+        size_t hash;
+        vector<uint32_t> key, data;
+        int n[5], nc;
+        size_t memory() const {
+            return (key.size() + data.size()) * sizeof(uint32_t) +
+                   sizeof(Entry);
+        }
+    };
+    list<Entry> entries;
+    unordered_multimap<size_t, typename list<Entry>::iterator> index;
+    size_t max_memory, used_memory = 0;
+    size_t n_hits = 0, n_misses = 0, n_evictions = 0;
+    ConnectionInfoCache(size_t max_memory = (size_t)1 << 30)
+        : max_memory(max_memory) {}
+    static void push_quanta(vector<uint32_t> &key, const S *quanta, int n) {
+        key.push_back((uint32_t)n);
+        key.insert(key.end(), (const uint32_t *)quanta,
+                   (const uint32_t *)(quanta + n));
+    }
+    static void
+    push_subdq(vector<uint32_t> &key, const vector<pair<uint8_t, S>> &subdq) {
+        key.push_back((uint32_t)subdq.size());
+        for (auto &p : subdq) {
+            key.push_back(p.first);
+            push_quanta(key, &p.second, 1);
+        }
+    }
+    static void
+    push_infos(vector<uint32_t> &key,
+               const vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> &infos) {
+        key.push_back((uint32_t)infos.size());
+        for (auto &p : infos) {
+            push_quanta(key, &p.first, 1);
+            key.push_back(p.second->is_fermion);
+            push_quanta(key, p.second->quanta, p.second->n);
+        }
+    }
+    static size_t hash_key(const vector<uint32_t> &key) {
+        size_t h = key.size();
+        for (uint32_t x : key)
+            h ^= x + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        return h;
+    }
+    // Copy cached table into ci (allocated from ialloc) if key is found
+    bool load(const vector<uint32_t> &key, size_t h, ConnectionInfo &ci) {
+        auto rg = index.equal_range(h);
+        for (auto it = rg.first; it != rg.second; ++it) {
+            const Entry &e = *it->second;
+            if (e.key != key)
+                continue;
+            memcpy(ci.n, e.n, sizeof(ci.n));
+            ci.nc = e.nc;
+            const size_t lq = (size_t)ci.n[4] * (sizeof(S) >> 2) + ci.n[4];
+            uint32_t *ptr = ialloc->allocate(lq);
+            uint32_t *cptr = ialloc->allocate((size_t)ci.nc * 7);
+            memcpy(ptr, e.data.data(), lq * sizeof(uint32_t));
+            memcpy(cptr, e.data.data() + lq,
+                   (size_t)ci.nc * 7 * sizeof(uint32_t));
+            ci.quanta = (S *)ptr;
+            ci.idx = ptr + ci.n[4] * (sizeof(S) >> 2);
+            ci.stride = (uint64_t *)cptr;
+            ci.factor = (double *)(cptr + ci.nc * 2);
+            ci.ia = (uint32_t *)(cptr + ci.nc * 4), ci.ib = ci.ia + ci.nc,
+            ci.ic = ci.ib + ci.nc;
+            entries.splice(entries.begin(), entries, it->second);
+            n_hits++;
+            return true;
+        }
+        n_misses++;
+        return false;
+    }
+    void store(vector<uint32_t> &&key, size_t h, const ConnectionInfo &ci) {
+        Entry e;
+        e.hash = h;
+        e.key = move(key);
+        memcpy(e.n, ci.n, sizeof(e.n));
+        e.nc = ci.nc;
+        const size_t lq = (size_t)ci.n[4] * (sizeof(S) >> 2) + ci.n[4];
+        e.data.resize(lq + (size_t)ci.nc * 7);
+        memcpy(e.data.data(), ci.quanta, lq * sizeof(uint32_t));
+        memcpy(e.data.data() + lq, ci.stride,
+               (size_t)ci.nc * 7 * sizeof(uint32_t));
+        const size_t mem = e.memory();
+        if (mem > max_memory)
+            return;
+        while (used_memory + mem > max_memory)
+            evict();
+        entries.push_front(move(e));
+        index.insert(make_pair(h, entries.begin()));
+        used_memory += mem;
+    }
+    void evict() {
+        assert(entries.size() != 0);
+        auto it = prev(entries.end());
+        auto rg = index.equal_range(it->hash);
+        for (auto ix = rg.first; ix != rg.second; ++ix)
+            if (ix->second == it) {
+                index.erase(ix);
+                break;
+            }
+        used_memory -= it->memory();
+        entries.erase(it);
+        n_evictions++;
+    }
+    void clear() {
+        entries.clear();
+        index.clear();
+        used_memory = 0;
+    }
+    // Cached version of ConnectionInfo::initialize_diag
+    void initialize_diag(
+        ConnectionInfo &ci, S cdq, S opdq,
+        const vector<pair<uint8_t, S>> &subdq,
+        const vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> &ainfos,
+        const vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> &binfos,
+        const shared_ptr<SparseMatrixInfo<S>> &cinfo,
+        const shared_ptr<CG<S>> &cg) {
+        if (ainfos.size() == 0 || binfos.size() == 0)
+            return ci.initialize_diag(cdq, opdq, subdq, ainfos, binfos, cinfo,
+                                      cg);
+        vector<uint32_t> key(1, 0);
+        push_quanta(key, &cdq, 1);
+        push_quanta(key, &opdq, 1);
+        push_subdq(key, subdq);
+        push_infos(key, ainfos);
+        push_infos(key, binfos);
+        push_quanta(key, cinfo->quanta, cinfo->n);
+        const size_t h = hash_key(key);
+        if (!load(key, h, ci)) {
+            ci.initialize_diag(cdq, opdq, subdq, ainfos, binfos, cinfo, cg);
+            store(move(key), h, ci);
+        }
+    }
+    // Cached version of ConnectionInfo::initialize_wfn
+    void initialize_wfn(
+        ConnectionInfo &ci, S cdq, S vdq, S opdq,
+        const vector<pair<uint8_t, S>> &subdq,
+        const vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> &ainfos,
+        const vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> &binfos,
+        const shared_ptr<SparseMatrixInfo<S>> &cinfo,
+        const shared_ptr<SparseMatrixInfo<S>> &vinfo,
+        const shared_ptr<CG<S>> &cg) {
+        if (ainfos.size() == 0 || binfos.size() == 0)
+            return ci.initialize_wfn(cdq, vdq, opdq, subdq, ainfos, binfos,
+                                     cinfo, vinfo, cg);
+        vector<uint32_t> key(1, 1);
+        push_quanta(key, &cdq, 1);
+        push_quanta(key, &vdq, 1);
+        push_quanta(key, &opdq, 1);
+        push_subdq(key, subdq);
+        push_infos(key, ainfos);
+        push_infos(key, binfos);
+        push_quanta(key, cinfo->quanta, cinfo->n);
+        push_quanta(key, vinfo->quanta, vinfo->n);
+        const size_t h = hash_key(key);
+        if (!load(key, h, ci)) {
+            ci.initialize_wfn(cdq, vdq, opdq, subdq, ainfos, binfos, cinfo,
+                              vinfo, cg);
+            store(move(key), h, ci);
+        }
+    }
+    friend ostream &operator<<(ostream &os, const ConnectionInfoCache &c) {
+        os << "CICache HIT=" << c.n_hits << " MISS=" << c.n_misses
+           << " EVICT=" << c.n_evictions << " N=" << c.entries.size()
+           << " MEM=" << Parsing::to_size_string(c.used_memory);
+        return os;
+    }
+};
+
 enum struct SparseMatrixTypes : uint8_t {
     Normal = 0,
     CSR = 1,
@@ -897,8 +1098,10 @@ template <typename S, typename FL> struct SparseMatrix {
         ifs.read((char *)&factor, sizeof(factor));
         ifs.read((char *)&total_memory, sizeof(total_memory));
         const size_t cps_flag = numeric_limits<size_t>::max();
+        const size_t lz_cps_flag = cps_flag - 1;
         bool cpsd = total_memory == cps_flag;
-        if (cpsd)
+        bool lz_cpsd = total_memory == lz_cps_flag;
+        if (cpsd || lz_cpsd)
             ifs.read((char *)&total_memory, sizeof(total_memory));
         if (pointer_only && total_memory != 0) {
             size_t psz;
@@ -909,6 +1112,10 @@ template <typename S, typename FL> struct SparseMatrix {
             data = (FL *)alloc->allocate(total_memory * cpx_sz);
             make_shared<FPCodec<FP>>()->read_array(ifs, (FP *)data,
                                                    total_memory * cpx_sz);
+        } else if (lz_cpsd) {
+            data = (FL *)alloc->allocate(total_memory * cpx_sz);
+            make_shared<LZCodec>()->read_array(ifs, (FP *)data,
+                                               total_memory * cpx_sz);
         } else {
             data = (FL *)alloc->allocate(total_memory * cpx_sz);
             ifs.read((char *)data, sizeof(FL) * total_memory);
@@ -935,8 +1142,15 @@ template <typename S, typename FL> struct SparseMatrix {
     }
     virtual void save_data(ostream &ofs, bool pointer_only = false) const {
         ofs.write((char *)&factor, sizeof(factor));
-        if (frame_<FP>()->compressed_sparse_tensor_storage) {
-            const size_t cps_flag = numeric_limits<size_t>::max();
+        // lossless compression is used if there is no fp_codec
+        // and data is written uncompressed if there is no codec
+        const bool fp_cps = frame_<FP>()->compressed_sparse_tensor_storage &&
+                            frame_<FP>()->fp_codec != nullptr;
+        const bool lz_cps = frame_<FP>()->compressed_sparse_tensor_storage &&
+                            !fp_cps && frame_<FP>()->lz_codec != nullptr;
+        if (fp_cps || lz_cps) {
+            const size_t cps_flag =
+                numeric_limits<size_t>::max() - (size_t)lz_cps;
             ofs.write((char *)&cps_flag, sizeof(cps_flag));
         }
         ofs.write((char *)&total_memory, sizeof(total_memory));
@@ -947,8 +1161,10 @@ template <typename S, typename FL> struct SparseMatrix {
             // assert(alloc == dalloc_<FP>());
             size_t psz = (FP *)data - dalloc_<FP>()->data;
             ofs.write((char *)&psz, sizeof(psz));
-        } else if (frame_<FP>()->compressed_sparse_tensor_storage) {
-            assert(frame_<FP>()->fp_codec != nullptr);
+        } else if (lz_cps) {
+            frame_<FP>()->lz_codec->write_array(ofs, (FP *)data,
+                                                total_memory * cpx_sz);
+        } else if (fp_cps) {
             frame_<FP>()->fp_codec->write_array(ofs, (FP *)data,
                                                 total_memory * cpx_sz);
         } else
@@ -1784,6 +2000,32 @@ template <typename S, typename FL> struct SparseMatrix {
             }
         }
     }
+    // Project wavefunction onto the bond space of a rotation matrix
+    // wfn = rot.H x wfn (left) or wfn = wfn x rot.H (!left)
+    // (inverse of the contraction of a bond wavefunction with rot)
+    void contract_conj_rotation(const shared_ptr<SparseMatrix> &wfn,
+                                const shared_ptr<SparseMatrix> &rot,
+                                bool left) {
+        assert(info->is_wavefunction && wfn->info->is_wavefunction);
+        assert(!rot->info->is_wavefunction);
+        clear();
+        for (int i = 0; i < info->n; i++) {
+            int iw = wfn->info->find_state(info->quanta[i]);
+            int ir = rot->info->find_state(
+                left ? info->quanta[i].get_bra(info->delta_quantum)
+                     : -info->quanta[i].get_ket());
+            if (iw == -1 || ir == -1)
+                continue;
+            if (left)
+                GMatrixFunctions<FL>::multiply(
+                    (*rot)[ir], 3, (*wfn)[iw], false, (*this)[i],
+                    xconj<FL>(rot->factor) * wfn->factor, 0.0);
+            else
+                GMatrixFunctions<FL>::multiply(
+                    (*wfn)[iw], false, (*rot)[ir], 3, (*this)[i],
+                    wfn->factor * xconj<FL>(rot->factor), 0.0);
+        }
+    }
     // Change from [l x (fused m and r)] to [(fused l and m) x r]
     void
     swap_to_fused_left(const shared_ptr<SparseMatrix> &mat,
@@ -52,6 +52,53 @@ typedef int32_t total_bond_t;
 #endif
 #endif
 
+// Open-addressing hash index over an array of symmetry labels
+// Only positions are stored, so the index is only valid for the array
+// (and length) it was built from
+struct StateIndex {
+    vector<int> slots;
+    const void *quanta;
+    int n;
+    size_t mask;
+    template <typename S>
+    StateIndex(const S *quanta, int n) : quanta(quanta), n(n) {
+        size_t sz = 2;
+        while (sz < (size_t)n * 2)
+            sz <<= 1;
+        mask = sz - 1;
+        slots.resize(sz, -1);
+        // for repeated labels the first position is kept,
+        // which is the same as lower_bound
+        for (int i = 0; i < n; i++)
+            for (size_t j = mix(quanta[i].hash()) & mask;; j = (j + 1) & mask)
+                if (slots[j] == -1) {
+                    slots[j] = i;
+                    break;
+                } else if (quanta[slots[j]] == quanta[i])
+                    break;
+    }
+    // Minimal number of labels for building an index
+    // (binary search is used for shorter arrays)
+    static int &min_n() {
+        static int x = 32;
+        return x;
+    }
+    static size_t mix(size_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return h;
+    }
+    bool valid(const void *quanta, int n) const {
+        return this->quanta == quanta && this->n == n;
+    }
+    template <typename S> int find(const S *quanta, S q) const {
+        for (size_t j = mix(q.hash()) & mask;; j = (j + 1) & mask)
+            if (slots[j] == -1 || quanta[slots[j]] == q)
+                return slots[j];
+    }
+};
+
 template <typename, typename = void> struct StateInfo;
 
 // A collection of quantum symmetry labels and their quantity
@@ -66,6 +113,8 @@ struct StateInfo<S,
     ubond_t *n_states;
     int n;
     total_bond_t n_states_total;
+    // Hash index for find_state (nullptr for binary search)
+    shared_ptr<StateIndex> index;
     struct ConnectionInfo {
         vector<uint32_t> acc_n_states;
         vector<pair<uint32_t, uint32_t>> ij_indices;
@@ -86,6 +135,7 @@ struct StateInfo<S,
         ifs.read((char *)ptr, sizeof(uint32_t) * _SI_MEM_SIZE(n));
         quanta = (S *)ptr;
         n_states = (ubond_t *)(ptr + n * (sizeof(S) >> 2));
+        build_index();
     }
     void load_data(const string &filename) {
         ifstream ifs(filename.c_str(), ios::binary);
@@ -125,8 +175,10 @@ struct StateInfo<S,
         n = length;
         quanta = (S *)ptr;
         n_states = (ubond_t *)(ptr + length * (sizeof(S) >> 2));
+        index = nullptr;
     }
     void reallocate(int length) {
+        index = nullptr;
         if (length < n) {
             memmove((uint32_t *)(quanta + length), (uint32_t *)n_states,
                     length * sizeof(ubond_t));
@@ -147,6 +199,7 @@ struct StateInfo<S,
         vdata = nullptr;
         quanta = nullptr;
         n_states = nullptr;
+        index = nullptr;
     }
     StateInfo deep_copy() const {
         StateInfo other;
@@ -158,6 +211,9 @@ struct StateInfo<S,
     void copy_data_to(StateInfo &other) const {
         assert(other.n == n);
         memcpy(other.quanta, quanta, _SI_MEM_SIZE(n) * sizeof(uint32_t));
+        other.index = nullptr;
+        if (index != nullptr)
+            other.build_index();
     }
     void sort_states() {
         vector<int> idx(n);
@@ -172,6 +228,7 @@ struct StateInfo<S,
         n_states_total = 0;
         for (int i = 0; i < n; i++)
             n_states_total += n_states[i];
+        build_index();
     }
     // Remove quanta larger than target and quanta with zero n_states
     void collect(S target = S(S::invalid)) {
@@ -194,8 +251,17 @@ struct StateInfo<S,
         n_states_total = 0;
         for (int i = 0; i < n; i++)
             n_states_total += n_states[i];
+        build_index();
+    }
+    // Build hash index for find_state
+    // Must be called again after quanta is changed in place
+    void build_index() {
+        index = n >= StateIndex::min_n() ? make_shared<StateIndex>(quanta, n)
+                                         : nullptr;
     }
     int find_state(S q) const {
+        if (index != nullptr && index->valid(quanta, n))
+            return index->find(quanta, q);
         auto p = lower_bound(quanta, quanta + n, q);
         if (p == quanta + n || *p != q)
             return -1;
@@ -234,6 +300,7 @@ struct StateInfo<S,
         c.allocate(cref.n);
         memcpy(c.quanta, cref.quanta, c.n * sizeof(S));
         memset(c.n_states, 0, c.n * sizeof(ubond_t));
+        c.build_index();
         for (int i = 0; i < a.n; i++)
             for (int j = 0; j < b.n; j++) {
                 S qc = a.quanta[i] + b.quanta[j];
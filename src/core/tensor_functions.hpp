@@ -60,12 +60,19 @@ template <typename S, typename FL> struct TensorFunctions {
                             FL scale = 1.0) {
         opf->seq->operator()(b, c, scale);
     }
+    virtual void operator()(const vector<GMatrix<FL>> &bs,
+                            const vector<GMatrix<FL>> &cs, FL scale = 1.0) {
+        opf->seq->operator()(bs, cs, scale);
+    }
     template <typename T> void serial_for(size_t n, T op) const {
         shared_ptr<TensorFunctions> tf = make_shared<TensorFunctions>(*this);
         for (size_t i = 0; i < n; i++)
             op(tf, i);
     }
-    template <typename T> void parallel_for(size_t n, T op) const {
+    // costs: optional cost hints of tasks, used when threading->work_stealing
+    template <typename T>
+    void parallel_for(size_t n, T op,
+                      const vector<uint64_t> &costs = vector<uint64_t>()) const {
         shared_ptr<TensorFunctions> tf = make_shared<TensorFunctions>(*this);
         int ntop = threading->activate_operator();
         if (ntop == 1) {
@@ -78,10 +85,17 @@ template <typename S, typename FL> struct TensorFunctions {
                 tfs.push_back(this->copy());
                 tfs[i]->opf->seq->cumulative_nflop = 0;
             }
+            if (threading->work_stealing)
+                TaskScheduler::run(ntop, n, costs,
+                                   [&tfs, &op](int tid, size_t i) {
+                                       op(tfs[tid], i);
+                                   });
+            else {
 #pragma omp parallel for schedule(dynamic) num_threads(ntop)
-            for (int i = 0; i < (int)n; i++) {
-                int tid = threading->get_thread_id();
-                op(tfs[tid], (size_t)i);
+                for (int i = 0; i < (int)n; i++) {
+                    int tid = threading->get_thread_id();
+                    op(tfs[tid], (size_t)i);
+                }
             }
             tf_sz[1][0] = opf->seq->batch[0]->gp.size();
             tf_sz[1][1] = opf->seq->batch[0]->c.size();
@@ -136,12 +150,14 @@ template <typename S, typename FL> struct TensorFunctions {
             op(tf, mat, i);
     }
     template <typename T, typename SM>
-    void parallel_reduce(size_t n, const shared_ptr<SM> &mat, T op) const {
+    void parallel_reduce(size_t n, const shared_ptr<SM> &mat, T op,
+                         const vector<uint64_t> &costs =
+                             vector<uint64_t>()) const {
         if (opf->seq->mode == SeqTypes::Auto ||
             (opf->seq->mode & SeqTypes::Tasked)) {
             auto xop = [&mat, &op](const shared_ptr<TensorFunctions> &tf,
                                    size_t i) { op(tf, mat, i); };
-            return parallel_for(n, xop);
+            return parallel_for(n, xop, costs);
         }
         shared_ptr<TensorFunctions> tf = make_shared<TensorFunctions>(*this);
         int ntop = threading->activate_operator();
@@ -156,18 +172,30 @@ template <typename S, typename FL> struct TensorFunctions {
                 tfs.push_back(this->copy());
                 tfs[i]->opf->seq->cumulative_nflop = 0;
             }
+            shared_ptr<TaskScheduler> sched =
+                threading->work_stealing
+                    ? make_shared<TaskScheduler>(ntop, n, costs)
+                    : nullptr;
+            auto xop = [&tfs, &mats, &op](int tid, size_t i) {
+                op(tfs[tid], mats[tid], i);
+            };
 #pragma omp parallel num_threads(ntop)
             {
                 int tid = threading->get_thread_id();
                 if (tid != 0) {
-                    shared_ptr<VectorAllocator<FP>> d_alloc =
-                        make_shared<VectorAllocator<FP>>();
+                    shared_ptr<ArenaAllocator<FP>> d_alloc =
+                        make_shared<ArenaAllocator<FP>>();
                     mats[tid] = make_shared<SM>(d_alloc);
                     mats[tid]->allocate_like(mat);
                 }
+                if (sched != nullptr) {
+                    sched->work(tid, xop);
+#pragma omp barrier
+                } else {
 #pragma omp for schedule(dynamic)
-                for (int i = 0; i < (int)n; i++)
-                    op(tfs[tid], mats[tid], (size_t)i);
+                    for (int i = 0; i < (int)n; i++)
+                        xop(tid, (size_t)i);
+                }
 #pragma omp single
                 tfs[tid]->opf->parallel_reduce(mats, 0, ntop);
                 if (tid != 0) {
@@ -2361,6 +2389,33 @@ template <typename S, typename FL> struct TensorFunctions {
             }
         }
     }
+    // cost hints of rotating each operator in a (for work stealing)
+    vector<uint64_t>
+    rotate_costs(const shared_ptr<Symbolic<S>> &amat,
+                 const shared_ptr<OperatorTensor<S, FL>> &a) const {
+        return threading->task_costs(amat->data.size(), [&](size_t i) {
+            if (amat->data[i]->get_type() == OpTypes::Zero)
+                return (uint64_t)0;
+            return (uint64_t)a->ops.at(abs_value(amat->data[i]))->info->n;
+        });
+    }
+    // cost hints of contracting each expression into an operator in c
+    // (for work stealing): number of terms x size of the result
+    vector<uint64_t>
+    contract_costs(const shared_ptr<Symbolic<S>> &exprs,
+                   const shared_ptr<Symbolic<S>> &cmat,
+                   const shared_ptr<OperatorTensor<S, FL>> &c) const {
+        return threading->task_costs(exprs->data.size(), [&](size_t i) {
+            const shared_ptr<OpExpr<S>> &expr = exprs->data[i];
+            uint64_t nterms = 1;
+            if (expr->get_type() == OpTypes::Zero)
+                return (uint64_t)0;
+            else if (expr->get_type() == OpTypes::Sum)
+                nterms =
+                    dynamic_pointer_cast<OpSum<S, FL>>(expr)->strings.size();
+            return nterms * c->ops.at(abs_value(cmat->data[i]))->info->n;
+        });
+    }
     // c = mpst_bra x a x mpst_ket
     virtual void left_rotate(const shared_ptr<OperatorTensor<S, FL>> &a,
                              const shared_ptr<SparseMatrix<S, FL>> &mpst_bra,
@@ -2377,7 +2432,8 @@ template <typename S, typename FL> struct TensorFunctions {
                                                     c->ops.at(pa), mpst_bra,
                                                     mpst_ket, false);
                          }
-                     });
+                     },
+                     rotate_costs(a->lmat, a));
         if (opf->seq->mode == SeqTypes::Auto)
             opf->seq->auto_perform();
     }
@@ -2397,7 +2453,8 @@ template <typename S, typename FL> struct TensorFunctions {
                                                     c->ops.at(pa), mpst_bra,
                                                     mpst_ket, true);
                          }
-                     });
+                     },
+                     rotate_costs(a->rmat, a));
         if (opf->seq->mode == SeqTypes::Auto)
             opf->seq->auto_perform();
     }
@@ -2878,7 +2935,8 @@ template <typename S, typename FL> struct TensorFunctions {
                         }
                         tf->tensor_product(expr, a->ops, b->ops, c->ops.at(op));
                     }
-                });
+                },
+                contract_costs(exprs, c->lmat, c));
             if (opf->seq->mode == SeqTypes::Auto)
                 opf->seq->auto_perform();
         }
@@ -2977,7 +3035,8 @@ template <typename S, typename FL> struct TensorFunctions {
                         }
                         tf->tensor_product(expr, b->ops, a->ops, c->ops.at(op));
                     }
-                });
+                },
+                contract_costs(exprs, c->rmat, c));
             if (opf->seq->mode == SeqTypes::Auto)
                 opf->seq->auto_perform();
         }
@@ -3094,7 +3153,8 @@ template <typename S, typename FL> struct TensorFunctions {
                         if (!frame_<FP>()->use_main_stack)
                             ab->ops.at(op)->deallocate();
                     }
-                });
+                },
+                contract_costs(exprs, ab->lmat, ab));
         }
     }
     // c = mpst_bra x [ b (dot) x a ] x mpst_ket
@@ -3156,7 +3216,8 @@ template <typename S, typename FL> struct TensorFunctions {
                         if (!frame_<FP>()->use_main_stack)
                             ab->ops.at(op)->deallocate();
                     }
-                });
+                },
+                contract_costs(exprs, ab->rmat, ab));
         }
     }
     virtual void left_contract_rotate_stacked(
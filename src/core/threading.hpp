@@ -40,12 +40,23 @@
 #define BLIS_DISABLE_BLAS_DEFS
 #include "blis/blis.h"
 #endif
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#define _HAS_NUMA_AFFINITY
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <queue>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -142,6 +153,141 @@ inline SeqTypes operator|(SeqTypes a, SeqTypes b) {
     return SeqTypes((uint8_t)a | (uint8_t)b);
 }
 
+/**
+ * Work-stealing scheduler for a set of independent tasks with cost hints.
+ * Tasks are first distributed to the threads using the longest-processing-time
+ * rule. Each thread runs its own tasks from the most expensive to the least
+ * expensive one, and when it runs out of tasks, it steals the cheapest
+ * remaining task from the thread with the most remaining work. Compared to
+ * ``schedule(dynamic)``, expensive tasks are never started last, which avoids
+ * idle tails when task costs vary by orders of magnitude.
+ */
+struct TaskScheduler {
+    /** Task queue of one thread. */
+    struct TaskQueue {
+        mutex mtx;            //!< Mutex protecting head and tail.
+        vector<size_t> tasks; //!< Task indices (in decreasing cost order).
+        size_t head = 0,      //!< Index of the next task run by the owner.
+            tail = 0;         //!< One past the index of the next stolen task.
+        atomic<uint64_t> remaining{0}; //!< Total cost of tasks not started.
+    };
+    vector<uint64_t> costs;  //!< Cost of each task.
+    vector<TaskQueue> queues; //!< Task queues of all threads.
+    atomic<size_t> n_steals{0}; //!< Number of stolen tasks.
+    /** Constructor.
+     * @param n_threads Number of threads.
+     * @param n Number of tasks.
+     * @param xcosts Cost hints of tasks (for example, number of flops). If
+     *   empty, all tasks are considered to have the same cost.
+     */
+    TaskScheduler(int n_threads, size_t n, const vector<uint64_t> &xcosts)
+        : costs(xcosts), queues(max(n_threads, 1)) {
+        if (costs.size() != n)
+            costs.assign(n, 1);
+        for (auto &c : costs)
+            c = max(c, (uint64_t)1);
+        vector<size_t> idx(n);
+        for (size_t i = 0; i < n; i++)
+            idx[i] = i;
+        stable_sort(idx.begin(), idx.end(), [this](size_t i, size_t j) {
+            return costs[i] > costs[j];
+        });
+        priority_queue<pair<uint64_t, int>, vector<pair<uint64_t, int>>,
+                       greater<pair<uint64_t, int>>>
+            loads;
+        for (int it = 0; it < (int)queues.size(); it++)
+            loads.push(make_pair((uint64_t)0, it));
+        for (auto i : idx) {
+            pair<uint64_t, int> p = loads.top();
+            loads.pop();
+            queues[p.second].tasks.push_back(i);
+            p.first += costs[i];
+            loads.push(p);
+        }
+        for (auto &q : queues) {
+            q.tail = q.tasks.size();
+            uint64_t r = 0;
+            for (auto i : q.tasks)
+                r += costs[i];
+            q.remaining = r;
+        }
+    }
+    /** Take the next task from the queue of the current thread.
+     * @param tid Thread index.
+     * @param task The task index (output).
+     * @return Whether a task is taken.
+     */
+    bool pop(int tid, size_t &task) {
+        TaskQueue &q = queues[tid];
+        lock_guard<mutex> lock(q.mtx);
+        if (q.head == q.tail)
+            return false;
+        task = q.tasks[q.head++];
+        q.remaining -= costs[task];
+        return true;
+    }
+    /** Steal a task from the queue with the most remaining work.
+     * @param tid Thread index of the thief.
+     * @param task The task index (output).
+     * @return Whether a task is taken. If false, all tasks have been taken.
+     */
+    bool steal(int tid, size_t &task) {
+        while (true) {
+            int victim = -1;
+            uint64_t vrem = 0;
+            for (int it = 0; it < (int)queues.size(); it++) {
+                uint64_t r = queues[it].remaining;
+                if (it != tid && r > vrem)
+                    victim = it, vrem = r;
+            }
+            if (victim == -1)
+                return false;
+            TaskQueue &q = queues[victim];
+            lock_guard<mutex> lock(q.mtx);
+            if (q.head == q.tail)
+                continue;
+            task = q.tasks[--q.tail];
+            q.remaining -= costs[task];
+            n_steals++;
+            return true;
+        }
+    }
+    /** Run tasks in the current thread until all tasks have been taken.
+     * @param tid Thread index.
+     * @param f The task function, taking thread index and task index.
+     */
+    template <typename F> void work(int tid, F &f) {
+        size_t task;
+        while (pop(tid, task))
+            f(tid, task);
+        while (steal(tid, task))
+            f(tid, task);
+    }
+    /** Run all tasks using OpenMP threads.
+     * @param n_threads Number of threads.
+     * @param n Number of tasks.
+     * @param costs Cost hints of tasks. If empty, all tasks are considered to
+     *   have the same cost.
+     * @param f The task function, taking thread index and task index.
+     * @return Number of stolen tasks.
+     */
+    template <typename F>
+    static size_t run(int n_threads, size_t n, const vector<uint64_t> &costs,
+                      F f) {
+        TaskScheduler sched(n_threads, n, costs);
+#pragma omp parallel num_threads(n_threads)
+        {
+#ifdef _OPENMP
+            int tid = omp_get_thread_num();
+#else
+            int tid = 0;
+#endif
+            sched.work(tid, f);
+        }
+        return sched.n_steals;
+    }
+};
+
 /**
  * Global information for threading schemes.
  */
@@ -157,6 +303,236 @@ struct Threading {
                               //!< dense matrix multiplications.
         n_threads_global = 0, //!< Number of threads for general tasks
         n_levels = 0;         //!< Number of nested threading layers
+    bool numa_pinning =
+        false; //!< Whether threads for parallelism over renormalized operators
+               //!< should be pinned to sockets (NUMA nodes). Worker ``i`` of
+               //!< ``n_threads_op`` is bound to all cores of socket
+               //!< ``i * n_sockets / n_threads_op``, and dense matrix
+               //!< multiplication threads created by the worker inherit this
+               //!< binding. Threads are pinned once (by the first
+               //!< ``activate_operator`` or by ``pin_operator_threads``) and
+               //!< stay pinned for other tasks until ``unpin_threads``.
+               //!< Only effective on Linux.
+    mutable int pinned_threads = 0; //!< Number of threads currently pinned to
+                                    //!< sockets (zero if not pinned).
+    bool work_stealing =
+        false; //!< Whether parallelism over renormalized operators and
+               //!< symmetry sectors should use TaskScheduler with cost hints,
+               //!< instead of OpenMP ``schedule(dynamic)``.
+    bool cache_activation =
+        true; //!< Whether library calls for setting the number of threads in
+              //!< ``activate_*`` methods should be skipped when the number is
+              //!< unchanged. OpenMP settings are checked against
+              //!< ``omp_get_max_threads``. MKL and BLIS settings are cached
+              //!< process-wide, so ``invalidate_cache`` must be invoked after
+              //!< setting them outside this class.
+    int small_gemm_size =
+        0; //!< Maximal dimension of dense matrix multiplications in batched
+           //!< GEMM computed by SmallGEMM microkernels instead of BLAS.
+           //!< Zero (default) to always use BLAS. The benefit depends on the
+           //!< BLAS library and the shape histogram, which can be measured
+           //!< using ``gemm_replay``.
+    /** Number of threads last set in MKL (-1 if unknown). */
+    static atomic<int> &mkl_threads_cache() {
+        static atomic<int> x(-1);
+        return x;
+    }
+    /** Number of threads last set in BLIS (-1 if unknown). */
+    static atomic<int> &blis_threads_cache() {
+        static atomic<int> x(-1);
+        return x;
+    }
+    /** Number of calls into OpenMP, MKL and BLIS for setting the number of
+     * threads (for benchmarking the activation overhead). */
+    static atomic<size_t> &n_library_calls() {
+        static atomic<size_t> x(0);
+        return x;
+    }
+    /** Forget cached MKL and BLIS settings. */
+    static void invalidate_cache() {
+        mkl_threads_cache() = -1;
+        blis_threads_cache() = -1;
+    }
+    /** Set number of OpenMP threads for the next parallel region of the
+     * calling thread, if it is changed.
+     * @param n Number of threads.
+     */
+    void set_omp_threads(int n) const {
+#ifdef _OPENMP
+        if (!cache_activation || omp_get_max_threads() != n) {
+            omp_set_num_threads(n);
+            n_library_calls()++;
+        }
+#endif
+    }
+    /** Set number of MKL threads, if it is changed.
+     * @param n Number of threads.
+     */
+    void set_mkl_threads(int n) const {
+#ifdef _HAS_INTEL_MKL
+        if (!cache_activation || mkl_threads_cache() != n) {
+            mkl_set_num_threads(n);
+            mkl_threads_cache() = n;
+            n_library_calls()++;
+        }
+#endif
+    }
+    /** Set number of BLIS threads, if it is changed.
+     * @param n Number of threads.
+     */
+    void set_blis_threads(int n) const {
+#ifdef _HAS_BLIS
+        if (!cache_activation || blis_threads_cache() != n) {
+            bli_thread_set_num_threads(n);
+            blis_threads_cache() = n;
+            n_library_calls()++;
+        }
+#endif
+    }
+    /** Compute cost hints of tasks for TaskScheduler.
+     * @param n Number of tasks.
+     * @param f The cost function, taking the task index.
+     * @return Cost hints of tasks. Empty if work_stealing is false.
+     */
+    template <typename F>
+    vector<uint64_t> task_costs(size_t n, const F &f) const {
+        vector<uint64_t> r;
+        if (!work_stealing)
+            return r;
+        r.resize(n);
+        for (size_t i = 0; i < n; i++)
+            r[i] = (uint64_t)f(i);
+        return r;
+    }
+    /** Get the NUMA topology of the machine, restricted to the CPUs that this
+     * process is allowed to run on. Nodes without any allowed CPU are
+     * omitted. If the topology cannot be detected, a single node with index
+     * zero containing all allowed CPUs is returned.
+     * @return A list of (NUMA node index, CPU indices) pairs.
+     */
+    static const vector<pair<int, vector<int>>> &numa_topology() {
+        static const vector<pair<int, vector<int>>> topo = detect_numa();
+        return topo;
+    }
+    /** Parse a Linux cpu/node list string (such as ``0-3,8,10-11``).
+     * @param x The list string.
+     * @return The list of indices.
+     */
+    static vector<int> parse_cpu_list(const string &x) {
+        vector<int> r;
+        stringstream ss(x);
+        string tok;
+        while (getline(ss, tok, ',')) {
+            if (tok.find_first_of("0123456789") == string::npos)
+                continue;
+            size_t p = tok.find('-');
+            int a = stoi(tok.substr(0, p));
+            int b = p == string::npos ? a : stoi(tok.substr(p + 1));
+            for (int i = a; i <= b; i++)
+                r.push_back(i);
+        }
+        return r;
+    }
+    static vector<pair<int, vector<int>>> detect_numa() {
+        vector<pair<int, vector<int>>> r;
+        vector<int> allowed;
+#ifdef _HAS_NUMA_AFFINITY
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+            for (int i = 0; i < CPU_SETSIZE; i++)
+                if (CPU_ISSET(i, &mask))
+                    allowed.push_back(i);
+        const string dir = "/sys/devices/system/node/";
+        ifstream ifs(dir + "online");
+        string line;
+        if (ifs.good() && getline(ifs, line))
+            for (int node : parse_cpu_list(line)) {
+                ifstream ifn(dir + "node" + to_string(node) + "/cpulist");
+                string cl;
+                if (!ifn.good() || !getline(ifn, cl))
+                    continue;
+                vector<int> cpus;
+                for (int c : parse_cpu_list(cl))
+                    if (binary_search(allowed.begin(), allowed.end(), c))
+                        cpus.push_back(c);
+                if (cpus.size() != 0)
+                    r.push_back(make_pair(node, cpus));
+            }
+#endif
+        if (r.size() == 0)
+            r.push_back(make_pair(0, allowed));
+        return r;
+    }
+    /** Number of sockets (NUMA nodes with allowed CPUs). */
+    int get_n_sockets() const { return (int)numa_topology().size(); }
+    /** Get the socket that one operator worker thread is (or would be)
+     * pinned to.
+     * @param tid The thread index in the operator parallel region.
+     * @return The socket index (index into ``numa_topology()``).
+     */
+    int get_thread_socket(int tid) const {
+        const int nt = max(n_threads_op, 1);
+        return (int)((long long)min(tid, nt - 1) * get_n_sockets() / nt);
+    }
+    /** Get the socket that the calling thread is currently running on.
+     * @return The socket index, or -1 if it cannot be determined.
+     */
+    int get_current_socket() const {
+#ifdef _HAS_NUMA_AFFINITY
+        const int cpu = sched_getcpu();
+        const auto &topo = numa_topology();
+        for (int i = 0; i < (int)topo.size(); i++)
+            if (binary_search(topo[i].second.begin(), topo[i].second.end(),
+                              cpu))
+                return i;
+#endif
+        return -1;
+    }
+    /** Restrict the calling thread to a set of CPUs.
+     * @param cpus The CPU indices.
+     * @return true if successful.
+     */
+    static bool set_thread_affinity(const vector<int> &cpus) {
+#ifdef _HAS_NUMA_AFFINITY
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int c : cpus)
+            if (c < CPU_SETSIZE)
+                CPU_SET(c, &mask);
+        return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+        return false;
+#endif
+    }
+    /** Pin the threads for parallelism over renormalized operators to
+     * sockets, as described in ``numa_pinning``. */
+    void pin_operator_threads() const {
+#ifdef _OPENMP
+        if (omp_in_parallel())
+            return;
+#endif
+        const int nt = max(n_threads_op, 1);
+        const auto &topo = numa_topology();
+#pragma omp parallel num_threads(nt)
+        set_thread_affinity(topo[get_thread_socket(get_thread_id())].second);
+        pinned_threads = nt;
+    }
+    /** Allow the previously pinned threads to run on all CPUs again. */
+    void unpin_threads() const {
+        if (pinned_threads == 0)
+            return;
+#ifdef _OPENMP
+        if (omp_in_parallel())
+            return;
+#endif
+        vector<int> cpus;
+        for (const auto &node : numa_topology())
+            cpus.insert(cpus.end(), node.second.begin(), node.second.end());
+#pragma omp parallel num_threads(pinned_threads)
+        set_thread_affinity(cpus);
+        pinned_threads = 0;
+    }
     /** Whether openmp compiler option is set. */
     bool openmp_available() const {
 #ifdef _OPENMP
@@ -278,14 +654,10 @@ struct Threading {
      * @return Number of threads for general tasks.
      *   Returns 1 if openMP should not be used for a general task. */
     int activate_global() const {
-#ifdef _HAS_BLIS
-        bli_thread_set_num_threads(1);
-#endif
-#ifdef _HAS_INTEL_MKL
-        mkl_set_num_threads(1);
-#endif
+        set_blis_threads(1);
+        set_mkl_threads(1);
 #ifdef _OPENMP
-        omp_set_num_threads(n_threads_global != 0 ? n_threads_global : 1);
+        set_omp_threads(n_threads_global != 0 ? n_threads_global : 1);
         return n_threads_global != 0 ? n_threads_global : 1;
 #else
         return 1;
@@ -296,18 +668,15 @@ struct Threading {
      * @return Number of threads for general tasks.
      *   Returns 1 if MKL is not supported. */
     int activate_global_mkl() const {
-#ifdef _OPENMP
-        omp_set_num_threads(1);
-#endif
+        set_omp_threads(1);
 #ifdef _HAS_BLIS
-        bli_thread_set_num_threads(n_threads_global != 0 ? n_threads_global
-                                                         : 1);
+        set_blis_threads(n_threads_global != 0 ? n_threads_global : 1);
         return n_threads_global != 0 ? n_threads_global : 1;
 #else
         return 1;
 #endif
 #ifdef _HAS_INTEL_MKL
-        mkl_set_num_threads(n_threads_global != 0 ? n_threads_global : 1);
+        set_mkl_threads(n_threads_global != 0 ? n_threads_global : 1);
         return n_threads_global != 0 ? n_threads_global : 1;
 #else
         return 1;
@@ -322,14 +691,15 @@ struct Threading {
      * @return Number of threads for parallelism over renormalized operators.
      */
     int activate_operator() const {
-#ifdef _HAS_BLIS
-        bli_thread_set_num_threads(n_threads_mkl != 0 ? n_threads_mkl : 1);
-#endif
-#ifdef _HAS_INTEL_MKL
-        mkl_set_num_threads(n_threads_mkl != 0 ? n_threads_mkl : 1);
-#endif
+        // pinning only happens when the setting or n_threads_op changes
+        if (numa_pinning && pinned_threads != max(n_threads_op, 1))
+            pin_operator_threads();
+        else if (!numa_pinning && pinned_threads != 0)
+            unpin_threads();
+        set_blis_threads(n_threads_mkl != 0 ? n_threads_mkl : 1);
+        set_mkl_threads(n_threads_mkl != 0 ? n_threads_mkl : 1);
 #ifdef _OPENMP
-        omp_set_num_threads(n_threads_op != 0 ? n_threads_op : 1);
+        set_omp_threads(n_threads_op != 0 ? n_threads_op : 1);
         return n_threads_op != 0 ? n_threads_op : 1;
 #else
         return 1;
@@ -340,13 +710,13 @@ struct Threading {
      */
     int activate_quanta() const {
 #ifdef _HAS_BLIS
-        bli_thread_set_num_threads(n_threads_mkl != 0 ? n_threads_mkl : 1);
+        set_blis_threads(n_threads_mkl != 0 ? n_threads_mkl : 1);
         const int nt = max(n_threads_quanta, n_threads_op);
 #else
         const int nt = n_threads_quanta;
 #endif
 #ifdef _OPENMP
-        omp_set_num_threads(nt != 0 ? nt : 1);
+        set_omp_threads(nt != 0 ? nt : 1);
         return nt != 0 ? nt : 1;
 #else
         return 1;
@@ -369,6 +739,7 @@ struct Threading {
 #ifdef _HAS_INTEL_MKL
         n_threads_mkl = mkl_get_max_threads();
         mkl_set_num_threads(n_threads_mkl);
+        mkl_threads_cache() = n_threads_mkl;
         mkl_set_dynamic(0);
         n_levels++;
         type = type | ThreadingTypes::BatchedGEMM;
@@ -376,8 +747,10 @@ struct Threading {
         n_threads_mkl = 0;
 #endif
 #ifdef _HAS_BLIS
-        if (n_threads_mkl != 0)
+        if (n_threads_mkl != 0) {
             bli_thread_set_num_threads(n_threads_mkl);
+            blis_threads_cache() = n_threads_mkl;
+        }
 #endif
 #ifdef _OPENMP
 #ifndef _MSC_VER
@@ -468,9 +841,11 @@ struct Threading {
         if (type & ThreadingTypes::BatchedGEMM) {
 #ifdef _HAS_BLIS
             bli_thread_set_num_threads(n_threads_mkl);
+            blis_threads_cache() = n_threads_mkl;
 #endif
 #ifdef _HAS_INTEL_MKL
             mkl_set_num_threads(n_threads_mkl);
+            mkl_threads_cache() = n_threads_mkl;
             mkl_set_dynamic(0);
 #endif
         }
@@ -524,7 +899,12 @@ struct Threading {
            << " MKL = " << th.n_threads_mkl << endl;
         os << " COMPLEX = " << th.complex_available()
            << " SINGLE-PREC = " << th.single_precision_available()
-           << " KSYMM = " << th.ksymm_available();
+           << " KSYMM = " << th.ksymm_available() << endl;
+        os << " NUMA : Sockets = " << th.get_n_sockets()
+           << " Pinning = " << th.numa_pinning
+           << " WorkStealing = " << th.work_stealing
+           << " CacheActivation = " << th.cache_activation
+           << " SmallGEMM = " << th.small_gemm_size;
         return os;
     }
 };
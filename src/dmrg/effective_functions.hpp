@@ -43,7 +43,8 @@ struct EffectiveFunctions<
         FL omega, FL eta, const shared_ptr<SparseMatrix<S, FL>> &real_bra,
         pair<int, int> linear_solver_params, bool iprint = false,
         FP conv_thrd = 5E-6, int max_iter = 5000, int soft_max_iter = -1,
-        const shared_ptr<ParallelRule<S>> &para_rule = nullptr) {
+        const shared_ptr<ParallelRule<S>> &para_rule = nullptr,
+        const shared_ptr<KrylovRecycleSpace<FC>> &recycle = nullptr) {
         if (solver_type == LinearSolverTypes::Automatic)
             solver_type = LinearSolverTypes::GCROT;
         int nmult = 0, nmultx = 0, niter = 0;
@@ -114,7 +115,7 @@ struct EffectiveFunctions<
                 op, aa, cbra, cket, nmultx, niter, linear_solver_params.first,
                 linear_solver_params.second, 0.0, iprint,
                 para_rule == nullptr ? nullptr : para_rule->comm, conv_thrd,
-                max_iter, soft_max_iter);
+                max_iter, soft_max_iter, recycle, FC((FL)const_e + omega, eta));
         else if (solver_type == LinearSolverTypes::LSQR) {
             // Implementation uses conventional tolerance of ||r|| instead of
             // ||r||^2
@@ -140,10 +141,16 @@ struct EffectiveFunctions<
                 nmult += 2;
             };
             const FP precond_reg = 1E-8;
+            IterativeMatrixFunctions<FC>::recycle_initial_guess(
+                op, cbra, cket, 0.0, recycle, FC((FL)const_e + omega, eta),
+                para_rule == nullptr ? nullptr : para_rule->comm);
             gf = IterativeMatrixFunctions<FC>::lsqr(
                 op, rop, aa, cbra, cket, nmultx, niter, iprint,
                 para_rule == nullptr ? nullptr : para_rule->comm, precond_reg,
                 tol, tol, max_iter, soft_max_iter);
+            IterativeMatrixFunctions<FC>::recycle_add_solution(
+                op, cbra, 0.0, recycle, FC((FL)const_e + omega, eta),
+                para_rule == nullptr ? nullptr : para_rule->comm);
             niter++;
         } else if (solver_type == LinearSolverTypes::IDRS) {
             // Use linear_solver_params.first as "S" value in IDR(S)
@@ -153,12 +160,19 @@ struct EffectiveFunctions<
             const FP idrs_atol = 0.0;
             const FP precond_reg = 1E-8;
             assert(linear_solver_params.first > 0);
+            IterativeMatrixFunctions<FC>::recycle_initial_guess(
+                op, cbra, cket, 0.0, recycle, FC((FL)const_e + omega, eta),
+                para_rule == nullptr ? nullptr : para_rule->comm);
             gf = IterativeMatrixFunctions<FC>::idrs(
                 op, aa, cbra, cket, nmultx, niter, linear_solver_params.first,
                 iprint, para_rule == nullptr ? nullptr : para_rule->comm,
                 precond_reg, idrs_tol, idrs_atol, max_iter, soft_max_iter);
+            IterativeMatrixFunctions<FC>::recycle_add_solution(
+                op, cbra, 0.0, recycle, FC((FL)const_e + omega, eta),
+                para_rule == nullptr ? nullptr : para_rule->comm);
             niter++;
         } else if (solver_type == LinearSolverTypes::Cheby) {
+            // recycle is not used by the Chebyshev expansion
             // Here I only use f and not op, so wrap it for nmult
             const auto Hvec = [f, &nmult](const GMatrix<FL> &a,
                                           const GMatrix<FL> &b) {
@@ -296,7 +310,8 @@ struct EffectiveFunctions<
         int n_harmonic_projection = 0, bool iprint = false, FP conv_thrd = 5E-6,
         int max_iter = 5000, int soft_max_iter = -1, int deflation_min_size = 2,
         int deflation_max_size = 50,
-        const shared_ptr<ParallelRule<S>> &para_rule = nullptr) {
+        const shared_ptr<ParallelRule<S>> &para_rule = nullptr,
+        const shared_ptr<KrylovRecycleSpace<FL>> &recycle = nullptr) {
         int nmult = 0, nmultx = 0;
         frame_<FP>()->activate(0);
         Timer t;
@@ -344,21 +359,40 @@ struct EffectiveFunctions<
         // solve imag part -> ibra
         FL igf = 0;
         int nmultp = 0;
-        if (n_harmonic_projection == 0)
+        if (n_harmonic_projection == 0) {
+            // op is not a scalar shift of a fixed operator for different
+            // frequencies, so cs is always rebuilt
+            if (recycle != nullptr)
+                recycle->cs.clear();
+            IterativeMatrixFunctions<FL>::recycle_initial_guess(
+                op, ibra, ktmp, 0.0, recycle, 0.0,
+                para_rule == nullptr ? nullptr : para_rule->comm);
             igf = IterativeMatrixFunctions<FL>::conjugate_gradient(
                       op, aa, ibra, ktmp, nmultx, 0.0, iprint,
                       para_rule == nullptr ? nullptr : para_rule->comm,
                       conv_thrd, max_iter, soft_max_iter) /
                   (-eta);
-        else if (n_harmonic_projection < 0)
+            IterativeMatrixFunctions<FL>::recycle_add_solution(
+                op, ibra, 0.0, recycle, 0.0,
+                para_rule == nullptr ? nullptr : para_rule->comm);
+        } else if (n_harmonic_projection < 0)
             assert(false);
         else {
             vector<GMatrix<FL>> bs = vector<GMatrix<FL>>(
                 n_harmonic_projection,
                 GMatrix<FL>(nullptr, (MKL_INT)h_eff->ket->total_memory, 1));
+            // eigenvectors from the previous frequency are good guesses
+            const bool restart = recycle != nullptr &&
+                                 recycle->matches(ibra.size()) &&
+                                 recycle->nk == n_harmonic_projection;
             for (int ih = 0; ih < n_harmonic_projection; ih++) {
                 bs[ih].allocate();
-                if (ih == 0)
+                if (restart)
+                    GMatrixFunctions<FL>::copy(
+                        bs[ih], GMatrix<FL>(recycle->us.data() +
+                                                ibra.size() * ih,
+                                            ibra.m, ibra.n));
+                else if (ih == 0)
                     GMatrixFunctions<FL>::copy(bs[ih], ibra);
                 else
                     Random::fill(bs[ih].data, bs[ih].size());
@@ -370,6 +404,15 @@ struct EffectiveFunctions<
                 para_rule == nullptr ? nullptr : para_rule->comm, 1E-4, 0.0,
                 max_iter, soft_max_iter, deflation_min_size,
                 deflation_max_size);
+            if (recycle != nullptr) {
+                recycle->n = ibra.size(), recycle->nk = n_harmonic_projection;
+                recycle->us.resize(ibra.size() * n_harmonic_projection);
+                for (int ih = 0; ih < n_harmonic_projection; ih++)
+                    GMatrixFunctions<FL>::copy(
+                        GMatrix<FL>(recycle->us.data() + ibra.size() * ih,
+                                    ibra.m, ibra.n),
+                        bs[ih]);
+            }
             nmultp = nmult;
             nmult = 0;
             igf = IterativeMatrixFunctions<FL>::deflated_conjugate_gradient(
@@ -580,7 +623,8 @@ struct EffectiveFunctions<S, FL,
         FL omega, FL eta, const shared_ptr<SparseMatrix<S, FL>> &real_bra,
         pair<int, int> linear_solver_params, bool iprint = false,
         FP conv_thrd = 5E-6, int max_iter = 5000, int soft_max_iter = -1,
-        const shared_ptr<ParallelRule<S>> &para_rule = nullptr) {
+        const shared_ptr<ParallelRule<S>> &para_rule = nullptr,
+        const shared_ptr<KrylovRecycleSpace<FC>> &recycle = nullptr) {
         assert(real_bra == nullptr);
         if (solver_type == LinearSolverTypes::Automatic)
             solver_type = LinearSolverTypes::GCROT;
@@ -620,7 +664,7 @@ struct EffectiveFunctions<S, FL,
                 op, aa, mbra, mket, nmultx, niter, linear_solver_params.first,
                 linear_solver_params.second, 0.0, iprint,
                 para_rule == nullptr ? nullptr : para_rule->comm, conv_thrd,
-                max_iter, soft_max_iter);
+                max_iter, soft_max_iter, recycle, const_x);
         else if (solver_type == LinearSolverTypes::LSQR) {
             FC const_y = xconj<FL>(const_x);
             // Implementation uses conventional tolerance of ||r|| instead of
@@ -639,10 +683,16 @@ struct EffectiveFunctions<S, FL,
                 nmult += 1;
             };
             const FP precond_reg = 1E-8;
+            IterativeMatrixFunctions<FC>::recycle_initial_guess(
+                op, mbra, mket, 0.0, recycle, const_x,
+                para_rule == nullptr ? nullptr : para_rule->comm);
             gf = IterativeMatrixFunctions<FC>::lsqr(
                 op, rop, aa, mbra, mket, nmultx, niter, iprint,
                 para_rule == nullptr ? nullptr : para_rule->comm, precond_reg,
                 tol, tol, max_iter, soft_max_iter);
+            IterativeMatrixFunctions<FC>::recycle_add_solution(
+                op, mbra, 0.0, recycle, const_x,
+                para_rule == nullptr ? nullptr : para_rule->comm);
             niter++;
         } else if (solver_type == LinearSolverTypes::IDRS) {
             // Use linear_solver_params.first as "S" value in IDR(S)
@@ -652,10 +702,16 @@ struct EffectiveFunctions<S, FL,
             const FP idrs_atol = 0.0;
             const FP precond_reg = 1E-8;
             assert(linear_solver_params.first > 0);
+            IterativeMatrixFunctions<FC>::recycle_initial_guess(
+                op, mbra, mket, 0.0, recycle, const_x,
+                para_rule == nullptr ? nullptr : para_rule->comm);
             gf = IterativeMatrixFunctions<FC>::idrs(
                 op, aa, mbra, mket, nmultx, niter, linear_solver_params.first,
                 iprint, para_rule == nullptr ? nullptr : para_rule->comm,
                 precond_reg, idrs_tol, idrs_atol, max_iter, soft_max_iter);
+            IterativeMatrixFunctions<FC>::recycle_add_solution(
+                op, mbra, 0.0, recycle, const_x,
+                para_rule == nullptr ? nullptr : para_rule->comm);
             niter++;
         } else
             throw runtime_error("Invalid solver type of Green's function.");
@@ -90,6 +90,110 @@ template <typename FL> struct EffectiveKernel {
     }
 };
 
+// [c] = [H_eff] x [b] with operators translated (once) to the lower
+// precision FLL, for mixed precision Davidson
+// the vectors are kept in FL and translated in each multiplication
+template <typename S, typename FL> struct LowPrecisionMultiply {
+    typedef typename alt_fl_type<FL>::FL FLL;
+    typedef typename GMatrix<FL>::FP FP;
+    typedef typename GMatrix<FLL>::FP FPL;
+    shared_ptr<DelayedOperatorTensor<S, FLL>> op;
+    shared_ptr<TensorFunctions<S, FLL>> tf;
+    shared_ptr<SparseMatrix<S, FLL>> cmat, vmat;
+    FLL *cdata, *vdata;
+    S opdq;
+    LowPrecisionMultiply(const shared_ptr<DelayedOperatorTensor<S, FLL>> &op,
+                         const shared_ptr<CG<S>> &cg,
+                         const shared_ptr<SparseMatrix<S, FL>> &bra,
+                         const shared_ptr<SparseMatrix<S, FL>> &ket, S opdq)
+        : op(op), opdq(opdq) {
+        tf = make_shared<TensorFunctions<S, FLL>>(
+            make_shared<OperatorFunctions<S, FLL>>(cg));
+        shared_ptr<VectorAllocator<FPL>> d_alloc =
+            make_shared<VectorAllocator<FPL>>();
+        cmat = make_shared<SparseMatrix<S, FLL>>(d_alloc);
+        vmat = make_shared<SparseMatrix<S, FLL>>(d_alloc);
+        cmat->allocate(ket->info);
+        vmat->allocate(bra->info);
+        cdata = cmat->data, vdata = vmat->data;
+    }
+    // returns nullptr if H_eff cannot be translated
+    static shared_ptr<LowPrecisionMultiply>
+    create(const shared_ptr<DelayedOperatorTensor<S, FL>> &op,
+           const shared_ptr<TensorFunctions<S, FL>> &tf,
+           const shared_ptr<SparseMatrix<S, FL>> &bra,
+           const shared_ptr<SparseMatrix<S, FL>> &ket, S opdq) {
+        if (sizeof(FLL) >= sizeof(FL) ||
+            tf->get_type() != TensorFunctionsTypes::Normal ||
+            tf->opf->get_type() != SparseMatrixTypes::Normal)
+            return nullptr;
+        shared_ptr<DelayedOperatorTensor<S, FLL>> xop =
+            TransOperatorTensor<S, FL, FLL>::forward(op);
+        if (xop == nullptr)
+            return nullptr;
+        return make_shared<LowPrecisionMultiply>(xop, tf->opf->cg, bra, ket,
+                                                 opdq);
+    }
+    template <typename FL1, typename FL2>
+    static void translate(const FL1 *a, FL2 *b, size_t n) {
+        int ntg = threading->activate_global();
+#pragma omp parallel for schedule(static) num_threads(ntg)
+        for (size_t i = 0; i < n; i++)
+            b[i] = (FL2)a[i];
+        threading->activate_normal();
+    }
+    // squared residual norm below which the Davidson iteration cannot
+    // make progress, estimated from the machine epsilon of FLL and
+    // the largest diagonal element of H_eff
+    FP noise_conv_thrd(const GDiagonalMatrix<FL> &aa) const {
+        FP hmax = 0;
+        for (MKL_INT i = 0; i < aa.n; i++)
+            hmax = max(hmax, (FP)abs(aa.data[i]));
+        const FP eps = (FP)10.0 * (FP)numeric_limits<FPL>::epsilon() * hmax;
+        return eps * eps;
+    }
+    void precompute(SeqTypes mode) const {
+        tf->opf->seq->mode = mode;
+        if (mode == SeqTypes::Auto || (mode & SeqTypes::Tasked)) {
+            cmat->data = vmat->data = (FLL *)0;
+            cmat->factor = 1.0;
+            tf->tensor_product_multiply(op->mat->data[0], nullptr, op->lopt,
+                                        op->ropt, cmat, vmat, opdq, false);
+            if (mode == SeqTypes::Auto) {
+                tf->opf->seq->prepare();
+                tf->opf->seq->allocate();
+            }
+            cmat->data = cdata, vmat->data = vdata;
+        }
+    }
+    void post_precompute() const {
+        if (tf->opf->seq->mode == SeqTypes::Auto ||
+            (tf->opf->seq->mode & SeqTypes::Tasked)) {
+            tf->opf->seq->deallocate();
+            tf->opf->seq->clear();
+        }
+    }
+    // [c] += scale * [H_eff] x [b]
+    void operator()(const GMatrix<FL> &b, const GMatrix<FL> &c, FL scale) {
+        assert((size_t)b.size() == cmat->total_memory);
+        assert((size_t)c.size() == vmat->total_memory);
+        translate(b.data, cdata, cmat->total_memory);
+        translate(c.data, vdata, vmat->total_memory);
+        if (tf->opf->seq->mode == SeqTypes::Auto ||
+            (tf->opf->seq->mode & SeqTypes::Tasked))
+            tf->operator()(
+                GMatrix<FLL>(cdata, (MKL_INT)cmat->total_memory, 1),
+                GMatrix<FLL>(vdata, (MKL_INT)vmat->total_memory, 1),
+                (FLL)scale);
+        else {
+            cmat->factor = (FLL)scale;
+            tf->tensor_product_multiply(op->mat->data[0], nullptr, op->lopt,
+                                        op->ropt, cmat, vmat, opdq, true);
+        }
+        translate(vdata, c.data, vmat->total_memory);
+    }
+};
+
 template <typename S, typename FL, typename = MPS<S, FL>>
 struct EffectiveHamiltonian;
 
@@ -117,10 +221,20 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
     vector<shared_ptr<typename SparseMatrixInfo<S>::ConnectionInfo>> wfn_infos;
     vector<S> operator_quanta;
     shared_ptr<NPDMScheme> npdm_scheme = nullptr;
+    // if not nullptr, ConnectionInfo tables are reused from this cache
+    shared_ptr<ConnectionInfoCache<S>> cinfo_cache = nullptr;
     string npdm_fragment_filename = "";
     int npdm_n_sites = 0, npdm_center = -1, npdm_parallel_center = -1;
     shared_ptr<EffectiveKernel<FL>> eff_kernel = nullptr;
     string seq_filename = "";
+    // if not empty, batched DGEMM in one multiplication is captured
+    // in eigs and written into this file (see BatchGEMMTrace)
+    string trace_filename = "";
+    // if true, eigs first multiplies [H_eff] in single precision
+    // (see LowPrecisionMultiply), and switches to FL when the residual
+    // stalls for mixed_stall_iter iterations or reaches the noise level
+    bool mixed_precision = false;
+    int mixed_stall_iter = 5;
     EffectiveHamiltonian(
         const vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> &left_op_infos,
         const vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> &right_op_infos,
@@ -130,11 +244,12 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
         const shared_ptr<OpElement<S, FL>> &hop,
         const shared_ptr<SymbolicColumnVector<S>> &hop_mat, S hop_left_vacuum,
         const shared_ptr<TensorFunctions<S, FL>> &ptf, bool compute_diag = true,
-        const shared_ptr<NPDMScheme> &npdm_scheme = nullptr)
+        const shared_ptr<NPDMScheme> &npdm_scheme = nullptr,
+        const shared_ptr<ConnectionInfoCache<S>> &cinfo_cache = nullptr)
         : left_op_infos(left_op_infos), right_op_infos(right_op_infos), op(op),
           bra(bra), ket(ket), tf(ptf->copy()), hop_mat(hop_mat),
           hop_left_vacuum(hop_left_vacuum), compute_diag(compute_diag),
-          npdm_scheme(npdm_scheme) {
+          npdm_scheme(npdm_scheme), cinfo_cache(cinfo_cache) {
         // wavefunction
         if (compute_diag) {
             // for non-hermitian hamiltonian, bra and ket may share the same
@@ -189,8 +304,14 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
         if (compute_diag) {
             shared_ptr<typename SparseMatrixInfo<S>::ConnectionInfo> diag_info =
                 make_shared<typename SparseMatrixInfo<S>::ConnectionInfo>();
-            diag_info->initialize_diag(cdq, opdq, msubsl[0], left_op_infos,
-                                       right_op_infos, diag->info, tf->opf->cg);
+            if (cinfo_cache != nullptr)
+                cinfo_cache->initialize_diag(*diag_info, cdq, opdq, msubsl[0],
+                                             left_op_infos, right_op_infos,
+                                             diag->info, tf->opf->cg);
+            else
+                diag_info->initialize_diag(cdq, opdq, msubsl[0], left_op_infos,
+                                           right_op_infos, diag->info,
+                                           tf->opf->cg);
             diag->info->cinfo = diag_info;
             tf->tensor_product_diagonal(
                 op->mat->data[0],
@@ -209,9 +330,15 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
             if (msl[i].combine(vdq, cdq) != S(S::invalid)) {
                 wfn_infos[i] =
                     make_shared<typename SparseMatrixInfo<S>::ConnectionInfo>();
-                wfn_infos[i]->initialize_wfn(cdq, vdq, msl[i], msubsl[i],
-                                             left_op_infos, right_op_infos,
-                                             ket->info, bra->info, tf->opf->cg);
+                if (cinfo_cache != nullptr)
+                    cinfo_cache->initialize_wfn(
+                        *wfn_infos[i], cdq, vdq, msl[i], msubsl[i],
+                        left_op_infos, right_op_infos, ket->info, bra->info,
+                        tf->opf->cg);
+                else
+                    wfn_infos[i]->initialize_wfn(
+                        cdq, vdq, msl[i], msubsl[i], left_op_infos,
+                        right_op_infos, ket->info, bra->info, tf->opf->cg);
             }
         cmat->info->cinfo = nullptr;
         for (int i = 0; i < (int)msl.size(); i++)
@@ -249,6 +376,81 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
             tf->opf->seq->clear();
         }
     }
+    // capture batched DGEMM in one multiplication [H_eff] x [ket]
+    // precompute must be invoked before this
+    shared_ptr<BatchGEMMTrace> capture_trace() {
+        const shared_ptr<BatchGEMMSeq<FL>> &seq = tf->opf->seq;
+        shared_ptr<BatchGEMMTrace> trace = make_shared<BatchGEMMTrace>();
+        trace->fl_size = (int)sizeof(FL);
+        trace->is_cpx = is_complex<FL>::value;
+        trace->mode = seq->mode;
+        shared_ptr<VectorAllocator<FP>> d_alloc =
+            make_shared<VectorAllocator<FP>>();
+        GMatrix<FL> b(ket->data, (MKL_INT)ket->total_memory, 1);
+        GMatrix<FL> c(nullptr, (MKL_INT)bra->total_memory, 1);
+        c.allocate(d_alloc);
+        c.clear();
+        const size_t nflop = seq->cumulative_nflop;
+        const shared_ptr<BatchGEMMTrace> orig_trace = seq->trace;
+        seq->trace = trace;
+        if (seq->mode == SeqTypes::Auto || (seq->mode & SeqTypes::Tasked))
+            tf->operator()(b, c, (FL)1.0);
+        else
+            (*this)(b, c, 0, (FL)1.0);
+        seq->trace = orig_trace;
+        seq->cumulative_nflop = nflop;
+        c.deallocate(d_alloc);
+        return trace;
+    }
+    // select SeqTypes for multiplication using measurements of trial
+    // multiplications, cached in seq->tuner for each bucket of sizes
+    // returns the previous SeqTypes
+    SeqTypes
+    autotune_mode(const shared_ptr<ParallelRule<S>> &para_rule = nullptr) {
+        const shared_ptr<BatchGEMMSeq<FL>> &seq = tf->opf->seq;
+        const SeqTypes orig_mode = seq->mode;
+        if (seq->tuner == nullptr || seq->tuner->modes.size() == 0)
+            return orig_mode;
+        const shared_ptr<BatchGEMMAutoTuner> &tuner = seq->tuner;
+        const int key = BatchGEMMAutoTuner::bucket(ket->total_memory);
+        if (!tuner->has_mode(key)) {
+            shared_ptr<VectorAllocator<FP>> d_alloc =
+                make_shared<VectorAllocator<FP>>();
+            GMatrix<FL> b(ket->data, (MKL_INT)ket->total_memory, 1);
+            GMatrix<FL> c(nullptr, (MKL_INT)bra->total_memory, 1);
+            c.allocate(d_alloc);
+            vector<double> times;
+            const size_t nflop = seq->cumulative_nflop;
+            for (SeqTypes mode : tuner->modes) {
+                seq->mode = mode;
+                Timer t;
+                t.get_time();
+                precompute();
+                const double tpre = t.get_time();
+                for (int i = 0; i < tuner->n_trials; i++) {
+                    c.clear();
+                    if (seq->mode == SeqTypes::Auto ||
+                        (seq->mode & SeqTypes::Tasked))
+                        tf->operator()(b, c, (FL)1.0);
+                    else
+                        (*this)(b, c, 0, (FL)1.0);
+                }
+                const double tmult = t.get_time();
+                post_precompute();
+                times.push_back(tpre / max(tuner->n_expected, 1) +
+                                tmult / max(tuner->n_trials, 1));
+            }
+            seq->cumulative_nflop = nflop;
+            c.deallocate(d_alloc);
+            // all procs must use the same mode
+            if (para_rule != nullptr)
+                para_rule->comm->broadcast(times.data(), times.size(),
+                                           para_rule->comm->root);
+            tuner->set_mode_times(key, times);
+        }
+        seq->mode = tuner->get_mode(key);
+        return orig_mode;
+    }
     shared_ptr<SparseMatrixGroup<S, FL>>
     perturbative_noise(bool trace_right, int iL, int iR, FuseTypes ftype,
                        const shared_ptr<MPSInfo<S>> &mps_info,
@@ -500,11 +702,20 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
         Timer t;
         t.get_time();
         tf->opf->seq->cumulative_nflop = 0;
+        const SeqTypes orig_mode =
+            metric == nullptr ? autotune_mode(para_rule) : tf->opf->seq->mode;
         precompute();
+        if (trace_filename != "")
+            capture_trace()->save_data(trace_filename);
+        // [H_eff] x [b] in single precision (only in mixed precision mode)
+        function<void(const GMatrix<FL> &, const GMatrix<FL> &, FL)> lf =
+            nullptr;
         const function<void(const GMatrix<FL> &, const GMatrix<FL> &, FL)> &f =
-            [this](const GMatrix<FL> &a, const GMatrix<FL> &b, FL scale) {
-                if (this->tf->opf->seq->mode == SeqTypes::Auto ||
-                    (this->tf->opf->seq->mode & SeqTypes::Tasked))
+            [this, &lf](const GMatrix<FL> &a, const GMatrix<FL> &b, FL scale) {
+                if (lf != nullptr)
+                    return lf(a, b, scale);
+                else if (this->tf->opf->seq->mode == SeqTypes::Auto ||
+                         (this->tf->opf->seq->mode & SeqTypes::Tasked))
                     return this->tf->operator()(a, b, scale);
                 else
                     return (*this)(a, b, 0, scale);
@@ -520,8 +731,71 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
                     GMatrixFunctions<FL>::elementwise("*", (FL)1.0, cmask,
                                                       (FL)1.0, b, b, (FL)0.0);
             };
+        // [c[i]] = [H_eff] x [b[i]] for several vectors
+        // operator blocks are shared by all vectors in Tasked mode
+        const function<void(const vector<GMatrix<FL>> &,
+                            const vector<GMatrix<FL>> &)> &bg =
+            [this, &g, &cmask](const vector<GMatrix<FL>> &a,
+                               const vector<GMatrix<FL>> &b) {
+                if (this->eff_kernel != nullptr ||
+                    !(this->tf->opf->seq->mode & SeqTypes::Tasked)) {
+                    for (size_t i = 0; i < a.size(); i++)
+                        g(a[i], b[i]);
+                    return;
+                }
+                this->tf->operator()(a, b, (FL)1.0);
+                if (cmask.data != nullptr)
+                    for (size_t i = 0; i < b.size(); i++)
+                        GMatrixFunctions<FL>::elementwise("*", (FL)1.0, cmask,
+                                                          (FL)1.0, b[i], b[i],
+                                                          (FL)0.0);
+            };
         vector<FP> eners;
-        if (metric == nullptr)
+        int low_ndav = 0;
+        if (mixed_precision && metric == nullptr && para_rule == nullptr &&
+            !(davidson_type & DavidsonTypes::Harmonic) &&
+            !(davidson_type & DavidsonTypes::NonHermitian) &&
+            !(davidson_type & DavidsonTypes::Exact) &&
+            !(davidson_type & DavidsonTypes::Lanczos) &&
+            !(davidson_type & DavidsonTypes::LOBPCG)) {
+#ifdef _USE_SINGLE_PREC
+            shared_ptr<LowPrecisionMultiply<S, FL>> lpm =
+                LowPrecisionMultiply<S, FL>::create(op, tf, bra, ket, opdq);
+            if (lpm != nullptr) {
+                // single precision iterations, until the residual stalls
+                // the result is the initial guess for the iterations in FL
+                lpm->precompute(tf->opf->seq->mode);
+                lf = [&lpm](const GMatrix<FL> &a, const GMatrix<FL> &b,
+                            FL scale) { (*lpm)(a, b, scale); };
+                IterativeMatrixFunctions<FL>::davidson(
+                    g, aa, bs, shift, davidson_type, low_ndav, iprint,
+                    para_rule == nullptr ? nullptr : para_rule->comm,
+                    max(conv_thrd, lpm->noise_conv_thrd(aa)), rel_conv_thrd,
+                    max_iter - 1,
+                    soft_max_iter == -1 ? max_iter - 1 : soft_max_iter,
+                    deflation_min_size, deflation_max_size, ors,
+                    projection_weights, (FP)1E-3, mixed_stall_iter);
+                lf = nullptr;
+                lpm->post_precompute();
+                tf->opf->seq->cumulative_nflop +=
+                    lpm->tf->opf->seq->cumulative_nflop;
+                if (soft_max_iter != -1)
+                    soft_max_iter = max(soft_max_iter - low_ndav, 1);
+                max_iter = max(max_iter - low_ndav, 1);
+            }
+#else
+            throw runtime_error("EffectiveHamiltonian::eigs: mixed precision "
+                                "requires USE_SINGLE_PREC.");
+#endif
+        }
+        if (metric == nullptr && (davidson_type & DavidsonTypes::Block) &&
+            !(davidson_type & DavidsonTypes::Harmonic))
+            eners = IterativeMatrixFunctions<FL>::block_davidson(
+                bg, aa, bs, shift, davidson_type, ndav, iprint,
+                para_rule == nullptr ? nullptr : para_rule->comm, conv_thrd,
+                rel_conv_thrd, max_iter, soft_max_iter, deflation_min_size,
+                deflation_max_size, ors, projection_weights);
+        else if (metric == nullptr)
             eners = IterativeMatrixFunctions<FL>::harmonic_davidson(
                 g, aa, bs, shift, davidson_type, ndav, iprint,
                 para_rule == nullptr ? nullptr : para_rule->comm, conv_thrd,
@@ -547,7 +821,9 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
                 deflation_max_size, ors, projection_weights);
             metric->post_precompute();
         }
+        ndav += low_ndav;
         post_precompute();
+        tf->opf->seq->mode = orig_mode;
         uint64_t nflop = tf->opf->seq->cumulative_nflop;
         if (para_rule != nullptr)
             para_rule->comm->reduce_sum_optional(&nflop, 1,
@@ -558,6 +834,8 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
     }
     // [bra] = [H_eff]^(-1) x [ket]
     // energy, nmult, nflop, tmult
+    // recycle: subspace for GCROT, or latest solutions for CG and MINRES
+    // (ignored when ortho_bra is not empty)
     tuple<FL, pair<int, int>, size_t, double>
     inverse_multiply(typename const_fl_type<FL>::FL const_e,
                      LinearSolverTypes solver_type,
@@ -566,7 +844,9 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
                      int max_iter = 5000, int soft_max_iter = -1,
                      const shared_ptr<ParallelRule<S>> &para_rule = nullptr,
                      const vector<shared_ptr<SparseMatrix<S, FL>>> &ortho_bra =
-                         vector<shared_ptr<SparseMatrix<S, FL>>>()) {
+                         vector<shared_ptr<SparseMatrix<S, FL>>>(),
+                     const shared_ptr<KrylovRecycleSpace<FL>> &recycle =
+                         nullptr) {
         if (solver_type == LinearSolverTypes::Automatic)
             solver_type = LinearSolverTypes::MinRes;
         int nmult = 0, niter = 0;
@@ -605,6 +885,13 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
                     this->eff_kernel->compute((FL)1.0, f, a, b,
                                               vector<GMatrix<FL>>());
             };
+        const shared_ptr<KrylovRecycleSpace<FL>> xrecycle =
+            ortho_bra.size() == 0 ? recycle : nullptr;
+        int nrmult = 0;
+        if (solver_type != LinearSolverTypes::GCROT)
+            nrmult += IterativeMatrixFunctions<FL>::recycle_initial_guess(
+                g, mbra, mket, (FL)const_e, xrecycle, 0.0,
+                para_rule == nullptr ? nullptr : para_rule->comm);
         FL r =
             solver_type == LinearSolverTypes::CG
                 ? IterativeMatrixFunctions<FL>::conjugate_gradient(
@@ -622,7 +909,12 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
                              linear_solver_params.first,
                              linear_solver_params.second, (FL)const_e, iprint,
                              para_rule == nullptr ? nullptr : para_rule->comm,
-                             conv_thrd, max_iter, soft_max_iter));
+                             conv_thrd, max_iter, soft_max_iter, xrecycle));
+        if (solver_type != LinearSolverTypes::GCROT)
+            nrmult += IterativeMatrixFunctions<FL>::recycle_add_solution(
+                g, mbra, (FL)const_e, xrecycle, 0.0,
+                para_rule == nullptr ? nullptr : para_rule->comm);
+        nmult += nrmult;
         if (compute_diag && solver_type != LinearSolverTypes::MinRes)
             aa.deallocate();
         post_precompute();
@@ -1115,6 +1407,12 @@ struct EffectiveHamiltonian<S, FL, MPS<S, FL>> {
                 t.second->cinfo->deallocate();
             t.second->deallocate();
         }
+        // temporaries cached during the solve are not kept between sites
+        const int ntr =
+            max(threading->n_threads_op, threading->n_threads_global);
+        ArenaAllocator<FP>::release_all_thread_caches(ntr);
+        if (!is_same<FL, FP>::value)
+            ArenaAllocator<FL>::release_all_thread_caches(ntr);
     }
 };
 
@@ -1281,6 +1579,8 @@ struct EffectiveHamiltonian<S, FL, MultiMPS<S, FL>> {
         wfn_infos;
     vector<S> operator_quanta;
     shared_ptr<NPDMScheme> npdm_scheme = nullptr;
+    // if not nullptr, ConnectionInfo tables are reused from this cache
+    shared_ptr<ConnectionInfoCache<S>> cinfo_cache = nullptr;
     string npdm_fragment_filename = "";
     int npdm_n_sites = 0, npdm_center = -1, npdm_parallel_center = -1;
     string seq_filename = "";
@@ -1293,11 +1593,12 @@ struct EffectiveHamiltonian<S, FL, MultiMPS<S, FL>> {
         const shared_ptr<OpElement<S, FL>> &hop,
         const shared_ptr<SymbolicColumnVector<S>> &hop_mat, S hop_left_vacuum,
         const shared_ptr<TensorFunctions<S, FL>> &ptf, bool compute_diag = true,
-        const shared_ptr<NPDMScheme> &npdm_scheme = nullptr)
+        const shared_ptr<NPDMScheme> &npdm_scheme = nullptr,
+        const shared_ptr<ConnectionInfoCache<S>> &cinfo_cache = nullptr)
         : left_op_infos(left_op_infos), right_op_infos(right_op_infos), op(op),
           bra(bra), ket(ket), tf(ptf->copy()), hop_mat(hop_mat),
           hop_left_vacuum(hop_left_vacuum), compute_diag(compute_diag),
-          npdm_scheme(npdm_scheme) {
+          npdm_scheme(npdm_scheme), cinfo_cache(cinfo_cache) {
         // wavefunction
         if (compute_diag) {
             // for non-hermitian hamiltonian, bra and ket may share the same
@@ -1357,9 +1658,16 @@ struct EffectiveHamiltonian<S, FL, MultiMPS<S, FL>> {
                 shared_ptr<typename SparseMatrixInfo<S>::ConnectionInfo>
                     diag_info = make_shared<
                         typename SparseMatrixInfo<S>::ConnectionInfo>();
-                diag_info->initialize_diag(
-                    ket[0]->infos[i]->delta_quantum, opdq, msubsl[0],
-                    left_op_infos, right_op_infos, diag->infos[i], tf->opf->cg);
+                if (cinfo_cache != nullptr)
+                    cinfo_cache->initialize_diag(
+                        *diag_info, ket[0]->infos[i]->delta_quantum, opdq,
+                        msubsl[0], left_op_infos, right_op_infos,
+                        diag->infos[i], tf->opf->cg);
+                else
+                    diag_info->initialize_diag(
+                        ket[0]->infos[i]->delta_quantum, opdq, msubsl[0],
+                        left_op_infos, right_op_infos, diag->infos[i],
+                        tf->opf->cg);
                 diag->infos[i]->cinfo = diag_info;
                 shared_ptr<SparseMatrix<S, FL>> xdiag = (*diag)[i];
                 tf->tensor_product_diagonal(op->mat->data[0],
@@ -1388,10 +1696,16 @@ struct EffectiveHamiltonian<S, FL, MultiMPS<S, FL>> {
                     shared_ptr<typename SparseMatrixInfo<S>::ConnectionInfo>
                         wfn_info = make_shared<
                             typename SparseMatrixInfo<S>::ConnectionInfo>();
-                    wfn_info->initialize_wfn(cdq, vdq, msl[i], msubsl[i],
-                                             left_op_infos, right_op_infos,
-                                             cmat->infos[ic], vmat->infos[iv],
-                                             tf->opf->cg);
+                    if (cinfo_cache != nullptr)
+                        cinfo_cache->initialize_wfn(
+                            *wfn_info, cdq, vdq, msl[i], msubsl[i],
+                            left_op_infos, right_op_infos, cmat->infos[ic],
+                            vmat->infos[iv], tf->opf->cg);
+                    else
+                        wfn_info->initialize_wfn(
+                            cdq, vdq, msl[i], msubsl[i], left_op_infos,
+                            right_op_infos, cmat->infos[ic], vmat->infos[iv],
+                            tf->opf->cg);
                     wfn_infos[i][cvdq] = wfn_info;
                 }
         for (int i = 0; i < cmat->n; i++) {
@@ -1713,8 +2027,33 @@ struct EffectiveHamiltonian<S, FL, MultiMPS<S, FL>> {
                     GMatrixFunctions<FL>::elementwise("*", (FL)1.0, cmask,
                                                       (FL)1.0, b, b, (FL)0.0);
             };
+        // [c[i]] = [H_eff] x [b[i]] for several vectors
+        // operator blocks are shared by all vectors in Tasked mode
+        const function<void(const vector<GMatrix<FL>> &,
+                            const vector<GMatrix<FL>> &)> &bf =
+            [this, &f, &cmask](const vector<GMatrix<FL>> &a,
+                               const vector<GMatrix<FL>> &b) {
+                if (!(this->tf->opf->seq->mode & SeqTypes::Tasked)) {
+                    for (size_t i = 0; i < a.size(); i++)
+                        f(a[i], b[i]);
+                    return;
+                }
+                this->tf->operator()(a, b, (FL)1.0);
+                if (cmask.data != nullptr)
+                    for (size_t i = 0; i < b.size(); i++)
+                        GMatrixFunctions<FL>::elementwise("*", (FL)1.0, cmask,
+                                                          (FL)1.0, b[i], b[i],
+                                                          (FL)0.0);
+            };
         vector<FP> xeners;
-        if (metric == nullptr)
+        if (metric == nullptr && (davidson_type & DavidsonTypes::Block) &&
+            !(davidson_type & DavidsonTypes::Harmonic))
+            xeners = IterativeMatrixFunctions<FL>::block_davidson(
+                bf, aa, bs, shift, davidson_type, ndav, iprint,
+                para_rule == nullptr ? nullptr : para_rule->comm, conv_thrd,
+                rel_conv_thrd, max_iter, soft_max_iter, deflation_min_size,
+                deflation_max_size, ors, projection_weights);
+        else if (metric == nullptr)
             xeners = IterativeMatrixFunctions<FL>::harmonic_davidson(
                 f, aa, bs, shift, davidson_type, ndav, iprint,
                 para_rule == nullptr ? nullptr : para_rule->comm, conv_thrd,
@@ -2147,6 +2486,12 @@ struct EffectiveHamiltonian<S, FL, MultiMPS<S, FL>> {
                 t.second->cinfo->deallocate();
             t.second->deallocate();
         }
+        // temporaries cached during the solve are not kept between sites
+        const int ntr =
+            max(threading->n_threads_op, threading->n_threads_global);
+        ArenaAllocator<FP>::release_all_thread_caches(ntr);
+        if (!is_same<FL, FP>::value)
+            ArenaAllocator<FL>::release_all_thread_caches(ntr);
     }
 };
 
@@ -26,11 +26,13 @@
 #include "../core/fp_codec.hpp"
 #include "general_hamiltonian.hpp"
 #include "mpo.hpp"
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <numeric>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -149,6 +151,30 @@ inline ostream &operator<<(ostream &os, const MPOAlgorithmTypes c) {
     return os;
 }
 
+// Position of one term in the current site of MPO construction
+struct GeneralMPOTermKey {
+    size_t hl, hr; // hashed left/right block string of op
+    int ip, iq;    // mpo index; quantum number block index
+    uint16_t k;    // first right site position
+    pair<uint16_t, pair<uint16_t, uint16_t>> ppqq; // block kind
+};
+
+// Sum expressions and site operators of one site of MPO construction,
+// for updating the MPO coefficients without rebuilding the bond structure
+template <typename S, typename FL> struct GeneralMPOSiteRecord {
+    typedef long long int LL;
+    // site operators (before evaluating sum expressions)
+    unordered_map<shared_ptr<OpExpr<S>>, shared_ptr<SparseMatrix<S, FL>>> ops;
+    LL ixx = 0; // number of site operators with name X
+    // index in mpo matrix data; offset of the strings of each sum expression
+    vector<size_t> idxs, offs;
+    // operator and term index (-1 for factor 1) of each string
+    vector<shared_ptr<OpElement<S, FL>>> elems;
+    vector<LL> terms;
+    // whether ops is stored in disk (minimal memory mode)
+    bool ops_saved = false;
+};
+
 template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
     typedef typename GMatrix<FL>::FP FP;
     typedef long long int LL;
@@ -174,6 +200,15 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
     FP disjoint_multiplier = (FP)1.0;
     bool block_max_length = false;   // separate 1e/2e terms
     bool fast_no_orb_dep_op = false; // fast mode for no orb_sym case
+    // record the sum expressions during build, so that the mpo can be
+    // updated for new coefficients (only for Bipartite algorithms)
+    // update must be invoked before the mpo is wrapped (for example, by
+    // SimplifiedMPO), since the wrapper has its own copy of the tensors
+    bool updatable = false;
+    shared_ptr<GeneralFCIDUMP<FL>> ref_afd; // terms of the recorded build
+    S ref_left_vacuum = S(S::invalid);
+    vector<LL> ref_dropped; // terms dropped by cutoff in the recorded build
+    vector<GeneralMPOSiteRecord<S, FL>> site_records;
     static inline size_t expr_index_hash(const string &expr,
                                          const uint16_t *terms, int n,
                                          const uint16_t init = 0) noexcept {
@@ -183,6 +218,33 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             h ^= terms[i] + 0x9E3779B9 + (h << 6) + (h >> 2);
         return h;
     }
+    // apply f to all blocks; blocks taking a large fraction of the total
+    // cost are processed one by one with threaded BLAS, other blocks are
+    // distributed over threads with serial BLAS
+    template <typename F>
+    static void parallel_for_blocks(const vector<double> &costs, bool serial,
+                                    F f) {
+        const int ntg = serial ? 1 : threading->activate_global();
+        const double total =
+            accumulate(costs.begin(), costs.end(), 0.0, plus<double>());
+        vector<int> iqs;
+        for (int iq = 0; iq < (int)costs.size(); iq++)
+            if (ntg == 1 || costs[iq] * ntg >= total) {
+                threading->activate_global_mkl();
+                f(iq);
+            } else
+                iqs.push_back(iq);
+        if (iqs.size() != 0) {
+            stable_sort(iqs.begin(), iqs.end(), [&costs](int a, int b) {
+                return costs[a] > costs[b];
+            });
+            threading->activate_global();
+#pragma omp parallel for schedule(dynamic) num_threads(ntg)
+            for (int i = 0; i < (int)iqs.size(); i++)
+                f(iqs[i]);
+        }
+        threading->activate_normal();
+    }
     GeneralMPO(const shared_ptr<GeneralHamiltonian<S, FL>> &hamil,
                const shared_ptr<GeneralFCIDUMP<FL>> &afd,
                MPOAlgorithmTypes algo_type, FP cutoff = (FP)0.0,
@@ -191,6 +253,125 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
           cutoff(cutoff), max_bond_dim(max_bond_dim), iprint(iprint) {
         MPO<S, FL>::hamil = hamil;
     }
+    // evaluate sum expressions in the mpo matrix of site ii as new site
+    // operators; ixx is the number of site operators with name X
+    void evaluate_sums(int ii, const shared_ptr<OperatorTensor<S, FL>> &opt,
+                       LL &ixx) const {
+        shared_ptr<GeneralHamiltonian<S, FL>> hamil =
+            dynamic_pointer_cast<GeneralHamiltonian<S, FL>>(MPO<S, FL>::hamil);
+        Symbolic<S> &mat = *opt->lmat;
+        shared_ptr<VectorAllocator<FP>> d_alloc =
+            make_shared<VectorAllocator<FP>>();
+        for (size_t i = 0; i < mat.data.size(); i++) {
+            // only happens for non-sparse boundary tensors
+            if (mat.data[i]->get_type() == OpTypes::Zero)
+                continue;
+            shared_ptr<OpSum<S, FL>> opx =
+                dynamic_pointer_cast<OpSum<S, FL>>(mat.data[i]);
+            assert(opx->strings.size() != 0);
+            shared_ptr<SparseMatrix<S, FL>> xmat =
+                opt->ops.at(opx->strings[0]->get_op());
+            if (opx->strings.size() == 1) {
+                if (ii == 0 || ii == n_sites - 1) {
+                    shared_ptr<OpElement<S, FL>> opel =
+                        make_shared<OpElement<S, FL>>(
+                            ii == 0 ? OpNames::XL : OpNames::XR,
+                            SiteIndex({(uint16_t)(i / 1000),
+                                       (uint16_t)(i % 1000)},
+                                      {}),
+                            xmat->info->delta_quantum);
+                    mat.data[i] = opel;
+                    assert(opx->strings[0]->get_op()->q_label ==
+                           opel->q_label);
+                    if (opx->strings[0]->factor != (FL)1.0) {
+                        shared_ptr<SparseMatrix<S, FL>> gmat =
+                            make_shared<SparseMatrix<S, FL>>(nullptr);
+                        gmat->allocate(xmat->info, xmat->data);
+                        gmat->factor =
+                            xmat->factor * opx->strings[0]->factor;
+                        opt->ops[opel] = gmat;
+                    } else
+                        opt->ops[opel] = xmat;
+                } else
+                    mat.data[i] =
+                        opx->strings[0]->get_op()->scalar_multiply(
+                            (FL)opx->strings[0]->factor);
+            } else {
+                // for SU2 there will be multiple possible gmats
+                // with different dq
+                map<S, shared_ptr<SparseMatrix<S, FL>>> gmats;
+                bool all_same_dq = true;
+                for (auto &x : opx->strings) {
+                    shared_ptr<SparseMatrixInfo<S>> info =
+                        opt->ops.at(x->get_op())->info;
+                    if (!gmats.count(info->delta_quantum)) {
+                        shared_ptr<SparseMatrix<S, FL>> gmat =
+                            make_shared<SparseMatrix<S, FL>>(d_alloc);
+                        gmat->allocate(info);
+                        gmats[info->delta_quantum] = gmat;
+                    }
+                }
+                for (auto &x : opx->strings) {
+                    shared_ptr<SparseMatrix<S, FL>> mmat =
+                        opt->ops.at(x->get_op());
+                    shared_ptr<SparseMatrix<S, FL>> gmat =
+                        gmats.at(mmat->info->delta_quantum);
+                    hamil->opf->iadd(gmat, mmat, x->factor);
+                    if (hamil->opf->seq->mode != SeqTypes::None)
+                        hamil->opf->seq->simple_perform();
+                }
+                if (gmats.size() == 1) {
+                    shared_ptr<SparseMatrix<S, FL>> gmat =
+                        gmats.begin()->second;
+                    shared_ptr<OpElement<S, FL>> opel;
+                    if (ii == 0 || ii == n_sites - 1)
+                        opel = make_shared<OpElement<S, FL>>(
+                            ii == 0 ? OpNames::XL : OpNames::XR,
+                            SiteIndex({(uint16_t)(i / 1000),
+                                       (uint16_t)(i % 1000)},
+                                      {}),
+                            gmat->info->delta_quantum);
+                    else {
+                        opel = make_shared<OpElement<S, FL>>(
+                            OpNames::X,
+                            SiteIndex({(uint16_t)(ixx / 1000 / 1000),
+                                       (uint16_t)(ixx / 1000 % 1000),
+                                       (uint16_t)(ixx % 1000)},
+                                      {}),
+                            gmat->info->delta_quantum);
+                        ixx++;
+                    }
+                    mat.data[i] = opel;
+                    opt->ops[opel] = gmat;
+                    assert(opx->strings[0]->get_op()->q_label ==
+                           opel->q_label);
+                } else {
+                    // for non-singlet Hamiltonian:
+                    // ii != 0 && ii != n_sites - 1 may not be satisfied
+                    // in fact for non singlet mps this is already supported
+                    // since with non-zero left_vac, the left_assign will be
+                    // replaced by left_contract which supports arbitrary
+                    // expressions
+                    vector<shared_ptr<OpExpr<S>>> opels;
+                    opels.reserve(gmats.size());
+                    for (auto &gmat : gmats) {
+                        shared_ptr<OpElement<S, FL>> opel =
+                            make_shared<OpElement<S, FL>>(
+                                OpNames::X,
+                                SiteIndex({(uint16_t)(ixx / 1000 / 1000),
+                                           (uint16_t)(ixx / 1000 % 1000),
+                                           (uint16_t)(ixx % 1000)},
+                                          {}),
+                                gmat.second->info->delta_quantum);
+                        ixx++;
+                        opels.push_back(opel);
+                        opt->ops[opel] = gmat.second;
+                    }
+                    mat.data[i] = sum(opels);
+                }
+            }
+        }
+    }
     void build() override {
         bool rescale = algo_type & MPOAlgorithmTypes::Rescaled;
         bool fast = algo_type & MPOAlgorithmTypes::Fast;
@@ -233,6 +414,17 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
         discarded_weights.resize(n_sites);
         for (uint16_t m = 0; m < n_sites; m++)
             tensors[m] = make_shared<OperatorTensor<S, FL>>();
+        // in bipartite algorithms, each coefficient in the mpo is either
+        // one or the coefficient of a single term, so the sum expressions
+        // can be recorded in terms of term indices
+        const bool record =
+            updatable && (algo_type & MPOAlgorithmTypes::Bipartite);
+        ref_afd = record ? afd : nullptr;
+        ref_left_vacuum = left_vacuum;
+        ref_dropped.clear();
+        site_records.clear();
+        if (record)
+            site_records.resize(n_sites);
         S vacuum = hamil->vacuum;
         // length of each term; starting index of each term
         // at the beginning, term_i is all zero
@@ -306,38 +498,40 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
         // index of current terms
         // in future, cur_terms should have an extra level
         // indicating the term length
+        // in fast mode, terms with non-zero length are not included here
         vector<vector<pair<int, LL>>> cur_terms(1);
         vector<vector<FL>> cur_values(1);
-        cur_terms[0].resize(n_terms);
-        cur_values[0].resize(n_terms);
-        size_t ik = 0;
         for (int ix = 0; ix < (int)afd->exprs.size(); ix++)
-            for (size_t it = 0; it < afd->data[ix].size(); it++) {
-                cur_terms[0][ik] = make_pair(ix, (LL)it);
-                cur_values[0][ik] = afd->data[ix][it];
-                ik++;
-            }
-        assert(ik == n_terms);
+            if (!fast || term_l[ix] == 0)
+                for (size_t it = 0; it < afd->data[ix].size(); it++) {
+                    cur_terms[0].push_back(make_pair(ix, (LL)it));
+                    cur_values[0].push_back(afd->data[ix][it]);
+                }
+        // global index of the first term of each expr
+        vector<LL> term_off(afd->exprs.size() + 1, 0);
+        for (int ix = 0; ix < (int)afd->exprs.size(); ix++)
+            term_off[ix + 1] = term_off[ix] + (LL)afd->data[ix].size();
         vector<pair<int, LL>> part_terms;
         vector<FL> part_values;
         vector<LL> part_indices;
+        // in minimal memory mode (partial memory reduction), the (expr, term)
+        // index pairs and values of part terms are stored in disk, and only
+        // those of the current site (and the delayed term) are loaded;
+        // part_base is the index of the first loaded part term.
+        // the site indices and values in afd are not streamed and stay in
+        // memory, so the peak memory still grows with the number of terms
+        const bool part_disk = fast && frame_<FP>()->minimal_memory_usage;
+        fstream part_fs;
+        string part_filename;
+        LL part_base = 0, part_n_terms = 0;
         // to save time, divide O(K^4) terms into K groups
         // for each iteration on site k, only O(K^3) terms are processed
         if (fast) {
-            vector<pair<int, LL>> ext_cur_terms;
-            vector<FL> ext_cur_values;
             vector<LL> part_count(n_sites, 0);
-            for (LL ik = 0; ik < n_terms; ik++) {
-                int ix = cur_terms[0][ik].first;
-                LL it = cur_terms[0][ik].second;
+            for (int ix = 0; ix < (int)afd->exprs.size(); ix++)
                 if (term_l[ix] != 0)
-                    part_count[afd->indices[ix][it * term_l[ix]]]++;
-                else {
-                    ext_cur_terms.push_back(cur_terms[0][ik]);
-                    ext_cur_values.push_back(cur_values[0][ik]);
-                }
-            }
-            LL part_n_terms = 0;
+                    for (size_t it = 0; it < afd->data[ix].size(); it++)
+                        part_count[afd->indices[ix][it * term_l[ix]]]++;
             for (int ii = 0; ii < n_sites; ii++)
                 part_n_terms += part_count[ii];
             part_indices.resize(n_sites + 1, 0);
@@ -345,22 +539,66 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             // part_count[ii]
             for (int ii = 1; ii < n_sites; ii++)
                 part_indices[ii + 1] = part_indices[ii] + part_count[ii - 1];
-            part_terms.resize(part_n_terms);
-            part_values.resize(part_n_terms);
-            for (LL ik = 0; ik < n_terms; ik++) {
-                int ix = cur_terms[0][ik].first;
-                LL it = cur_terms[0][ik].second;
-                if (term_l[ix] != 0) {
-                    int ii = afd->indices[ix][it * term_l[ix]];
-                    LL x = part_indices[ii + 1]++;
-                    part_terms[x] = cur_terms[0][ik];
-                    part_values[x] = cur_values[0][ik];
-                }
+            if (!part_disk) {
+                part_terms.resize(part_n_terms);
+                part_values.resize(part_n_terms);
+            } else {
+                stringstream ss;
+                ss << frame_<FP>()->mpo_dir << "/"
+                   << frame_<FP>()->prefix_distri << ".MPO." << this->tag
+                   << ".TERMS";
+                part_filename = ss.str();
+                part_fs.open(part_filename.c_str(),
+                             ios::in | ios::out | ios::binary | ios::trunc);
+                if (!part_fs.good())
+                    throw runtime_error("GeneralMPO::build on '" +
+                                        part_filename + "' failed.");
             }
+            // buffered writing of part terms (only for part_disk)
+            const size_t buf_size = 1 << 12;
+            vector<vector<pair<int, LL>>> buf_terms(part_disk ? n_sites : 0);
+            vector<vector<FL>> buf_values(part_disk ? n_sites : 0);
+            auto flush_part = [&](int ii) {
+                LL x = part_indices[ii + 1];
+                part_fs.seekp(sizeof(pair<int, LL>) * x);
+                part_fs.write((char *)buf_terms[ii].data(),
+                              sizeof(pair<int, LL>) * buf_terms[ii].size());
+                part_fs.seekp(sizeof(pair<int, LL>) * part_n_terms +
+                              sizeof(FL) * x);
+                part_fs.write((char *)buf_values[ii].data(),
+                              sizeof(FL) * buf_values[ii].size());
+                part_indices[ii + 1] += (LL)buf_terms[ii].size();
+                buf_terms[ii].clear();
+                buf_values[ii].clear();
+            };
+            for (int ix = 0; ix < (int)afd->exprs.size(); ix++)
+                if (term_l[ix] != 0)
+                    for (size_t it = 0; it < afd->data[ix].size(); it++) {
+                        int ii = afd->indices[ix][it * term_l[ix]];
+                        if (!part_disk) {
+                            LL x = part_indices[ii + 1]++;
+                            part_terms[x] = make_pair(ix, (LL)it);
+                            part_values[x] = afd->data[ix][it];
+                        } else {
+                            buf_terms[ii].push_back(make_pair(ix, (LL)it));
+                            buf_values[ii].push_back(afd->data[ix][it]);
+                            if (buf_terms[ii].size() >= buf_size)
+                                flush_part(ii);
+                        }
+                    }
+            for (int ii = 0; ii < (int)buf_terms.size(); ii++)
+                flush_part(ii);
+            if (part_disk && !part_fs.good())
+                throw runtime_error("GeneralMPO::build on '" + part_filename +
+                                    "' failed.");
             assert(part_indices[n_sites] == part_n_terms);
-            cur_terms[0] = ext_cur_terms;
-            cur_values[0] = ext_cur_values;
         }
+        // global term index of each value in cur_values (only when recording)
+        // -1 means the value is fixed to one
+        vector<vector<LL>> cur_srcs(1);
+        if (record)
+            for (auto &ct : cur_terms[0])
+                cur_srcs[0].push_back(term_off[ct.first] + ct.second);
         // do svd from left to right
         // time complexity: O(KDLN(log N))
         // K: n_sites, D: max_bond_dim, L: term_len, N: n_terms
@@ -378,6 +616,8 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
         vector<unordered_map<size_t, vector<pair<pair<int, LL>, int>>>> map_rs;
         // sparse repr of the connection (edge) matrix for each block
         vector<vector<pair<pair<int, int>, FL>>> mats;
+        // global term index of the value of each edge (only when recording)
+        vector<vector<LL>> mat_srcs;
         // for each block, the nrow and ncol of the block
         vector<pair<LL, LL>> nms;
         // range of ip that should be svd/bip separately
@@ -387,8 +627,14 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
         vector<map<pair<uint16_t, uint16_t>, string>> sub_exprs(
             afd->exprs.size());
         FL rsc_factor = 1;
+        // offset of the marks for (ik, k) sub expressions of each term
+        vector<size_t> sub_off(afd->exprs.size() + 1, 0);
+        for (int ix = 0; ix < (int)afd->exprs.size(); ix++)
+            sub_off[ix + 1] =
+                sub_off[ix] + (size_t)(term_l[ix] + 1) * (term_l[ix] + 1);
         Timer _t, _t2;
-        double tsite, tsvd, tsite_total = 0, tsvd_total = 0;
+        double tsite, tsvd, tterm, tsite_total = 0, tsvd_total = 0,
+                                   tterm_total = 0;
         FP dw_max = 0, error_total = 0;
         size_t nnz_total = 0, size_total = 0;
         int bond_max = 0;
@@ -404,6 +650,7 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             map_ls.clear();
             map_rs.clear();
             mats.clear();
+            mat_srcs.clear();
             nms.clear();
             LL delayed_term = -1, part_off = 0;
             vector<int> ip_sparse(cur_values.size(), ii);
@@ -415,109 +662,113 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             }
             FP eff_disjoint_multiplier =
                 ii == n_sites - 1 ? (FP)1.0 : disjoint_multiplier;
+            _t2.get_time();
             // Part 1: iter over all mpos
-            for (int ip = 0; ip < (int)cur_values.size(); ip++) {
-                LL cn = (LL)cur_terms[ip].size(), cnr = cn;
-                // for part terms, we have two things:
-                // (1) terms starting with the current index should be handled
-                // (cnr ~ cn) (2) terms not starting with the current index
-                // should be delayed here ip = 0 is fixed to be identity in the
-                // left
-                if (part_indices.size() != 0 && ip == 0) {
-                    cn += part_indices[ii + 1] - part_indices[ii];
-                    part_off = part_indices[ii] - cnr;
-                    if (part_indices[ii + 1] != part_indices[n_sites]) {
-                        // this represents all terms with starting index > ii
-                        delayed_term = part_indices[ii + 1];
-                        int ix = part_terms[delayed_term].first;
-                        LL it = part_terms[delayed_term].second;
-                        LL itt = it * term_l[ix];
-                        term_k[ix][it] = 0;
-                        if (!sub_exprs[ix].count(make_pair(0, 0)))
-                            sub_exprs[ix][make_pair(0, 0)] =
-                                GeneralHamiltonian<S, FL>::get_sub_expr(
-                                    afd->exprs[ix], 0, 0);
-                        if (!sub_exprs[ix].count(make_pair(0, term_l[ix])))
-                            sub_exprs[ix][make_pair(0, term_l[ix])] =
-                                GeneralHamiltonian<S, FL>::get_sub_expr(
-                                    afd->exprs[ix], 0, term_l[ix]);
-                        pair<S, S> pq =
-                            fast_no_orb_dep_op
-                                ? make_pair(quanta_ref[ix][0],
-                                            quanta_ref[ix].back() -
-                                                quanta_ref[ix][0])
-                                : hamil->get_string_quanta(
-                                      quanta_ref[ix], afd->exprs[ix],
-                                      &afd->indices[ix][itt], 0);
-                        q_map[make_pair(make_pair(0, make_pair(0, 0)),
-                                        qh.combine(pq.first, -pq.second))] = 0;
-                        map_ls.emplace_back();
-                        map_rs.emplace_back();
-                        mats.emplace_back();
-                        nms.push_back(make_pair(1, 1));
-                        map_ls[0][0].push_back(make_pair(make_pair(0, -1), 0));
-                        map_rs[0][0].push_back(make_pair(make_pair(0, -1), 0));
-                        mats[0].push_back(
-                            make_pair(make_pair(0, 0),
-                                      part_values[delayed_term] * rsc_factor));
-                    }
+            // for part terms, we have two things:
+            // (1) terms starting with the current index should be handled
+            // (appended to ip = 0) (2) terms not starting with the current
+            // index should be delayed here ip = 0 is fixed to be identity in
+            // the left
+            if (part_disk) {
+                // load part terms of the current site and the delayed term
+                part_base = part_indices[ii];
+                const LL part_end =
+                    min(part_indices[ii + 1] + 1, part_indices[n_sites]);
+                part_terms.resize(part_end - part_base);
+                part_values.resize(part_end - part_base);
+                part_fs.seekg(sizeof(pair<int, LL>) * part_base);
+                part_fs.read((char *)part_terms.data(),
+                             sizeof(pair<int, LL>) * part_terms.size());
+                part_fs.seekg(sizeof(pair<int, LL>) * part_n_terms +
+                              sizeof(FL) * part_base);
+                part_fs.read((char *)part_values.data(),
+                             sizeof(FL) * part_values.size());
+                if (!part_fs.good())
+                    throw runtime_error("GeneralMPO::build on '" +
+                                        part_filename + "' failed.");
+            }
+            if (part_indices.size() != 0) {
+                part_off =
+                    part_indices[ii] - part_base - (LL)cur_terms[0].size();
+                if (part_indices[ii + 1] != part_indices[n_sites]) {
+                    // this represents all terms with starting index > ii
+                    delayed_term = part_indices[ii + 1] - part_base;
+                    int ix = part_terms[delayed_term].first;
+                    LL it = part_terms[delayed_term].second;
+                    LL itt = it * term_l[ix];
+                    term_k[ix][it] = 0;
+                    if (!sub_exprs[ix].count(make_pair(0, 0)))
+                        sub_exprs[ix][make_pair(0, 0)] =
+                            GeneralHamiltonian<S, FL>::get_sub_expr(
+                                afd->exprs[ix], 0, 0);
+                    if (!sub_exprs[ix].count(make_pair(0, term_l[ix])))
+                        sub_exprs[ix][make_pair(0, term_l[ix])] =
+                            GeneralHamiltonian<S, FL>::get_sub_expr(
+                                afd->exprs[ix], 0, term_l[ix]);
+                    pair<S, S> pq =
+                        fast_no_orb_dep_op
+                            ? make_pair(quanta_ref[ix][0],
+                                        quanta_ref[ix].back() -
+                                            quanta_ref[ix][0])
+                            : hamil->get_string_quanta(quanta_ref[ix],
+                                                       afd->exprs[ix],
+                                                       &afd->indices[ix][itt],
+                                                       0);
+                    q_map[make_pair(make_pair(0, make_pair(0, 0)),
+                                    qh.combine(pq.first, -pq.second))] = 0;
+                    map_ls.emplace_back();
+                    map_rs.emplace_back();
+                    mats.emplace_back();
+                    mat_srcs.emplace_back();
+                    nms.push_back(make_pair(1, 1));
+                    map_ls[0][0].push_back(make_pair(make_pair(0, -1), 0));
+                    map_rs[0][0].push_back(make_pair(make_pair(0, -1), 0));
+                    mats[0].push_back(make_pair(
+                        make_pair(0, 0),
+                        part_values[delayed_term] * rsc_factor));
+                    if (record)
+                        mat_srcs[0].push_back(term_off[ix] + it);
                 }
-                for (LL ic = 0; ic < cn; ic++) {
-                    LL ix, it;
-                    FL itv;
-                    if (ic < cnr) {
-                        ix = cur_terms[ip][ic].first;
-                        it = cur_terms[ip][ic].second;
-                        itv = cur_values[ip][ic];
-                    } else {
-                        ix = part_terms[ic + part_off].first;
-                        it = part_terms[ic + part_off].second;
-                        itv = part_values[ic + part_off] * rsc_factor;
-                    }
+            }
+            // all terms of all mpos are numbered by a global index ig
+            // (ip-major); g_off[ip] is the global index of (ip, 0)
+            vector<LL> g_off(cur_values.size() + 1, 0);
+            for (int ip = 0; ip < (int)cur_values.size(); ip++) {
+                g_off[ip + 1] = g_off[ip] + (LL)cur_terms[ip].size();
+                if (part_indices.size() != 0 && ip == 0)
+                    g_off[ip + 1] += part_indices[ii + 1] - part_indices[ii];
+            }
+            const LL ng = g_off.back();
+            vector<GeneralMPOTermKey> gks(ng);
+            const int ntg = threading->activate_global();
+            vector<vector<uint8_t>> sub_marks(
+                ntg, vector<uint8_t>(sub_off.back(), 0));
+            // (a) separate each term into two parts (left block part and
+            // right block part) and hash both parts
+#pragma omp parallel num_threads(ntg)
+            {
+                const int tid = threading->get_thread_id();
+#pragma omp for schedule(static)
+                for (LL ig = 0; ig < ng; ig++) {
+                    const int ip = (int)(upper_bound(g_off.begin(),
+                                                     g_off.end(), ig) -
+                                         g_off.begin()) -
+                                   1;
+                    const LL ic = ig - g_off[ip];
+                    const pair<int, LL> &pt =
+                        ic < (LL)cur_terms[ip].size()
+                            ? cur_terms[ip][ic]
+                            : part_terms[ic + part_off];
+                    const int ix = pt.first;
+                    const LL it = pt.second;
                     int ik = term_i[ix][it], k = ik, kmax = term_l[ix];
                     LL itt = it * kmax;
-                    // separate the current product into two parts
-                    // (left block part and right block part)
                     for (; k < kmax && afd->indices[ix][itt + k] <= ii; k++)
                         ;
                     int iw = k == kmax ? 0 : 1, iwl = kmax - k;
                     for (int iwk = k + 1; iwk < kmax; iwk++)
                         iw += (afd->indices[ix][itt + iwk] ==
                                afd->indices[ix][itt + iwk - 1]);
-                    if (!sub_exprs[ix].count(make_pair(ik, k)))
-                        sub_exprs[ix][make_pair(ik, k)] =
-                            GeneralHamiltonian<S, FL>::get_sub_expr(
-                                afd->exprs[ix], ik, k);
-                    if (!sub_exprs[ix].count(make_pair(k, kmax)))
-                        sub_exprs[ix][make_pair(k, kmax)] =
-                            GeneralHamiltonian<S, FL>::get_sub_expr(
-                                afd->exprs[ix], k, kmax);
-                    // cout << "ip = " << ip << " ic = " << ic << " ix = " << ix
-                    //      << " it = " << it << " ik = " << ik
-                    //      << " kmax = " << kmax << " k = " << k
-                    //      << " term = " << afd->exprs[ix];
-                    // for (int gk = 0; gk < kmax; gk++)
-                    //     cout << " " << afd->indices[ix][itt + gk];
-                    // cout << " L = " << sub_exprs[ix].at(make_pair(ik, k))
-                    //      << " R = " << sub_exprs[ix].at(make_pair(k, kmax));
-                    // first right site position
-                    term_k[ix][it] = k;
-                    const string &lstr = sub_exprs[ix].at(make_pair(ik, k));
-                    const string &rstr = sub_exprs[ix].at(make_pair(k, kmax));
-                    size_t hl = expr_index_hash(
-                        lstr, afd->indices[ix].data() + itt + ik, k - ik, ip);
-                    size_t hr = expr_index_hash(
-                        rstr, afd->indices[ix].data() + itt + k, kmax - k, 1);
-                    pair<S, S> pq = fast_no_orb_dep_op
-                                        ? make_pair(quanta_ref[ix][k],
-                                                    quanta_ref[ix].back() -
-                                                        quanta_ref[ix][k])
-                                        : hamil->get_string_quanta(
-                                              quanta_ref[ix], afd->exprs[ix],
-                                              &afd->indices[ix][itt], k);
-                    S qq = qh.combine(pq.first, -pq.second);
-                    // possible error here due to unsymmetrized integral
-                    assert(qq != S(S::invalid));
                     pair<uint16_t, uint16_t> pqq =
                         make_pair((uint16_t)0, (uint16_t)0);
                     if (constrain && kmax - k == k)
@@ -540,25 +791,130 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                         ppqq.second.second = (uint16_t)kmax;
                     if (length)
                         ppqq.second.second = (uint16_t)(iw * max_term_l + iwl);
-                    if (q_map.count(make_pair(ppqq, qq)) == 0) {
-                        const int nq = (int)q_map.size();
-                        q_map[make_pair(ppqq, qq)] = nq;
-                        map_ls.emplace_back();
-                        map_rs.emplace_back();
-                        mats.emplace_back();
-                        nms.push_back(make_pair(0, 0));
+                    gks[ig].ip = ip, gks[ig].k = (uint16_t)k;
+                    gks[ig].ppqq = ppqq;
+                    uint8_t *mk = sub_marks[tid].data() + sub_off[ix];
+                    mk[ik * (kmax + 1) + k] = mk[k * (kmax + 1) + kmax] = 1;
+                }
+#pragma omp single
+                for (int ix = 0; ix < (int)afd->exprs.size(); ix++) {
+                    const int kmax = term_l[ix];
+                    for (int ik = 0; ik <= kmax; ik++)
+                        for (int k = ik; k <= kmax; k++) {
+                            const size_t imk =
+                                sub_off[ix] + ik * (kmax + 1) + k;
+                            bool marked = false;
+                            for (int itg = 0; itg < ntg && !marked; itg++)
+                                marked = sub_marks[itg][imk];
+                            if (marked && !sub_exprs[ix].count(make_pair(ik, k)))
+                                sub_exprs[ix][make_pair(ik, k)] =
+                                    GeneralHamiltonian<S, FL>::get_sub_expr(
+                                        afd->exprs[ix], ik, k);
+                        }
+                }
+#pragma omp for schedule(static)
+                for (LL ig = 0; ig < ng; ig++) {
+                    const int ip = gks[ig].ip;
+                    const LL ic = ig - g_off[ip];
+                    const pair<int, LL> &pt =
+                        ic < (LL)cur_terms[ip].size()
+                            ? cur_terms[ip][ic]
+                            : part_terms[ic + part_off];
+                    const int ix = pt.first;
+                    const LL it = pt.second;
+                    int ik = term_i[ix][it], k = gks[ig].k, kmax = term_l[ix];
+                    LL itt = it * kmax;
+                    const string &lstr = sub_exprs[ix].at(make_pair(ik, k));
+                    const string &rstr = sub_exprs[ix].at(make_pair(k, kmax));
+                    gks[ig].hl = expr_index_hash(
+                        lstr, afd->indices[ix].data() + itt + ik, k - ik, ip);
+                    gks[ig].hr = expr_index_hash(
+                        rstr, afd->indices[ix].data() + itt + k, kmax - k, 1);
+                }
+            }
+            threading->activate_normal();
+            // (b) assign quantum number blocks in the order of terms
+            // (serial, since get_string_quanta may be implemented in python)
+            for (LL ig = 0; ig < ng; ig++) {
+                const int ip = gks[ig].ip;
+                const LL ic = ig - g_off[ip];
+                const pair<int, LL> &pt = ic < (LL)cur_terms[ip].size()
+                                              ? cur_terms[ip][ic]
+                                              : part_terms[ic + part_off];
+                const int ix = pt.first, k = gks[ig].k;
+                const LL it = pt.second, itt = it * term_l[ix];
+                // first right site position
+                term_k[ix][it] = k;
+                pair<S, S> pq = fast_no_orb_dep_op
+                                    ? make_pair(quanta_ref[ix][k],
+                                                quanta_ref[ix].back() -
+                                                    quanta_ref[ix][k])
+                                    : hamil->get_string_quanta(
+                                          quanta_ref[ix], afd->exprs[ix],
+                                          &afd->indices[ix][itt], k);
+                S qq = qh.combine(pq.first, -pq.second);
+                // possible error here due to unsymmetrized integral
+                assert(qq != S(S::invalid));
+                auto mq = q_map.find(make_pair(gks[ig].ppqq, qq));
+                if (mq == q_map.end()) {
+                    const int nq = (int)q_map.size();
+                    q_map[make_pair(gks[ig].ppqq, qq)] = nq;
+                    map_ls.emplace_back();
+                    map_rs.emplace_back();
+                    mats.emplace_back();
+                    mat_srcs.emplace_back();
+                    nms.push_back(make_pair(0, 0));
+                    gks[ig].iq = nq;
+                } else
+                    gks[ig].iq = mq->second;
+            }
+            // (c) for each block, find the left and right vertices of each
+            // term in the order of terms (parallel over blocks)
+            vector<LL> q_off(q_map.size() + 1, 0), g_ord(ng);
+            for (LL ig = 0; ig < ng; ig++)
+                q_off[gks[ig].iq + 1]++;
+            for (size_t iq = 0; iq < q_map.size(); iq++)
+                q_off[iq + 1] += q_off[iq];
+            vector<LL> q_pos(q_off.begin(), q_off.end() - 1);
+            for (LL ig = 0; ig < ng; ig++)
+                g_ord[q_pos[gks[ig].iq]++] = ig;
+            threading->activate_global();
+#pragma omp parallel for schedule(dynamic) num_threads(ntg)
+            for (int iq = 0; iq < (int)q_map.size(); iq++) {
+                LL &nml = nms[iq].first, &nmr = nms[iq].second;
+                auto &mpl = map_ls[iq];
+                auto &mpr = map_rs[iq];
+                mats[iq].reserve(mats[iq].size() + q_off[iq + 1] - q_off[iq]);
+                for (LL igx = q_off[iq]; igx < q_off[iq + 1]; igx++) {
+                    const LL ig = g_ord[igx];
+                    const int ip = gks[ig].ip;
+                    const LL ic = ig - g_off[ip];
+                    LL ix, it, src = -1;
+                    FL itv;
+                    if (ic < (LL)cur_terms[ip].size()) {
+                        ix = cur_terms[ip][ic].first;
+                        it = cur_terms[ip][ic].second;
+                        itv = cur_values[ip][ic];
+                        if (record)
+                            src = cur_srcs[ip][ic];
+                    } else {
+                        ix = part_terms[ic + part_off].first;
+                        it = part_terms[ic + part_off].second;
+                        itv = part_values[ic + part_off] * rsc_factor;
+                        src = term_off[ix] + it;
                     }
-                    int iq = q_map.at(make_pair(ppqq, qq));
+                    int ik = term_i[ix][it], k = gks[ig].k, kmax = term_l[ix];
+                    LL itt = it * kmax;
+                    const string &lstr = sub_exprs[ix].at(make_pair(ik, k));
+                    const string &rstr = sub_exprs[ix].at(make_pair(k, kmax));
+                    const size_t hl = gks[ig].hl, hr = gks[ig].hr;
                     LL il = -1, ir = -1;
-                    LL &nml = nms[iq].first, &nmr = nms[iq].second;
-                    auto &mpl = map_ls[iq];
-                    auto &mpr = map_rs[iq];
                     if (mpl.count(hl)) {
-                        int iq = 0;
+                        int jq = 0;
                         auto &vq = mpl.at(hl);
-                        for (; iq < (int)vq.size(); iq++) {
-                            int vip = vq[iq].first.first, vix;
-                            LL vic = vq[iq].first.second, vit;
+                        for (; jq < (int)vq.size(); jq++) {
+                            int vip = vq[jq].first.first, vix;
+                            LL vic = vq[jq].first.second, vit;
                             if (vic >= (LL)cur_terms[vip].size()) {
                                 vix = part_terms[vic + part_off].first;
                                 vit = part_terms[vic + part_off].second;
@@ -579,20 +935,20 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                                  lstr == sub_exprs[vix].at(make_pair(vik, vk))))
                                 break;
                         }
-                        if (iq == (int)vq.size())
+                        if (jq == (int)vq.size())
                             vq.push_back(make_pair(make_pair(ip, ic),
                                                    (int)(il = nml++)));
                         else
-                            il = vq[iq].second;
+                            il = vq[jq].second;
                     } else
                         mpl[hl].push_back(
                             make_pair(make_pair(ip, ic), (int)(il = nml++)));
                     if (mpr.count(hr)) {
-                        int iq = 0;
+                        int jq = 0;
                         auto &vq = mpr.at(hr);
-                        for (; iq < (int)vq.size(); iq++) {
-                            int vip = vq[iq].first.first, vix;
-                            LL vic = vq[iq].first.second, vit;
+                        for (; jq < (int)vq.size(); jq++) {
+                            int vip = vq[jq].first.first, vix;
+                            LL vic = vq[jq].first.second, vit;
                             if (vic >= (LL)cur_terms[vip].size()) {
                                 vix = part_terms[vic + part_off].first;
                                 vit = part_terms[vic + part_off].second;
@@ -614,21 +970,24 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                                      sub_exprs[vix].at(make_pair(vk, vkmax))))
                                 break;
                         }
-                        if (iq == (int)vq.size())
+                        if (jq == (int)vq.size())
                             vq.push_back(make_pair(make_pair(ip, ic),
                                                    (int)(ir = nmr++)));
                         else
-                            ir = vq[iq].second;
+                            ir = vq[jq].second;
                     } else
                         mpr[hr].push_back(
                             make_pair(make_pair(ip, ic), (int)(ir = nmr++)));
-                    // cout << "il = " << il << " ir = " << ir
-                    //      << " ql = " << qq.get_bra(qh)
-                    //      << " qr = " << -qq.get_ket() << endl;
                     mats[iq].push_back(
                         make_pair(make_pair((int)il, (int)ir), itv));
+                    if (record)
+                        mat_srcs[iq].push_back(src);
                 }
             }
+            threading->activate_normal();
+            vector<GeneralMPOTermKey>().swap(gks);
+            vector<LL>().swap(g_ord);
+            tterm = _t2.get_time();
             // cout << "mats size = " << mats.size() << endl;
             // Part 2: svd or mvc
             vector<pair<array<vector<FL>, 2>, vector<FP>>> svds;
@@ -646,8 +1005,16 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             int s_kept_total = 0, nr_total = 0;
             FP res_s_sum = 0, res_factor = 1;
             size_t res_s_count = 0;
-            for (auto &mq : q_map) {
-                int iq = mq.second;
+            // number of kept singular values (or vertices) in each block
+            vector<int> s_kepts(q_map.size(), 0);
+            vector<double> q_costs(q_map.size());
+            for (int iq = 0; iq < (int)q_map.size(); iq++)
+                q_costs[iq] = (algo_type & MPOAlgorithmTypes::Bipartite)
+                                  ? (double)mats[iq].size()
+                                  : (double)nms[iq].first * nms[iq].second *
+                                        min(nms[iq].first, nms[iq].second);
+            _t2.get_time();
+            parallel_for_blocks(q_costs, disjoint && iprint >= 2, [&](int iq) {
                 auto &matvs = mats[iq];
                 auto &nm = nms[iq];
                 int szl = (int)nm.first, szr = (int)nm.second, szm;
@@ -671,7 +1038,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                 }
                 int s_kept = 0;
                 if (algo_type & MPOAlgorithmTypes::Bipartite) { // bipartite
-                    _t2.get_time();
                     Flow flow(szl + szr);
                     for (auto &lrv : matvs)
                         flow.resi[lrv.first.first][lrv.first.second + szl] = 1;
@@ -686,7 +1052,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                         mvcs[iq][1].resize(1);
                         mvcs[iq][1][0] = 0;
                     }
-                    tsvd += _t2.get_time();
                     // delayed I * O(K^4) term must be of NC type
                     if (delayed_term != -1 && iq == 0) {
                         if ((mvcs[iq][0].size() == 0 || mvcs[iq][0][0] != 0))
@@ -726,7 +1091,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                             svds[iq].second[i] = 1;
                     s_kept = szm;
                 } else { // SVD
-                    _t2.get_time();
                     vector<FL> mat((size_t)szl * szr, 0);
                     if (delayed_term != -1 && iq == 0) {
                         for (auto &lrv : matvs)
@@ -739,7 +1103,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                         szl--;
                         svds[iq].second[0] = 1;
                         svds[iq].first[0][0] = 1;
-                        threading->activate_global_mkl();
                         if ((pqx[iq] >= 2 || disjoint_all_blocks) && disjoint)
                             IterativeMatrixFunctions<FL>::disjoint_svd(
                                 GMatrix<FL>(mat.data(), szl, szr),
@@ -759,7 +1122,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                                             szm - 1),
                                 GMatrix<FL>(svds[iq].first[1].data() + szr,
                                             szm - 1, szr));
-                        threading->activate_normal();
                         szl++;
                     } else {
                         for (auto &lrv : matvs)
@@ -767,7 +1129,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                                 lrv.first.second] += lrv.second;
                         // cout << "mat = " << GMatrix<FL>(mat.data(), szl, szr)
                         // << endl;
-                        threading->activate_global_mkl();
                         if ((pqx[iq] >= 2 || disjoint_all_blocks) && disjoint)
                             IterativeMatrixFunctions<FL>::disjoint_svd(
                                 GMatrix<FL>(mat.data(), szl, szr),
@@ -782,7 +1143,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                                 GMatrix<FP>(svds[iq].second.data(), 1, szm),
                                 GMatrix<FL>(svds[iq].first[1].data(), szm,
                                             szr));
-                        threading->activate_normal();
                         // cout << "l = " <<
                         // GMatrix<FL>(svds[iq].first[0].data(), szl, szm) <<
                         // endl; cout << "s = " <<
@@ -791,6 +1151,20 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                         // << "r = " << GMatrix<FL>(svds[iq].first[1].data(),
                         // szm, szr) << endl;
                     }
+                }
+                s_kepts[iq] = s_kept;
+            });
+            tsvd += _t2.get_time();
+            // truncation is done in the order of blocks
+            // so that the reductions do not depend on the number of threads
+            for (auto &mq : q_map) {
+                int iq = mq.second;
+                int szr = (int)nms[iq].second, szm;
+                int &s_kept = s_kepts[iq];
+                if (!(algo_type & MPOAlgorithmTypes::Bipartite) &&
+                    !(algo_type & (MPOAlgorithmTypes::NC |
+                                   MPOAlgorithmTypes::CN))) {
+                    szm = (int)svds[iq].second.size();
                     res_s_sum +=
                         accumulate(svds[iq].second.begin(),
                                    svds[iq].second.end(), (FP)0, plus<FP>());
@@ -807,7 +1181,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                         svds[iq].second.resize(s_kept);
                     } else
                         s_kept = szm;
-                    tsvd += _t2.get_time();
                 }
                 s_kept_total += s_kept;
                 nr_total += szr;
@@ -941,8 +1314,11 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             FP accurate_svd_error = (FP)0.0;
             if (compute_accurate_svd_error &&
                 (algo_type & MPOAlgorithmTypes::SVD)) {
-                for (auto &mq : q_map) {
-                    int iq = mq.second;
+                vector<FP> q_errors(q_map.size(), 0);
+                for (int iq = 0; iq < (int)q_map.size(); iq++)
+                    q_costs[iq] = (double)nms[iq].first * nms[iq].second *
+                                  svds[iq].second.size();
+                parallel_for_blocks(q_costs, false, [&](int iq) {
                     auto &nm = nms[iq];
                     auto &matvs = mats[iq];
                     int szl = (int)nm.first, szr = (int)nm.second,
@@ -960,7 +1336,6 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                     for (int i = 0; i < s_kept; i++)
                         smat[(size_t)i * s_kept + i] =
                             svds[iq].second[i] * res_factor;
-                    threading->activate_global_mkl();
                     if (s_kept > 0) {
                         GMatrixFunctions<FL>::multiply(
                             GMatrix<FL>(smat.data(), s_kept, s_kept), false,
@@ -976,11 +1351,12 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                     for (auto &lrv : matvs)
                         smat[(size_t)lrv.first.first * szr +
                              lrv.first.second] -= lrv.second;
-                    FP xnorm = GMatrixFunctions<FL>::norm(
+                    q_errors[iq] = GMatrixFunctions<FL>::norm(
                         GMatrix<FL>(smat.data(), szl, szr));
-                    accurate_svd_error += xnorm * xnorm;
-                    threading->activate_normal();
-                }
+                });
+                for (auto &mq : q_map)
+                    accurate_svd_error +=
+                        q_errors[mq.second] * q_errors[mq.second];
             }
             if (iprint) {
                 cout << "Mmpo = " << setw(5) << s_kept_total
@@ -995,6 +1371,12 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                 dw_max = max(dw_max, discarded_weights[ii]);
                 error_total += accurate_svd_error;
             }
+            // in minimal memory mode, release intermediates of all blocks
+            // as soon as they are no longer needed
+            if (frame_<FP>()->minimal_memory_usage &&
+                !(algo_type & MPOAlgorithmTypes::Bipartite))
+                for (auto &matvs : mats)
+                    vector<pair<pair<int, int>, FL>>().swap(matvs);
             // Part 3: construct mpo tensor
             shared_ptr<OperatorTensor<S, FL>> opt = tensors[ii];
             shared_ptr<Symbolic<S>> pmat;
@@ -1060,6 +1442,13 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                 else
                     opt->ops[site_op_names.at(xm.first)] = xm.second;
             }
+            if (record) {
+                site_records[ii].ops = opt->ops;
+                site_records[ii].ixx = ixx;
+                site_records[ii].offs.push_back(0);
+                if (frame_<FP>()->minimal_memory_usage)
+                    save_site_record(ii);
+            }
             int ppir = 0;
             for (int iq = 0; iq < (int)qs.size(); iq++) {
                 S qq = qs[iq];
@@ -1129,24 +1518,51 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                         rix[mvcs[iq][1][ixr]] = ixr + ixln;
                     vector<vector<shared_ptr<OpExpr<S>>>> tterms(
                         cur_terms.size() * szm);
-                    for (auto &lrv : matvs) {
+                    vector<vector<pair<int, LL>>> tsrcs(
+                        record ? tterms.size() : 0);
+                    for (size_t iv = 0; iv < matvs.size(); iv++) {
+                        auto &lrv = matvs[iv];
                         int il = lrv.first.first, ir = lrv.first.second, irx;
                         FL factor = 1;
+                        LL src = -1;
                         if (lix[il] == -2)
                             continue;
                         else if (lix[il] != -1)
                             irx = lix[il], lix[il] = -2;
-                        else
+                        else {
                             irx = rix[ir], factor = lrv.second;
+                            if (record)
+                                src = mat_srcs[iq][iv];
+                        }
                         int ip = lip[il];
-                        if (abs(factor) > cutoff && site_mp[il] != nullptr)
+                        if (abs(factor) > cutoff && site_mp[il] != nullptr) {
                             tterms[ip * szm + irx].push_back(
                                 site_mp[il]->scalar_multiply(factor));
+                            if (record)
+                                tsrcs[ip * szm + irx].push_back(
+                                    make_pair(il, src));
+                        } else if (record && site_mp[il] != nullptr &&
+                                   src != -1)
+                            ref_dropped.push_back(src);
                     }
                     for (LL vix = 0; vix < (int)tterms.size(); vix++)
-                        if (tterms[vix].size() != 0)
-                            mat[{(int)(vix / szm), ppir + (int)(vix % szm)}] =
-                                sum(tterms[vix]);
+                        if (tterms[vix].size() != 0) {
+                            shared_ptr<OpExpr<S>> &x =
+                                mat[{(int)(vix / szm),
+                                     ppir + (int)(vix % szm)}];
+                            x = sum(tterms[vix]);
+                            if (record) {
+                                GeneralMPOSiteRecord<S, FL> &rec =
+                                    site_records[ii];
+                                rec.idxs.push_back(
+                                    (size_t)(&x - mat.data.data()));
+                                for (auto &ts : tsrcs[vix]) {
+                                    rec.elems.push_back(site_mp[ts.first]);
+                                    rec.terms.push_back(ts.second);
+                                }
+                                rec.offs.push_back(rec.terms.size());
+                            }
+                        }
                 } else {
                     int rszm = (int)svds[iq].second.size();
                     for (int ir = 0; ir < rszm; ir++) {
@@ -1196,118 +1612,12 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                 nnz_total += mat.nnz();
                 size_total += mat.size();
             }
+            if (frame_<FP>()->minimal_memory_usage)
+                for (auto &mpl : map_ls)
+                    unordered_map<size_t, vector<pair<pair<int, LL>, int>>>()
+                        .swap(mpl);
             // Part 4: evaluate sum expressions
-            shared_ptr<VectorAllocator<FP>> d_alloc =
-                make_shared<VectorAllocator<FP>>();
-            for (size_t i = 0; i < mat.data.size(); i++) {
-                // only happens for non-sparse boundary tensors
-                if (mat.data[i]->get_type() == OpTypes::Zero)
-                    continue;
-                shared_ptr<OpSum<S, FL>> opx =
-                    dynamic_pointer_cast<OpSum<S, FL>>(mat.data[i]);
-                assert(opx->strings.size() != 0);
-                shared_ptr<SparseMatrix<S, FL>> xmat =
-                    opt->ops.at(opx->strings[0]->get_op());
-                if (opx->strings.size() == 1) {
-                    if (ii == 0 || ii == n_sites - 1) {
-                        shared_ptr<OpElement<S, FL>> opel =
-                            make_shared<OpElement<S, FL>>(
-                                ii == 0 ? OpNames::XL : OpNames::XR,
-                                SiteIndex({(uint16_t)(i / 1000),
-                                           (uint16_t)(i % 1000)},
-                                          {}),
-                                xmat->info->delta_quantum);
-                        mat.data[i] = opel;
-                        assert(opx->strings[0]->get_op()->q_label ==
-                               opel->q_label);
-                        if (opx->strings[0]->factor != (FL)1.0) {
-                            shared_ptr<SparseMatrix<S, FL>> gmat =
-                                make_shared<SparseMatrix<S, FL>>(nullptr);
-                            gmat->allocate(xmat->info, xmat->data);
-                            gmat->factor =
-                                xmat->factor * opx->strings[0]->factor;
-                            opt->ops[opel] = gmat;
-                        } else
-                            opt->ops[opel] = xmat;
-                    } else
-                        mat.data[i] =
-                            opx->strings[0]->get_op()->scalar_multiply(
-                                (FL)opx->strings[0]->factor);
-                } else {
-                    // for SU2 there will be multiple possible gmats
-                    // with different dq
-                    map<S, shared_ptr<SparseMatrix<S, FL>>> gmats;
-                    bool all_same_dq = true;
-                    for (auto &x : opx->strings) {
-                        shared_ptr<SparseMatrixInfo<S>> info =
-                            opt->ops.at(x->get_op())->info;
-                        if (!gmats.count(info->delta_quantum)) {
-                            shared_ptr<SparseMatrix<S, FL>> gmat =
-                                make_shared<SparseMatrix<S, FL>>(d_alloc);
-                            gmat->allocate(info);
-                            gmats[info->delta_quantum] = gmat;
-                        }
-                    }
-                    for (auto &x : opx->strings) {
-                        shared_ptr<SparseMatrix<S, FL>> mmat =
-                            opt->ops.at(x->get_op());
-                        shared_ptr<SparseMatrix<S, FL>> gmat =
-                            gmats.at(mmat->info->delta_quantum);
-                        hamil->opf->iadd(gmat, mmat, x->factor);
-                        if (hamil->opf->seq->mode != SeqTypes::None)
-                            hamil->opf->seq->simple_perform();
-                    }
-                    if (gmats.size() == 1) {
-                        shared_ptr<SparseMatrix<S, FL>> gmat =
-                            gmats.begin()->second;
-                        shared_ptr<OpElement<S, FL>> opel;
-                        if (ii == 0 || ii == n_sites - 1)
-                            opel = make_shared<OpElement<S, FL>>(
-                                ii == 0 ? OpNames::XL : OpNames::XR,
-                                SiteIndex({(uint16_t)(i / 1000),
-                                           (uint16_t)(i % 1000)},
-                                          {}),
-                                gmat->info->delta_quantum);
-                        else {
-                            opel = make_shared<OpElement<S, FL>>(
-                                OpNames::X,
-                                SiteIndex({(uint16_t)(ixx / 1000 / 1000),
-                                           (uint16_t)(ixx / 1000 % 1000),
-                                           (uint16_t)(ixx % 1000)},
-                                          {}),
-                                gmat->info->delta_quantum);
-                            ixx++;
-                        }
-                        mat.data[i] = opel;
-                        opt->ops[opel] = gmat;
-                        assert(opx->strings[0]->get_op()->q_label ==
-                               opel->q_label);
-                    } else {
-                        // for non-singlet Hamiltonian:
-                        // ii != 0 && ii != n_sites - 1 may not be satisfied
-                        // in fact for non singlet mps this is already supported
-                        // since with non-zero left_vac, the left_assign will be
-                        // replaced by left_contract which supports arbitrary
-                        // expressions
-                        vector<shared_ptr<OpExpr<S>>> opels;
-                        opels.reserve(gmats.size());
-                        for (auto &gmat : gmats) {
-                            shared_ptr<OpElement<S, FL>> opel =
-                                make_shared<OpElement<S, FL>>(
-                                    OpNames::X,
-                                    SiteIndex({(uint16_t)(ixx / 1000 / 1000),
-                                               (uint16_t)(ixx / 1000 % 1000),
-                                               (uint16_t)(ixx % 1000)},
-                                              {}),
-                                    gmat.second->info->delta_quantum);
-                            ixx++;
-                            opels.push_back(opel);
-                            opt->ops[opel] = gmat.second;
-                        }
-                        mat.data[i] = sum(opels);
-                    }
-                }
-            }
+            evaluate_sums(ii, opt, ixx);
             assert(ixx < 1000 * 1000 * 1000);
             // Part 5: left and right operator names
             shared_ptr<SymbolicRowVector<S>> plop;
@@ -1333,6 +1643,7 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             // Part 6: prepare for next
             vector<vector<FL>> new_cur_values(s_kept_total);
             vector<vector<pair<int, LL>>> new_cur_terms(s_kept_total);
+            vector<vector<LL>> new_cur_srcs(record ? s_kept_total : 0);
             int isk = 0;
             left_q.resize(s_kept_total);
             sparse_ranges.clear();
@@ -1376,12 +1687,15 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                         rix[ir] = ixr + ixln;
                         new_cur_terms[rix[ir] + isk].push_back(vct[ir]);
                         new_cur_values[rix[ir] + isk].push_back((FL)1.0);
+                        if (record)
+                            new_cur_srcs[rix[ir] + isk].push_back(-1);
                     }
                     for (int ir = 0; ir < rszm; ir++)
                         left_q[ir + isk] = qq;
                     // add edges with right vertex not in MVC
                     // and edges with both left and right vertices in MVC
-                    for (auto &lrv : matvs) {
+                    for (size_t iv = 0; iv < matvs.size(); iv++) {
+                        auto &lrv = matvs[iv];
                         int il = lrv.first.first, ir = lrv.first.second;
                         if (rix[ir] != -1 && lix[il] == -1)
                             continue;
@@ -1391,6 +1705,9 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                             continue;
                         new_cur_terms[lix[il] + isk].push_back(vct[ir]);
                         new_cur_values[lix[il] + isk].push_back(lrv.second);
+                        if (record)
+                            new_cur_srcs[lix[il] + isk].push_back(
+                                mat_srcs[iq][iv]);
                     }
                 } else {
                     rszm = (int)svds[iq].second.size();
@@ -1440,10 +1757,13 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             assert(isk == s_kept_total);
             cur_terms = new_cur_terms;
             cur_values = new_cur_values;
+            cur_srcs = new_cur_srcs;
             if (cur_terms.size() == 0) {
                 cur_terms.emplace_back();
                 cur_values.emplace_back();
             }
+            if (record && cur_srcs.size() == 0)
+                cur_srcs.emplace_back();
             // Part 7: sanity check
             for (auto &op : opt->ops)
                 assert((dynamic_pointer_cast<OpElement<S, FL>>(op.first)
@@ -1507,6 +1827,7 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
             }
             if (iprint) {
                 tsite = _t.get_time();
+                cout << fixed << setprecision(3) << " Tterm = " << tterm;
                 if (algo_type & MPOAlgorithmTypes::SVD)
                     cout << fixed << setprecision(3) << " Tsvd = " << tsvd;
                 else if (algo_type & MPOAlgorithmTypes::Bipartite)
@@ -1514,9 +1835,21 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                 cout << " T = " << tsite << endl;
                 tsite_total += tsite;
                 tsvd_total += tsvd;
+                tterm_total += tterm;
             }
             this->save_tensor(ii);
             this->unload_tensor(ii);
+            this->save_right_operators(ii);
+            this->unload_right_operators(ii);
+            // left operator names of the previous site are used in Part 7
+            if (ii != 0) {
+                this->save_left_operators(ii - 1);
+                this->unload_left_operators(ii - 1);
+            }
+        }
+        if (part_disk) {
+            part_fs.close();
+            Parsing::remove_file(part_filename);
         }
         if (n_terms != 0) {
             // end of loop; check last term is identity with cur_values = 1
@@ -1530,6 +1863,7 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
         if (iprint) {
             cout << "Ttotal = " << fixed << setprecision(3) << setw(10)
                  << tsite_total << fixed << setprecision(3);
+            cout << " Tterm-total = " << tterm_total;
             if (algo_type & MPOAlgorithmTypes::SVD)
                 cout << " Tsvd-total = " << tsvd_total;
             else if (algo_type & MPOAlgorithmTypes::Bipartite)
@@ -1548,14 +1882,145 @@ template <typename S, typename FL> struct GeneralMPO : MPO<S, FL> {
                  << (double)(size_total - nnz_total) / size_total << endl
                  << endl;
         }
-        for (int i = 0; i < (int)left_operator_names.size(); i++) {
-            this->save_left_operators(i);
-            this->unload_left_operators(i);
+        if (n_sites != 0) {
+            this->save_left_operators(n_sites - 1);
+            this->unload_left_operators(n_sites - 1);
+        }
+    }
+    string get_site_record_filename(int i) const {
+        return this->get_filename(i, 0) + ".REC";
+    }
+    // in minimal memory mode, the site operators of the record are stored in
+    // disk in the same format as the mpo tensors (without mpo matrices)
+    void save_site_record(int i) {
+        GeneralMPOSiteRecord<S, FL> &rec = site_records[i];
+        string filename = get_site_record_filename(i);
+        ofstream ofs(filename.c_str(), ios::binary);
+        if (!ofs.good())
+            throw runtime_error("GeneralMPO:save_site_record on '" +
+                                filename + "' failed.");
+        OperatorTensor<S, FL> opt;
+        opt.ops = rec.ops;
+        opt.save_data(ofs);
+        if (!ofs.good())
+            throw runtime_error("GeneralMPO:save_site_record on '" +
+                                filename + "' failed.");
+        ofs.close();
+        rec.ops.clear();
+        rec.ops_saved = true;
+    }
+    void load_site_record(int i) {
+        GeneralMPOSiteRecord<S, FL> &rec = site_records[i];
+        if (!rec.ops_saved)
+            return;
+        string filename = get_site_record_filename(i);
+        ifstream ifs(filename.c_str(), ios::binary);
+        if (!ifs.good())
+            throw runtime_error("GeneralMPO:load_site_record on '" +
+                                filename + "' failed.");
+        OperatorTensor<S, FL> opt;
+        opt.load_data(ifs);
+        if (ifs.fail() || ifs.bad())
+            throw runtime_error("GeneralMPO:load_site_record on '" +
+                                filename + "' failed.");
+        ifs.close();
+        rec.ops = opt.ops;
+    }
+    void unload_site_record(int i) {
+        if (site_records[i].ops_saved)
+            site_records[i].ops.clear();
+    }
+    // update the coefficients of the mpo for new integrals, reusing the bond
+    // structure of the recorded build (see updatable). The new terms must be
+    // the recorded terms (or a subset in the same order), and no sum
+    // expression may change its sparsity pattern due to the cutoff.
+    // Otherwise the mpo is built again and false is returned.
+    // Only the tensors of this object are updated, so an mpo created from it
+    // (for example, SimplifiedMPO) must be created again after update.
+    // An mpo stored in an archive file cannot be updated (the updated
+    // tensors could not be written back).
+    bool update(const shared_ptr<GeneralFCIDUMP<FL>> &new_afd) {
+        if (this->archive_filename != "" &&
+            !frame_<FP>()->minimal_memory_usage)
+            throw runtime_error(
+                "GeneralMPO::update: cannot update mpo in archive file '" +
+                this->archive_filename + "'.");
+        Timer _t;
+        _t.get_time();
+        bool ok = ref_afd != nullptr && (int)site_records.size() == n_sites &&
+                  new_afd->exprs == ref_afd->exprs;
+        // new coefficient for each recorded term (zero if missing)
+        vector<FL> vals;
+        LL n_terms = 0;
+        for (int ix = 0; ok && ix < (int)ref_afd->exprs.size(); ix++) {
+            const int nn = SpinPermRecoupling::count_cds(ref_afd->exprs[ix]);
+            const uint16_t *ridx = ref_afd->indices[ix].data();
+            const uint16_t *nidx = new_afd->indices[ix].data();
+            const size_t nt = new_afd->data[ix].size();
+            size_t jt = 0;
+            for (size_t it = 0; it < ref_afd->data[ix].size(); it++)
+                if (jt < nt && equal(nidx + jt * nn, nidx + (jt + 1) * nn,
+                                     ridx + it * nn))
+                    vals.push_back(new_afd->data[ix][jt++]);
+                else
+                    vals.push_back((FL)0.0);
+            ok = jt == nt;
+            n_terms += (LL)nt;
         }
-        for (int i = 0; i < (int)right_operator_names.size(); i++) {
-            this->save_right_operators(i);
-            this->unload_right_operators(i);
+        for (size_t i = 0; ok && i < ref_dropped.size(); i++)
+            ok = abs(vals[ref_dropped[i]]) <= cutoff;
+        for (int ii = 0; ok && ii < n_sites; ii++) {
+            const GeneralMPOSiteRecord<S, FL> &rec = site_records[ii];
+            for (size_t ie = 0; ok && ie < rec.idxs.size(); ie++) {
+                ok = false;
+                for (size_t is = rec.offs[ie]; !ok && is < rec.offs[ie + 1];
+                     is++)
+                    ok = rec.terms[is] == -1 ||
+                         abs(vals[rec.terms[is]]) > cutoff;
+            }
+        }
+        if (!ok) {
+            if (iprint)
+                cout << endl << "Update MPO | structure changed" << endl;
+            afd = new_afd;
+            left_vacuum = ref_left_vacuum;
+            discarded_weights.clear();
+            build();
+            return false;
+        }
+        for (int ii = 0; ii < n_sites; ii++) {
+            const GeneralMPOSiteRecord<S, FL> &rec = site_records[ii];
+            // the operators of the tensor are replaced by the recorded ones
+            this->load_tensor(ii, true);
+            load_site_record(ii);
+            shared_ptr<OperatorTensor<S, FL>> opt = tensors[ii];
+            Symbolic<S> &mat = *opt->lmat;
+            opt->ops = rec.ops;
+            for (size_t ie = 0; ie < rec.idxs.size(); ie++) {
+                vector<shared_ptr<OpExpr<S>>> tterms;
+                tterms.reserve(rec.offs[ie + 1] - rec.offs[ie]);
+                for (size_t is = rec.offs[ie]; is < rec.offs[ie + 1]; is++) {
+                    FL factor = rec.terms[is] == -1 ? (FL)1.0
+                                                    : vals[rec.terms[is]];
+                    if (abs(factor) > cutoff)
+                        tterms.push_back(rec.elems[is]->scalar_multiply(factor));
+                }
+                mat.data[rec.idxs[ie]] = sum(tterms);
+            }
+            LL ixx = rec.ixx;
+            evaluate_sums(ii, opt, ixx);
+            this->save_tensor(ii);
+            this->unload_tensor(ii);
+            unload_site_record(ii);
         }
+        MPO<S, FL>::const_e = new_afd->e();
+        afd = new_afd;
+        if (iprint)
+            cout << endl
+                 << "Update MPO | Nsites = " << setw(5) << n_sites
+                 << " | Nterms = " << setw(10) << n_terms << " | T = " << fixed
+                 << setprecision(3) << _t.get_time() << endl;
+        return true;
     }
     virtual ~GeneralMPO() = default;
 };
@@ -99,8 +99,8 @@ struct ComplexMixture<S, complex<FP>, FP> : ComplexMixture<S, FP, FP> {
     typedef complex<FP> FL;
     static shared_ptr<SparseMatrix<S, FL>>
     forward(shared_ptr<SparseMatrix<S, FP>> mat) {
-        shared_ptr<VectorAllocator<FP>> d_alloc =
-            make_shared<VectorAllocator<FP>>();
+        shared_ptr<ArenaAllocator<FP>> d_alloc =
+            make_shared<ArenaAllocator<FP>>();
         assert(mat->get_type() == SparseMatrixTypes::Normal);
         shared_ptr<SparseMatrix<S, FL>> cmat =
             make_shared<SparseMatrix<S, FL>>(d_alloc);
@@ -114,8 +114,8 @@ struct ComplexMixture<S, complex<FP>, FP> : ComplexMixture<S, FP, FP> {
     }
     static shared_ptr<SparseMatrixGroup<S, FL>>
     forward(shared_ptr<SparseMatrixGroup<S, FP>> wfn) {
-        shared_ptr<VectorAllocator<FP>> d_alloc =
-            make_shared<VectorAllocator<FP>>();
+        shared_ptr<ArenaAllocator<FP>> d_alloc =
+            make_shared<ArenaAllocator<FP>>();
         shared_ptr<SparseMatrixGroup<S, FL>> cwfn =
             make_shared<SparseMatrixGroup<S, FL>>(d_alloc);
         cwfn->allocate(wfn->infos);
@@ -130,8 +130,8 @@ struct ComplexMixture<S, complex<FP>, FP> : ComplexMixture<S, FP, FP> {
         vector<shared_ptr<SparseMatrixGroup<S, FL>>> cwfns(wfns.size() / 2,
                                                            nullptr);
         for (size_t i = 0; i < cwfns.size(); i++) {
-            shared_ptr<VectorAllocator<FP>> d_alloc =
-                make_shared<VectorAllocator<FP>>();
+            shared_ptr<ArenaAllocator<FP>> d_alloc =
+                make_shared<ArenaAllocator<FP>>();
             cwfns[i] = make_shared<SparseMatrixGroup<S, FL>>(d_alloc);
             cwfns[i]->allocate(wfns[i + i]->infos);
             GMatrixFunctions<FL>::fill_complex(
@@ -181,6 +181,9 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
     bool fused_contraction_multiplication = false;
     // whether numerical transform should be done with copy
     bool lowmem_numerical_transform = false;
+    // if not nullptr, ConnectionInfo tables for effective Hamiltonian are
+    // reused across sites and sweeps when the quanta structure repeats
+    shared_ptr<ConnectionInfoCache<S>> cinfo_cache = nullptr;
     double tctr = 0, trot = 0, tint = 0, tmid = 0, tdiag = 0, tdctr = 0,
            tinfo = 0;
     Timer _t, _t2, _t3;
@@ -225,6 +228,7 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
     // return <intmed memory, rotated renormalized op memory>
     pair<size_t, size_t> left_contract_rotate(int i,
                                               bool preserve_data = false) {
+        ProfileScope ps("MovingEnvironment::left_contract_rotate");
         mpo->load_left_operators(i - 1);
         mpo->load_tensor(i - 1);
         if (stacked_mpo != nullptr) {
@@ -426,12 +430,17 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
             new_left->deallocate();
         Partition<S, FL>::deallocate_op_infos_notrunc(left_op_infos_notrunc);
         if (save_environments) {
+            promote_partition_file(left_part_files, i);
             frame_<FP>()->save_data(1, get_left_partition_filename(i));
             left_part_files[i] = make_pair(get_left_partition_filename(i),
                                            renormal_mem * sizeof(FL));
             if (frame_<FP>()->fp_codec != nullptr)
                 left_part_files[i].second =
                     frame_<FPS>()->fp_codec->ncpsd_last * sizeof(FP);
+            else if (frame_<FP>()->lz_codec != nullptr)
+                left_part_files[i].second =
+                    frame_<FP>()->lz_codec->ncpsd_last;
+            spill_cold_partitions();
             if (save_partition_info) {
                 frame_<FP>()->activate(1);
                 envs[i]->save_data(true, get_left_partition_filename(i, true));
@@ -445,6 +454,7 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
     // return <intmed memory, rotated renormalized op memory>
     pair<size_t, size_t> right_contract_rotate(int i,
                                                bool preserve_data = false) {
+        ProfileScope ps("MovingEnvironment::right_contract_rotate");
         mpo->load_right_operators(i + dot);
         mpo->load_tensor(i + dot);
         if (stacked_mpo != nullptr) {
@@ -654,12 +664,17 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
             new_right->deallocate();
         Partition<S, FL>::deallocate_op_infos_notrunc(right_op_infos_notrunc);
         if (save_environments) {
+            promote_partition_file(right_part_files, i);
             frame_<FP>()->save_data(1, get_right_partition_filename(i));
             right_part_files[i] = make_pair(get_right_partition_filename(i),
                                             renormal_mem * sizeof(FL));
             if (frame_<FP>()->fp_codec != nullptr)
                 right_part_files[i].second =
                     frame_<FPS>()->fp_codec->ncpsd_last * sizeof(FP);
+            else if (frame_<FP>()->lz_codec != nullptr)
+                right_part_files[i].second =
+                    frame_<FP>()->lz_codec->ncpsd_last;
+            spill_cold_partitions();
             if (save_partition_info) {
                 frame_<FP>()->activate(1);
                 envs[i]->save_data(false,
@@ -854,12 +869,70 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
                 used += p.second.second;
         return used;
     }
+    // Move the partition files farthest from the sweep front from save_dir
+    // to alt_save_dir, until the used size of save_dir is within the quota.
+    // Files next to the sweep front are never moved.
+    void spill_cold_partitions() const {
+        if (!frame_<FP>()->tiered_scratch ||
+            frame_<FP>()->save_dir_quota == 0 ||
+            frame_<FP>()->alt_save_dir == "")
+            return;
+        const string xdir = frame_<FP>()->save_dir + "/";
+        size_t used = get_used_save_dir_size();
+        while (used > frame_<FP>()->save_dir_quota) {
+            pair<string, size_t> *cold = nullptr;
+            int cold_dist = dot;
+            for (auto &p : left_part_files)
+                if (p.second.first.rfind(xdir, 0) == 0 &&
+                    abs(center - p.first) > cold_dist)
+                    cold = &p.second, cold_dist = abs(center - p.first);
+            for (auto &p : right_part_files)
+                if (p.second.first.rfind(xdir, 0) == 0 &&
+                    abs(p.first - center) > cold_dist)
+                    cold = &p.second, cold_dist = abs(p.first - center);
+            if (cold == nullptr)
+                break;
+            cold->first = frame_<FP>()->spill_data(cold->first);
+            used -= cold->second;
+        }
+    }
+    // A partition file spilled to alt_save_dir that is saved again is near
+    // the sweep front, so the new contents are written to save_dir and
+    // the spilled copy is removed.
+    void promote_partition_file(map<int, pair<string, size_t>> &part_files,
+                                int i) const {
+        if (!frame_<FP>()->tiered_scratch || !part_files.count(i) ||
+            part_files.at(i).first.rfind(frame_<FP>()->save_dir + "/", 0) == 0)
+            return;
+        frame_<FP>()->remove_data(part_files.at(i).first);
+        part_files.erase(i);
+    }
+    // Hint the data frame to start reading the partition files needed by the
+    // next move_to and eff_ham in the sweep direction
+    void prefetch_partitions(bool forward) const {
+        if (forward) {
+            if (center != 0 && left_part_files.count(center))
+                frame_<FP>()->prefetch_data(
+                    get_left_partition_filename(center));
+            if (right_part_files.count(center + 1))
+                frame_<FP>()->prefetch_data(
+                    get_right_partition_filename(center + 1));
+        } else {
+            if (right_part_files.count(center))
+                frame_<FP>()->prefetch_data(
+                    get_right_partition_filename(center));
+            if (center - 1 != 0 && left_part_files.count(center - 1))
+                frame_<FP>()->prefetch_data(
+                    get_left_partition_filename(center - 1));
+        }
+    }
     string get_left_partition_filename(int i, bool info = false) const {
         stringstream ss;
         string xdir = frame_<FP>()->save_dir;
         if (!info && left_part_files.count(i))
             return left_part_files.at(i).first;
         else if (!info && frame_<FP>()->save_dir_quota != 0 &&
+                 !frame_<FP>()->tiered_scratch &&
                  get_used_save_dir_size() >= frame_<FP>()->save_dir_quota)
             xdir = frame_<FP>()->alt_save_dir;
         ss << xdir << "/" << frame_<FP>()->prefix_distri << ".PART."
@@ -872,6 +945,7 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
         if (!info && right_part_files.count(i))
             return right_part_files.at(i).first;
         else if (!info && frame_<FP>()->save_dir_quota != 0 &&
+                 !frame_<FP>()->tiered_scratch &&
                  get_used_save_dir_size() >= frame_<FP>()->save_dir_quota)
             xdir = frame_<FP>()->alt_save_dir;
         ss << xdir << "/" << frame_<FP>()->prefix_distri << ".PART."
@@ -2063,6 +2137,7 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
     eff_ham(FuseTypes fuse_type, bool forward, bool compute_diag,
             const shared_ptr<SparseMatrix<S, FLS>> &bra_wfn,
             const shared_ptr<SparseMatrix<S, FLS>> &ket_wfn) {
+        ProfileScope ps("MovingEnvironment::eff_ham");
         // for level shift projection, we can have mixed multibra + single ket
         // assert(!(bra->get_type() & MPSTypes::MultiWfn));
         assert(!(ket->get_type() & MPSTypes::MultiWfn));
@@ -2190,19 +2265,23 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
         shared_ptr<EffectiveHamiltonian<S, FL>> efh =
             make_shared<EffectiveHamiltonian<S, FL>>(
                 left_op_infos, right_op_infos, op, fbw, fkw, mpo->op, hops,
-                mpo->left_vacuum, mpo->tf, compute_diag, mpo->npdm_scheme);
+                mpo->left_vacuum, mpo->tf, compute_diag, mpo->npdm_scheme,
+                cinfo_cache);
         efh->npdm_fragment_filename = get_npdm_fragment_filename(iM);
         efh->npdm_n_sites = n_sites;
         efh->npdm_center = iM;
         efh->npdm_parallel_center = mpo->npdm_parallel_center;
         tdiag += _t2.get_time();
         frame_<FP>()->update_peak_used_memory();
+        if (save_environments)
+            prefetch_partitions(forward);
         return efh;
     }
     // Generate effective hamiltonian at current center site
     // for MultiMPS case
     shared_ptr<EffectiveHamiltonian<S, FL, MultiMPS<S, FL>>>
     multi_eff_ham(FuseTypes fuse_type, bool forward, bool compute_diag) {
+        ProfileScope ps("MovingEnvironment::multi_eff_ham");
         assert(bra->get_type() & MPSTypes::MultiWfn);
         assert(ket->get_type() & MPSTypes::MultiWfn);
         const bool delay_left = center <= fuse_center;
@@ -2333,13 +2412,16 @@ template <typename S, typename FL, typename FLS> struct MovingEnvironment {
         shared_ptr<EffectiveHamiltonian<S, FL, MultiMPS<S, FL>>> efh =
             make_shared<EffectiveHamiltonian<S, FL, MultiMPS<S, FL>>>(
                 left_op_infos, right_op_infos, op, fbw, fkw, mpo->op, hops,
-                mpo->left_vacuum, mpo->tf, compute_diag, mpo->npdm_scheme);
+                mpo->left_vacuum, mpo->tf, compute_diag, mpo->npdm_scheme,
+                cinfo_cache);
         efh->npdm_fragment_filename = get_npdm_fragment_filename(iM);
         efh->npdm_n_sites = n_sites;
         efh->npdm_center = iM;
         efh->npdm_parallel_center = mpo->npdm_parallel_center;
         tdiag += _t2.get_time();
         frame_<FP>()->update_peak_used_memory();
+        if (save_environments)
+            prefetch_partitions(forward);
         return efh;
     }
     // Absorb wfn matrix into adjacent MPS tensor in one-site algorithm
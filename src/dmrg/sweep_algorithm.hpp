@@ -96,6 +96,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
     int isweep = 0;
     int davidson_max_iter = 5000;
     int davidson_soft_max_iter = -1;
+    // single precision [H_eff] x [ket] in Davidson (see EffectiveHamiltonian)
+    bool davidson_mixed_precision = false;
     FPS davidson_shift = 0.0;
     DavidsonTypes davidson_type = DavidsonTypes::Normal;
     int conn_adjust_step = 2;
@@ -125,6 +127,9 @@ template <typename S, typename FL, typename FLS> struct DMRG {
     // store all wfn singular values (for analysis) at each site
     bool store_wfn_spectra = false;
     bool store_seq_data = false;
+    // store batched DGEMM in one multiplication at each site
+    // (for replaying with gemm_replay)
+    bool store_gemm_trace = false;
     vector<vector<FPS>> sweep_wfn_spectra;
     vector<FPS> wfn_spectra;
     int sweep_start_site = 0;
@@ -758,6 +763,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
             fuse_left ? FuseTypes::FuseL : FuseTypes::FuseR, forward, true,
             me->bra->tensors[i], me->ket->tensors[i]);
         h_eff->eff_kernel = eff_kernel;
+        h_eff->mixed_precision = davidson_mixed_precision;
         if (context_ket != nullptr)
             h_eff->context_mask =
                 MovingEnvironment<S, FL, FLS>::symm_context_convert(
@@ -770,6 +776,13 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                << Parsing::to_string(isweep) << "." << Parsing::to_string(i);
             h_eff->seq_filename = ss.str();
         }
+        if (store_gemm_trace) {
+            stringstream ss;
+            ss << frame_<FP>()->save_dir << "/" << frame_<FP>()->prefix_distri
+               << ".GEMM." << me->tag << (forward ? ".FORW." : ".BACKW.")
+               << Parsing::to_string(isweep) << "." << Parsing::to_string(i);
+            h_eff->trace_filename = ss.str();
+        }
         size_t current_eff_ham_size =
             metric_me == nullptr
                 ? h_eff->op->get_total_memory()
@@ -783,6 +796,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
         callback_()->compute("DMRG::sweep::iter.eff_ham", iprint);
         current_eff_ham = nullptr;
         teff += _t.get_time();
+        ProfileScope ps("DMRG::eigs");
         pdi = h_eff->eigs(m_eff, iprint >= 3, davidson_conv_thrd,
                           davidson_rel_conv_thrd, davidson_max_iter,
                           davidson_soft_max_iter, davidson_def_min_size,
@@ -790,6 +804,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                           davidson_shift - xreal<FL>((FL)me->mpo->const_e),
                           me->para_rule, ortho_bra, projection_weights);
         teig += _t.get_time();
+        ps.nflop = get<2>(pdi);
+        ps.end();
         current_eff_ham = h_eff;
         callback_()->compute("DMRG::sweep::iter.eff_ham.end", iprint);
         current_eff_ham = nullptr;
@@ -1212,6 +1228,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
             me->eff_ham(FuseTypes::FuseLR, forward, true, me->bra->tensors[i],
                         me->ket->tensors[i]);
         h_eff->eff_kernel = eff_kernel;
+        h_eff->mixed_precision = davidson_mixed_precision;
         if (context_ket != nullptr)
             h_eff->context_mask =
                 MovingEnvironment<S, FL, FLS>::symm_context_convert(
@@ -1223,6 +1240,13 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                << Parsing::to_string(isweep) << "." << Parsing::to_string(i);
             h_eff->seq_filename = ss.str();
         }
+        if (store_gemm_trace) {
+            stringstream ss;
+            ss << frame_<FP>()->save_dir << "/" << frame_<FP>()->prefix_distri
+               << ".GEMM." << me->tag << (forward ? ".FORW." : ".BACKW.")
+               << Parsing::to_string(isweep) << "." << Parsing::to_string(i);
+            h_eff->trace_filename = ss.str();
+        }
         size_t current_eff_ham_size =
             metric_me == nullptr
                 ? h_eff->op->get_total_memory()
@@ -1236,6 +1260,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
         callback_()->compute("DMRG::sweep::iter.eff_ham", iprint);
         current_eff_ham = nullptr;
         teff += _t.get_time();
+        ProfileScope ps("DMRG::eigs");
         pdi = h_eff->eigs(m_eff, iprint >= 3, davidson_conv_thrd,
                           davidson_rel_conv_thrd, davidson_max_iter,
                           davidson_soft_max_iter, davidson_def_min_size,
@@ -1243,6 +1268,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                           davidson_shift - xreal<FL>((FL)me->mpo->const_e),
                           me->para_rule, ortho_bra, projection_weights);
         teig += _t.get_time();
+        ps.nflop = get<2>(pdi);
+        ps.end();
         current_eff_ham = h_eff;
         callback_()->compute("DMRG::sweep::iter.eff_ham.end", iprint);
         current_eff_ham = nullptr;
@@ -1908,6 +1935,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
         callback_()->compute("DMRG::sweep::iter.eff_ham", iprint);
         current_multi_eff_ham = nullptr;
         teff += _t.get_time();
+        ProfileScope ps("DMRG::eigs");
         if (x_eff != nullptr)
             pdi = EffectiveFunctions<S, FL>::eigs_mixed(
                 h_eff, x_eff, iprint >= 3, davidson_conv_thrd,
@@ -1937,6 +1965,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                 mps_quanta[i] = SparseMatrixGroup<S, FLS>::merge_delta_quanta(
                     mps_quanta[i + i], mps_quanta[i + i + 1]);
         teig += _t.get_time();
+        ps.nflop = get<2>(pdi);
+        ps.end();
         current_multi_eff_ham = h_eff;
         callback_()->compute("DMRG::sweep::iter.eff_ham.end", iprint);
         current_multi_eff_ham = nullptr;
@@ -2441,6 +2471,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
         callback_()->compute("DMRG::sweep::iter.eff_ham", iprint);
         current_multi_eff_ham = nullptr;
         teff += _t.get_time();
+        ProfileScope ps("DMRG::eigs");
         if (x_eff != nullptr)
             pdi = EffectiveFunctions<S, FL>::eigs_mixed(
                 h_eff, x_eff, iprint >= 3, davidson_conv_thrd,
@@ -2470,6 +2501,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                 mps_quanta[i] = SparseMatrixGroup<S, FLS>::merge_delta_quanta(
                     mps_quanta[i + i], mps_quanta[i + i + 1]);
         teig += _t.get_time();
+        ps.nflop = get<2>(pdi);
+        ps.end();
         current_multi_eff_ham = h_eff;
         callback_()->compute("DMRG::sweep::iter.eff_ham.end", iprint);
         current_multi_eff_ham = nullptr;
@@ -2490,6 +2523,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
     }
     virtual Iteration blocking(int i, bool forward, ubond_t bond_dim, FPS noise,
                                FPS davidson_conv_thrd) {
+        profiler_()->site = i;
+        ProfileScope ps("DMRG::blocking"), psm("DMRG::move_to");
         _t2.get_time();
         me->move_to(i);
         for (auto &xme : ext_mes)
@@ -2501,6 +2536,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
         if (context_ket != nullptr)
             context_ket->center = me->ket->center;
         tmve += _t2.get_time();
+        psm.end();
         assert(me->dot == 1 || me->dot == 2);
         Iteration it(vector<FPLS>(), 0, 0, 0);
         // use site dependent bond dims
@@ -2556,6 +2592,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
         frame_<FPS>()->fpwrite = frame_<FPS>()->fpread = 0;
         if (frame_<FPS>()->fp_codec != nullptr)
             frame_<FPS>()->fp_codec->ndata = frame_<FPS>()->fp_codec->ncpsd = 0;
+        if (me->mpo->tf->opf->seq->tuner != nullptr)
+            me->mpo->tf->opf->seq->tuner->clear();
         if (me->para_rule != nullptr && iprint >= 2) {
             me->para_rule->comm->tcomm = 0;
             me->para_rule->comm->tidle = 0;
@@ -3064,6 +3102,8 @@ template <typename S, typename FL, typename FLS> struct DMRG {
         Timer start, current;
         start.get_time();
         current.get_time();
+        if (me->para_rule != nullptr)
+            profiler_()->rank = me->para_rule->comm->rank;
         energies.resize(sweep_start, vector<FPLS>(1, (FPLS)(FPS)0.0));
         discarded_weights.resize(sweep_start);
         mps_quanta.resize(sweep_start);
@@ -3088,6 +3128,7 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                                       davidson_conv_thrds[iw])
                     : sweep(forward, bond_dims[iw], noises[iw],
                             davidson_conv_thrds[iw]);
+            profiler_()->write_sweep_trace(iw);
             energies.push_back(get<0>(sweep_results));
             discarded_weights.push_back(get<1>(sweep_results));
             mps_quanta.push_back(get<2>(sweep_results));
@@ -3204,6 +3245,15 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                         sout << " | quota-used = "
                              << Parsing::to_size_string(
                                     me->get_used_save_dir_size());
+                    if (frame_<FPS>()->scratch_cache_size != 0)
+                        sout << " | cache-hit = "
+                             << frame_<FPS>()->n_cache_hits
+                             << " | cache-miss = "
+                             << frame_<FPS>()->n_cache_misses
+                             << " | cache-evict = "
+                             << frame_<FPS>()->n_cache_evictions;
+                    if (frame_<FPS>()->tiered_scratch)
+                        sout << " | spills = " << frame_<FPS>()->n_spills;
                     sout << " | Tasync = " << frame_<FPS>()->tasync << endl;
                     sout << " | Trot = " << me->trot << " | Tctr = " << me->tctr
                          << " | Tint = " << me->tint << " | Tmid = " << me->tmid
@@ -3216,6 +3266,9 @@ template <typename S, typename FL, typename FLS> struct DMRG {
                          << " | Tsplt = " << tsplt << " | Tsvd = " << tsvd
                          << " | Torth = " << torth;
                     sout << endl;
+                    if (me->mpo->tf->opf->seq->tuner != nullptr)
+                        sout << " AUTOTUNE :" << endl
+                             << *me->mpo->tf->opf->seq->tuner;
                     cout << sout.rdbuf();
                     if (para_mps != nullptr && para_mps->rule != nullptr) {
                         para_mps->disable_parallel_writing();
@@ -3322,6 +3375,24 @@ template <typename S, typename FL, typename FLS> struct Linear {
     // First entry also used for "S" in IDR(S). Second entry will then be
     // ignored
     pair<int, int> linear_solver_params = make_pair(40, -1);
+    // if true, the GCROT(m, k) subspace (the harmonic Ritz vectors for
+    // deflated CG, or the latest solutions for CG, MINRES, LSQR and IDR(S))
+    // is reused between frequencies solved at the same site
+    // (not used by Cheby)
+    bool linear_recycle = false;
+    // if true (and linear_recycle), for the two-site algorithm without
+    // para_rule, the recycled vectors are also transformed to the next site
+    // in the same way as the bra wavefunction. Each transformed vector costs
+    // one extra multiplication at the next site, which is usually not paid
+    // back when the initial guess from the previous site is already good
+    bool linear_recycle_next_site = false;
+    // max number of latest solutions kept for solvers without a subspace,
+    // and max number of vectors transformed to the next site
+    int linear_recycle_size = 4;
+    shared_ptr<KrylovRecycleSpace<FCS>> gf_recycle = nullptr;
+    shared_ptr<KrylovRecycleSpace<FLS>> real_recycle = nullptr;
+    // recycled vectors transformed to the next site
+    vector<shared_ptr<SparseMatrix<S, FLS>>> recycle_wfns;
     // weight for mixing rhs wavefunction in density matrix/svd
     FPS right_weight = 0.0;
     // only useful when target contains some other
@@ -3416,6 +3487,140 @@ template <typename S, typename FL, typename FLS> struct Linear {
             return os;
         }
     };
+    void clear_recycle_wfns() {
+        for (int k = (int)recycle_wfns.size() - 1; k >= 0; k--) {
+            recycle_wfns[k]->deallocate();
+            recycle_wfns[k]->info->deallocate();
+        }
+        recycle_wfns.clear();
+    }
+    // Reset the recycle spaces before the solves at a site, then fill them
+    // with the vectors transformed from the previous site (if any)
+    // info: the bra wavefunction info at this site
+    void load_recycle(const shared_ptr<SparseMatrixInfo<S>> &info) {
+        if (gf_recycle == nullptr)
+            gf_recycle = make_shared<KrylovRecycleSpace<FCS>>();
+        if (real_recycle == nullptr)
+            real_recycle = make_shared<KrylovRecycleSpace<FLS>>();
+        gf_recycle->clear(), real_recycle->clear();
+        gf_recycle->max_nk = real_recycle->max_nk = linear_recycle_size;
+        if (recycle_wfns.size() != 0) {
+            if (eq_type == EquationTypes::GreensFunction)
+                recycle_from_wfns(gf_recycle, info);
+            else
+                recycle_from_wfns(real_recycle, info);
+        }
+        clear_recycle_wfns();
+    }
+    // us of the recycle space from recycle_wfns (one vector per real
+    // component when T is complex and FLS is real)
+    template <typename T>
+    void recycle_from_wfns(const shared_ptr<KrylovRecycleSpace<T>> &space,
+                           const shared_ptr<SparseMatrixInfo<S>> &info) {
+        const int nc = (int)(sizeof(T) / sizeof(FLS));
+        shared_ptr<SparseMatrix<S, FLS>> wfn =
+            make_shared<SparseMatrix<S, FLS>>(
+                make_shared<VectorAllocator<FPS>>());
+        wfn->allocate(info);
+        const size_t n = wfn->total_memory;
+        space->n = n, space->nk = (int)recycle_wfns.size() / nc;
+        space->us.resize(n * space->nk);
+        for (int ik = 0; ik < space->nk; ik++)
+            for (int ic = 0; ic < nc; ic++) {
+                const shared_ptr<SparseMatrix<S, FLS>> &xwfn =
+                    recycle_wfns[ik * nc + ic];
+                wfn->clear();
+                for (int k = 0, j; k < xwfn->info->n; k++)
+                    if ((j = info->find_state(xwfn->info->quanta[k])) != -1 &&
+                        info->n_states_bra[j] == xwfn->info->n_states_bra[k] &&
+                        info->n_states_ket[j] == xwfn->info->n_states_ket[k])
+                        GMatrixFunctions<FLS>::copy((*wfn)[j], (*xwfn)[k]);
+                FLS *pu = (FLS *)(space->us.data() + n * ik);
+                for (size_t j = 0; j < n; j++)
+                    pu[j * nc + ic] = wfn->data[j];
+            }
+        wfn->deallocate();
+    }
+    // Transform us of the recycle space at the two-site wavefunction (i, i +
+    // 1) to the next two-site wavefunction of the sweep (only the latest
+    // linear_recycle_size vectors, since each of them costs one
+    // multiplication at the next site)
+    // info: the bra wavefunction info at this site
+    template <typename T>
+    void recycle_to_wfns(int i, bool forward, const shared_ptr<MPS<S, FLS>> &mps,
+                         const shared_ptr<KrylovRecycleSpace<T>> &space,
+                         const shared_ptr<SparseMatrixInfo<S>> &info) {
+        const int nc = (int)(sizeof(T) / sizeof(FLS));
+        clear_recycle_wfns();
+        if (space == nullptr || !space->matches(info->get_total_memory()))
+            return;
+        shared_ptr<SparseMatrix<S, FLS>> wfn =
+            make_shared<SparseMatrix<S, FLS>>(
+                make_shared<VectorAllocator<FPS>>());
+        wfn->allocate(info);
+        const size_t n = wfn->total_memory;
+        for (int ik = max(space->nk - linear_recycle_size, 0); ik < space->nk;
+             ik++)
+            for (int ic = 0; ic < nc; ic++) {
+                FLS *pu = (FLS *)(space->us.data() + n * ik);
+                for (size_t j = 0; j < n; j++)
+                    wfn->data[j] = pu[j * nc + ic];
+                recycle_wfns.push_back(
+                    transform_two_dot_wfn(i, forward, mps, wfn));
+            }
+        wfn->deallocate();
+    }
+    // Transform a vector in the space of the two-site wavefunction (i, i + 1)
+    // to the two-site wavefunction at the next sweep position, using the
+    // split mps tensors i and i + 1 (the new left or right dims must be saved)
+    // The returned vector has a reduced info
+    shared_ptr<SparseMatrix<S, FLS>>
+    transform_two_dot_wfn(int i, bool forward,
+                          const shared_ptr<MPS<S, FLS>> &mps,
+                          const shared_ptr<SparseMatrix<S, FLS>> &wfn) const {
+        shared_ptr<VectorAllocator<uint32_t>> i_alloc =
+            make_shared<VectorAllocator<uint32_t>>();
+        shared_ptr<VectorAllocator<FPS>> d_alloc =
+            make_shared<VectorAllocator<FPS>>();
+        const shared_ptr<CG<S>> &cg = rme->mpo->tf->opf->cg;
+        // bond wavefunction: rot.H x wfn or wfn x rot.H
+        shared_ptr<SparseMatrix<S, FLS>> rot = mps->tensors[forward ? i : i + 1];
+        shared_ptr<SparseMatrix<S, FLS>> bwfn =
+            make_shared<SparseMatrix<S, FLS>>(d_alloc);
+        bwfn->allocate(mps->tensors[forward ? i + 1 : i]->info);
+        bwfn->contract_conj_rotation(wfn, rot, forward);
+        // same as propagate_wfn and contract_two_dot
+        const bool edge =
+            forward ? i + 1 == sweep_end_site - 1 : i == sweep_start_site;
+        const int j = forward ? i + 2 : i - 1;
+        shared_ptr<SparseMatrix<S, FLS>> xwfn = bwfn, xrot = rot;
+        if (!edge) {
+            xwfn = forward ? mps->info->swap_wfn_to_fused_left(i + 1, bwfn, cg)
+                           : mps->info->swap_wfn_to_fused_right(i, bwfn, cg);
+            mps->load_tensor(j);
+            xrot = mps->tensors[j];
+        }
+        shared_ptr<SparseMatrixInfo<S>> rinfo =
+            make_shared<SparseMatrixInfo<S>>(i_alloc);
+        shared_ptr<SparseMatrix<S, FLS>> rwfn =
+            make_shared<SparseMatrix<S, FLS>>(d_alloc);
+        if (forward == edge) {
+            rinfo->initialize_contract(xrot->info, xwfn->info);
+            rwfn->allocate(rinfo);
+            rwfn->contract(xrot, xwfn);
+        } else {
+            rinfo->initialize_contract(xwfn->info, xrot->info);
+            rwfn->allocate(rinfo);
+            rwfn->contract(xwfn, xrot);
+        }
+        if (!edge) {
+            mps->unload_tensor(j);
+            xwfn->info->deallocate();
+            xwfn->deallocate();
+        }
+        bwfn->deallocate();
+        return rwfn;
+    }
     Iteration update_one_dot(int i, bool forward, ubond_t bra_bond_dim,
                              ubond_t ket_bond_dim, FPS noise,
                              FPS linear_conv_thrd) {
@@ -3600,13 +3805,16 @@ template <typename S, typename FL, typename FLS> struct Linear {
             sweep_max_eff_wfn_size =
                 max(sweep_max_eff_wfn_size, l_eff->ket->total_memory);
             teff += _t.get_time();
+            // the one-site algorithm only reuses the space within this site
+            if (linear_recycle)
+                load_recycle(me->bra->tensors[i]->info);
             if (eq_type == EquationTypes::Normal) {
                 tuple<FLS, pair<int, int>, size_t, double> lpdi;
                 lpdi = l_eff->inverse_multiply(
                     lme->mpo->const_e, solver_type, linear_solver_params,
                     iprint >= 3, linear_conv_thrd, linear_rel_conv_thrd,
                     linear_max_iter, linear_soft_max_iter, me->para_rule,
-                    ortho_bra);
+                    ortho_bra, linear_recycle ? real_recycle : nullptr);
                 targets[0] = get<0>(lpdi);
                 get<1>(pdi).first += get<1>(lpdi).first;
                 get<1>(pdi).second += get<1>(lpdi).second;
@@ -3614,6 +3822,11 @@ template <typename S, typename FL, typename FLS> struct Linear {
             } else if (eq_type == EquationTypes::GreensFunction ||
                        eq_type == EquationTypes::GreensFunctionSquared) {
                 tuple<FCS, pair<int, int>, size_t, double> lpdi;
+                // Krylov subspace shared by all frequencies at this site
+                shared_ptr<KrylovRecycleSpace<FCS>> gf_recycle =
+                    linear_recycle ? this->gf_recycle : nullptr;
+                shared_ptr<KrylovRecycleSpace<FLS>> gfsq_recycle =
+                    linear_recycle ? real_recycle : nullptr;
                 if (gf_extra_omegas_at_site == i &&
                     gf_extra_omegas.size() != 0) {
                     gf_extra_targets.resize(gf_extra_omegas.size());
@@ -3637,7 +3850,7 @@ template <typename S, typename FL, typename FLS> struct Linear {
                                     iprint >= 3, linear_conv_thrd,
                                     linear_max_iter, linear_soft_max_iter,
                                     linear_def_min_size, linear_def_max_size,
-                                    me->para_rule);
+                                    me->para_rule, gfsq_recycle);
                         else
                             lpdi = EffectiveFunctions<S, FL>::greens_function(
                                 l_eff, lme->mpo->const_e, solver_type,
@@ -3646,7 +3859,8 @@ template <typename S, typename FL, typename FLS> struct Linear {
                                                          : gf_extra_eta,
                                 real_bra, linear_solver_params, iprint >= 3,
                                 linear_conv_thrd, linear_max_iter,
-                                linear_soft_max_iter, me->para_rule);
+                                linear_soft_max_iter, me->para_rule,
+                                gf_recycle);
                         if (tme != nullptr || ext_tmes.size() != 0) {
                             memcpy(extra_bras.data() +
                                        j * 2 * l_eff->bra->total_memory,
@@ -3679,13 +3893,13 @@ template <typename S, typename FL, typename FLS> struct Linear {
                         cg_n_harmonic_projection, iprint >= 3, linear_conv_thrd,
                         linear_max_iter, linear_soft_max_iter,
                         linear_def_min_size, linear_def_max_size,
-                        me->para_rule);
+                        me->para_rule, gfsq_recycle);
                 else
                     lpdi = EffectiveFunctions<S, FL>::greens_function(
                         l_eff, lme->mpo->const_e, solver_type, gf_omega, gf_eta,
                         real_bra, linear_solver_params, iprint >= 3,
                         linear_conv_thrd, linear_max_iter, linear_soft_max_iter,
-                        me->para_rule);
+                        me->para_rule, gf_recycle);
                 targets =
                     is_same<FLS, FCS>::value
                         ? vector<FLS>{(FLS &)get<0>(lpdi)}
@@ -4334,13 +4548,15 @@ template <typename S, typename FL, typename FLS> struct Linear {
             sweep_max_eff_wfn_size =
                 max(sweep_max_eff_wfn_size, l_eff->ket->total_memory);
             teff += _t.get_time();
+            if (linear_recycle)
+                load_recycle(me->bra->tensors[i]->info);
             if (eq_type == EquationTypes::Normal) {
                 tuple<FLS, pair<int, int>, size_t, double> lpdi;
                 lpdi = l_eff->inverse_multiply(
                     lme->mpo->const_e, solver_type, linear_solver_params,
                     iprint >= 3, linear_conv_thrd, linear_rel_conv_thrd,
                     linear_max_iter, linear_soft_max_iter, me->para_rule,
-                    ortho_bra);
+                    ortho_bra, linear_recycle ? real_recycle : nullptr);
                 targets[0] = get<0>(lpdi);
                 get<1>(pdi).first += get<1>(lpdi).first;
                 get<1>(pdi).second += get<1>(lpdi).second;
@@ -4348,6 +4564,11 @@ template <typename S, typename FL, typename FLS> struct Linear {
             } else if (eq_type == EquationTypes::GreensFunction ||
                        eq_type == EquationTypes::GreensFunctionSquared) {
                 tuple<FCS, pair<int, int>, size_t, double> lpdi;
+                // Krylov subspace shared by all frequencies at this site
+                shared_ptr<KrylovRecycleSpace<FCS>> gf_recycle =
+                    linear_recycle ? this->gf_recycle : nullptr;
+                shared_ptr<KrylovRecycleSpace<FLS>> gfsq_recycle =
+                    linear_recycle ? real_recycle : nullptr;
                 if (gf_extra_omegas_at_site == i &&
                     gf_extra_omegas.size() != 0) {
                     gf_extra_targets.resize(gf_extra_omegas.size());
@@ -4371,7 +4592,7 @@ template <typename S, typename FL, typename FLS> struct Linear {
                                     iprint >= 3, linear_conv_thrd,
                                     linear_max_iter, linear_soft_max_iter,
                                     linear_def_min_size, linear_def_max_size,
-                                    me->para_rule);
+                                    me->para_rule, gfsq_recycle);
                         else
                             lpdi = EffectiveFunctions<S, FL>::greens_function(
                                 l_eff, lme->mpo->const_e, solver_type,
@@ -4380,7 +4601,8 @@ template <typename S, typename FL, typename FLS> struct Linear {
                                                          : gf_extra_eta,
                                 real_bra, linear_solver_params, iprint >= 3,
                                 linear_conv_thrd, linear_max_iter,
-                                linear_soft_max_iter, me->para_rule);
+                                linear_soft_max_iter, me->para_rule,
+                                gf_recycle);
                         if (tme != nullptr || ext_tmes.size() != 0) {
                             memcpy(extra_bras.data() +
                                        j * 2 * l_eff->bra->total_memory,
@@ -4413,13 +4635,13 @@ template <typename S, typename FL, typename FLS> struct Linear {
                         cg_n_harmonic_projection, iprint >= 3, linear_conv_thrd,
                         linear_max_iter, linear_soft_max_iter,
                         linear_def_min_size, linear_def_max_size,
-                        me->para_rule);
+                        me->para_rule, gfsq_recycle);
                 else
                     lpdi = EffectiveFunctions<S, FL>::greens_function(
                         l_eff, lme->mpo->const_e, solver_type, gf_omega, gf_eta,
                         real_bra, linear_solver_params, iprint >= 3,
                         linear_conv_thrd, linear_max_iter, linear_soft_max_iter,
-                        me->para_rule);
+                        me->para_rule, gf_recycle);
                 targets =
                     is_same<FLS, FCS>::value
                         ? vector<FLS>{(FLS &)get<0>(lpdi)}
@@ -4749,6 +4971,15 @@ template <typename S, typename FL, typename FLS> struct Linear {
                         max(mps->info->bond_dim, (ubond_t)bra_mmps);
                 }
                 info->deallocate();
+                if (mps == me->bra && linear_recycle &&
+                    linear_recycle_next_site && me->para_rule == nullptr) {
+                    if (eq_type == EquationTypes::GreensFunction)
+                        recycle_to_wfns(i, forward, mps, gf_recycle,
+                                        old_wfn->info);
+                    else
+                        recycle_to_wfns(i, forward, mps, real_recycle,
+                                        old_wfn->info);
+                }
                 mps->save_tensor(i + 1);
                 mps->save_tensor(i);
                 mps->unload_tensor(i + 1);
@@ -4805,6 +5036,8 @@ template <typename S, typename FL, typename FLS> struct Linear {
     virtual Iteration blocking(int i, bool forward, ubond_t bra_bond_dim,
                                ubond_t ket_bond_dim, FPS noise,
                                FPS linear_conv_thrd) {
+        profiler_()->site = i;
+        ProfileScope ps("Linear::blocking"), psm("Linear::move_to");
         _t2.get_time();
         rme->move_to(i);
         if (lme != nullptr)
@@ -4816,6 +5049,7 @@ template <typename S, typename FL, typename FLS> struct Linear {
         for (auto &xme : ext_mes)
             xme->move_to(i);
         tmve += _t2.get_time();
+        psm.end();
         Iteration it(vector<FLS>(), 0, 0, 0, 0);
         if (rme->dot == 2)
             it = update_two_dot(i, forward, bra_bond_dim, ket_bond_dim, noise,
@@ -5069,8 +5303,11 @@ template <typename S, typename FL, typename FLS> struct Linear {
         Timer start, current;
         start.get_time();
         current.get_time();
+        if (rme->para_rule != nullptr)
+            profiler_()->rank = rme->para_rule->comm->rank;
         targets.clear();
         discarded_weights.clear();
+        clear_recycle_wfns();
         bool converged;
         FLS target_difference;
         if (iprint >= 1)
@@ -5092,6 +5329,7 @@ template <typename S, typename FL, typename FLS> struct Linear {
             auto sweep_results =
                 sweep(forward, bra_bond_dims[iw], ket_bond_dims[iw], noises[iw],
                       linear_conv_thrds[iw]);
+            profiler_()->write_sweep_trace(iw);
             targets.push_back(get<0>(sweep_results));
             discarded_weights.push_back(get<1>(sweep_results));
             if (targets.size() >= 2)
@@ -5201,6 +5439,15 @@ template <typename S, typename FL, typename FLS> struct Linear {
                         cout << " | quota-used = "
                              << Parsing::to_size_string(
                                     lme->get_used_save_dir_size());
+                    if (frame_<FPS>()->scratch_cache_size != 0)
+                        cout << " | cache-hit = "
+                             << frame_<FPS>()->n_cache_hits
+                             << " | cache-miss = "
+                             << frame_<FPS>()->n_cache_misses
+                             << " | cache-evict = "
+                             << frame_<FPS>()->n_cache_evictions;
+                    if (frame_<FPS>()->tiered_scratch)
+                        cout << " | spills = " << frame_<FPS>()->n_spills;
                     cout << " | Tasync = " << frame_<FPS>()->tasync << endl;
                     if (lme != nullptr)
                         cout << " | Trot = " << lme->trot
@@ -6530,6 +6777,15 @@ struct Expect {
                     cout << " | quota-used = "
                          << Parsing::to_size_string(
                                 me->get_used_save_dir_size());
+                if (frame_<FPS>()->scratch_cache_size != 0)
+                    cout << " | cache-hit = "
+                         << frame_<FPS>()->n_cache_hits
+                         << " | cache-miss = "
+                         << frame_<FPS>()->n_cache_misses
+                         << " | cache-evict = "
+                         << frame_<FPS>()->n_cache_evictions;
+                if (frame_<FPS>()->tiered_scratch)
+                    cout << " | spills = " << frame_<FPS>()->n_spills;
                 cout << " | Tasync = " << frame_<FPS>()->tasync << endl;
                 if (me != nullptr)
                     cout << " | Trot = " << me->trot << " | Tctr = " << me->tctr
@@ -0,0 +1,80 @@
+
+/*
+ * block2: Efficient MPO implementation of quantum chemistry DMRG
+ * Copyright (C) 2020-2021 Huanchen Zhai <hczhai@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Convert FCIDUMP text files to binary integral files, which can be read
+// (and memory-mapped) by FCIDUMP::read and CompressedFCIDUMP::read.
+
+#include "block2_core.hpp"
+
+using namespace std;
+using namespace block2;
+
+void usage() {
+    cout << "usage : block2_fcidump_convert [options] <FCIDUMP> <output>"
+         << endl;
+    cout << "  -p PREC     compress integrals using FPCodec with precision "
+            "PREC (default: 0, no compression)"
+         << endl;
+    cout << "  -b BATCH    number of lines parsed at one time (default: "
+            "1048576)"
+         << endl;
+    cout << "  -c          store complex integrals" << endl;
+    abort();
+}
+
+int main(int argc, char *argv[]) {
+
+    double prec = 0;
+    size_t batch_size = (size_t)1 << 20;
+    bool cpx = false;
+    vector<string> filenames;
+    for (int i = 1; i < argc; i++) {
+        const string x = argv[i];
+        if (x == "-c")
+            cpx = true;
+        else if (x.length() == 2 && x[0] == '-') {
+            if (i + 1 >= argc)
+                usage();
+            string y = argv[++i];
+            if (x == "-p")
+                prec = Parsing::to_double(y);
+            else if (x == "-b")
+                batch_size = (size_t)Parsing::to_long_long(y);
+            else
+                usage();
+        } else
+            filenames.push_back(x);
+    }
+    if (filenames.size() != 2 || batch_size == 0)
+        usage();
+
+    Timer t;
+    t.get_time();
+    if (cpx)
+        FCIDUMP<complex<double>>::convert_to_binary(filenames[0], filenames[1],
+                                                    prec, batch_size);
+    else
+        FCIDUMP<double>::convert_to_binary(filenames[0], filenames[1], prec,
+                                           batch_size);
+    cout << "FCIDUMP = " << filenames[0] << " -> " << filenames[1]
+         << " T = " << fixed << setprecision(3) << t.get_time() << endl;
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+
+/*
+ * block2: Efficient MPO implementation of quantum chemistry DMRG
+ * Copyright (C) 2020-2021 Huanchen Zhai <hczhai@caltech.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Replay batched DGEMM traces written by DMRG::store_gemm_trace
+// (or EffectiveHamiltonian::trace_filename) and report GFLOP/S, for
+// comparing BLAS libraries, numbers of threads and SeqTypes offline.
+// The BLAS library is the one linked into this executable.
+
+#include "block2_core.hpp"
+
+using namespace std;
+using namespace block2;
+
+void usage() {
+    cout << "usage : block2_gemm_replay [options] <trace filename> ..." << endl;
+    cout << "  -m MODES    SeqTypes (none, simple, auto, tasked), comma "
+            "separated (default: mode used for capturing)"
+         << endl;
+    cout << "  -t THREADS  numbers of threads, comma separated (default: "
+            "OpenMP default)"
+         << endl;
+    cout << "  -p PARA     parallelism for non-tasked modes: quanta "
+            "(threaded batch) or blas (grouped batch, threaded BLAS) "
+            "(default: quanta)"
+         << endl;
+    cout << "  -s SIZES    Threading::small_gemm_size, comma separated "
+            "(default: 0,16; 0 for BLAS only)"
+         << endl;
+    cout << "  -r REPEAT   number of timed replays (default: 5)" << endl;
+    cout << "  -x MEM      number of elements in each of input and output "
+            "arenas (default: 16777216)"
+         << endl;
+    abort();
+}
+
+vector<int> read_ints(const string &x) {
+    vector<int> r;
+    for (auto &s : Parsing::split(x, ",", true))
+        r.push_back(Parsing::to_int(s));
+    return r;
+}
+
+SeqTypes read_mode(const string &x) {
+    string y = x;
+    Parsing::lower(Parsing::trim(y));
+    if (y == "none")
+        return SeqTypes::None;
+    else if (y == "simple")
+        return SeqTypes::Simple;
+    else if (y == "auto")
+        return SeqTypes::Auto;
+    else if (y == "tasked")
+        return SeqTypes::Tasked;
+    else if (y == "simpletasked")
+        return SeqTypes::SimpleTasked;
+    cout << "unknown mode : " << x << endl;
+    abort();
+}
+
+int main(int argc, char *argv[]) {
+
+    vector<SeqTypes> modes;
+    vector<int> n_threads, small_sizes = {0, 16};
+    bool para_blas = false;
+    int n_repeat = 5;
+    size_t max_mem = (size_t)1 << 24;
+    vector<string> filenames;
+    for (int i = 1; i < argc; i++) {
+        const string x = argv[i];
+        if (x.length() == 2 && x[0] == '-') {
+            if (i + 1 >= argc)
+                usage();
+            string y = argv[++i];
+            if (x == "-m")
+                for (auto &s : Parsing::split(y, ",", true))
+                    modes.push_back(read_mode(s));
+            else if (x == "-t")
+                n_threads = read_ints(y);
+            else if (x == "-p")
+                para_blas = Parsing::lower(y) == "blas";
+            else if (x == "-s")
+                small_sizes = read_ints(y);
+            else if (x == "-r")
+                n_repeat = Parsing::to_int(y);
+            else if (x == "-x")
+                max_mem = (size_t)Parsing::to_long_long(y);
+            else
+                usage();
+        } else
+            filenames.push_back(x);
+    }
+    if (filenames.size() == 0)
+        usage();
+    if (n_threads.size() == 0)
+        n_threads.push_back(Threading().n_threads_global);
+
+    for (auto &filename : filenames) {
+        BatchGEMMTrace trace;
+        trace.load_data(filename);
+        cout << "TRACE = " << filename << endl << trace;
+        const vector<SeqTypes> xmodes =
+            modes.size() == 0 ? vector<SeqTypes>{trace.mode} : modes;
+        for (int nt : n_threads) {
+            if (para_blas)
+                threading_() = make_shared<Threading>(
+                    ThreadingTypes::OperatorBatchedGEMM |
+                        ThreadingTypes::Global,
+                    nt, nt, nt);
+            else
+                threading_() = make_shared<Threading>(
+                    ThreadingTypes::OperatorQuantaBatchedGEMM |
+                        ThreadingTypes::Global,
+                    nt, nt, nt, 1);
+            for (int sz : small_sizes) {
+                threading_()->small_gemm_size = sz;
+                for (SeqTypes mode : xmodes) {
+                    // warm up
+                    trace.replay(mode, 1, max_mem);
+                    const double t = trace.replay(mode, n_repeat, max_mem);
+                    const double nflop = (double)trace.n_flop() * n_repeat;
+                    cout << " THREADS = " << setw(4) << nt
+                         << " SMALL = " << setw(4) << sz
+                         << " MODE = " << setw(4) << (int)mode
+                         << " PARA = " << (para_blas ? "blas  " : "quanta")
+                         << " T = " << fixed << setprecision(5) << setw(12)
+                         << t / n_repeat << " GFLOP/S = " << setprecision(3)
+                         << setw(10) << (t == 0 ? 0.0 : nflop / t / 1E9)
+                         << endl;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -38,6 +38,7 @@
 #include "../core/integral.hpp"
 #include "../core/integral_general.hpp"
 #include "../core/iterative_matrix_functions.hpp"
+#include "../core/lz_codec.hpp"
 #include "../core/matrix.hpp"
 #include "../core/matrix_functions.hpp"
 #include "../core/operator_functions.hpp"
@@ -45,7 +46,9 @@
 #include "../core/parallel_mpi.hpp"
 #include "../core/parallel_rule.hpp"
 #include "../core/parallel_tensor_functions.hpp"
+#include "../core/profiler.hpp"
 #include "../core/rule.hpp"
+#include "../core/small_gemm.hpp"
 #include "../core/sparse_matrix.hpp"
 #include "../core/state_info.hpp"
 #include "../core/symbolic.hpp"
@@ -61,6 +64,7 @@ extern template struct block2::VectorAllocator<uint32_t>;
 extern template struct block2::Allocator<double>;
 extern template struct block2::StackAllocator<double>;
 extern template struct block2::VectorAllocator<double>;
+extern template struct block2::ArenaAllocator<double>;
 extern template struct block2::TemporaryAllocator<double>;
 extern template struct block2::DataFrame<double>;
 
@@ -1053,6 +1057,7 @@ extern template struct block2::TensorFunctions<block2::SAny, complex<double>>;
 extern template struct block2::Allocator<float>;
 extern template struct block2::StackAllocator<float>;
 extern template struct block2::VectorAllocator<float>;
+extern template struct block2::ArenaAllocator<float>;
 extern template struct block2::TemporaryAllocator<float>;
 extern template struct block2::DataFrame<float>;
 
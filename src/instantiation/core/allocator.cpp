@@ -27,6 +27,7 @@ template struct block2::VectorAllocator<uint32_t>;
 template struct block2::Allocator<double>;
 template struct block2::StackAllocator<double>;
 template struct block2::VectorAllocator<double>;
+template struct block2::ArenaAllocator<double>;
 template struct block2::TemporaryAllocator<double>;
 template struct block2::DataFrame<double>;
 
@@ -47,6 +48,8 @@ shared_ptr<block2::CallbackKernel> _g_callback =
 
 shared_ptr<block2::Threading> _g_threading = make_shared<block2::Threading>();
 
+shared_ptr<block2::Profiler> _g_profiler = make_shared<block2::Profiler>();
+
 } // namespace block2
 
 #endif
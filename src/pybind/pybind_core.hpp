@@ -708,6 +708,7 @@ template <typename S> void bind_state_info(py::module &m, const string &name) {
         .def("deep_copy", &StateInfo<S>::deep_copy)
         .def("collect", &StateInfo<S>::collect,
              py::arg("target") = S(S::invalid))
+        .def("build_index", &StateInfo<S>::build_index)
         .def("find_state", &StateInfo<S>::find_state)
         .def_static("tensor_product_ref",
                     (StateInfo<S>(*)(const StateInfo<S> &, const StateInfo<S> &,
@@ -800,6 +801,7 @@ template <typename S> void bind_sparse(py::module &m) {
              &SparseMatrixInfo<S>::initialize_trans_contract)
         .def("initialize_contract", &SparseMatrixInfo<S>::initialize_contract)
         .def("initialize_dm", &SparseMatrixInfo<S>::initialize_dm)
+        .def("build_index", &SparseMatrixInfo<S>::build_index)
         .def("find_state", &SparseMatrixInfo<S>::find_state, py::arg("q"),
              py::arg("start") = 0)
         .def_property_readonly("total_memory",
@@ -816,6 +818,22 @@ template <typename S> void bind_sparse(py::module &m) {
             return ss.str();
         });
 
+    py::class_<ConnectionInfoCache<S>, shared_ptr<ConnectionInfoCache<S>>>(
+        m, "ConnectionInfoCache")
+        .def(py::init<>())
+        .def(py::init<size_t>(), py::arg("max_memory"))
+        .def_readwrite("max_memory", &ConnectionInfoCache<S>::max_memory)
+        .def_readonly("used_memory", &ConnectionInfoCache<S>::used_memory)
+        .def_readonly("n_hits", &ConnectionInfoCache<S>::n_hits)
+        .def_readonly("n_misses", &ConnectionInfoCache<S>::n_misses)
+        .def_readonly("n_evictions", &ConnectionInfoCache<S>::n_evictions)
+        .def("clear", &ConnectionInfoCache<S>::clear)
+        .def("__repr__", [](ConnectionInfoCache<S> *self) {
+            stringstream ss;
+            ss << *self;
+            return ss.str();
+        });
+
     py::bind_vector<vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>>>(
         m, "VectorPLMatInfo");
     py::bind_vector<vector<vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>>>>(
@@ -1723,6 +1741,11 @@ template <typename S = void> void bind_types(py::module &m) {
         .def(py::self & py::self)
         .def(py::self | py::self);
 
+    py::enum_<NUMATypes>(m, "NUMATypes", py::arithmetic())
+        .value("Nothing", NUMATypes::None)
+        .value("Interleave", NUMATypes::Interleave)
+        .value("Frames", NUMATypes::Frames);
+
     py::enum_<SeqTypes>(m, "SeqTypes", py::arithmetic())
         .value("Nothing", SeqTypes::None)
         .value("Simple", SeqTypes::Simple)
@@ -1750,6 +1773,9 @@ template <typename S = void> void bind_types(py::module &m) {
                DavidsonTypes::NonHermitianDavidsonPrecond)
         .value("LeftEigen", DavidsonTypes::LeftEigen)
         .value("ElementProj", DavidsonTypes::ElementProj)
+        .value("Block", DavidsonTypes::Block)
+        .value("Lanczos", DavidsonTypes::Lanczos)
+        .value("LOBPCG", DavidsonTypes::LOBPCG)
         .value("ExactNonHermitianLeftEigen",
                DavidsonTypes::ExactNonHermitianLeftEigen)
         .value("NonHermitianDavidsonPrecondLeftEigen",
@@ -1846,6 +1872,7 @@ template <typename S = void> void bind_io(py::module &m) {
 #ifdef _HAS_INTEL_MKL
         mkl_set_num_threads(n);
         mkl_set_dynamic(0);
+        Threading::mkl_threads_cache() = n;
         threading_()->n_threads_mkl = n;
         threading_()->type = threading_()->type | ThreadingTypes::BatchedGEMM;
 #else
@@ -1895,6 +1922,32 @@ template <typename S = void> void bind_io(py::module &m) {
         .def_readwrite("data", &VectorAllocator<uint32_t>::data)
         .def(py::init<>());
 
+    py::class_<ArenaStats, shared_ptr<ArenaStats>>(m, "ArenaStats")
+        .def(py::init<>())
+        .def_readonly("used", &ArenaStats::used)
+        .def_readonly("requested", &ArenaStats::requested)
+        .def_readonly("peak_used", &ArenaStats::peak_used)
+        .def_readonly("cached", &ArenaStats::cached)
+        .def_readonly("n_allocs", &ArenaStats::n_allocs)
+        .def_readonly("n_reuses", &ArenaStats::n_reuses)
+        .def("fragmentation", &ArenaStats::fragmentation)
+        .def("__repr__", [](ArenaStats *self) {
+            stringstream ss;
+            ss << *self;
+            return ss.str();
+        });
+
+    py::class_<LZCodec, shared_ptr<LZCodec>>(m, "LZCodec")
+        .def(py::init<>())
+        .def(py::init<size_t>())
+        .def(py::init<size_t, bool>())
+        .def_readwrite("ndata", &LZCodec::ndata)
+        .def_readwrite("ncpsd", &LZCodec::ncpsd)
+        .def_readwrite("ncpsd_last", &LZCodec::ncpsd_last)
+        .def_readwrite("chunk_size", &LZCodec::chunk_size)
+        .def_readwrite("n_parallel_chunks", &LZCodec::n_parallel_chunks)
+        .def_readwrite("shuffle", &LZCodec::shuffle);
+
     py::class_<StackAllocator<uint32_t>, shared_ptr<StackAllocator<uint32_t>>,
                Allocator<uint32_t>>(m, "IntStackAllocator")
         .def(py::init<>())
@@ -1904,6 +1957,42 @@ template <typename S = void> void bind_io(py::module &m) {
 
     struct Global {};
 
+    py::class_<ProfileStats, shared_ptr<ProfileStats>>(m, "ProfileStats")
+        .def(py::init<>())
+        .def_readonly("time", &ProfileStats::time)
+        .def_readonly("count", &ProfileStats::count)
+        .def_readonly("nflop", &ProfileStats::nflop)
+        .def("__repr__", [](ProfileStats *self) {
+            stringstream ss;
+            ss << *self;
+            return ss.str();
+        });
+
+    py::class_<Profiler, shared_ptr<Profiler>>(m, "Profiler")
+        .def(py::init<>())
+        .def_readwrite("enabled", &Profiler::enabled)
+        .def_readwrite("rank", &Profiler::rank)
+        .def_readwrite("site", &Profiler::site)
+        .def_readwrite("trace_prefix", &Profiler::trace_prefix)
+        .def("clear", &Profiler::clear)
+        .def("size", &Profiler::size)
+        .def(
+            "summary",
+            [](Profiler *self, int tid) {
+                py::dict r;
+                for (auto &st : self->summary(tid))
+                    r[py::str(st.first)] = st.second;
+                return r;
+            },
+            py::arg("tid") = -1)
+        .def("write_trace", &Profiler::write_trace)
+        .def("write_sweep_trace", &Profiler::write_sweep_trace)
+        .def("__repr__", [](Profiler *self) {
+            stringstream ss;
+            ss << *self;
+            return ss.str();
+        });
+
     py::class_<KuhnMunkres, shared_ptr<KuhnMunkres>>(m, "KuhnMunkres")
         .def(py::init([](const py::array_t<double> &cost) {
             assert(cost.ndim() == 2);
@@ -2074,6 +2163,27 @@ template <typename S = void> void bind_io(py::module &m) {
         .def_readwrite("n_threads_mkl", &Threading::n_threads_mkl)
         .def_readwrite("n_threads_global", &Threading::n_threads_global)
         .def_readwrite("n_levels", &Threading::n_levels)
+        .def_readwrite("numa_pinning", &Threading::numa_pinning)
+        .def_readwrite("work_stealing", &Threading::work_stealing)
+        .def_readwrite("cache_activation", &Threading::cache_activation)
+        .def_readwrite("small_gemm_size", &Threading::small_gemm_size)
+        .def_static("invalidate_cache", &Threading::invalidate_cache)
+        .def_static("n_library_calls",
+                    []() { return (size_t)Threading::n_library_calls(); })
+        .def_readonly("pinned_threads", &Threading::pinned_threads)
+        .def("get_socket_node",
+             [](Threading *self, int i) {
+                 return Threading::numa_topology().at(i).first;
+             })
+        .def("get_socket_cpus",
+             [](Threading *self, int i) {
+                 return Threading::numa_topology().at(i).second;
+             })
+        .def("get_n_sockets", &Threading::get_n_sockets)
+        .def("get_thread_socket", &Threading::get_thread_socket)
+        .def("get_current_socket", &Threading::get_current_socket)
+        .def("pin_operator_threads", &Threading::pin_operator_threads)
+        .def("unpin_threads", &Threading::unpin_threads)
         .def("openmp_available", &Threading::openmp_available)
         .def("mkl_available", &Threading::mkl_available)
         .def("tbb_available", &Threading::tbb_available)
@@ -2087,6 +2197,60 @@ template <typename S = void> void bind_io(py::module &m) {
             return ss.str();
         });
 
+    py::class_<BatchGEMMAutoTuner, shared_ptr<BatchGEMMAutoTuner>>(
+        m, "BatchGEMMAutoTuner")
+        .def(py::init<>())
+        .def_property(
+            "modes",
+            [](BatchGEMMAutoTuner *self) {
+                py::list r;
+                for (SeqTypes mode : self->modes)
+                    r.append(mode);
+                return r;
+            },
+            [](BatchGEMMAutoTuner *self, const py::list &modes) {
+                self->modes.clear();
+                for (auto mode : modes)
+                    self->modes.push_back(mode.cast<SeqTypes>());
+            })
+        .def_readwrite("n_trials", &BatchGEMMAutoTuner::n_trials)
+        .def_readwrite("n_expected", &BatchGEMMAutoTuner::n_expected)
+        .def_readwrite("tune_batch", &BatchGEMMAutoTuner::tune_batch)
+        .def_readwrite("n_batch_trials", &BatchGEMMAutoTuner::n_batch_trials)
+        .def_static("bucket", &BatchGEMMAutoTuner::bucket)
+        .def("has_mode", &BatchGEMMAutoTuner::has_mode)
+        .def("get_mode", &BatchGEMMAutoTuner::get_mode)
+        .def("clear", &BatchGEMMAutoTuner::clear)
+        .def("__repr__", [](BatchGEMMAutoTuner *self) {
+            stringstream ss;
+            ss << *self;
+            return ss.str();
+        });
+
+    py::class_<BatchGEMMTrace, shared_ptr<BatchGEMMTrace>>(m, "BatchGEMMTrace")
+        .def(py::init<>())
+        .def_readwrite("fl_size", &BatchGEMMTrace::fl_size)
+        .def_readwrite("is_cpx", &BatchGEMMTrace::is_cpx)
+        .def_readwrite("mode", &BatchGEMMTrace::mode)
+        .def_property_readonly("n_stages",
+                               [](BatchGEMMTrace *self) {
+                                   return self->stages.size();
+                               })
+        .def("n_gemm", &BatchGEMMTrace::n_gemm)
+        .def("n_flop", &BatchGEMMTrace::n_flop)
+        .def("clear", &BatchGEMMTrace::clear)
+        .def("save_data", (void(BatchGEMMTrace::*)(const string &) const) &
+                              BatchGEMMTrace::save_data)
+        .def("load_data", (void(BatchGEMMTrace::*)(const string &)) &
+                              BatchGEMMTrace::load_data)
+        .def("replay", &BatchGEMMTrace::replay, py::arg("mode"),
+             py::arg("n_repeat") = 1, py::arg("max_mem") = (size_t)1 << 24)
+        .def("__repr__", [](BatchGEMMTrace *self) {
+            stringstream ss;
+            ss << *self;
+            return ss.str();
+        });
+
     py::bind_vector<vector<shared_ptr<StackAllocator<uint32_t>>>>(
         m, "VectorIntStackAllocator");
 
@@ -2120,7 +2284,10 @@ template <typename S = void> void bind_io(py::module &m) {
 #endif
         .def_property_static(
             "threading", [](py::object) { return threading_(); },
-            [](py::object, shared_ptr<Threading> th) { threading_() = th; });
+            [](py::object, shared_ptr<Threading> th) { threading_() = th; })
+        .def_property_static(
+            "profiler", [](py::object) { return profiler_(); },
+            [](py::object, shared_ptr<Profiler> pf) { profiler_() = pf; });
 
     py::class_<Random, shared_ptr<Random>>(m, "Random")
         .def_static("rand_seed", &Random::rand_seed, py::arg("i") = 0U)
@@ -2153,9 +2320,26 @@ template <typename S = void> void bind_io(py::module &m) {
         .def_static("size", &block2::MPI::size);
 #endif
 
+    py::class_<StateIndex, shared_ptr<StateIndex>>(m, "StateIndex")
+        .def_readonly("n", &StateIndex::n)
+        .def_property_static(
+            "min_n", [](py::object) { return StateIndex::min_n(); },
+            [](py::object, int n) { StateIndex::min_n() = n; });
+
+    py::class_<SU2CGTable, shared_ptr<SU2CGTable>>(m, "SU2CGTable")
+        .def_readonly("max_tj", &SU2CGTable::max_tj)
+        .def("memo_size", &SU2CGTable::memo_size)
+        .def("clear_memo", &SU2CGTable::clear_memo);
+
     py::class_<SU2CG, shared_ptr<SU2CG>>(m, "SU2CG")
         .def(py::init<>())
         .def(py::init<int>())
+        .def(py::init<int, int>(), py::arg("n_sqrt_fact"), py::arg("max_tj"))
+        .def_readonly("table", &SU2CG::table)
+        .def_property_static(
+            "max_table_twoj",
+            [](py::object) { return SU2CG::max_table_twoj(); },
+            [](py::object, int max_tj) { SU2CG::max_table_twoj() = max_tj; })
         .def_static("triangle", &SU2CG::triangle, py::arg("tja"),
                     py::arg("tjb"), py::arg("tjc"))
         .def("sqrt_delta", &SU2CG::sqrt_delta, py::arg("tja"), py::arg("tjb"),
@@ -2169,6 +2353,12 @@ template <typename S = void> void bind_io(py::module &m) {
         .def("wigner_9j", &SU2CG::wigner_9j, py::arg("tja"), py::arg("tjb"),
              py::arg("tjc"), py::arg("tjd"), py::arg("tje"), py::arg("tjf"),
              py::arg("tjg"), py::arg("tjh"), py::arg("tji"))
+        .def("wigner_6j_direct", &SU2CG::wigner_6j_direct, py::arg("tja"),
+             py::arg("tjb"), py::arg("tjc"), py::arg("tjd"), py::arg("tje"),
+             py::arg("tjf"))
+        .def("wigner_9j_direct", &SU2CG::wigner_9j_direct, py::arg("tja"),
+             py::arg("tjb"), py::arg("tjc"), py::arg("tjd"), py::arg("tje"),
+             py::arg("tjf"), py::arg("tjg"), py::arg("tjh"), py::arg("tji"))
         .def("racah", &SU2CG::racah, py::arg("ta"), py::arg("tb"),
              py::arg("tc"), py::arg("td"), py::arg("te"), py::arg("tf"))
         .def("transpose_cg", &SU2CG::transpose_cg, py::arg("td"), py::arg("tl"),
@@ -2650,6 +2840,29 @@ template <typename FL> void bind_fl_io(py::module &m, const string &name) {
         .def_readwrite("data", &VectorAllocator<FL>::data)
         .def(py::init<>());
 
+    py::class_<ArenaAllocator<FL>, shared_ptr<ArenaAllocator<FL>>,
+               Allocator<FL>>(m, (name + "ArenaAllocator").c_str())
+        .def(py::init<>())
+        .def_static("stats", &ArenaAllocator<FL>::stats)
+        .def_static("reset_stats", &ArenaAllocator<FL>::reset_stats)
+        .def_static("release_thread_cache",
+                    &ArenaAllocator<FL>::release_thread_cache)
+        .def_static("get_max_thread_cache",
+                    []() {
+                        return (size_t)ArenaAllocator<FL>::max_thread_cache();
+                    })
+        .def_static("set_max_thread_cache",
+                    [](size_t x) { ArenaAllocator<FL>::max_thread_cache() = x; })
+        .def_static("release_all_thread_caches",
+                    &ArenaAllocator<FL>::release_all_thread_caches)
+        .def_static("get_max_total_cache",
+                    []() {
+                        return (size_t)ArenaAllocator<FL>::max_total_cache();
+                    })
+        .def_static("set_max_total_cache", [](size_t x) {
+            ArenaAllocator<FL>::max_total_cache() = x;
+        });
+
     py::class_<StackAllocator<FL>, shared_ptr<StackAllocator<FL>>,
                Allocator<FL>>(m, (name + "StackAllocator").c_str())
         .def(py::init<>())
@@ -2672,6 +2885,8 @@ template <typename FL> void bind_fl_io(py::module &m, const string &name) {
         .def_readwrite("ndata", &FPCodec<FL>::ndata)
         .def_readwrite("ncpsd", &FPCodec<FL>::ncpsd)
         .def_readwrite("ncpsd_last", &FPCodec<FL>::ncpsd_last)
+        .def_readwrite("simd_level", &FPCodec<FL>::simd_level)
+        .def("get_simd_level", &FPCodec<FL>::get_simd_level)
         .def("encode",
              [](FPCodec<FL> *self, py::array_t<FL> arr) {
                  FL *tmp = new FL[arr.size() + 2];
@@ -2793,11 +3008,29 @@ template <typename FL> void bind_fl_io(py::module &m, const string &name) {
         .def_readwrite("compressed_sparse_tensor_storage",
                        &DataFrame<FL>::compressed_sparse_tensor_storage)
         .def_readwrite("fp_codec", &DataFrame<FL>::fp_codec)
+        .def_readwrite("lz_codec", &DataFrame<FL>::lz_codec)
+        .def_readwrite("mmap_scratch", &DataFrame<FL>::mmap_scratch)
+        .def_readonly("numa_type", &DataFrame<FL>::numa_type)
+        .def("set_numa_policy", &DataFrame<FL>::set_numa_policy)
+        .def_readwrite("prefetch_buffering",
+                       &DataFrame<FL>::prefetch_buffering)
         .def("update_peak_used_memory", &DataFrame<FL>::update_peak_used_memory)
         .def("reset_peak_used_memory", &DataFrame<FL>::reset_peak_used_memory)
         .def("activate", &DataFrame<FL>::activate)
         .def("load_data", &DataFrame<FL>::load_data)
         .def("save_data", &DataFrame<FL>::save_data)
+        .def("prefetch_data", &DataFrame<FL>::prefetch_data)
+        .def_readwrite("tiered_scratch", &DataFrame<FL>::tiered_scratch)
+        .def_readwrite("scratch_cache_size",
+                       &DataFrame<FL>::scratch_cache_size)
+        .def_readonly("scratch_cache_used", &DataFrame<FL>::scratch_cache_used)
+        .def_readwrite("n_cache_hits", &DataFrame<FL>::n_cache_hits)
+        .def_readwrite("n_cache_misses", &DataFrame<FL>::n_cache_misses)
+        .def_readwrite("n_cache_evictions", &DataFrame<FL>::n_cache_evictions)
+        .def_readwrite("n_spills", &DataFrame<FL>::n_spills)
+        .def("clear_cache", &DataFrame<FL>::clear_cache)
+        .def("spill_data", &DataFrame<FL>::spill_data)
+        .def("remove_data", &DataFrame<FL>::remove_data)
         .def("reset", &DataFrame<FL>::reset)
         .def("__repr__", [](DataFrame<FL> *self) {
             stringstream ss;
@@ -3323,6 +3556,15 @@ template <typename S = void> void bind_post_matrix(py::module &m) {
 
 template <typename FL> void bind_fl_matrix(py::module &m) {
 
+    py::class_<KrylovRecycleSpace<FL>, shared_ptr<KrylovRecycleSpace<FL>>>(
+        m, "KrylovRecycleSpace")
+        .def(py::init<>())
+        .def_readonly("n", &KrylovRecycleSpace<FL>::n)
+        .def_readonly("nk", &KrylovRecycleSpace<FL>::nk)
+        .def_readwrite("shift", &KrylovRecycleSpace<FL>::shift)
+        .def_readwrite("max_nk", &KrylovRecycleSpace<FL>::max_nk)
+        .def("clear", &KrylovRecycleSpace<FL>::clear);
+
     py::class_<GCSRMatrix<FL>, shared_ptr<GCSRMatrix<FL>>>(m, "CSRMatrix")
         .def(py::init<>())
         .def(py::init<MKL_INT, MKL_INT>())
@@ -3479,6 +3721,14 @@ template <typename FL> void bind_fl_matrix(py::module &m) {
         .def(py::init<>())
         .def("read", &FCIDUMP<FL>::read)
         .def("write", &FCIDUMP<FL>::write)
+        .def("read_binary", &FCIDUMP<FL>::read_binary, py::arg("filename"),
+             py::arg("use_mmap") = true)
+        .def("write_binary", &FCIDUMP<FL>::write_binary, py::arg("filename"),
+             py::arg("prec") = (typename FCIDUMP<FL>::FP)0.0)
+        .def_static("convert_to_binary", &FCIDUMP<FL>::convert_to_binary,
+                    py::arg("text_filename"), py::arg("filename"),
+                    py::arg("prec") = (typename FCIDUMP<FL>::FP)0.0,
+                    py::arg("batch_size") = (size_t)1 << 20)
         .def("initialize_h1e",
              [](FCIDUMP<FL> *self, uint16_t n_sites, uint16_t n_elec,
                 uint16_t twos, uint16_t isym, FL e, const py::array_t<FL> &t) {
@@ -3797,6 +4047,8 @@ template <typename FL> void bind_fl_matrix(py::module &m) {
         .def_readwrite("refs", &BatchGEMMSeq<FL>::refs)
         .def_readwrite("cumulative_nflop", &BatchGEMMSeq<FL>::cumulative_nflop)
         .def_readwrite("mode", &BatchGEMMSeq<FL>::mode)
+        .def_readwrite("tuner", &BatchGEMMSeq<FL>::tuner)
+        .def_readwrite("trace", &BatchGEMMSeq<FL>::trace)
         .def(py::init<>())
         .def(py::init<size_t>())
         .def(py::init<size_t, SeqTypes>())
@@ -3842,7 +4094,16 @@ template <typename FL> void bind_fl_matrix(py::module &m) {
              py::arg("vs"))
         .def("perform", &BatchGEMMSeq<FL>::perform)
         .def("clear", &BatchGEMMSeq<FL>::clear)
-        .def("__call__", &BatchGEMMSeq<FL>::operator())
+        .def("__call__",
+             (void(BatchGEMMSeq<FL>::*)(const GMatrix<FL> &,
+                                         const GMatrix<FL> &, FL)) &
+                 BatchGEMMSeq<FL>::operator(),
+             py::arg("c"), py::arg("v"), py::arg("scale") = (FL)1.0)
+        .def("__call__",
+             (void(BatchGEMMSeq<FL>::*)(const vector<GMatrix<FL>> &,
+                                         const vector<GMatrix<FL>> &, FL)) &
+                 BatchGEMMSeq<FL>::operator(),
+             py::arg("cs"), py::arg("vs"), py::arg("scale") = (FL)1.0)
         .def("__repr__", [](BatchGEMMSeq<FL> *self) {
             stringstream ss;
             ss << *self;
@@ -621,12 +621,20 @@ template <typename S, typename FL> void bind_fl_partition(py::module &m) {
         .def_readwrite("npdm_fragment_filename",
                        &EffectiveHamiltonian<S, FL>::npdm_fragment_filename)
         .def_readwrite("npdm_scheme", &EffectiveHamiltonian<S, FL>::npdm_scheme)
+        .def_readwrite("cinfo_cache", &EffectiveHamiltonian<S, FL>::cinfo_cache)
         .def_readwrite("npdm_parallel_center",
                        &EffectiveHamiltonian<S, FL>::npdm_parallel_center)
         .def_readwrite("npdm_n_sites",
                        &EffectiveHamiltonian<S, FL>::npdm_n_sites)
         .def_readwrite("npdm_center", &EffectiveHamiltonian<S, FL>::npdm_center)
         .def_readwrite("eff_kernel", &EffectiveHamiltonian<S, FL>::eff_kernel)
+        .def_readwrite("trace_filename",
+                       &EffectiveHamiltonian<S, FL>::trace_filename)
+        .def_readwrite("mixed_precision",
+                       &EffectiveHamiltonian<S, FL>::mixed_precision)
+        .def_readwrite("mixed_stall_iter",
+                       &EffectiveHamiltonian<S, FL>::mixed_stall_iter)
+        .def("capture_trace", &EffectiveHamiltonian<S, FL>::capture_trace)
         .def("__call__", &EffectiveHamiltonian<S, FL>::operator(), py::arg("b"),
              py::arg("c"), py::arg("idx") = 0, py::arg("factor") = 1.0,
              py::arg("all_reduce") = true)
@@ -744,6 +752,9 @@ template <typename S, typename FL> void bind_fl_partition(py::module &m) {
         .def_readwrite(
             "npdm_scheme",
             &EffectiveHamiltonian<S, FL, MultiMPS<S, FL>>::npdm_scheme)
+        .def_readwrite(
+            "cinfo_cache",
+            &EffectiveHamiltonian<S, FL, MultiMPS<S, FL>>::cinfo_cache)
         .def_readwrite(
             "npdm_parallel_center",
             &EffectiveHamiltonian<S, FL, MultiMPS<S, FL>>::npdm_parallel_center)
@@ -812,6 +823,8 @@ void bind_fl_moving_environment(py::module &m, const string &name) {
         .def_readwrite(
             "lowmem_numerical_transform",
             &MovingEnvironment<S, FL, FLS>::lowmem_numerical_transform)
+        .def_readwrite("cinfo_cache",
+                       &MovingEnvironment<S, FL, FLS>::cinfo_cache)
         .def_readwrite("save_environments",
                        &MovingEnvironment<S, FL, FLS>::save_environments)
         .def_readwrite("left_part_files",
@@ -1322,6 +1335,8 @@ void bind_fl_dmrg(py::module &m) {
                        &DMRG<S, FL, FLS>::davidson_max_iter)
         .def_readwrite("davidson_soft_max_iter",
                        &DMRG<S, FL, FLS>::davidson_soft_max_iter)
+        .def_readwrite("davidson_mixed_precision",
+                       &DMRG<S, FL, FLS>::davidson_mixed_precision)
         .def_readwrite("davidson_def_min_size",
                        &DMRG<S, FL, FLS>::davidson_def_min_size)
         .def_readwrite("davidson_def_max_size",
@@ -1356,6 +1371,7 @@ void bind_fl_dmrg(py::module &m) {
         .def_readwrite("store_wfn_spectra",
                        &DMRG<S, FL, FLS>::store_wfn_spectra)
         .def_readwrite("store_seq_data", &DMRG<S, FL, FLS>::store_seq_data)
+        .def_readwrite("store_gemm_trace", &DMRG<S, FL, FLS>::store_gemm_trace)
         .def_readwrite("wfn_spectra", &DMRG<S, FL, FLS>::wfn_spectra)
         .def_readwrite("sweep_wfn_spectra",
                        &DMRG<S, FL, FLS>::sweep_wfn_spectra)
@@ -1619,6 +1635,11 @@ void bind_fl_linear(py::module &m) {
                        &Linear<S, FL, FLS>::linear_use_precondition)
         .def_readwrite("cg_n_harmonic_projection",
                        &Linear<S, FL, FLS>::cg_n_harmonic_projection)
+        .def_readwrite("linear_recycle", &Linear<S, FL, FLS>::linear_recycle)
+        .def_readwrite("linear_recycle_next_site",
+                       &Linear<S, FL, FLS>::linear_recycle_next_site)
+        .def_readwrite("linear_recycle_size",
+                       &Linear<S, FL, FLS>::linear_recycle_size)
         .def_readwrite("linear_solver_params",
                        &Linear<S, FL, FLS>::linear_solver_params)
         .def_readwrite("decomp_last_site",
@@ -2168,6 +2189,11 @@ template <typename S, typename FL> void bind_fl_general(py::module &m) {
         .def_readwrite("block_max_length", &GeneralMPO<S, FL>::block_max_length)
         .def_readwrite("fast_no_orb_dep_op",
                        &GeneralMPO<S, FL>::fast_no_orb_dep_op)
+        .def_readwrite("updatable", &GeneralMPO<S, FL>::updatable)
+        .def_readwrite("ref_afd", &GeneralMPO<S, FL>::ref_afd)
+        .def("update", &GeneralMPO<S, FL>::update,
+             py::call_guard<checked_ostream_redirect,
+                            checked_estream_redirect>())
         .def(py::init<const shared_ptr<GeneralHamiltonian<S, FL>> &,
                       const shared_ptr<GeneralFCIDUMP<FL>> &,
                       MPOAlgorithmTypes>(),
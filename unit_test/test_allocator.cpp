@@ -0,0 +1,157 @@
+
+#include "block2_core.hpp"
+#include "gtest/gtest.h"
+
+using namespace block2;
+
+class TestArenaAllocator : public ::testing::Test {
+  protected:
+    static const int n_tests = 200;
+    void SetUp() override { Random::rand_seed(0); }
+    void TearDown() override {}
+};
+
+TEST_F(TestArenaAllocator, TestSizeClass) {
+    for (size_t n = 1; n < 100000; n++) {
+        int c = ArenaAllocator<double>::size_class(n);
+        size_t sz = ArenaAllocator<double>::class_size(c);
+        ASSERT_GE(sz, n);
+        ASSERT_LE(sz, max(n + n / 4, (size_t)16));
+        if (c != 0)
+            ASSERT_LT(ArenaAllocator<double>::class_size(c - 1), n);
+    }
+}
+
+TEST_F(TestArenaAllocator, TestOutOfOrder) {
+    ArenaAllocator<double>::release_thread_cache();
+    ArenaAllocator<double>::reset_stats();
+    ArenaStats st0 = ArenaAllocator<double>::stats();
+    shared_ptr<ArenaAllocator<double>> alloc =
+        make_shared<ArenaAllocator<double>>();
+    vector<pair<double *, size_t>> ptrs;
+    for (int i = 0; i < n_tests; i++) {
+        if (ptrs.size() != 0 && Random::rand_int(0, 3) == 0) {
+            int j = Random::rand_int(0, (int)ptrs.size());
+            for (size_t k = 0; k < ptrs[j].second; k++)
+                ASSERT_EQ(ptrs[j].first[k], (double)j);
+            alloc->deallocate(ptrs[j].first, ptrs[j].second);
+            ptrs[j] = ptrs.back();
+            ptrs.pop_back();
+            for (size_t k = 0; k < ptrs.size(); k++)
+                for (size_t l = 0; l < ptrs[k].second; l++)
+                    ptrs[k].first[l] = (double)k;
+        } else {
+            size_t n = Random::rand_int(1, 5000);
+            double *p = alloc->allocate(n);
+            for (size_t k = 0; k < n; k++)
+                ASSERT_EQ(p[k], 0.0);
+            for (size_t k = 0; k < n; k++)
+                p[k] = (double)ptrs.size();
+            ptrs.push_back(make_pair(p, n));
+        }
+    }
+    ArenaStats st = ArenaAllocator<double>::stats();
+    size_t req = 0;
+    for (auto &p : ptrs)
+        req += p.second * sizeof(double);
+    EXPECT_EQ(st.requested - st0.requested, req);
+    EXPECT_GE(st.used - st0.used, req);
+    EXPECT_GE(st.peak_used, st.used);
+    EXPECT_GT(st.n_reuses, 0);
+    EXPECT_LE(st.fragmentation(), 0.25);
+    // live blocks are returned to the pool when the allocator is destroyed
+    alloc = nullptr;
+    st = ArenaAllocator<double>::stats();
+    EXPECT_EQ(st.used, st0.used);
+    EXPECT_EQ(st.requested, st0.requested);
+    EXPECT_GT(st.cached, 0);
+    ArenaAllocator<double>::release_thread_cache();
+    EXPECT_EQ(ArenaAllocator<double>::stats().cached, 0);
+}
+
+TEST_F(TestArenaAllocator, TestReuse) {
+    ArenaAllocator<double>::release_thread_cache();
+    shared_ptr<ArenaAllocator<double>> alloc =
+        make_shared<ArenaAllocator<double>>();
+    double *p = alloc->allocate(1000);
+    p[999] = 1.0;
+    alloc->deallocate(p, 1000);
+    ArenaStats st0 = ArenaAllocator<double>::stats();
+    // a different allocator of similar size on the same thread reuses
+    shared_ptr<ArenaAllocator<double>> alloc2 =
+        make_shared<ArenaAllocator<double>>();
+    double *q = alloc2->allocate(990);
+    EXPECT_EQ(p, q);
+    EXPECT_EQ(ArenaAllocator<double>::stats().n_reuses, st0.n_reuses + 1);
+    for (size_t k = 0; k < 990; k++)
+        ASSERT_EQ(q[k], 0.0);
+    // shrinking and growing within the same size class keeps the pointer
+    q[500] = 2.0;
+    double *r = alloc2->reallocate(q, 990, 600);
+    EXPECT_EQ(r, q);
+    r = alloc2->reallocate(r, 600, 1024);
+    EXPECT_EQ(r, q);
+    EXPECT_EQ(r[500], 2.0);
+    EXPECT_EQ(r[700], 0.0);
+    r = alloc2->reallocate(r, 1024, 5000);
+    EXPECT_EQ(r[500], 2.0);
+    alloc2->deallocate(r, 5000);
+    ArenaAllocator<double>::release_thread_cache();
+}
+
+TEST_F(TestArenaAllocator, TestThreading) {
+    const int n_threads = 4;
+    ArenaStats st0 = ArenaAllocator<double>::stats();
+    vector<shared_ptr<ArenaAllocator<double>>> allocs(n_threads);
+    vector<vector<pair<double *, size_t>>> ptrs(n_threads);
+    for (int it = 0; it < 5; it++) {
+        for (int i = 0; i < n_threads; i++)
+            allocs[i] = make_shared<ArenaAllocator<double>>();
+#pragma omp parallel for num_threads(n_threads)
+        for (int i = 0; i < n_threads; i++) {
+            for (int j = 0; j < 100; j++) {
+                size_t n = 100 + j * 13 + i;
+                ptrs[i].push_back(make_pair(allocs[i]->allocate(n), n));
+                ptrs[i].back().first[n - 1] = i;
+            }
+        }
+        // blocks are freed from a different thread
+#pragma omp parallel for num_threads(n_threads)
+        for (int i = 0; i < n_threads; i++) {
+            int k = (i + 1) % n_threads;
+            for (auto &p : ptrs[k]) {
+                EXPECT_EQ(p.first[p.second - 1], (double)k);
+                allocs[k]->deallocate(p.first, p.second);
+            }
+        }
+        for (int i = 0; i < n_threads; i++)
+            ptrs[i].clear();
+    }
+    EXPECT_EQ(ArenaAllocator<double>::stats().used, st0.used);
+    ArenaAllocator<double>::release_thread_cache();
+}
+
+TEST_F(TestArenaAllocator, TestCacheLimit) {
+    const int n_threads = 4;
+    ArenaAllocator<double>::release_all_thread_caches(n_threads);
+    EXPECT_EQ(ArenaAllocator<double>::stats().cached, 0);
+    const size_t max_total = ArenaAllocator<double>::max_total_cache();
+    ArenaAllocator<double>::max_total_cache() = 1 << 16;
+#pragma omp parallel num_threads(n_threads)
+    {
+        shared_ptr<ArenaAllocator<double>> alloc =
+            make_shared<ArenaAllocator<double>>();
+        vector<double *> ptrs;
+        for (int i = 0; i < 64; i++)
+            ptrs.push_back(alloc->allocate(1000));
+        for (auto &p : ptrs)
+            alloc->deallocate(p, 1000);
+    }
+    // the total size of the cached blocks is bounded by the global limit
+    EXPECT_GT(ArenaAllocator<double>::stats().cached, 0);
+    EXPECT_LE(ArenaAllocator<double>::stats().cached, 1 << 16);
+    // caches of all threads are released
+    ArenaAllocator<double>::release_all_thread_caches(n_threads);
+    EXPECT_EQ(ArenaAllocator<double>::stats().cached, 0);
+    ArenaAllocator<double>::max_total_cache() = max_total;
+}
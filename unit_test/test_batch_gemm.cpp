@@ -16,6 +16,8 @@ template <typename FL> class TestBatchGEMM : public ::testing::Test {
         threading_() = make_shared<Threading>(
             ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global, 4, 4,
             4);
+        // SmallGEMM is opt-in, enabled here to cover the mixed batches
+        threading_()->small_gemm_size = 16;
     }
     void TearDown() override {
         frame_<FP>()->activate(0);
@@ -85,6 +87,59 @@ TYPED_TEST(TestBatchGEMM, TestRotate) {
     }
 }
 
+TYPED_TEST(TestBatchGEMM, TestRotateAutoTuned) {
+    using FL = TypeParam;
+    typedef typename GMatrix<FL>::FP FP;
+    const FP thrd = is_same<FP, double>::value ? 1E-10 : 1E-5;
+    shared_ptr<BatchGEMMSeq<FP>> seq = make_shared<BatchGEMMSeq<FP>>(1 << 24);
+    seq->mode = SeqTypes::Auto;
+    seq->tuner = make_shared<BatchGEMMAutoTuner>();
+    for (int i = 0; i < this->n_tests / 4; i++) {
+        int ma = Random::rand_int(1, 100), na = Random::rand_int(1, 100);
+        int mc = Random::rand_int(1, 100), nc = Random::rand_int(1, 100);
+        int nbatch = Random::rand_int(1, 30);
+        GMatrix<FP> a(dalloc_<FP>()->allocate(ma * na * nbatch), ma, na);
+        GMatrix<FP> c(dalloc_<FP>()->allocate(mc * nc), mc, nc);
+        GMatrix<FP> l(dalloc_<FP>()->allocate(ma * mc), mc, ma);
+        GMatrix<FP> r(dalloc_<FP>()->allocate(na * nc), na, nc);
+        Random::fill<FP>(l.data, l.size());
+        Random::fill<FP>(r.data, r.size());
+        Random::fill<FP>(a.data, a.size() * nbatch);
+        c.clear();
+        for (int ii = 0; ii < nbatch; ii++)
+            seq->rotate(a.shift_ptr(ma * na * ii), c, l, false, r, false, 1.0);
+        seq->auto_perform();
+        GMatrix<FP> cstd(dalloc_<FP>()->allocate(mc * nc), mc, nc);
+        cstd.clear();
+        for (int ii = 0; ii < nbatch; ii++)
+            GMatrixFunctions<FP>::rotate(a.shift_ptr(ma * na * ii), cstd, l,
+                                         false, r, false, 1.0);
+        ASSERT_TRUE(GMatrixFunctions<FP>::all_close(c, cstd, thrd, thrd));
+        cstd.deallocate();
+        r.deallocate();
+        l.deallocate();
+        c.deallocate();
+        dalloc_<FP>()->deallocate(a.data, ma * na * nbatch);
+    }
+#ifndef _HAS_BLIS
+    EXPECT_GT(seq->tuner->batch_times.size(), 0);
+    for (auto &r : seq->tuner->batch_times) {
+        const int impl = seq->tuner->batch_impl(r.first);
+        EXPECT_TRUE(impl == 0 || impl == 1);
+    }
+#endif
+    // mode selection
+    EXPECT_EQ(BatchGEMMAutoTuner::bucket(1), 0);
+    EXPECT_EQ(BatchGEMMAutoTuner::bucket(1000), 10);
+    EXPECT_EQ(BatchGEMMAutoTuner::bucket(1024), 10);
+    EXPECT_FALSE(seq->tuner->has_mode(10));
+    EXPECT_EQ(seq->tuner->set_mode_times(10, vector<double>{3, 1, 2}),
+              SeqTypes::Simple);
+    EXPECT_EQ(seq->tuner->get_mode(10), SeqTypes::Simple);
+    seq->tuner->clear();
+    EXPECT_FALSE(seq->tuner->has_mode(10));
+}
+
 TYPED_TEST(TestBatchGEMM, TestRotateTasked) {
     using FL = TypeParam;
     typedef typename GMatrix<FL>::FP FP;
@@ -142,6 +197,152 @@ TYPED_TEST(TestBatchGEMM, TestRotateTasked) {
     }
 }
 
+template <typename FL, typename FP>
+static void check_small_gemm(int n_tests, FP thrd) {
+    const size_t nx = sizeof(FL) / sizeof(FP);
+    for (int i = 0; i < n_tests; i++) {
+        MKL_INT m = Random::rand_int(1, 20), n = Random::rand_int(1, 20);
+        MKL_INT k = Random::rand_int(1, 20);
+        if (i % 10 == 0)
+            n = k = 1, m = Random::rand_int(1, 200);
+        bool ta = Random::rand_int(0, 2), tb = Random::rand_int(0, 2);
+        MKL_INT lda = (ta ? m : k) + Random::rand_int(0, 3);
+        MKL_INT ldb = (tb ? k : n) + Random::rand_int(0, 3);
+        MKL_INT ldc = n + Random::rand_int(0, 3);
+        FL alpha = (FP)Random::rand_double(-2, 2);
+        FL beta = (FP)(i % 3 == 0 ? 0.0 : Random::rand_double(-2, 2));
+        if (i % 7 == 0)
+            alpha = 0.0;
+        const MKL_INT sa = (ta ? k : m) * lda, sb = (tb ? n : k) * ldb;
+        vector<FL> a(sa), b(sb), c(m * ldc), cstd(m * ldc);
+        Random::fill<FP>((FP *)a.data(), sa * nx);
+        Random::fill<FP>((FP *)b.data(), sb * nx);
+        Random::fill<FP>((FP *)c.data(), m * ldc * nx);
+        cstd = c;
+        SmallGEMM<FL>::multiply(ta, tb, m, n, k, alpha, a.data(), lda,
+                                b.data(), ldb, beta, c.data(), ldc);
+        xgemm<FL>(tb ? "t" : "n", ta ? "t" : "n", &n, &m, &k, &alpha,
+                  b.data(), &ldb, a.data(), &lda, &beta, cstd.data(), &ldc);
+        ASSERT_TRUE(GMatrixFunctions<FL>::all_close(
+            GMatrix<FL>(c.data(), m, ldc), GMatrix<FL>(cstd.data(), m, ldc),
+            thrd, thrd));
+    }
+}
+
+TYPED_TEST(TestBatchGEMM, TestSmallGEMM) {
+    using FL = TypeParam;
+    typedef typename GMatrix<FL>::FP FP;
+    const FP thrd = is_same<FP, double>::value ? 1E-10 : 1E-5;
+    check_small_gemm<FP, FP>(this->n_tests * 5, thrd);
+    check_small_gemm<FL, FP>(this->n_tests * 5, thrd);
+    EXPECT_FALSE(SmallGEMM<FP>::is_small(4, 4, 4, 0));
+    EXPECT_TRUE(SmallGEMM<FP>::is_small(16, 16, 16, 16));
+    EXPECT_FALSE(SmallGEMM<FP>::is_small(17, 4, 4, 16));
+    EXPECT_TRUE(SmallGEMM<FP>::is_small(256, 1, 1, 16));
+    EXPECT_FALSE(SmallGEMM<FP>::is_small(257, 1, 1, 16));
+}
+
+TYPED_TEST(TestBatchGEMM, BenchmarkSmallGEMM) {
+    using FL = TypeParam;
+    typedef typename GMatrix<FL>::FP FP;
+    // shape histogram of rotations of tiny symmetry blocks
+    shared_ptr<BatchGEMMSeq<FP>> seq = make_shared<BatchGEMMSeq<FP>>(1 << 24);
+    seq->mode = SeqTypes::Simple;
+    GMatrix<FP> xa(nullptr, 1, 1), xc(nullptr, 1, 1);
+    for (int i = 0; i < this->n_tests * 10; i++) {
+        int ma = Random::rand_int(1, 9), na = Random::rand_int(1, 9);
+        int mc = Random::rand_int(1, 9), nc = Random::rand_int(1, 9);
+        seq->rotate(GMatrix<FP>(nullptr, ma, na), GMatrix<FP>(nullptr, mc, nc),
+                    GMatrix<FP>(nullptr, mc, ma), false,
+                    GMatrix<FP>(nullptr, na, nc), false, 1.0);
+    }
+    const string filename = frame_<FP>()->save_dir + "/small-gemm.txt";
+    seq->save_data(filename);
+    seq->clear();
+    ifstream ifs(filename.c_str());
+    vector<array<MKL_INT, 3>> shapes = SmallGEMM<FP>::read_shapes(ifs);
+    ifs.close();
+    EXPECT_EQ(shapes.size(), this->n_tests * 20);
+    const int n_repeat = 200;
+    size_t nflop = 0;
+    const MKL_INT ld = 16;
+    vector<FP> a(ld * ld), b(ld * ld), c(ld * ld);
+    Random::fill<FP>(a.data(), a.size());
+    Random::fill<FP>(b.data(), b.size());
+    for (auto &x : shapes)
+        nflop += (size_t)2 * x[0] * x[1] * x[2] * n_repeat;
+    double tsmall = 0, tblas = 0;
+    Timer t;
+    for (int it = 0; it < 2; it++) {
+        t.get_time();
+        for (int ir = 0; ir < n_repeat; ir++)
+            for (auto &x : shapes) {
+                if (it == 0)
+                    SmallGEMM<FP>::multiply(false, false, x[0], x[1], x[2],
+                                            1.0, a.data(), ld, b.data(), ld,
+                                            1.0, c.data(), ld);
+                else {
+                    const FP one = 1.0;
+                    xgemm<FP>("n", "n", &x[1], &x[0], &x[2], &one, b.data(),
+                              &ld, a.data(), &ld, &one, c.data(), &ld);
+                }
+            }
+        (it == 0 ? tsmall : tblas) = t.get_time();
+    }
+    cout << "SMALL GEMM : " << shapes.size() << " shapes T = " << fixed
+         << setprecision(3) << tsmall << " s " << nflop / tsmall / 1E9
+         << " GFLOP/S ; BLAS T = " << tblas << " s " << nflop / tblas / 1E9
+         << " GFLOP/S" << endl;
+}
+
+TYPED_TEST(TestBatchGEMM, TestTrace) {
+    using FL = TypeParam;
+    typedef typename GMatrix<FL>::FP FP;
+    shared_ptr<BatchGEMMSeq<FP>> seq = make_shared<BatchGEMMSeq<FP>>(1 << 24);
+    seq->mode = SeqTypes::Auto;
+    seq->trace = make_shared<BatchGEMMTrace>();
+    size_t nflop = 0, ngemm = 0;
+    for (int i = 0; i < this->n_tests / 10; i++) {
+        int ma = Random::rand_int(1, 50), na = Random::rand_int(1, 50);
+        int mc = Random::rand_int(1, 50), nc = Random::rand_int(1, 50);
+        int nbatch = Random::rand_int(1, 10);
+        GMatrix<FP> a(dalloc_<FP>()->allocate(ma * na * nbatch), ma, na);
+        GMatrix<FP> c(dalloc_<FP>()->allocate(mc * nc), mc, nc);
+        GMatrix<FP> l(dalloc_<FP>()->allocate(ma * mc), mc, ma);
+        GMatrix<FP> r(dalloc_<FP>()->allocate(na * nc), na, nc);
+        Random::fill<FP>(l.data, l.size());
+        Random::fill<FP>(r.data, r.size());
+        Random::fill<FP>(a.data, a.size() * nbatch);
+        c.clear();
+        bool conjl = Random::rand_int(0, 2);
+        for (int ii = 0; ii < nbatch; ii++)
+            seq->rotate(a.shift_ptr(ma * na * ii), c,
+                        conjl ? l.flip_dims() : l, conjl, r, false, 1.0);
+        const size_t cnflop = seq->cumulative_nflop;
+        seq->auto_perform();
+        nflop += seq->cumulative_nflop - cnflop, ngemm += 2 * nbatch;
+        r.deallocate();
+        l.deallocate();
+        c.deallocate();
+        dalloc_<FP>()->deallocate(a.data, ma * na * nbatch);
+    }
+    shared_ptr<BatchGEMMTrace> trace = seq->trace;
+    EXPECT_EQ(trace->fl_size, (int)sizeof(FP));
+    EXPECT_GE(trace->n_flop(), nflop);
+    EXPECT_GE(trace->n_gemm(), ngemm);
+    const string filename = frame_<FP>()->save_dir + "/gemm-trace.txt";
+    trace->save_data(filename);
+    BatchGEMMTrace xtrace;
+    xtrace.load_data(filename);
+    EXPECT_EQ(xtrace.stages.size(), trace->stages.size());
+    EXPECT_EQ(xtrace.n_gemm(), trace->n_gemm());
+    EXPECT_EQ(xtrace.n_flop(), trace->n_flop());
+    for (SeqTypes mode :
+         {SeqTypes::None, SeqTypes::Simple, SeqTypes::Tasked})
+        EXPECT_GE(xtrace.replay(mode, 2, 1 << 16), 0.0);
+    cout << xtrace;
+}
+
 TYPED_TEST(TestBatchGEMM, TestTensorProduct) {
     using FL = TypeParam;
     typedef typename GMatrix<FL>::FP FP;
@@ -307,4 +307,63 @@ TEST_F(TestCG, TestW9jJiZero) {
             sqrt((tf + 1) * (tg + 1)) * cg.wigner_6j(ta, tb, tf, te, td, tg);
         EXPECT_LT(abs(actual - expected), 1E-14);
     }
-}
\ No newline at end of file
+}
+
+TEST_F(TestCG, TestTable) {
+    SU2CG dcg(max_twoj, -1);
+    EXPECT_NE(cg.table, nullptr);
+    EXPECT_EQ(dcg.table, nullptr);
+    const int max_tj = cg.table->max_tj;
+    for (int i = 0; i < n_tests; i++) {
+        // half of the cases are inside the prefilled range
+        int mx = (i & 1) ? max_tj : 30;
+        int ta = Random::rand_int(0, mx + 1), tb = Random::rand_int(0, mx + 1);
+        int tc = Random::rand_double() > 0.2 ? rand_triangle(ta, tb)
+                                             : Random::rand_int(0, mx + 1);
+        int tma = rand_proj(ta), tmb = rand_proj(tb);
+        int tmc = Random::rand_double() > 0.2 ? tma + tmb : rand_proj(tc);
+        EXPECT_EQ(cg.cg(ta, tb, tc, tma, tmb, tmc),
+                  dcg.cg(ta, tb, tc, tma, tmb, tmc));
+        int td = Random::rand_int(0, mx + 1), te = Random::rand_int(0, mx + 1);
+        int tf = Random::rand_double() > 0.2 ? rand_triangle(ta, te)
+                                             : Random::rand_int(0, mx + 1);
+        EXPECT_EQ(cg.wigner_6j(ta, tb, tc, td, te, tf),
+                  dcg.wigner_6j(ta, tb, tc, td, te, tf));
+        EXPECT_EQ(cg.racah(ta, tb, tc, td, te, tf),
+                  dcg.racah(ta, tb, tc, td, te, tf));
+        int tg = rand_triangle(ta, td), th = rand_triangle(tb, te);
+        int tj = rand_triangle(tg, th);
+        tf = Random::rand_double() > 0.2 ? rand_triangle(td, te)
+                                         : Random::rand_int(0, mx + 1);
+        EXPECT_EQ(cg.wigner_9j(ta, tb, tc, td, te, tf, tg, th, tj),
+                  dcg.wigner_9j(ta, tb, tc, td, te, tf, tg, th, tj));
+        EXPECT_LT(abs(cg.wigner_9j(ta, tb, tc, td, te, tf, tg, th, tj) -
+                      cg.wigner_9j_direct(ta, tb, tc, td, te, tf, tg, th, tj)),
+                  1E-14);
+    }
+    EXPECT_GT(cg.table->memo_size(), 0);
+    // objects created with the same maximal 2j share one table
+    EXPECT_EQ(SU2CG().table, cg.table);
+}
+
+TEST_F(TestCG, TestTableThreads) {
+    SU2CG dcg(max_twoj, -1);
+    cg.table->clear_memo();
+    const int n = 16;
+    vector<long double> r(n * n * n), rd(n * n * n);
+#pragma omp parallel for schedule(dynamic) num_threads(8)
+    for (int ix = 0; ix < n * n * n; ix++) {
+        const int ta = ix / (n * n), tb = ix / n % n, tc = ix % n;
+        for (int tf = abs(tb - tc); tf <= tb + tc; tf += 2)
+            r[ix] += cg.wigner_9j(ta, tb, ta + tb, ta, tc, ta + tc, 0, tf, tf) +
+                     cg.wigner_6j(ta, tb, tc, tc, ta, tf);
+    }
+    for (int ix = 0; ix < n * n * n; ix++) {
+        const int ta = ix / (n * n), tb = ix / n % n, tc = ix % n;
+        for (int tf = abs(tb - tc); tf <= tb + tc; tf += 2)
+            rd[ix] +=
+                dcg.wigner_9j(ta, tb, ta + tb, ta, tc, ta + tc, 0, tf, tf) +
+                dcg.wigner_6j(ta, tb, tc, tc, ta, tf);
+        EXPECT_EQ(r[ix], rd[ix]);
+    }
+}
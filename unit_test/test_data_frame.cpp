@@ -0,0 +1,230 @@
+
+#include "block2_core.hpp"
+#include "gtest/gtest.h"
+
+using namespace block2;
+
+class TestDataFrame : public ::testing::Test {
+  protected:
+    size_t isize = 1LL << 20;
+    size_t dsize = 1LL << 24;
+    static const int n_tests = 50;
+    void SetUp() override {
+        Random::rand_seed(0);
+        frame_<double>() = make_shared<DataFrame<double>>(isize, dsize, "nodex");
+    }
+    void TearDown() override {
+        frame_<double>()->activate(0);
+        frame_<double>() = nullptr;
+    }
+    void fill_frame(int i, vector<uint32_t> &iref, vector<double> &dref) {
+        shared_ptr<DataFrame<double>> fr = frame_<double>();
+        fr->reset(i);
+        size_t ni = Random::rand_int(0, 1000);
+        size_t nd = Random::rand_int(0, 100000);
+        iref.resize(ni), dref.resize(nd);
+        for (size_t j = 0; j < ni; j++)
+            iref[j] = (uint32_t)Random::rand_int(0, 100000);
+        Random::fill<double>(dref.data(), nd, -5, 5);
+        memcpy(fr->iallocs[i]->allocate(ni), iref.data(), ni * 4);
+        memcpy(fr->dallocs[i]->allocate(nd), dref.data(), nd * 8);
+    }
+    void check_frame(int i, const vector<uint32_t> &iref,
+                     const vector<double> &dref) {
+        shared_ptr<DataFrame<double>> fr = frame_<double>();
+        ASSERT_EQ(fr->iallocs[i]->used, iref.size());
+        ASSERT_EQ(fr->dallocs[i]->used, dref.size());
+        EXPECT_EQ(memcmp(fr->iallocs[i]->data, iref.data(), iref.size() * 4),
+                  0);
+        EXPECT_EQ(memcmp(fr->dallocs[i]->data, dref.data(), dref.size() * 8),
+                  0);
+    }
+};
+
+TEST_F(TestDataFrame, TestMMapScratch) {
+    shared_ptr<DataFrame<double>> fr = frame_<double>();
+    vector<uint32_t> iref, iref2;
+    vector<double> dref, dref2;
+    for (int i = 0; i < n_tests; i++) {
+        fr->mmap_scratch = Random::rand_int(0, 4) != 0;
+        bool write_mmap = fr->mmap_scratch;
+        string fn = fr->save_dir + "/DF.TEST." + Parsing::to_string(i % 3);
+        fill_frame(1, iref, dref);
+        fr->save_data(1, fn);
+        fill_frame(1, iref2, dref2);
+        fr->mmap_scratch = Random::rand_int(0, 4) != 0;
+        fr->prefetch_data(fn);
+        fr->load_data(1, fn);
+        check_frame(1, iref, dref);
+        // modifying the loaded frame must not change the file
+        if (dref.size() != 0) {
+            fr->dallocs[1]->data[0] += 1.0;
+            fr->reset(1);
+            fr->mmap_scratch = write_mmap;
+            fr->load_data(1, fn);
+            check_frame(1, iref, dref);
+        }
+        fr->reset(1);
+    }
+    for (int i = 0; i < 3; i++)
+        Parsing::remove_file(fr->save_dir + "/DF.TEST." + Parsing::to_string(i));
+}
+
+TEST_F(TestDataFrame, TestPrefetchBuffering) {
+    shared_ptr<DataFrame<double>> fr = frame_<double>();
+    fr->prefetch_buffering = true;
+    const int n_files = 4;
+    vector<vector<uint32_t>> irefs(n_files);
+    vector<vector<double>> drefs(n_files);
+    vector<string> fns(n_files);
+    for (int j = 0; j < n_files; j++) {
+        fns[j] = fr->save_dir + "/DF.PREF." + Parsing::to_string(j);
+        fill_frame(1, irefs[j], drefs[j]);
+        fr->save_data(1, fns[j]);
+    }
+    vector<uint32_t> iref;
+    vector<double> dref;
+    for (int i = 0; i < n_tests; i++) {
+        int j = Random::rand_int(0, n_files);
+        fr->prefetch_data(fns[j]);
+        if (Random::rand_int(0, 3) == 0) {
+            // overwriting a file must invalidate its prefetched contents
+            fill_frame(1, irefs[j], drefs[j]);
+            fr->save_data(1, fns[j]);
+            fr->prefetch_data(fns[j]);
+        }
+        fill_frame(1, iref, dref);
+        fr->load_data(1, fns[j]);
+        check_frame(1, irefs[j], drefs[j]);
+        fr->reset(1);
+    }
+    for (int j = 0; j < n_files; j++)
+        Parsing::remove_file(fns[j]);
+}
+
+TEST_F(TestDataFrame, TestLZCompression) {
+    shared_ptr<DataFrame<double>> fr = frame_<double>();
+    fr->lz_codec = make_shared<LZCodec>();
+    vector<uint32_t> iref, iref2;
+    vector<double> dref, dref2;
+    for (int i = 0; i < n_tests; i++) {
+        fr->lz_codec->shuffle = Random::rand_int(0, 2) == 0;
+        string fn = fr->save_dir + "/DF.LZ." + Parsing::to_string(i % 3);
+        fill_frame(1, iref, dref);
+        fr->save_data(1, fn);
+        fill_frame(1, iref2, dref2);
+        fr->prefetch_data(fn);
+        fr->load_data(1, fn);
+        check_frame(1, iref, dref);
+        fr->reset(1);
+    }
+    for (int i = 0; i < 3; i++)
+        Parsing::remove_file(fr->save_dir + "/DF.LZ." + Parsing::to_string(i));
+}
+
+TEST_F(TestDataFrame, TestScratchCache) {
+    shared_ptr<DataFrame<double>> fr = frame_<double>();
+    const int n_files = 6;
+    vector<vector<uint32_t>> irefs(n_files);
+    vector<vector<double>> drefs(n_files);
+    vector<string> fns(n_files);
+    // the cache can hold about three files
+    fr->scratch_cache_size = 3 * 100000 / 2 * sizeof(double);
+    int j = 0;
+    for (int i = 0; i < n_tests; i++) {
+        fr->save_buffering = Random::rand_int(0, 2) == 0;
+        fr->mmap_scratch = Random::rand_int(0, 2) == 0;
+        j = Random::rand_int(0, n_files);
+        fns[j] = fr->save_dir + "/DF.CACHE." + Parsing::to_string(j);
+        if (irefs[j].size() == 0 || Random::rand_int(0, 3) == 0) {
+            fill_frame(1, irefs[j], drefs[j]);
+            fr->save_data(1, fns[j]);
+        }
+        vector<uint32_t> iref;
+        vector<double> dref;
+        fill_frame(1, iref, dref);
+        fr->load_data(1, fns[j]);
+        check_frame(1, irefs[j], drefs[j]);
+        fr->reset(1);
+        EXPECT_LE(fr->scratch_cache_used, fr->scratch_cache_size);
+    }
+    EXPECT_GT(fr->n_cache_hits, 0);
+    EXPECT_GT(fr->n_cache_misses, 0);
+    EXPECT_GT(fr->n_cache_evictions, 0);
+    // without pending saves, the first load of a file misses the cache
+    // and the second load is served from the cache
+    fr->reset_buffer(1);
+    fr->mmap_scratch = false;
+    fr->clear_cache();
+    size_t n_hits = fr->n_cache_hits, n_misses = fr->n_cache_misses;
+    fr->load_data(1, fns[j]);
+    fr->reset(1);
+    fr->load_data(1, fns[j]);
+    check_frame(1, irefs[j], drefs[j]);
+    EXPECT_EQ(fr->n_cache_hits, n_hits + 1);
+    EXPECT_EQ(fr->n_cache_misses, n_misses + 1);
+    fr->reset(1);
+    // removed files are not served from the cache
+    Parsing::remove_file(fns[j]);
+    EXPECT_THROW(fr->load_data(1, fns[j]), runtime_error);
+    fr->reset(1);
+    fr->clear_cache();
+    EXPECT_EQ(fr->scratch_cache_used, 0);
+    for (int k = 0; k < n_files; k++)
+        if (k != j && fns[k] != "")
+            Parsing::remove_file(fns[k]);
+}
+
+TEST_F(TestDataFrame, TestScratchSpill) {
+    shared_ptr<DataFrame<double>> fr = frame_<double>();
+    fr->alt_save_dir = fr->save_dir + "/alt";
+    fr->tiered_scratch = true;
+    fr->scratch_cache_size = 1LL << 24;
+    vector<uint32_t> iref, iref2;
+    vector<double> dref, dref2;
+    string fn = fr->save_dir + "/DF.SPILL";
+    fill_frame(1, iref, dref);
+    fr->save_data(1, fn);
+    fr->reset(1);
+    string new_fn = fr->spill_data(fn);
+    EXPECT_EQ(new_fn, fr->alt_save_dir + "/DF.SPILL");
+    EXPECT_FALSE(Parsing::file_exists(fn));
+    EXPECT_TRUE(Parsing::file_exists(new_fn));
+    EXPECT_EQ(fr->n_spills, 1);
+    // the cached contents follow the file
+    fill_frame(1, iref2, dref2);
+    fr->load_data(1, new_fn);
+    check_frame(1, iref, dref);
+    EXPECT_EQ(fr->n_cache_hits, 1);
+    fr->reset(1);
+    fr->clear_cache();
+    fr->load_data(1, new_fn);
+    check_frame(1, iref, dref);
+    fr->reset(1);
+    fr->remove_data(new_fn);
+    EXPECT_FALSE(Parsing::file_exists(new_fn));
+    EXPECT_THROW(fr->load_data(1, new_fn), runtime_error);
+    fr->reset(1);
+}
+
+TEST_F(TestDataFrame, TestCompressedTensorStorage) {
+    shared_ptr<DataFrame<double>> fr = frame_<double>();
+    fr->compressed_sparse_tensor_storage = true;
+    vector<double> ref(10000);
+    Random::fill<double>(ref.data(), ref.size(), -5, 5);
+    // without any codec the data is written uncompressed
+    for (int ic = 0; ic < 2; ic++) {
+        fr->lz_codec = ic == 0 ? nullptr : make_shared<LZCodec>();
+        SparseMatrix<SZ, double> mat;
+        mat.data = ref.data(), mat.total_memory = ref.size();
+        stringstream ss;
+        mat.save_data(ss);
+        SparseMatrix<SZ, double> mat2(make_shared<VectorAllocator<double>>());
+        mat2.load_data(ss);
+        ASSERT_EQ(mat2.total_memory, ref.size());
+        EXPECT_EQ(memcmp(mat2.data, ref.data(), ref.size() * 8), 0);
+        mat2.deallocate();
+    }
+    fr->lz_codec = nullptr;
+    fr->compressed_sparse_tensor_storage = false;
+}
@@ -21,7 +21,7 @@ template <typename FL> class TestDMRGN2STO3G : public ::testing::Test {
                    const vector<vector<FLL>> &energies,
                    const shared_ptr<HamiltonianQC<S, FL>> &hamil,
                    const string &name, DecompositionTypes dt, NoiseTypes nt,
-                   bool condense = false);
+                   bool condense = false, bool mixed = false);
     void SetUp() override {
         cout << "BOND INTEGER SIZE = " << sizeof(ubond_t) << endl;
         Random::rand_seed(0);
@@ -48,7 +48,7 @@ template <typename S>
 void TestDMRGN2STO3G<FL>::test_dmrg(
     const vector<vector<S>> &targets, const vector<vector<FLL>> &energies,
     const shared_ptr<HamiltonianQC<S, FL>> &hamil, const string &name,
-    DecompositionTypes dt, NoiseTypes nt, bool condense) {
+    DecompositionTypes dt, NoiseTypes nt, bool condense, bool mixed) {
     Timer t;
     t.get_time();
     // MPO construction
@@ -105,7 +105,7 @@ void TestDMRGN2STO3G<FL>::test_dmrg(
                 make_shared<MovingEnvironment<S, FL, FL>>(mpo, mps, mps,
                                                           "DMRG");
             me->init_environments(false);
-            if (!condense)
+            if (!condense && !mixed)
                 me->delayed_contraction = OpNamesSet::normal_ops();
             me->cached_contraction = true;
 
@@ -116,6 +116,7 @@ void TestDMRGN2STO3G<FL>::test_dmrg(
             dmrg->decomp_type = dt;
             dmrg->noise_type = nt;
             dmrg->davidson_soft_max_iter = 200;
+            dmrg->davidson_mixed_precision = mixed;
             FLL energy = dmrg->solve(10, mps->center == 0, conv * 0.1);
 
             // deallocate persistent stack memory
@@ -232,6 +233,11 @@ TYPED_TEST(TestDMRGN2STO3G, TestSU2) {
     this->template test_dmrg<SU2>(
         targets, energies, hamil, "SU2 SVD RED PERT LM",
         DecompositionTypes::SVD, NoiseTypes::ReducedPerturbativeLowMem);
+#ifdef _USE_SINGLE_PREC
+    this->template test_dmrg<SU2>(targets, energies, hamil, "SU2 MIXED",
+                                  DecompositionTypes::DensityMatrix,
+                                  NoiseTypes::DensityMatrix, false, true);
+#endif
 
     hamil->deallocate();
     fcidump->deallocate();
@@ -132,3 +132,196 @@ TEST_F(TestFCIDUMP, TestCompressedComplexRead) {
     EXPECT_EQ(fcidump.cps_vs[0](0, 2, 1, 1), fcidump.cps_vs[0](1, 1, 2, 0));
     fcidump.deallocate();
 }
+
+TEST_F(TestFCIDUMP, TestBinaryReadWrite) {
+    for (string filename :
+         {"data/CR2.SVP.FCIDUMP", "data/N2.STO3G.UHF.FCIDUMP"}) {
+        FCIDUMP<double> fcidump, fd_map, fd_cps, fd_conv;
+        fcidump.read(filename);
+        fcidump.write_binary("nodex/FCIDUMP.BIN");
+        fcidump.write_binary("nodex/FCIDUMP.CPS.BIN", 1E-16);
+        FCIDUMP<double>::convert_to_binary(filename, "nodex/FCIDUMP.CONV.BIN",
+                                           0, 1000);
+        EXPECT_TRUE(BinaryIntegralHeader::is_binary("nodex/FCIDUMP.BIN"));
+        EXPECT_FALSE(BinaryIntegralHeader::is_binary(filename));
+        fd_map.read("nodex/FCIDUMP.BIN");
+        fd_cps.read("nodex/FCIDUMP.CPS.BIN");
+        fd_conv.read("nodex/FCIDUMP.CONV.BIN");
+        EXPECT_NE(fd_map.mdata, nullptr);
+        EXPECT_EQ(fd_cps.mdata, nullptr);
+        uint16_t n = fcidump.n_sites();
+        for (auto fd : {&fd_map, &fd_cps, &fd_conv}) {
+            // compression is lossy (below prec)
+            double tol = fd == &fd_cps ? 1E-15 : 0.0;
+            EXPECT_EQ(fd->params, fcidump.params);
+            EXPECT_EQ(fd->uhf, fcidump.uhf);
+            EXPECT_EQ(fd->const_e, fcidump.const_e);
+            for (uint8_t s = 0; s < 2; s++)
+                for (uint16_t i = 0; i < n; i++)
+                    for (uint16_t j = 0; j < n; j++)
+                        EXPECT_LE(abs(fd->t(s, i, j) - fcidump.t(s, i, j)),
+                                  tol);
+            for (uint8_t sl = 0; sl < 2; sl++)
+                for (uint8_t sr = 0; sr < 2; sr++)
+                    for (uint16_t i = 0; i < n; i++)
+                        for (uint16_t j = 0; j < n; j++)
+                            for (uint16_t k = 0; k < n; k += 7)
+                                for (uint16_t l = 0; l < n; l++)
+                                    EXPECT_LE(
+                                        abs(fd->v(sl, sr, i, j, k, l) -
+                                            fcidump.v(sl, sr, i, j, k, l)),
+                                        tol);
+            fd->deallocate();
+        }
+        // CompressedFCIDUMP from uncompressed and compressed binary files
+        for (string bin_filename :
+             {"nodex/FCIDUMP.BIN", "nodex/FCIDUMP.CPS.BIN"}) {
+            CompressedFCIDUMP<double> cfd(1E-16);
+            cfd.read(bin_filename);
+            cfd.write_binary("nodex/FCIDUMP.CPS2.BIN");
+            FCIDUMP<double> fd;
+            fd.read("nodex/FCIDUMP.CPS2.BIN");
+            EXPECT_EQ(cfd.const_e, fcidump.const_e);
+            for (uint16_t i = 0; i < n; i++)
+                for (uint16_t j = 0; j < n; j++) {
+                    EXPECT_LT(abs(cfd.t(1, i, j) - fcidump.t(1, i, j)), 1E-15);
+                    EXPECT_EQ(fd.t(1, i, j), cfd.t(1, i, j));
+                    for (uint16_t k = 0; k < n; k += 7)
+                        for (uint16_t l = 0; l < n; l++) {
+                            EXPECT_LT(abs(cfd.v(0, 1, i, j, k, l) -
+                                          fcidump.v(0, 1, i, j, k, l)),
+                                      1E-15);
+                            EXPECT_EQ(fd.v(0, 1, i, j, k, l),
+                                      cfd.v(0, 1, i, j, k, l));
+                        }
+                }
+            fd.deallocate();
+            cfd.deallocate();
+        }
+        fcidump.deallocate();
+    }
+    for (string bin_filename :
+         {"nodex/FCIDUMP.BIN", "nodex/FCIDUMP.CPS.BIN",
+          "nodex/FCIDUMP.CONV.BIN", "nodex/FCIDUMP.CPS2.BIN"})
+        Parsing::remove_file(bin_filename);
+}
+
+TEST_F(TestFCIDUMP, TestComplexBinaryReadWrite) {
+    FCIDUMP<complex<double>> fcidump, fd_map;
+    string filename = "data/CR2.SVP.FCIDUMP";
+    fcidump.read(filename);
+    fcidump.write_binary("nodex/FCIDUMP.BIN");
+    fd_map.read("nodex/FCIDUMP.BIN");
+    EXPECT_EQ(fd_map.const_e, fcidump.const_e);
+    EXPECT_EQ(fd_map.ts[0](0, 3), fcidump.ts[0](0, 3));
+    EXPECT_EQ(fd_map.vs[0](0, 2, 1, 1), fcidump.vs[0](0, 2, 1, 1));
+    // the private mapping is copy-on-write
+    fd_map.ts[0](0, 3) = 0.0;
+    fd_map.deallocate();
+    fd_map.read("nodex/FCIDUMP.BIN");
+    EXPECT_EQ(fd_map.ts[0](0, 3), fcidump.ts[0](0, 3));
+    EXPECT_THROW(FCIDUMP<double>().read_binary("nodex/FCIDUMP.BIN"),
+                 runtime_error);
+    fd_map.deallocate();
+    fcidump.deallocate();
+    Parsing::remove_file("nodex/FCIDUMP.BIN");
+}
+
+// FCIDUMP with overridden integral access (no direct array access)
+template <typename FL> struct TestWrappedFCIDUMP : FCIDUMP<FL> {
+    shared_ptr<FCIDUMP<FL>> fd;
+    TestWrappedFCIDUMP(const shared_ptr<FCIDUMP<FL>> &fd) : fd(fd) {
+        this->params = fd->params;
+        this->uhf = fd->uhf;
+        this->general = fd->general;
+    }
+    FL t(uint16_t i, uint16_t j) const override { return fd->t(i, j); }
+    FL t(uint8_t s, uint16_t i, uint16_t j) const override {
+        return fd->t(s, i, j);
+    }
+    FL v(uint16_t i, uint16_t j, uint16_t k, uint16_t l) const override {
+        return fd->v(i, j, k, l);
+    }
+    FL v(uint8_t sl, uint8_t sr, uint16_t i, uint16_t j, uint16_t k,
+         uint16_t l) const override {
+        return fd->v(sl, sr, i, j, k, l);
+    }
+};
+
+// serial construction of two-electron terms
+template <typename FL>
+void test_qc_two_body_term(const shared_ptr<FCIDUMP<FL>> &fcidump, bool sz,
+                           uint8_t si, uint8_t sj, double cutoff, FL factor,
+                           vector<uint16_t> &idx, vector<FL> &dt) {
+    uint16_t n = fcidump->n_sites();
+    array<uint16_t, 4> arr;
+    for (arr[0] = 0; arr[0] < n; arr[0]++)
+        for (arr[1] = 0; arr[1] < n; arr[1]++)
+            for (arr[2] = 0; arr[2] < n; arr[2]++)
+                for (arr[3] = 0; arr[3] < n; arr[3]++) {
+                    FL x = sz ? fcidump->v(si, sj, arr[0], arr[3], arr[1],
+                                           arr[2])
+                              : fcidump->v(arr[0], arr[3], arr[1], arr[2]);
+                    if (abs(x) > cutoff) {
+                        idx.insert(idx.end(), arr.begin(), arr.end());
+                        dt.push_back(factor * x);
+                    }
+                }
+}
+
+TEST_F(TestFCIDUMP, TestGeneralFCIDUMPFromQC) {
+    for (string filename :
+         {"data/N2.STO3G.FCIDUMP", "data/N2.STO3G.UHF.FCIDUMP"}) {
+        shared_ptr<FCIDUMP<double>> fcidump = make_shared<FCIDUMP<double>>();
+        fcidump->read(filename);
+        shared_ptr<FCIDUMP<double>> wfd =
+            make_shared<TestWrappedFCIDUMP<double>>(fcidump);
+        for (double cutoff : {0.0, 1E-3})
+            for (auto et :
+                 {ElemOpTypes::SU2, ElemOpTypes::SZ, ElemOpTypes::SGF}) {
+                auto gfd = GeneralFCIDUMP<double>::initialize_from_qc(
+                    fcidump, et, cutoff);
+                auto wgfd = GeneralFCIDUMP<double>::initialize_from_qc(
+                    wfd, et, cutoff);
+                const bool sz = et == ElemOpTypes::SZ;
+                for (int ix = 0; ix < (sz ? 4 : 1); ix++) {
+                    vector<uint16_t> idx;
+                    vector<double> dt;
+                    test_qc_two_body_term<double>(
+                        fcidump, sz, ix >> 1, ix & 1, cutoff,
+                        et == ElemOpTypes::SU2 ? 1.0 : 0.5, idx, dt);
+                    EXPECT_EQ(gfd->indices[ix], idx);
+                    EXPECT_EQ(gfd->data[ix], dt);
+                    EXPECT_EQ(wgfd->indices[ix], idx);
+                    EXPECT_EQ(wgfd->data[ix], dt);
+                }
+                EXPECT_EQ(gfd->indices.back(), wgfd->indices.back());
+                EXPECT_EQ(gfd->data.back(), wgfd->data.back());
+            }
+        fcidump->deallocate();
+    }
+    // timing as the number of orbitals grows
+    for (uint16_t n : {8, 16, 24, 32}) {
+        shared_ptr<FCIDUMP<double>> fcidump = make_shared<FCIDUMP<double>>();
+        vector<double> t((size_t)n * (n + 1) / 2), v(V8Int<double>(n).size());
+        Random::fill<double>(t.data(), t.size());
+        Random::fill<double>(v.data(), v.size());
+        fcidump->initialize_su2(n, n, 0, 1, 0.0, t.data(), t.size(), v.data(),
+                                v.size());
+        Timer timer;
+        timer.get_time();
+        vector<uint16_t> idx;
+        vector<double> dt;
+        test_qc_two_body_term<double>(fcidump, false, 0, 0, 0.0, 1.0, idx, dt);
+        double tserial = timer.get_time();
+        auto gfd = GeneralFCIDUMP<double>::initialize_from_qc(
+            fcidump, ElemOpTypes::SU2);
+        double tpara = timer.get_time();
+        EXPECT_EQ(gfd->indices[0], idx);
+        EXPECT_EQ(gfd->data[0], dt);
+        cout << "N = " << setw(4) << n << " T(serial) = " << fixed
+             << setprecision(4) << tserial << " T(parallel) = " << tpara
+             << endl;
+        fcidump->deallocate();
+    }
+}
@@ -146,3 +146,63 @@ TEST_F(TestFPCodec, TestFloatCompressedVector) {
         }
     }
 }
+
+TEST_F(TestFPCodec, TestDoubleFPCodecSIMD) {
+    const int max_level = FPCodec<double>().get_simd_level();
+    for (int i = 0; i < n_tests / 10; i++) {
+        int n = Random::rand_int(1, 50000);
+        vector<double> arr(n), arx(n);
+        Random::fill<double>(arr.data(), n, -5, 5);
+        for (int j = 0; j < n; j++)
+            if (Random::rand_int(0, 10) == 0)
+                arr[j] = Random::rand_int(0, 2) ? 0.0 : arr[j] * 1E-12;
+        double prec = pow(10.0, -Random::rand_int(0, 16));
+        string ref;
+        for (int level = 0; level <= max_level; level++) {
+            FPCodec<double> fpc(prec, Random::rand_int(1, 1 + n));
+            fpc.chunk_size = 4096;
+            fpc.simd_level = level;
+            stringstream ss;
+            fpc.write_array(ss, arr.data(), n);
+            // the compressed stream must not depend on the SIMD level
+            if (level == 0)
+                ref = ss.str();
+            else
+                EXPECT_EQ(ss.str(), ref);
+            ss.clear();
+            ss.seekg(0);
+            fpc.read_array(ss, arx.data(), n);
+            for (int j = 0; j < n; j++)
+                EXPECT_LE(abs(arr[j] - arx[j]), 2 * prec);
+        }
+    }
+}
+
+TEST_F(TestFPCodec, BenchmarkDoubleFPCodec) {
+    const size_t n = 1LL << 24;
+    const int max_level = FPCodec<double>().get_simd_level();
+    vector<double> arr(n), arx(n);
+    Random::fill<double>(arr.data(), n, -5, 5);
+    for (double prec : {1E-8, 1E-16}) {
+        for (int level = 0; level <= max_level; level++) {
+            FPCodec<double> fpc(prec, 1024);
+            fpc.simd_level = level;
+            stringstream ss;
+            Timer t;
+            t.get_time();
+            fpc.write_array(ss, arr.data(), n);
+            double tw = t.get_time();
+            ss.clear();
+            ss.seekg(0);
+            fpc.read_array(ss, arx.data(), n);
+            double tr = t.get_time();
+            double gb = sizeof(double) * n / 1E9;
+            cout << "PREC = " << scientific << setprecision(0) << prec
+                 << " SIMD = " << level << " RATIO = " << fixed
+                 << setprecision(3) << (double)fpc.ncpsd / fpc.ndata
+                 << " ENCODE = " << gb / tw << " GB/S"
+                 << " DECODE = " << gb / tr << " GB/S" << endl;
+            EXPECT_LE(abs(arr[n - 1] - arx[n - 1]), 2 * prec);
+        }
+    }
+}
@@ -0,0 +1,299 @@
+
+#include "block2_core.hpp"
+#include "block2_dmrg.hpp"
+#include <gtest/gtest.h>
+
+using namespace block2;
+
+template <typename FL> class TestGeneralMPON2STO3G : public ::testing::Test {
+  protected:
+    size_t isize = 1LL << 24;
+    size_t dsize = 1LL << 30;
+    typedef typename GMatrix<FL>::FP FP;
+
+    template <typename S>
+    shared_ptr<MPO<S, FL>>
+    build_mpo(const shared_ptr<GeneralHamiltonian<S, FL>> &gham,
+              const shared_ptr<GeneralFCIDUMP<FL>> &gfd,
+              MPOAlgorithmTypes algo_type, int n_threads);
+    template <typename S>
+    void check_mpo(const shared_ptr<MPO<S, FL>> &a,
+                   const shared_ptr<MPO<S, FL>> &b);
+    template <typename S>
+    void test_mpo(const shared_ptr<FCIDUMP<FL>> &fcidump, ElemOpTypes et,
+                  const vector<MPOAlgorithmTypes> &algo_types);
+    template <typename S>
+    void test_update(const shared_ptr<FCIDUMP<FL>> &fcidump, ElemOpTypes et,
+                     MPOAlgorithmTypes algo_type);
+    template <typename S>
+    void test_minimal_memory(const shared_ptr<FCIDUMP<FL>> &fcidump,
+                             ElemOpTypes et,
+                             const vector<MPOAlgorithmTypes> &algo_types);
+    void SetUp() override {
+        Random::rand_seed(0);
+        frame_<FP>() = make_shared<DataFrame<FP>>(isize, dsize, "nodex");
+        frame_<FP>()->use_main_stack = false;
+        frame_<FP>()->minimal_disk_usage = true;
+        frame_<FP>()->minimal_memory_usage = false;
+    }
+    void TearDown() override {
+        frame_<FP>()->activate(0);
+        assert(ialloc_()->used == 0 && dalloc_<FP>()->used == 0);
+        frame_<FP>() = nullptr;
+        threading_() = make_shared<Threading>(
+            ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global, 8, 8,
+            1);
+    }
+};
+
+template <typename FL>
+template <typename S>
+shared_ptr<MPO<S, FL>> TestGeneralMPON2STO3G<FL>::build_mpo(
+    const shared_ptr<GeneralHamiltonian<S, FL>> &gham,
+    const shared_ptr<GeneralFCIDUMP<FL>> &gfd, MPOAlgorithmTypes algo_type,
+    int n_threads) {
+    threading_() = make_shared<Threading>(
+        ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global,
+        n_threads, n_threads, 1);
+    threading_()->seq_type = SeqTypes::Tasked;
+    shared_ptr<MPO<S, FL>> mpo = make_shared<GeneralMPO<S, FL>>(
+        gham, gfd, algo_type, 1E-7, -1, 0);
+    mpo->build();
+    return mpo;
+}
+
+template <typename FL>
+template <typename S>
+void TestGeneralMPON2STO3G<FL>::check_mpo(const shared_ptr<MPO<S, FL>> &a,
+                                          const shared_ptr<MPO<S, FL>> &b) {
+    ASSERT_EQ(a->n_sites, b->n_sites);
+    for (int i = 0; i < a->n_sites; i++) {
+        stringstream sa, sb;
+        save_symbolic(a->tensors[i]->lmat, sa);
+        save_symbolic(b->tensors[i]->lmat, sb);
+        save_symbolic(a->left_operator_names[i], sa);
+        save_symbolic(b->left_operator_names[i], sb);
+        save_symbolic(a->right_operator_names[i], sa);
+        save_symbolic(b->right_operator_names[i], sb);
+        EXPECT_TRUE(sa.str() == sb.str());
+        // ops are keyed by pointers, so they are compared by name
+        map<string, string> opsa, opsb;
+        for (auto &op : a->tensors[i]->ops) {
+            stringstream ss;
+            op.second->save_data(ss);
+            opsa[op.first->to_str()] = ss.str();
+        }
+        for (auto &op : b->tensors[i]->ops) {
+            stringstream ss;
+            op.second->save_data(ss);
+            opsb[op.first->to_str()] = ss.str();
+        }
+        EXPECT_TRUE(opsa == opsb);
+    }
+}
+
+template <typename FL>
+template <typename S>
+void TestGeneralMPON2STO3G<FL>::test_mpo(
+    const shared_ptr<FCIDUMP<FL>> &fcidump, ElemOpTypes et,
+    const vector<MPOAlgorithmTypes> &algo_types) {
+    vector<uint8_t> orbsym = fcidump->template orb_sym<uint8_t>();
+    transform(orbsym.begin(), orbsym.end(), orbsym.begin(),
+              PointGroup::swap_pg(PGTypes::D2H));
+    fcidump->symmetrize(orbsym);
+    shared_ptr<GeneralHamiltonian<S, FL>> gham =
+        make_shared<GeneralHamiltonian<S, FL>>(S(0), fcidump->n_sites(),
+                                               orbsym);
+    shared_ptr<GeneralFCIDUMP<FL>> gfd =
+        GeneralFCIDUMP<FL>::initialize_from_qc(fcidump, et)->adjust_order();
+    for (auto algo_type : algo_types) {
+        Timer t;
+        t.get_time();
+        shared_ptr<MPO<S, FL>> mpo_serial = build_mpo(gham, gfd, algo_type, 1);
+        double ts = t.get_time();
+        shared_ptr<MPO<S, FL>> mpo_parallel =
+            build_mpo(gham, gfd, algo_type, 4);
+        double tp = t.get_time();
+        cout << "MPO " << algo_type << " T(serial) = " << fixed
+             << setprecision(3) << ts << " T(parallel) = " << tp << endl;
+        check_mpo(mpo_serial, mpo_parallel);
+        mpo_parallel->deallocate();
+        mpo_serial->deallocate();
+    }
+    gham->deallocate();
+}
+
+template <typename FL>
+template <typename S>
+void TestGeneralMPON2STO3G<FL>::test_update(
+    const shared_ptr<FCIDUMP<FL>> &fcidump, ElemOpTypes et,
+    MPOAlgorithmTypes algo_type) {
+    vector<uint8_t> orbsym = fcidump->template orb_sym<uint8_t>();
+    transform(orbsym.begin(), orbsym.end(), orbsym.begin(),
+              PointGroup::swap_pg(PGTypes::D2H));
+    fcidump->symmetrize(orbsym);
+    shared_ptr<GeneralHamiltonian<S, FL>> gham =
+        make_shared<GeneralHamiltonian<S, FL>>(S(0), fcidump->n_sites(),
+                                               orbsym);
+    shared_ptr<GeneralFCIDUMP<FL>> gfd =
+        GeneralFCIDUMP<FL>::initialize_from_qc(fcidump, et)->adjust_order();
+    // same terms with perturbed coefficients
+    shared_ptr<GeneralFCIDUMP<FL>> gfd_new =
+        make_shared<GeneralFCIDUMP<FL>>(*gfd);
+    gfd_new->const_e += 0.5;
+    for (auto &xd : gfd_new->data)
+        for (size_t it = 0; it < xd.size(); it++)
+            if (abs(xd[it]) > 1E-4)
+                xd[it] *= (FL)(1.0 + 0.01 * (it % 7));
+    // one extra term, which changes the structure
+    shared_ptr<GeneralFCIDUMP<FL>> gfd_ext =
+        make_shared<GeneralFCIDUMP<FL>>(*gfd_new);
+    for (size_t ix = 0; ix < gfd_ext->exprs.size(); ix++)
+        if (gfd_ext->data[ix].size() != 0) {
+            const size_t nn = gfd_ext->indices[ix].size() /
+                              gfd_ext->data[ix].size();
+            for (size_t i = 0; i < nn; i++)
+                gfd_ext->indices[ix].push_back(gfd_ext->indices[ix][i]);
+            gfd_ext->data[ix].push_back((FL)0.1);
+            break;
+        }
+    threading_() = make_shared<Threading>(
+        ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global, 4, 4, 1);
+    threading_()->seq_type = SeqTypes::Tasked;
+    shared_ptr<GeneralMPO<S, FL>> mpo =
+        make_shared<GeneralMPO<S, FL>>(gham, gfd, algo_type, 1E-7, -1, 0);
+    mpo->updatable = true;
+    mpo->build();
+    // the updated tensors cannot be written back to an archive file
+    mpo->archive_filename = "nodex/HQC.MPO.ARCHIVE";
+    EXPECT_THROW(mpo->update(gfd_new), runtime_error);
+    mpo->archive_filename = "";
+    EXPECT_TRUE(mpo->update(gfd_new));
+    shared_ptr<MPO<S, FL>> mpo_ref = build_mpo(gham, gfd_new, algo_type, 4);
+    EXPECT_EQ(mpo->const_e, mpo_ref->const_e);
+    check_mpo<S>(mpo, mpo_ref);
+    mpo_ref->deallocate();
+    EXPECT_FALSE(mpo->update(gfd_ext));
+    mpo_ref = build_mpo(gham, gfd_ext, algo_type, 4);
+    check_mpo<S>(mpo, mpo_ref);
+    mpo_ref->deallocate();
+    mpo->deallocate();
+    // in minimal memory mode, the recorded site operators are stored in disk
+    frame_<FP>()->minimal_memory_usage = true;
+    mpo = make_shared<GeneralMPO<S, FL>>(gham, gfd, algo_type, 1E-7, -1, 0,
+                                         "HQCUPD");
+    mpo->updatable = true;
+    mpo->build();
+    for (auto &rec : mpo->site_records) {
+        EXPECT_TRUE(rec.ops_saved);
+        EXPECT_EQ(rec.ops.size(), 0);
+    }
+    EXPECT_TRUE(mpo->update(gfd_new));
+    for (int i = 0; i < mpo->n_sites; i++) {
+        EXPECT_EQ(mpo->site_records[i].ops.size(), 0);
+        mpo->load_tensor(i);
+        mpo->load_left_operators(i);
+        mpo->load_right_operators(i);
+    }
+    frame_<FP>()->minimal_memory_usage = false;
+    mpo_ref = build_mpo(gham, gfd_new, algo_type, 4);
+    check_mpo<S>(mpo, mpo_ref);
+    mpo_ref->deallocate();
+    mpo->deallocate();
+    gham->deallocate();
+}
+
+template <typename FL>
+template <typename S>
+void TestGeneralMPON2STO3G<FL>::test_minimal_memory(
+    const shared_ptr<FCIDUMP<FL>> &fcidump, ElemOpTypes et,
+    const vector<MPOAlgorithmTypes> &algo_types) {
+    vector<uint8_t> orbsym = fcidump->template orb_sym<uint8_t>();
+    transform(orbsym.begin(), orbsym.end(), orbsym.begin(),
+              PointGroup::swap_pg(PGTypes::D2H));
+    fcidump->symmetrize(orbsym);
+    shared_ptr<GeneralHamiltonian<S, FL>> gham =
+        make_shared<GeneralHamiltonian<S, FL>>(S(0), fcidump->n_sites(),
+                                               orbsym);
+    shared_ptr<GeneralFCIDUMP<FL>> gfd =
+        GeneralFCIDUMP<FL>::initialize_from_qc(fcidump, et)->adjust_order();
+    for (auto algo_type : algo_types) {
+        shared_ptr<MPO<S, FL>> mpo_ref = build_mpo(gham, gfd, algo_type, 4);
+        frame_<FP>()->minimal_memory_usage = true;
+        shared_ptr<MPO<S, FL>> mpo = make_shared<GeneralMPO<S, FL>>(
+            gham, gfd, algo_type, 1E-7, -1, 0, "HQCMIN");
+        mpo->build();
+        for (int i = 0; i < mpo->n_sites; i++) {
+            EXPECT_TRUE(mpo->tensors[i] == nullptr);
+            mpo->load_tensor(i);
+            mpo->load_left_operators(i);
+            mpo->load_right_operators(i);
+        }
+        frame_<FP>()->minimal_memory_usage = false;
+        check_mpo<S>(mpo, mpo_ref);
+        mpo->deallocate();
+        mpo_ref->deallocate();
+    }
+    gham->deallocate();
+}
+
+#ifdef _USE_COMPLEX
+typedef ::testing::Types<complex<double>> TestFL;
+#else
+typedef ::testing::Types<double> TestFL;
+#endif
+
+TYPED_TEST_CASE(TestGeneralMPON2STO3G, TestFL);
+
+TYPED_TEST(TestGeneralMPON2STO3G, TestSZ) {
+    using FL = TypeParam;
+    shared_ptr<FCIDUMP<FL>> fcidump = make_shared<FCIDUMP<FL>>();
+    fcidump->read("data/N2.STO3G.FCIDUMP");
+    this->template test_mpo<SZ>(
+        fcidump, ElemOpTypes::SZ,
+        {MPOAlgorithmTypes::FastBlockedSumDisjointSVD,
+         MPOAlgorithmTypes::FastBipartite, MPOAlgorithmTypes::SVD,
+         MPOAlgorithmTypes::NC});
+    fcidump->deallocate();
+}
+
+TYPED_TEST(TestGeneralMPON2STO3G, TestUpdateSZ) {
+    using FL = TypeParam;
+    shared_ptr<FCIDUMP<FL>> fcidump = make_shared<FCIDUMP<FL>>();
+    fcidump->read("data/N2.STO3G.FCIDUMP");
+    this->template test_update<SZ>(fcidump, ElemOpTypes::SZ,
+                                   MPOAlgorithmTypes::FastBipartite);
+    fcidump->deallocate();
+}
+
+TYPED_TEST(TestGeneralMPON2STO3G, TestSU2) {
+    using FL = TypeParam;
+    shared_ptr<FCIDUMP<FL>> fcidump = make_shared<FCIDUMP<FL>>();
+    fcidump->read("data/N2.STO3G.FCIDUMP");
+    this->template test_mpo<SU2>(
+        fcidump, ElemOpTypes::SU2,
+        {MPOAlgorithmTypes::FastBlockedSVD,
+         MPOAlgorithmTypes::FastBlockedRescaledSumDisjointSVD,
+         MPOAlgorithmTypes::FastBlockedBipartite});
+    fcidump->deallocate();
+}
+
+TYPED_TEST(TestGeneralMPON2STO3G, TestUpdateSU2) {
+    using FL = TypeParam;
+    shared_ptr<FCIDUMP<FL>> fcidump = make_shared<FCIDUMP<FL>>();
+    fcidump->read("data/N2.STO3G.FCIDUMP");
+    this->template test_update<SU2>(fcidump, ElemOpTypes::SU2,
+                                    MPOAlgorithmTypes::FastBlockedBipartite);
+    fcidump->deallocate();
+}
+
+TYPED_TEST(TestGeneralMPON2STO3G, TestMinimalMemorySZ) {
+    using FL = TypeParam;
+    shared_ptr<FCIDUMP<FL>> fcidump = make_shared<FCIDUMP<FL>>();
+    fcidump->read("data/N2.STO3G.FCIDUMP");
+    this->template test_minimal_memory<SZ>(
+        fcidump, ElemOpTypes::SZ,
+        {MPOAlgorithmTypes::FastBipartite,
+         MPOAlgorithmTypes::FastBlockedSumDisjointSVD});
+    fcidump->deallocate();
+}
@@ -233,6 +233,8 @@ void TestRTEGreenFunctionH10STO6G<FL>::test_dmrg(
     linear->noise_type = NoiseTypes::ReducedPerturbative;
     linear->decomp_type = DecompositionTypes::SVD;
     linear->right_weight = 0.2;
+    linear->linear_recycle = dot == 2;
+    linear->linear_recycle_next_site = dot == 2;
     linear->iprint = 2;
     FL igf = linear->solve(20, ymps->center == 0, 1E-12);
     igf = linear->targets.back().back();
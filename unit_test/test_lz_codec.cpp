@@ -0,0 +1,94 @@
+
+#include "block2_core.hpp"
+#include "gtest/gtest.h"
+
+using namespace block2;
+
+class TestLZCodec : public ::testing::Test {
+  protected:
+    static const int n_tests = 200;
+    void SetUp() override { Random::rand_seed(0); }
+    void TearDown() override {}
+};
+
+TEST_F(TestLZCodec, TestDoubleLZCodec) {
+    for (int i = 0; i < n_tests; i++) {
+        int n = i < n_tests / 10 ? Random::rand_int(1, 12)
+                                 : Random::rand_int(1, 50000);
+        size_t chunk_size = Random::rand_int(1, 1 + n * 8 * 4 / 3);
+        vector<double> arr(n), arx(n);
+        int kind = Random::rand_int(0, 3);
+        if (kind == 0)
+            Random::fill<double>(arr.data(), n, -5, 5);
+        else if (kind == 1)
+            // sparse data with many exact zeros
+            for (int j = 0; j < n; j++)
+                arr[j] = Random::rand_int(0, 4) == 0 ? Random::rand_double()
+                                                     : 0.0;
+        else
+            // integers stored as floating-point numbers
+            for (int j = 0; j < n; j++)
+                arr[j] = (double)Random::rand_int(0, 100);
+        LZCodec lzc(chunk_size, Random::rand_int(0, 2) == 0);
+        stringstream ss;
+        lzc.write_array(ss, arr.data(), n);
+        ss.clear();
+        ss.seekg(0);
+        lzc.read_array(ss, arx.data(), n);
+        ASSERT_EQ(memcmp(arr.data(), arx.data(), sizeof(double) * n), 0);
+    }
+}
+
+TEST_F(TestLZCodec, TestIntegerLZCodec) {
+    for (int i = 0; i < n_tests; i++) {
+        int n = Random::rand_int(1, 50000);
+        vector<uint32_t> arr(n), arx(n);
+        for (int j = 0; j < n; j++)
+            arr[j] = (uint32_t)Random::rand_int(0, 1000);
+        LZCodec lzc;
+        stringstream ss;
+        lzc.write_array(ss, arr.data(), n);
+        ss.clear();
+        ss.seekg(0);
+        LZCodec().read_array(ss, arx.data(), n);
+        ASSERT_EQ(arr, arx);
+    }
+}
+
+TEST_F(TestLZCodec, TestCompressionRatio) {
+    const int n = 1 << 20;
+    vector<double> arr(n, 0.0), arx(n);
+    for (int j = 0; j < n; j += 4)
+        arr[j] = (double)Random::rand_int(0, 1000) / 8;
+    for (bool shuffle : {false, true}) {
+        LZCodec lzc((size_t)1 << 16, shuffle);
+        stringstream ss;
+        lzc.write_array(ss, arr.data(), n);
+        EXPECT_EQ(lzc.ndata, sizeof(double) * n);
+        EXPECT_LT(lzc.ncpsd, lzc.ndata / 4);
+        ss.clear();
+        ss.seekg(0);
+        lzc.read_array(ss, arx.data(), n);
+        EXPECT_EQ(arr, arx);
+    }
+}
+
+TEST_F(TestLZCodec, TestCorruptedData) {
+    const int n = 10000;
+    vector<double> arr(n), arx(n);
+    for (int j = 0; j < n; j++)
+        arr[j] = (double)(j % 37);
+    LZCodec lzc;
+    stringstream ss;
+    lzc.write_array(ss, arr.data(), n);
+    string s = ss.str();
+    for (size_t j = 32; j < s.length() - 4; j++)
+        s[j] = (char)0xff;
+    stringstream sx(s);
+    EXPECT_THROW(lzc.read_array(sx, arx.data(), n), runtime_error);
+    // zero chunk size in the header
+    s = ss.str();
+    memset(&s[4], 0, sizeof(size_t));
+    stringstream sz(s);
+    EXPECT_THROW(lzc.read_array(sz, arx.data(), n), runtime_error);
+}
@@ -816,6 +816,129 @@ TYPED_TEST(TestMatrix, TestDavidson) {
     }
 }
 
+TYPED_TEST(TestMatrix, TestBlockDavidson) {
+    using FL = TypeParam;
+    const int sz = is_same<FL, double>::value ? 200 : 120;
+    const FL conv = is_same<FL, double>::value ? 1E-8 : 1E-7;
+    const FL thrd = is_same<FL, double>::value ? 1E-6 : 5E-3;
+    const FL thrd2 = is_same<FL, double>::value ? 1E-3 : 1E-1;
+    using MatMul = typename TestMatrix<FL>::MatMul;
+    for (int i = 0; i < this->n_tests; i++) {
+        MKL_INT n = Random::rand_int(1, sz);
+        MKL_INT k = min(n, (MKL_INT)Random::rand_int(1, 10));
+        int ndav = 0, nop = 0, nmult = 0;
+        GMatrix<FL> a(dalloc_<FL>()->allocate(n * n), n, n);
+        GDiagonalMatrix<FL> aa(dalloc_<FL>()->allocate(n), n);
+        GDiagonalMatrix<FL> ww(dalloc_<FL>()->allocate(n), n);
+        vector<GMatrix<FL>> bs(k, GMatrix<FL>(nullptr, n, 1));
+        Random::fill<FL>(a.data, a.size());
+        for (MKL_INT ki = 0; ki < n; ki++) {
+            for (MKL_INT kj = 0; kj < ki; kj++)
+                a(kj, ki) = a(ki, kj);
+            aa(ki, ki) = a(ki, ki);
+        }
+        for (int i = 0; i < k; i++) {
+            bs[i].allocate();
+            bs[i].clear();
+            bs[i].data[i] = 1;
+        }
+        MatMul mop(a);
+        auto bop = [&mop, &nop, &nmult](const vector<GMatrix<FL>> &b,
+                                        const vector<GMatrix<FL>> &c) {
+            nop++;
+            for (size_t j = 0; j < b.size(); j++, nmult++)
+                mop(b[j], c[j]);
+        };
+        vector<FL> vw = IterativeMatrixFunctions<FL>::block_davidson(
+            bop, aa, bs, 0, DavidsonTypes::Block, ndav, false,
+            (shared_ptr<ParallelCommunicator<SZ>>)nullptr, conv, 0.0, n * k * 5,
+            n * k * 4, k * 2, max((MKL_INT)5, k + 10));
+        EXPECT_EQ(nop, ndav);
+        EXPECT_GE(nmult, nop);
+        ASSERT_EQ((int)vw.size(), k);
+        GDiagonalMatrix<FL> w(&vw[0], k);
+        GMatrixFunctions<FL>::eigs(a, ww);
+        GDiagonalMatrix<FL> w2(ww.data, k);
+        ASSERT_TRUE(GMatrixFunctions<FL>::all_close(w, w2, thrd, thrd));
+        for (int i = 0; i < k; i++)
+            ASSERT_TRUE(GMatrixFunctions<FL>::all_close(
+                            bs[i], GMatrix<FL>(a.data + a.n * i, a.n, 1), thrd2,
+                            thrd2) ||
+                        GMatrixFunctions<FL>::all_close(
+                            bs[i], GMatrix<FL>(a.data + a.n * i, a.n, 1), thrd2,
+                            thrd2, -1.0));
+        for (int i = k - 1; i >= 0; i--)
+            bs[i].deallocate();
+        ww.deallocate();
+        aa.deallocate();
+        a.deallocate();
+    }
+}
+
+TYPED_TEST(TestMatrix, TestLanczosLOBPCG) {
+    using FL = TypeParam;
+    const int sz = is_same<FL, double>::value ? 200 : 120;
+    const FL conv = is_same<FL, double>::value ? 1E-12 : 1E-7;
+    const FL thrd = is_same<FL, double>::value ? 1E-6 : 5E-3;
+    const FL thrd2 = is_same<FL, double>::value ? 1E-3 : 1E-1;
+    using MatMul = typename TestMatrix<FL>::MatMul;
+    for (int i = 0; i < this->n_tests; i++) {
+        MKL_INT n = Random::rand_int(1, sz);
+        MKL_INT k = min(n, (MKL_INT)Random::rand_int(1, 5));
+        GMatrix<FL> a(dalloc_<FL>()->allocate(n * n), n, n);
+        GDiagonalMatrix<FL> aa(dalloc_<FL>()->allocate(n), n);
+        GDiagonalMatrix<FL> ww(dalloc_<FL>()->allocate(n), n);
+        vector<GMatrix<FL>> bs(k, GMatrix<FL>(nullptr, n, 1));
+        Random::fill<FL>(a.data, a.size());
+        for (MKL_INT ki = 0; ki < n; ki++) {
+            for (MKL_INT kj = 0; kj < ki; kj++)
+                a(kj, ki) = a(ki, kj);
+            aa(ki, ki) = a(ki, ki);
+        }
+        for (int i = 0; i < k; i++)
+            bs[i].allocate();
+        MatMul mop(a);
+        for (DavidsonTypes dt : {DavidsonTypes::Lanczos, DavidsonTypes::LOBPCG}) {
+            int ndav = 0, nmult = 0;
+            auto op = [&mop, &nmult](const GMatrix<FL> &b,
+                                     const GMatrix<FL> &c) {
+                nmult++;
+                mop(b, c);
+            };
+            for (int i = 0; i < k; i++) {
+                bs[i].clear();
+                bs[i].data[i] = 1;
+            }
+            vector<FL> vw = IterativeMatrixFunctions<FL>::davidson(
+                op, aa, bs, 0, dt, ndav, false,
+                (shared_ptr<ParallelCommunicator<SZ>>)nullptr, conv, 0.0,
+                n * k * 50, -1, k * 2, max((MKL_INT)5, k + 10));
+            EXPECT_GE(nmult, ndav);
+            ASSERT_EQ((int)vw.size(), k);
+            GMatrix<FL> ac(dalloc_<FL>()->allocate(n * n), n, n);
+            GMatrixFunctions<FL>::copy(ac, a);
+            GMatrixFunctions<FL>::eigs(ac, ww);
+            GDiagonalMatrix<FL> w(&vw[0], k);
+            GDiagonalMatrix<FL> w2(ww.data, k);
+            ASSERT_TRUE(GMatrixFunctions<FL>::all_close(w, w2, thrd, thrd));
+            for (int i = 0; i < k; i++)
+                ASSERT_TRUE(
+                    GMatrixFunctions<FL>::all_close(
+                        bs[i], GMatrix<FL>(ac.data + ac.n * i, ac.n, 1),
+                        thrd2, thrd2) ||
+                    GMatrixFunctions<FL>::all_close(
+                        bs[i], GMatrix<FL>(ac.data + ac.n * i, ac.n, 1),
+                        thrd2, thrd2, -1.0));
+            ac.deallocate();
+        }
+        for (int i = k - 1; i >= 0; i--)
+            bs[i].deallocate();
+        ww.deallocate();
+        aa.deallocate();
+        a.deallocate();
+    }
+}
+
 TYPED_TEST(TestMatrix, TestLinear) {
     using FL = TypeParam;
     const int sz = is_same<FL, double>::value ? 200 : 75;
@@ -1589,6 +1712,143 @@ TYPED_TEST(TestMatrix, TestGCROT) {
     }
 }
 
+TYPED_TEST(TestMatrix, TestGCROTRecycle) {
+    using FL = TypeParam;
+    const int sz = is_same<FL, double>::value ? 200 : 75;
+    const FL conv = is_same<FL, double>::value ? 1E-14 : 1E-7;
+    const FL thrd = is_same<FL, double>::value ? 1E-3 : 1E+0;
+    using MatMul = typename TestMatrix<FL>::MatMul;
+    int nmult_total[2] = {0, 0};
+    for (int i = 0; i < this->n_tests; i++) {
+        MKL_INT m = Random::rand_int(1, sz);
+        MKL_INT n = 1;
+        FL eta = 0.05;
+        GMatrix<FL> ax(dalloc_<FL>()->allocate(m * m), m, m);
+        GMatrix<FL> a(dalloc_<FL>()->allocate(m * m), m, m);
+        GMatrix<FL> af(dalloc_<FL>()->allocate(m * m), m, m);
+        GMatrix<FL> b(dalloc_<FL>()->allocate(n * m), m, n);
+        GMatrix<FL> x(dalloc_<FL>()->allocate(n * m), m, n);
+        GMatrix<FL> xg(dalloc_<FL>()->allocate(n * m), m, n);
+        Random::fill<FL>(ax.data, ax.size());
+        Random::fill<FL>(b.data, b.size());
+        GMatrixFunctions<FL>::multiply(ax, false, ax, true, a, 1.0, 0.0);
+        for (MKL_INT k = 0; k < m; k++)
+            a(k, k) += eta;
+        // a sequence of shifted systems (a + shift) x = b
+        for (int ir = 0; ir < 2; ir++) {
+            shared_ptr<KrylovRecycleSpace<FL>> recycle =
+                ir ? make_shared<KrylovRecycleSpace<FL>>() : nullptr;
+            for (int iw = 0; iw < 5; iw++) {
+                FL shift = (FL)0.01 * iw;
+                int nmult = 0, niter = 0;
+                auto mop = [&a, shift](const GMatrix<FL> &b,
+                                       const GMatrix<FL> &c) {
+                    GMatrixFunctions<FL>::multiply(a, false, b, false, c, 1.0,
+                                                   0.0);
+                    GMatrixFunctions<FL>::iadd(c, b, shift);
+                };
+                // only us is available (cs rebuilt by the solver)
+                if (recycle != nullptr && iw == 3)
+                    recycle->cs.clear();
+                x.clear();
+                IterativeMatrixFunctions<FL>::gcrotmk(
+                    mop, GDiagonalMatrix<FL>(nullptr, 0), x, b, nmult, niter,
+                    20, 10, 0.0, false,
+                    (shared_ptr<ParallelCommunicator<SZ>>)nullptr, conv, 10000,
+                    -1, recycle, shift);
+                nmult_total[ir] += nmult;
+                af.clear();
+                GMatrixFunctions<FL>::transpose(af, a, 1.0);
+                for (MKL_INT k = 0; k < m; k++)
+                    af(k, k) += shift;
+                GMatrixFunctions<FL>::copy(xg, b);
+                GMatrixFunctions<FL>::linear(af, xg.flip_dims());
+                EXPECT_TRUE(GMatrixFunctions<FL>::all_close(xg, x, thrd, thrd));
+            }
+        }
+        xg.deallocate();
+        x.deallocate();
+        b.deallocate();
+        af.deallocate();
+        a.deallocate();
+        ax.deallocate();
+    }
+    EXPECT_LT(nmult_total[1], nmult_total[0]);
+}
+
+TYPED_TEST(TestMatrix, TestCGRecycle) {
+    using FL = TypeParam;
+    const int sz = is_same<FL, double>::value ? 200 : 75;
+    const FL conv = is_same<FL, double>::value ? 1E-14 : 1E-7;
+    const FL thrd = is_same<FL, double>::value ? 1E-3 : 1E+0;
+    int nmult_total[2] = {0, 0};
+    for (int i = 0; i < this->n_tests; i++) {
+        MKL_INT m = Random::rand_int(1, sz);
+        MKL_INT n = 1;
+        FL eta = 0.05;
+        GMatrix<FL> ax(dalloc_<FL>()->allocate(m * m), m, m);
+        GMatrix<FL> a(dalloc_<FL>()->allocate(m * m), m, m);
+        GMatrix<FL> af(dalloc_<FL>()->allocate(m * m), m, m);
+        GMatrix<FL> b(dalloc_<FL>()->allocate(n * m), m, n);
+        GMatrix<FL> x(dalloc_<FL>()->allocate(n * m), m, n);
+        GMatrix<FL> xg(dalloc_<FL>()->allocate(n * m), m, n);
+        Random::fill<FL>(ax.data, ax.size());
+        Random::fill<FL>(b.data, b.size());
+        GMatrixFunctions<FL>::multiply(ax, false, ax, true, a, 1.0, 0.0);
+        for (MKL_INT k = 0; k < m; k++)
+            a(k, k) += eta;
+        // a sequence of shifted systems (a + shift) x = b
+        // with the latest solutions as the recycled space
+        for (int ir = 0; ir < 2; ir++) {
+            shared_ptr<KrylovRecycleSpace<FL>> recycle =
+                ir ? make_shared<KrylovRecycleSpace<FL>>() : nullptr;
+            for (int iw = 0; iw < 5; iw++) {
+                FL shift = (FL)0.01 * iw;
+                int nmult = 0;
+                auto mop = [&a, shift](const GMatrix<FL> &b,
+                                       const GMatrix<FL> &c) {
+                    GMatrixFunctions<FL>::multiply(a, false, b, false, c, 1.0,
+                                                   0.0);
+                    GMatrixFunctions<FL>::iadd(c, b, shift);
+                };
+                // only us is available for the second half
+                if (recycle != nullptr && iw == 3)
+                    recycle->cs.clear();
+                x.clear();
+                nmult_total[ir] +=
+                    IterativeMatrixFunctions<FL>::recycle_initial_guess(
+                        mop, x, b, 0.0, recycle, shift,
+                        (shared_ptr<ParallelCommunicator<SZ>>)nullptr);
+                IterativeMatrixFunctions<FL>::conjugate_gradient(
+                    mop, GDiagonalMatrix<FL>(nullptr, 0), x, b, nmult, 0.0,
+                    false, (shared_ptr<ParallelCommunicator<SZ>>)nullptr,
+                    conv, 0.0, 10000);
+                nmult_total[ir] += nmult;
+                nmult_total[ir] +=
+                    IterativeMatrixFunctions<FL>::recycle_add_solution(
+                        mop, x, 0.0, recycle, shift,
+                        (shared_ptr<ParallelCommunicator<SZ>>)nullptr);
+                if (recycle != nullptr)
+                    EXPECT_LE(recycle->nk, recycle->max_nk);
+                af.clear();
+                GMatrixFunctions<FL>::transpose(af, a, 1.0);
+                for (MKL_INT k = 0; k < m; k++)
+                    af(k, k) += shift;
+                GMatrixFunctions<FL>::copy(xg, b);
+                GMatrixFunctions<FL>::linear(af, xg.flip_dims());
+                EXPECT_TRUE(GMatrixFunctions<FL>::all_close(xg, x, thrd, thrd));
+            }
+        }
+        xg.deallocate();
+        x.deallocate();
+        b.deallocate();
+        af.deallocate();
+        a.deallocate();
+        ax.deallocate();
+    }
+    EXPECT_LT(nmult_total[1], nmult_total[0]);
+}
+
 TYPED_TEST(TestMatrix, TestIDRS) {
     using FL = TypeParam;
     const int sz = is_same<FL, double>::value ? 200 : 50;
@@ -0,0 +1,117 @@
+
+#include "block2_core.hpp"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace block2;
+
+class TestProfiler : public ::testing::Test {
+  protected:
+    shared_ptr<Profiler> orig_profiler;
+    void SetUp() override {
+        orig_profiler = profiler_();
+        profiler_() = make_shared<Profiler>();
+    }
+    void TearDown() override { profiler_() = orig_profiler; }
+};
+
+TEST_F(TestProfiler, TestDisabled) {
+    {
+        ProfileScope ps("Test::disabled");
+    }
+    profiler_()->counter("Test::counter", 1);
+    EXPECT_EQ(profiler_()->size(), 0);
+}
+
+TEST_F(TestProfiler, TestNestedScopes) {
+    profiler_()->enabled = true;
+    for (int i = 0; i < 3; i++) {
+        profiler_()->site = i;
+        ProfileScope ps("Test::outer");
+        {
+            ProfileScope psi("Test::inner");
+            psi.nflop = 100;
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+        ProfileScope psx("Test::ended");
+        psx.end();
+        psx.end();
+    }
+    map<string, ProfileStats> st = profiler_()->summary();
+    ASSERT_EQ(st.size(), 3);
+    EXPECT_EQ(st["Test::outer"].count, 3);
+    EXPECT_EQ(st["Test::inner"].count, 3);
+    EXPECT_EQ(st["Test::ended"].count, 3);
+    EXPECT_EQ(st["Test::inner"].nflop, 300);
+    EXPECT_GE(st["Test::inner"].time, 6E-3);
+    EXPECT_GE(st["Test::outer"].time, st["Test::inner"].time);
+    profiler_()->clear();
+    EXPECT_EQ(profiler_()->size(), 0);
+}
+
+TEST_F(TestProfiler, TestThreads) {
+    profiler_()->enabled = true;
+    const int n_threads = 4, n_regions = 1000;
+#pragma omp parallel num_threads(n_threads)
+    for (int i = 0; i < n_regions; i++)
+        ProfileScope ps("Test::thread");
+    map<string, ProfileStats> st = profiler_()->summary();
+    size_t n_total = 0;
+    for (int it = 0; it < (int)profiler_()->buffers.size(); it++) {
+        map<string, ProfileStats> stt = profiler_()->summary(it);
+        if (stt.count("Test::thread")) {
+            EXPECT_EQ(stt["Test::thread"].count % n_regions, 0);
+            n_total += stt["Test::thread"].count;
+        }
+    }
+    EXPECT_EQ(st["Test::thread"].count, n_total);
+#ifdef _OPENMP
+    EXPECT_EQ(n_total, (size_t)n_threads * n_regions);
+#endif
+}
+
+TEST_F(TestProfiler, TestTrace) {
+    profiler_()->enabled = true;
+    profiler_()->rank = 3;
+    profiler_()->site = 5;
+    {
+        ProfileScope ps("Test::region");
+        ps.nflop = 42;
+    }
+    profiler_()->counter("Test::counter", 7);
+    stringstream ss;
+    profiler_()->write_trace_to(ss);
+    string trace = ss.str();
+    EXPECT_EQ(trace.find("{\"displayTimeUnit\""), 0);
+    EXPECT_NE(trace.find("\"name\":\"Test::region\",\"pid\":3"), string::npos);
+    EXPECT_NE(trace.find("\"ph\":\"X\""), string::npos);
+    EXPECT_NE(trace.find("\"site\":5,\"nflop\":42"), string::npos);
+    EXPECT_NE(trace.find("\"ph\":\"C\",\"args\":{\"value\":7}"),
+              string::npos);
+    EXPECT_EQ(count(trace.begin(), trace.end(), '{'),
+              count(trace.begin(), trace.end(), '}'));
+    profiler_()->trace_prefix = "PROF";
+    profiler_()->write_sweep_trace(2);
+    EXPECT_TRUE(Parsing::file_exists("PROF.SWEEP.2.RANK.3.json"));
+    EXPECT_EQ(profiler_()->size(), 0);
+    Parsing::remove_file("PROF.SWEEP.2.RANK.3.json");
+}
+
+TEST_F(TestProfiler, TestBatchGEMM) {
+    profiler_()->enabled = true;
+    const MKL_INT m = 40;
+    vector<double> a(m * m), b(m * m), c(m * m, 0.0);
+    Random::fill<double>(a.data(), a.size());
+    Random::fill<double>(b.data(), b.size());
+    shared_ptr<BatchGEMMSeq<double>> seq =
+        make_shared<BatchGEMMSeq<double>>(1LU << 30, SeqTypes::Simple);
+    seq->multiply(GMatrix<double>(a.data(), m, m), false,
+                  GMatrix<double>(b.data(), m, m), false,
+                  GMatrix<double>(c.data(), m, m), 1.0, 0.0);
+    seq->simple_perform();
+    map<string, ProfileStats> st = profiler_()->summary();
+    ASSERT_EQ(st.count("BatchGEMMSeq::simple_perform"), 1);
+    EXPECT_EQ(st["BatchGEMMSeq::simple_perform"].nflop,
+              seq->cumulative_nflop);
+    EXPECT_GT(seq->cumulative_nflop, 0);
+}
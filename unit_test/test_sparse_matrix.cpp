@@ -273,3 +273,167 @@ TYPED_TEST(TestSparseMatrix, TestComplexSplit) {
         }
     }
 }
+
+TYPED_TEST(TestSparseMatrix, TestFindState) {
+    using S = TypeParam;
+    const int min_n = StateIndex::min_n();
+    StateIndex::min_n() = 1;
+    shared_ptr<Allocator<uint32_t>> i_alloc =
+        make_shared<VectorAllocator<uint32_t>>();
+    int iter = 10, nst = 50, nq = 200;
+    for (int i = 0; i < this->n_tests; i++) {
+        shared_ptr<StateInfo<S>> ksi = this->random_state_info(
+            Random::rand_int(2, iter), Random::rand_int(4, nq),
+            Random::rand_int(4, nst));
+        shared_ptr<StateInfo<S>> ph =
+            this->random_state_info(Random::rand_int(2, iter), 4, 1);
+        shared_ptr<StateInfo<S>> bsi = make_shared<StateInfo<S>>(
+            StateInfo<S>::tensor_product(*ksi, *ph, S(S::invalid)));
+        EXPECT_NE(bsi->index, nullptr);
+        S dq = ph->quanta[Random::rand_int(0, ph->n)];
+        shared_ptr<SparseMatrixInfo<S>> minfo =
+            make_shared<SparseMatrixInfo<S>>(i_alloc);
+        minfo->initialize(*bsi, *ksi, dq, dq.is_fermion(), false);
+        if (minfo->n != 0)
+            EXPECT_NE(minfo->index, nullptr);
+        for (int j = 0; j < bsi->n + ksi->n; j++) {
+            S q = j < bsi->n ? bsi->quanta[j] : ksi->quanta[j - bsi->n];
+            auto p = lower_bound(bsi->quanta, bsi->quanta + bsi->n, q);
+            EXPECT_EQ(bsi->find_state(q),
+                      p == bsi->quanta + bsi->n || *p != q
+                          ? -1
+                          : (int)(p - bsi->quanta));
+            S mq = dq.combine(q, ksi->quanta[Random::rand_int(0, ksi->n)]);
+            p = lower_bound(minfo->quanta, minfo->quanta + minfo->n, mq);
+            const int expected = p == minfo->quanta + minfo->n || *p != mq
+                                     ? -1
+                                     : (int)(p - minfo->quanta);
+            EXPECT_EQ(minfo->find_state(mq), expected);
+            if (expected != -1) {
+                EXPECT_EQ(minfo->find_state(mq, expected), expected);
+                EXPECT_EQ(minfo->find_state(mq, expected + 1), -1);
+            }
+        }
+        // index is dropped when quanta changes
+        minfo->deallocate();
+        EXPECT_EQ(minfo->index, nullptr);
+    }
+    StateIndex::min_n() = min_n;
+}
+
+TEST(TestStateIndex, BenchmarkSAny) {
+    typedef SAny S;
+    const int n_repeat = 20;
+    // sectors of a model with particle number, 2Sz, and a Z_n symmetry
+    for (int nk : {1, 4, 16, 64}) {
+        vector<S> qs;
+        for (int n = 0; n <= 40; n++)
+            for (int twos = -n; twos <= n; twos += 2)
+                for (int k = 0; k < nk; k++) {
+                    S q = S::init_sz(n, twos, 0);
+                    q.types[3] = SAnySymmTypes::ZN + nk;
+                    q.values[3] = k;
+                    qs.push_back(q);
+                }
+        StateInfo<S> si;
+        si.allocate((int)qs.size());
+        for (int i = 0; i < si.n; i++)
+            si.quanta[i] = qs[i], si.n_states[i] = 1;
+        si.sort_states();
+        vector<S> queries(qs.begin(), qs.end());
+        for (size_t i = 0; i < queries.size(); i += 2)
+            queries[i].values[0] += 100;
+        for (size_t i = 0; i < queries.size(); i++)
+            swap(queries[i],
+                 queries[Random::rand_int((int)i, (int)queries.size())]);
+        double tx[2];
+        int64_t r[2] = {0, 0};
+        for (int ix = 0; ix < 2; ix++) {
+            if (ix == 0)
+                si.index = nullptr;
+            else
+                si.build_index();
+            Timer t;
+            t.get_time();
+            for (int k = 0; k < n_repeat; k++)
+                for (auto &q : queries)
+                    r[ix] += si.find_state(q);
+            tx[ix] = t.get_time();
+        }
+        EXPECT_EQ(r[0], r[1]);
+        cout << "N = " << setw(6) << si.n << " BSEARCH T = " << fixed
+             << setprecision(5) << tx[0] << " HASH T = " << tx[1]
+             << " SPEEDUP = " << setprecision(2) << tx[0] / tx[1] << endl;
+    }
+}
+
+TYPED_TEST(TestSparseMatrix, TestConnectionInfoCache) {
+    using S = TypeParam;
+    typedef typename SparseMatrixInfo<S>::ConnectionInfo CI;
+    shared_ptr<CG<S>> cg = make_shared<CG<S>>();
+    ConnectionInfoCache<S> cache, small_cache(1 << 12);
+    int iter = 5, nst = 10, nq = 20, n_done = 0;
+    for (int i = 0; i < this->n_tests; i++) {
+        shared_ptr<StateInfo<S>> lsi = this->random_state_info(
+            Random::rand_int(2, iter), Random::rand_int(4, nq),
+            Random::rand_int(4, nst));
+        shared_ptr<StateInfo<S>> rsi = this->random_state_info(
+            Random::rand_int(2, iter), Random::rand_int(4, nq),
+            Random::rand_int(4, nst));
+        S vacuum = (lsi->quanta[0] - lsi->quanta[0])[0];
+        S dq = (lsi->quanta[Random::rand_int(0, lsi->n)] +
+                rsi->quanta[Random::rand_int(0, rsi->n)])[0];
+        shared_ptr<SparseMatrixInfo<S>> winfo =
+            make_shared<SparseMatrixInfo<S>>();
+        winfo->initialize(*lsi, *rsi, dq, false, true);
+        if (winfo->n == 0) {
+            winfo->deallocate();
+            continue;
+        }
+        shared_ptr<SparseMatrixInfo<S>> ainfo =
+            make_shared<SparseMatrixInfo<S>>();
+        shared_ptr<SparseMatrixInfo<S>> binfo =
+            make_shared<SparseMatrixInfo<S>>();
+        ainfo->initialize(*lsi, *lsi, vacuum, false);
+        binfo->initialize(*rsi, *rsi, vacuum, false);
+        vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> ainfos = {
+            make_pair(vacuum, ainfo)};
+        vector<pair<S, shared_ptr<SparseMatrixInfo<S>>>> binfos = {
+            make_pair(vacuum, binfo)};
+        vector<pair<uint8_t, S>> subdq = {
+            make_pair(0, vacuum.combine(vacuum, -vacuum))};
+        vector<CI> cis(4);
+        cis[0].initialize_wfn(dq, dq, vacuum, subdq, ainfos, binfos, winfo,
+                              winfo, cg);
+        cache.initialize_wfn(cis[1], dq, dq, vacuum, subdq, ainfos, binfos,
+                             winfo, winfo, cg);
+        cache.initialize_wfn(cis[2], dq, dq, vacuum, subdq, ainfos, binfos,
+                             winfo, winfo, cg);
+        small_cache.initialize_wfn(cis[3], dq, dq, vacuum, subdq, ainfos,
+                                   binfos, winfo, winfo, cg);
+        EXPECT_GT(cis[0].nc, 0);
+        for (int k = 1; k < 4; k++) {
+            EXPECT_EQ(cis[k].n[4], cis[0].n[4]);
+            ASSERT_EQ(cis[k].nc, cis[0].nc);
+            EXPECT_EQ(cis[k].quanta[0], cis[0].quanta[0]);
+            for (int j = 0; j < cis[0].nc; j++) {
+                EXPECT_EQ(cis[k].stride[j], cis[0].stride[j]);
+                EXPECT_EQ(cis[k].factor[j], cis[0].factor[j]);
+                EXPECT_EQ(cis[k].ia[j], cis[0].ia[j]);
+                EXPECT_EQ(cis[k].ib[j], cis[0].ib[j]);
+                EXPECT_EQ(cis[k].ic[j], cis[0].ic[j]);
+            }
+        }
+        EXPECT_LE(small_cache.used_memory, small_cache.max_memory);
+        for (int k = 3; k >= 0; k--)
+            cis[k].deallocate();
+        binfo->deallocate();
+        ainfo->deallocate();
+        winfo->deallocate();
+        n_done++;
+    }
+    EXPECT_EQ(cache.n_hits + cache.n_misses, (size_t)n_done * 2);
+    EXPECT_GE(cache.n_hits, (size_t)n_done);
+    EXPECT_GT(small_cache.n_evictions, (size_t)0);
+    cout << cache << endl << small_cache << endl;
+}
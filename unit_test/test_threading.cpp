@@ -0,0 +1,242 @@
+
+#include "block2_core.hpp"
+#include "gtest/gtest.h"
+
+using namespace block2;
+
+class TestThreading : public ::testing::Test {
+  protected:
+    size_t isize = 1LL << 20;
+    size_t dsize = 1LL << 26;
+    shared_ptr<Threading> orig_threading;
+    void SetUp() override {
+        Random::rand_seed(0);
+        orig_threading = threading_();
+        frame_<double>() =
+            make_shared<DataFrame<double>>(isize, dsize, "nodex");
+    }
+    void TearDown() override {
+        threading_()->unpin_threads();
+        threading_() = orig_threading;
+        threading_()->activate_global();
+        frame_<double>()->activate(0);
+        frame_<double>() = nullptr;
+    }
+};
+
+TEST_F(TestThreading, TestNUMATopology) {
+    const auto &topo = Threading::numa_topology();
+    ASSERT_GE(topo.size(), 1);
+    EXPECT_EQ(Threading().get_n_sockets(), (int)topo.size());
+    for (const auto &node : topo)
+        EXPECT_TRUE(is_sorted(node.second.begin(), node.second.end()));
+    vector<int> ref = {0, 1, 2, 3, 8, 10, 11};
+    EXPECT_EQ(Threading::parse_cpu_list("0-3,8,10-11\n"), ref);
+}
+
+TEST_F(TestThreading, TestPinning) {
+    const int nt = 4;
+    threading_() = make_shared<Threading>(
+        ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global, nt, nt,
+        1);
+    threading_()->numa_pinning = true;
+    const int ntop = threading_()->activate_operator();
+    EXPECT_EQ(threading_()->pinned_threads, ntop);
+    vector<int> sockets(ntop, -2), expected(ntop);
+#pragma omp parallel num_threads(ntop)
+    {
+        int tid = threading_()->get_thread_id();
+        sockets[tid] = threading_()->get_current_socket();
+        expected[tid] = threading_()->get_thread_socket(tid);
+    }
+#ifdef __linux__
+    EXPECT_EQ(sockets, expected);
+#endif
+    // switching tasks only changes the number of threads
+    threading_()->activate_global();
+    EXPECT_EQ(threading_()->pinned_threads, ntop);
+    EXPECT_EQ(threading_()->activate_operator(), ntop);
+    EXPECT_EQ(threading_()->pinned_threads, ntop);
+    threading_()->unpin_threads();
+    EXPECT_EQ(threading_()->pinned_threads, 0);
+}
+
+TEST_F(TestThreading, TestNUMADataFrame) {
+    shared_ptr<DataFrame<double>> fr = frame_<double>();
+    vector<double> ref(100000);
+    Random::fill<double>(ref.data(), ref.size());
+    for (NUMATypes t :
+         {NUMATypes::Interleave, NUMATypes::Frames, NUMATypes::None}) {
+        fr->set_numa_policy(t);
+        EXPECT_EQ(fr->numa_type, t);
+        double *d = fr->dallocs[1]->allocate(ref.size());
+        memcpy(d, ref.data(), sizeof(double) * ref.size());
+        fr->save_data(1, fr->save_dir + "/DF.NUMA");
+        fr->reset(1);
+        fr->mmap_scratch = true;
+        fr->load_data(1, fr->save_dir + "/DF.NUMA");
+        EXPECT_EQ(memcmp(fr->dallocs[1]->data, ref.data(),
+                         sizeof(double) * ref.size()),
+                  0);
+        fr->reset(1);
+    }
+    Parsing::remove_file(fr->save_dir + "/DF.NUMA");
+}
+
+// GEMM throughput of each socket with operands on local or remote memory
+TEST_F(TestThreading, BenchmarkSocketGEMM) {
+    const auto &topo = Threading::numa_topology();
+    const int n_sockets = (int)topo.size();
+    const MKL_INT m = 384;
+    const int n_repeat = 8;
+    vector<vector<double>> mats(n_sockets);
+    // first touch on each socket
+    for (int s = 0; s < n_sockets; s++) {
+        thread th([&mats, &topo, s]() {
+            Threading::set_thread_affinity(topo[s].second);
+            mats[s].resize(3 * m * m);
+            Random::fill<double>(mats[s].data(), mats[s].size());
+        });
+        th.join();
+    }
+    for (int s = 0; s < n_sockets; s++)
+        for (int ms = 0; ms < n_sockets; ms++) {
+            if (ms != s && ms != (s + 1) % n_sockets)
+                continue;
+            double tgemm = 0;
+            thread th([&]() {
+                Threading::set_thread_affinity(topo[s].second);
+                GMatrix<double> a(mats[ms].data(), m, m);
+                GMatrix<double> b(mats[ms].data() + m * m, m, m);
+                GMatrix<double> c(mats[ms].data() + 2 * m * m, m, m);
+                GMatrixFunctions<double>::multiply(a, false, b, false, c, 1.0,
+                                                   0.0);
+                Timer t;
+                t.get_time();
+                for (int i = 0; i < n_repeat; i++)
+                    GMatrixFunctions<double>::multiply(a, false, b, false, c,
+                                                       1.0, 0.0);
+                tgemm = t.get_time();
+            });
+            th.join();
+            double gflops = 2.0 * m * m * m * n_repeat / tgemm / 1E9;
+            cout << "SOCKET " << s << " (" << topo[s].second.size()
+                 << " cpus) MEMORY ON SOCKET " << ms << " : " << fixed
+                 << setprecision(3) << gflops << " GFLOP/S" << endl;
+            EXPECT_GT(gflops, 0.0);
+        }
+}
+
+TEST_F(TestThreading, TestTaskScheduler) {
+    const int nt = 4;
+    for (size_t n : {(size_t)0, (size_t)1, (size_t)3, (size_t)1000}) {
+        vector<uint64_t> costs(n);
+        for (size_t i = 0; i < n; i++)
+            costs[i] = i % 17 == 0 ? 10000 : Random::rand_int(0, 100);
+        vector<int> counts(n, 0);
+        TaskScheduler::run(nt, n, costs, [&counts](int tid, size_t i) {
+#pragma omp atomic
+            counts[i]++;
+        });
+        for (size_t i = 0; i < n; i++)
+            ASSERT_EQ(counts[i], 1);
+    }
+    // initial assignment balances the total cost
+    vector<uint64_t> costs = {100, 1, 1, 1, 1, 40, 30, 30};
+    TaskScheduler sched(2, costs.size(), costs);
+    EXPECT_EQ(sched.queues[0].remaining + sched.queues[1].remaining, 204);
+    EXPECT_EQ(sched.queues[0].tasks[0], 0);
+    EXPECT_EQ(sched.queues[0].remaining, 102);
+    EXPECT_EQ(sched.queues[1].remaining, 102);
+    // an idle thread steals the cheapest tasks from the busiest thread
+    size_t task;
+    ASSERT_TRUE(sched.pop(0, task));
+    EXPECT_EQ(task, 0);
+    ASSERT_TRUE(sched.steal(0, task));
+    EXPECT_EQ(costs[task], 1);
+    EXPECT_EQ(sched.n_steals, 1);
+}
+
+TEST_F(TestThreading, TestTaskCosts) {
+    const int nt = 4;
+    threading_() = make_shared<Threading>(
+        ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global, nt, nt,
+        1);
+    threading_()->work_stealing = true;
+    vector<uint64_t> costs = threading_()->task_costs(
+        (size_t)64, [](size_t i) { return i == 0 ? (uint64_t)64 : 1; });
+    ASSERT_EQ(costs.size(), 64);
+    vector<int> owner(64, -1);
+    TaskScheduler::run(nt, costs.size(), costs,
+                       [&owner](int tid, size_t i) { owner[i] = tid; });
+    for (auto x : owner)
+        EXPECT_GE(x, 0);
+    threading_()->work_stealing = false;
+    EXPECT_EQ(threading_()->task_costs((size_t)64, [](size_t i) { return 1; })
+                  .size(),
+              0);
+}
+
+TEST_F(TestThreading, TestActivationCache) {
+    const int nt = 4;
+    threading_() = make_shared<Threading>(
+        ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global, nt, nt,
+        1);
+    threading_()->activate_operator();
+    size_t ncalls = Threading::n_library_calls();
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(threading_()->activate_operator(), nt);
+    EXPECT_EQ(Threading::n_library_calls(), ncalls);
+    EXPECT_EQ(threading_()->activate_global(), nt);
+#ifdef _OPENMP
+    EXPECT_EQ(omp_get_max_threads(), nt);
+    // settings changed outside are detected for OpenMP
+    omp_set_num_threads(1);
+    threading_()->activate_global();
+    EXPECT_EQ(omp_get_max_threads(), nt);
+#endif
+    threading_()->cache_activation = false;
+    ncalls = Threading::n_library_calls();
+    threading_()->activate_operator();
+    EXPECT_GT(Threading::n_library_calls(), ncalls);
+}
+
+// cost of switching between threading modes, with and without caching
+TEST_F(TestThreading, BenchmarkActivation) {
+    const int nt = 4, n_repeat = 100000;
+    threading_() = make_shared<Threading>(
+        ThreadingTypes::OperatorBatchedGEMM | ThreadingTypes::Global, nt, nt,
+        1);
+    for (bool cache : {false, true}) {
+        threading_()->cache_activation = cache;
+        size_t ncalls = Threading::n_library_calls();
+        Timer t;
+        t.get_time();
+        for (int i = 0; i < n_repeat; i++) {
+            threading_()->activate_normal();
+            threading_()->activate_normal();
+        }
+        double tsame = t.get_time();
+        for (int i = 0; i < n_repeat; i++) {
+            threading_()->activate_global();
+            threading_()->activate_normal();
+        }
+        double tswitch = t.get_time();
+        int ntop = threading_()->activate_operator();
+        size_t nx = 0;
+        for (int i = 0; i < n_repeat / 10; i++) {
+            threading_()->activate_operator();
+#pragma omp parallel num_threads(ntop) reduction(+ : nx)
+            nx += threading_()->activate_quanta();
+            threading_()->activate_normal();
+        }
+        double tregion = t.get_time();
+        EXPECT_EQ(nx, (size_t)ntop * (n_repeat / 10));
+        cout << "CACHE = " << cache << " SAME = " << fixed << setprecision(1)
+             << tsame / (2 * n_repeat) * 1E9
+             << " ns SWITCH = " << tswitch / (2 * n_repeat) * 1E9
+             << " ns REGION = " << tregion / (n_repeat / 10) * 1E9
+             << " ns LIBCALLS = " << Threading::n_library_calls() - ncalls
+             << endl;
+    }
+}